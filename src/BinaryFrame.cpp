@@ -0,0 +1,200 @@
+#include "KinectToJSON.h"
+
+// forward declare of non-external functions
+INT16 quantizeValue(float value, float scale);
+
+/**
+ * Write a frame in the binary format, which carries the same data as the JSON.  Buffer must be at least FRAME_BINARY_SZ.
+ * @param quantize - when true, locations & rotations are stored as 16 bit ints, roughly halving the size.
+ * @returns the number of bytes written.
+ */
+int serializeFrameBinary(const FRAME_DATA *frame, char *buffer, bool quantize) {
+	return serializeProjectedBinary(frame, getFullProjection(), buffer, quantize);
+}
+
+/**
+ * As serializeFrameBinary(), with only the values the projection sends of each joint.  Joint & hand states are always
+ * sent, as they are in the fixed size body record, & decimals are only of JSON.  A resampled frame is marked
+ * BINARY_RESAMPLED, & its timeUs follows the header.  Unless every location & rotation is sent, the frame is marked
+ * BINARY_PROJECTED, & says which follow.
+ */
+int serializeProjectedBinary(const FRAME_DATA *frame, const PROJECTION *projection, char *buffer, bool quantize) {
+	const int VALUES = ProjectionField_Location | ProjectionField_Rotation;
+	bool projected = projection->jointMask != PROJECTION_ALL_JOINTS || (projection->fields & VALUES) != VALUES;
+
+	BINARY_HEADER *header = (BINARY_HEADER *) buffer;
+	memcpy(header->magic, BINARY_MAGIC, sizeof(header->magic));
+	header->version = BINARY_VERSION;
+	header->flags = (quantize ? BINARY_QUANTIZED : 0) | (projected ? BINARY_PROJECTED : 0) | (frame->resampled ? BINARY_RESAMPLED : 0);
+	header->bodyCount = (BYTE) frame->bodyCount;
+	header->frame = frame->frame;
+	header->cameraHeight = frame->cameraHeight;
+	header->clipPlane[0] = frame->clipPlane.x;
+	header->clipPlane[1] = frame->clipPlane.y;
+	header->clipPlane[2] = frame->clipPlane.z;
+	header->clipPlane[3] = frame->clipPlane.w;
+
+	char *out = buffer + sizeof(BINARY_HEADER);
+	if (frame->resampled) {
+		BINARY_TIME *time = (BINARY_TIME *) out;
+		time->timeUs = frame->timeUs;
+		out += sizeof(BINARY_TIME);
+	}
+	if (projected) {
+		BINARY_PROJECTION *sent = (BINARY_PROJECTION *) out;
+		memset(sent, 0, sizeof(BINARY_PROJECTION));
+		sent->jointMask = projection->jointMask;
+		sent->fields = (BYTE) projection->fields;
+		out += sizeof(BINARY_PROJECTION);
+	}
+
+	for (int b = 0; b < frame->bodyCount; b++) {
+		const BODY_DATA *body = &frame->bodies[b];
+		const char *base = (const char *) body;
+
+		BINARY_BODY *record = (BINARY_BODY *) out;
+		memset(record, 0, sizeof(BINARY_BODY));
+		record->id = body->id;
+		record->leftHandState = (BYTE) body->leftHandState;
+		record->rightHandState = (BYTE) body->rightHandState;
+		for (unsigned int i = 0; i < JointType_Count; i++) {
+			record->jointStates[i] = (BYTE) body->joints[i].TrackingState;
+		}
+		out += sizeof(BINARY_BODY);
+
+		// each run in the order of the projection, which for a full one is location then rotation of every joint
+		if (quantize) {
+			for (int r = 0; r < projection->nRuns; r++) {
+				const float *values = (const float *) (base + projection->runOffsets[r]);
+				INT16 *quantized = (INT16 *) out;
+				for (int i = 0; i < projection->runLengths[r]; i++) quantized[i] = quantizeValue(values[i], projection->runScales[r]);
+				out += projection->runLengths[r] * sizeof(INT16);
+			}
+
+		} else {
+			// each a copy of a fixed size, so a single move, of a location's 3 floats or a rotation's 4
+			for (int r = 0; r < projection->nRuns; r++) {
+				if (projection->runLengths[r] == 4) memcpy(out, base + projection->runOffsets[r], 4 * sizeof(float));
+				else memcpy(out, base + projection->runOffsets[r], 3 * sizeof(float));
+				out += projection->runLengths[r] * sizeof(float);
+			}
+		}
+	}
+	return (int) (out - buffer);
+}
+
+/**
+ * The runs of values of each body a projection sends in the binary format, in order.
+ */
+void compileBinaryValues(PROJECTION *projection) {
+	projection->nRuns = 0;
+
+	for (unsigned int j = 0; j < JointType_Count; j++) {
+		if ((projection->jointMask & (1u << j)) == 0) continue;
+
+		if (projection->fields & ProjectionField_Location) {
+			projection->runOffsets[projection->nRuns] = (int) (offsetof(BODY_DATA, joints) + j * sizeof(Joint) + offsetof(Joint, Position));
+			projection->runLengths[projection->nRuns] = 3;
+			projection->runScales[projection->nRuns++] = BINARY_LOCATION_SCALE;
+		}
+		if (projection->fields & ProjectionField_Rotation) {
+			projection->runOffsets[projection->nRuns] = (int) (offsetof(BODY_DATA, rotations) + j * sizeof(JointOrientation) + offsetof(JointOrientation, Orientation));
+			projection->runLengths[projection->nRuns] = 4;
+			projection->runScales[projection->nRuns++] = BINARY_ROTATION_SCALE;
+		}
+	}
+}
+
+/**
+ * Reference decoder of the binary format, back to the FRAME_DATA it was written from.  Quantized frames come back to
+ * within half a step of the scale of each value.  Values a projected frame did not send are zero, as are timeUs, unless
+ * resampled, & relativeTime, which is never sent.
+ * @returns E_INVALIDARG when the buffer is not a complete frame of a known version.
+ */
+HRESULT decodeFrameBinary(const char *buffer, int len, FRAME_DATA *frame) {
+	if (len < (int) sizeof(BINARY_HEADER)) return E_INVALIDARG;
+
+	const BINARY_HEADER *header = (const BINARY_HEADER *) buffer;
+	if (memcmp(header->magic, BINARY_MAGIC, sizeof(header->magic)) != 0 || header->version != BINARY_VERSION) {
+		return E_INVALIDARG;
+	}
+
+	bool quantized = (header->flags & BINARY_QUANTIZED) != 0;
+	const char *in = buffer + sizeof(BINARY_HEADER);
+	frame->resampled = (header->flags & BINARY_RESAMPLED) != 0;
+	frame->timeUs = 0;
+	frame->relativeTime = 0;
+	if (frame->resampled) {
+		if (len < (int) (in - buffer + sizeof(BINARY_TIME))) return E_INVALIDARG;
+
+		frame->timeUs = ((const BINARY_TIME *) in)->timeUs;
+		in += sizeof(BINARY_TIME);
+	}
+
+	UINT32 jointMask = PROJECTION_ALL_JOINTS;
+	bool locations = true;
+	bool rotations = true;
+	if (header->flags & BINARY_PROJECTED) {
+		if (len < (int) (in - buffer + sizeof(BINARY_PROJECTION))) return E_INVALIDARG;
+
+		const BINARY_PROJECTION *sent = (const BINARY_PROJECTION *) in;
+		jointMask = sent->jointMask;
+		locations = (sent->fields & ProjectionField_Location) != 0;
+		rotations = (sent->fields & ProjectionField_Rotation) != 0;
+		in += sizeof(BINARY_PROJECTION);
+	}
+
+	int nJoints = 0;
+	for (unsigned int i = 0; i < JointType_Count; i++) nJoints += (jointMask >> i) & 1;
+	int valueSz = quantized ? sizeof(INT16) : sizeof(float);
+	int jointSz = ((locations ? 3 : 0) + (rotations ? 4 : 0)) * valueSz;
+	int bodySz = sizeof(BINARY_BODY) + nJoints * jointSz;
+	if (header->bodyCount > BODY_COUNT || len < (int) (in - buffer) + header->bodyCount * bodySz) {
+		return E_INVALIDARG;
+	}
+
+	frame->bodyCount = header->bodyCount;
+	frame->frame = header->frame;
+	frame->cameraHeight = header->cameraHeight;
+	frame->clipPlane.x = header->clipPlane[0];
+	frame->clipPlane.y = header->clipPlane[1];
+	frame->clipPlane.z = header->clipPlane[2];
+	frame->clipPlane.w = header->clipPlane[3];
+	frame->nBones = 0; // JSON only
+
+	for (int b = 0; b < frame->bodyCount; b++) {
+		BODY_DATA *body = &frame->bodies[b];
+
+		const BINARY_BODY *record = (const BINARY_BODY *) in;
+		body->id = record->id;
+		body->leftHandState = (HandState) record->leftHandState;
+		body->rightHandState = (HandState) record->rightHandState;
+		in += sizeof(BINARY_BODY);
+
+		for (unsigned int i = 0; i < JointType_Count; i++) {
+			Joint &joint = body->joints[i];
+			Vector4 &orientation = body->rotations[i].Orientation;
+			joint.JointType = (JointType) i;
+			joint.TrackingState = (TrackingState) record->jointStates[i];
+			body->rotations[i].JointType = (JointType) i;
+			joint.Position = { 0, 0, 0 };
+			orientation = { 0, 0, 0, 0 };
+			if ((jointMask & (1u << i)) == 0) continue;
+
+			float *values[7] = { &joint.Position.X, &joint.Position.Y, &joint.Position.Z, &orientation.x, &orientation.y, &orientation.z, &orientation.w };
+			for (int v = locations ? 0 : 3; v < (rotations ? 7 : 3); v++) {
+				float scale = v < 3 ? BINARY_LOCATION_SCALE : BINARY_ROTATION_SCALE;
+				*values[v] = quantized ? ((const INT16 *) in)[0] / scale : ((const float *) in)[0];
+				in += valueSz;
+			}
+		}
+	}
+	return S_OK;
+}
+
+INT16 quantizeValue(float value, float scale) {
+	float scaled = std::nearbyint(value * scale);
+	if (scaled > 32767.0f) return 32767;
+	if (scaled < -32768.0f) return -32768;
+	return (INT16) scaled;
+}
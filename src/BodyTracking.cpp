@@ -1,18 +1,27 @@
 #include "KinectToJSON.h"
 
 // forward declare of non-external functions
+HRESULT startBodyTracking(void(*cb)(char *), void(*binaryCb)(char *, int), void(*leasedCb)(char *, int), SHARED_FRAME *sharedBuffer,
+	bool binary, bool quantize);
 void bodyReaderThreadLoop();
-void processBodies(const unsigned int &bodyCount, IBody **bodies, const Vector4 clipPlane);
-bool detectTPose(UINT64 bodyId, Joint *joints);
-bool isBodyRolling(UINT64 bodyId);
-void setBodyRolling(UINT64 bodyId);
-int formatVector(const CameraSpacePoint Position, const int idx);
-int formatQuaternion(const Vector4 Orientation, const int idx);
+void processBodies(const FRAME_DATA *sensorFrame);
+HRESULT acquireBodies(FRAME_DATA *sensorFrame);
+void sensorFrameRead(const FRAME_DATA *sensorFrame);
+bool extractBodies(const FRAME_DATA *sensorFrame, FRAME_DATA *extracted, DELTA_FRAME *deltaFrame);
+bool countChange(ChangeResult change);
+int serializeBodies(const FRAME_DATA *extracted, const DELTA_FRAME *deltaFrame, char *buffer);
+void deliverBodies(const FRAME_DATA *extracted, char *buffer, int len);
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 // file scope variables
-IBodyFrameReader *bodyFrameReader = nullptr;
 void (*applicationCallback)(char *) = nullptr;
+void (*binaryCallback)(char *, int) = nullptr; // only one of the callbacks, or the queue, is used for a tracking session
+void (*leasedCallback)(char *, int) = nullptr;
+bool polled = false;
+bool shared = false;
+bool binaryOutput = false;
+bool binaryQuantized = false;
+bool deltaOutput = false;
 CONFIG localConfig; // copy of main's; assigned when locked for thread safe transfer
 
 // the XZ location of the SpinBase Joint of the first frame of the first body recorded; all locations offset by,
@@ -20,25 +29,73 @@ CONFIG localConfig; // copy of main's; assigned when locked for thread safe tran
 CameraSpacePoint rootXZBasis;
 
 bool rolling = false; // has any frames been returned
-UINT64 rollingBodies[] = { 0, 0, 0, 0, 0 }; // the body ids that have passed the t-pose test, if using
+PoseMatcher poseMatcher; // which bodies have passed the t-pose test, if using, or any other poses loaded
 int nBodies = 0; // used to beep when value changed
 
 int frame = 0;
 bool clipPlaneEval = false; // used to print the height of the first non-zero reading of camera height, floor clip pane W
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-// threading, and mutex for sharing applicationCallback & config across threads
+// threading; the callbacks & config are only assigned before the thread is started, so need no lock
 std::thread bodyThread;
-std::mutex mu;
+std::atomic<bool> tracking(false);
+
+// frames waiting for pollFrame() / waitFrame(), when tracking was begun with beginBodyTrackingPolled()
+#define FRAME_QUEUE_SLOTS 8
+FrameQueue frameQueue(FRAME_QUEUE_SLOTS, FRAME_JSON_SZ);
+
+// buffers the application holds till releaseFrame(), when tracking was begun with beginBodyTrackingLeased()
+FramePool framePool(FRAME_POOL_BUFFERS, FRAME_POOL_BUFFER_SZ);
+
+// the caller's buffer, when tracking was begun with beginBodyTrackingShared()
+SharedFrameWriter sharedWriter;
+
+// only what changed since last sent, when setDeltaMode() has been called with a keyframe interval
+DELTA_CONFIG deltaConfig = { 0, 0, 0 };
+DeltaEncoder deltaEncoder;
+DELTA_FRAME delta;
+
+// frames at a steady rate in place of the source's, when setResampling() has been called with a rate
+int resampleHz = 0;
+ResampleMode resampleMode = ResampleMode_Interpolate;
+ResamplingFrameSource resampler;
+FrameSource *bodySource = nullptr; // frameSource, or the resampler reading it
+
+// what of each body is sent, from setProjection(); every joint & field until then
+PROJECTION projection = *getFullProjection();
+
+// bones solved for each body, from loadRig(); none until then
+RIG rig;
+RIG_JOINTS rigJoints;
+RIG_ROTATIONS rigRotations;
+
+// the last frames of each body, with the motion of its joints; predicted & smoothed, from setMotionPrediction()
+MOTION_CONFIG motionConfig = { 0, MotionFilter_None, 0, 0 };
+MotionHistory motionHistory;
+
+// frames the same as the last not sent, but for a heartbeat, from setChangeDetection()
+CHANGE_CONFIG changeConfig = { false, 0 };
+ChangeDetector changeDetector;
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-// storage for json
-#define BUF_SZ 10000
-char json[BUF_SZ];
+// storage for the frame as read, after transforms, & its json or binary, when not pipelined; sized for 6 fully tracked
+// bodies, & binary is always smaller than JSON
+FRAME_DATA inFrame;
+FRAME_DATA outFrame;
+char output[FRAME_JSON_SZ];
+JOINT_SOA jointsSoA; // the joints of the frame being extracted, while being transformed
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// the stages on threads of their own, unless setPipelineWorkers(0)
+const PIPELINE_STAGES BODY_STAGES = { &acquireBodies, &extractBodies, &serializeBodies, &deliverBodies };
+FramePipeline pipeline(PIPELINE_SLOTS);
+int pipelineWorkers = PIPELINE_DEFAULT_WORKERS;
+bool pipelined = false;
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 // vars from main.cpp
-extern IKinectSensor *sensor;
+extern FrameSource *frameSource;
+extern MultiFrameSource *multiSource;
 extern CONFIG config;
 
 // constants, in the order reported by body frame reader
@@ -86,6 +143,18 @@ const char *JOINT_NAMES[] = {
 	HAND_TIP_RIGHT, THUMB_RIGHT
 };
 
+// the joint each is attached to, toward SpineBase, the root, which is its own; the bones of the SDK's BodyBasics sample
+const JointType JOINT_PARENTS[] = {
+	JointType_SpineBase, JointType_SpineBase, JointType_SpineShoulder, JointType_Neck,
+	JointType_SpineShoulder, JointType_ShoulderLeft, JointType_ElbowLeft, JointType_WristLeft,
+	JointType_SpineShoulder, JointType_ShoulderRight, JointType_ElbowRight, JointType_WristRight,
+	JointType_SpineBase, JointType_HipLeft, JointType_KneeLeft, JointType_AnkleLeft,
+	JointType_SpineBase, JointType_HipRight, JointType_KneeRight, JointType_AnkleRight,
+	JointType_SpineMid,
+	JointType_HandLeft, JointType_WristLeft,
+	JointType_HandRight, JointType_WristRight
+};
+
 const char NOT_TRACKED[] = "Not Tracked"; // used for both join & hand states
 const char INFERRED[] = "Inferred";
 const char TRACKED[] = "Tracked";
@@ -102,42 +171,319 @@ const char *HAND_STATES[] = { UNKNOWN, NOT_TRACKED, OPEN, CLOSED, LASSO };
  * @param cb - The callback function which is passed the JSON as an argument.
  */
 DllExport HRESULT beginBodyTracking( void (*cb)(char *) ) {
+	if (cb == nullptr) return E_POINTER;
+
+	return startBodyTracking(cb, nullptr, nullptr, nullptr, false, false);
+}
+
+/**
+ * Begin tracking up to 6 bodies, delivering the compact binary format of BinaryFrame.cpp instead of JSON.
+ * @param cb - The callback function which is passed the frame & its length in bytes.
+ * @param quantize - anything other than \0, stores locations & rotations as 16 bit ints instead of floats.
+ */
+DllExport HRESULT beginBodyTrackingBinary( void (*cb)(char *, int), char quantize ) {
+	if (cb == nullptr) return E_POINTER;
+
+	return startBodyTracking(nullptr, cb, nullptr, nullptr, true, quantize != '\0');
+}
+
+/**
+ * Begin tracking up to 6 bodies, queueing frames for pollFrame() or waitFrame(), instead of calling back.  The sensor
+ * thread never waits on the application, unless told to block.
+ * @param JSON_Binary_or_Quantized - J for JSON, B for the binary format, or Q for binary with 16 bit ints
+ * @param Drop_or_Block - D to overwrite the oldest frame when the application falls behind, or B to wait for it
+ */
+DllExport HRESULT beginBodyTrackingPolled( char JSON_Binary_or_Quantized, char Drop_or_Block ) {
+	if (tracking) return E_ABORT;
+
+	frameQueue.open(Drop_or_Block != 'B');
+	bool binary = JSON_Binary_or_Quantized == 'B' || JSON_Binary_or_Quantized == 'Q';
+	HRESULT hr = startBodyTracking(nullptr, nullptr, nullptr, nullptr, binary, JSON_Binary_or_Quantized == 'Q');
+	if (FAILED(hr)) frameQueue.close();
+
+	return hr;
+}
+
+/**
+ * Copy the oldest waiting frame into buffer, without waiting.  JSON frames include the terminating null.
+ * @returns the length of the frame, 0 when there is none, or minus the size needed when bufferLen is too small.
+ */
+DllExport int pollFrame(char *buffer, int bufferLen) {
+	return frameQueue.pop(buffer, bufferLen);
+}
+
+/**
+ * As pollFrame(), but waits up to timeoutMillis for a frame, returning early when tracking ends.
+ */
+DllExport int waitFrame(char *buffer, int bufferLen, int timeoutMillis) {
+	return frameQueue.wait(buffer, bufferLen, timeoutMillis);
+}
+
+/**
+ * Counts of frames queued, delivered, & overwritten since beginBodyTrackingPolled().
+ */
+DllExport HRESULT getFrameQueueStats(FRAME_QUEUE_STATS *stats) {
+	if (stats == nullptr) return E_POINTER;
+
+	frameQueue.getStats(stats);
+	return S_OK;
+}
+
+/**
+ * Begin tracking up to 6 bodies, passing each frame in a buffer the application keeps till it calls releaseFrame(), so
+ * it can be read after the callback returns, e.g. on another thread, without copying it first.  Buffers are recycled,
+ * never allocated per frame.  With all of them still held, frames are dropped, & counted, till one is released.
+ * @param cb - The callback function which is passed the frame & its length in bytes; JSON includes the terminating null.
+ * @param JSON_Binary_or_Quantized - J for JSON, B for the binary format, or Q for binary with 16 bit ints
+ */
+DllExport HRESULT beginBodyTrackingLeased( void (*cb)(char *, int), char JSON_Binary_or_Quantized ) {
+	if (tracking) return E_ABORT;
+	if (cb == nullptr) return E_POINTER;
+
+	framePool.open();
+	bool binary = JSON_Binary_or_Quantized == 'B' || JSON_Binary_or_Quantized == 'Q';
+	return startBodyTracking(nullptr, nullptr, cb, nullptr, binary, JSON_Binary_or_Quantized == 'Q');
+}
+
+/**
+ * Give back a frame of beginBodyTrackingLeased(), once done with it.  Can be called from any thread, while tracking or
+ * after.
+ * @returns E_INVALIDARG when not a frame leased, or already released
+ */
+DllExport HRESULT releaseFrame(char *buffer) {
+	return framePool.release(buffer);
+}
+
+/**
+ * Counts of frames leased, released, & dropped with every buffer held, since beginBodyTrackingLeased().
+ */
+DllExport HRESULT getFramePoolStats(FRAME_POOL_STATS *stats) {
+	if (stats == nullptr) return E_POINTER;
+
+	framePool.getStats(stats);
+	return S_OK;
+}
+
+/**
+ * Begin tracking up to 6 bodies, writing each frame into buffer in place, instead of formatting it.  Nothing is parsed
+ * or copied by the caller; numpy can view the joints as a bodies x joints x 8 array of floats.  Frames with no bodies
+ * are written too, so the buffer is always the latest frame.
+ * @param buffer - owned by the caller, & must stay valid until endBodyTracking()
+ * @param bufferLen - sizeof(SHARED_FRAME), to catch a caller with a different layout
+ */
+DllExport HRESULT beginBodyTrackingShared( SHARED_FRAME *buffer, int bufferLen ) {
+	if (tracking) return E_ABORT;
+	if (buffer == nullptr) return E_POINTER;
+	if (bufferLen != sizeof(SHARED_FRAME)) return E_INVALIDARG;
+
+	sharedWriter.open(buffer);
+	HRESULT hr = startBodyTracking(nullptr, nullptr, nullptr, buffer, false, false);
+	if (FAILED(hr)) sharedWriter.close();
+
+	return hr;
+}
+
+/**
+ * Sleep until a frame after sequence is in the buffer of beginBodyTrackingShared(), returning early when tracking ends.
+ * @returns the sequence of the latest whole frame, which is sequence when none arrived in time.
+ */
+DllExport UINT32 waitSharedFrame(UINT32 sequence, int timeoutMillis) {
+	return sharedWriter.wait(sequence, timeoutMillis);
+}
+
+/**
+ * Run the stages of tracking begun after this on threads of their own, with this many threads serializing, so a slow
+ * frame or callback does not hold up reading the next frame.  Frames are still delivered in order.
+ * @param nWorkers - 0 to run every stage on the one thread, one frame at a time
+ */
+DllExport HRESULT setPipelineWorkers(int nWorkers) {
+	if (tracking) return E_ABORT;
+	if (nWorkers < 0 || nWorkers > PIPELINE_MAX_WORKERS) return E_INVALIDARG;
+
+	pipelineWorkers = nWorkers;
+	return S_OK;
+}
+
+/**
+ * Deliver frames at a steady rate, timed by the sensor's RelativeTime, for tracking begun after this.  Each frame also
+ * has its time since the first, as timeUs.
+ * @param hz - frames per second, or 0 for every frame of the sensor, as it arrives
+ * @param Interpolate_or_Decimate - I to interpolate between the sensor's frames, or D for the nearest of them
+ */
+DllExport HRESULT setResampling(int hz, char Interpolate_or_Decimate) {
+	if (tracking) return E_ABORT;
+	if (hz < 0 || hz > RESAMPLE_MAX_HZ) return E_INVALIDARG;
+
+	resampleHz = hz;
+	resampleMode = Interpolate_or_Decimate == 'D' ? ResampleMode_Decimate : ResampleMode_Interpolate;
+	return S_OK;
+}
+
+/**
+ * Replace the poses checked for every body, for tracking begun after this.  Bodies held in a start pose are sent from
+ * then on, till held in a stop pose; marker poses only make an event.  The T pose of openSensor is used when starting,
+ * & no start pose is loaded.  See the README for the format.
+ * @param templates - one pose a line, or nullptr for none
+ */
+DllExport HRESULT loadPoseTemplates(const char *templates) {
+	if (tracking) return E_ABORT;
+
+	return poseMatcher.load(templates);
+}
+
+/**
+ * Copy the pose events since last polled into buffer, as a JSON array.
+ * @returns as pollFrame()
+ */
+DllExport int pollPoseEvents(char *buffer, int bufferLen) {
+	return poseMatcher.pollEvents(buffer, bufferLen);
+}
+
+/**
+ * Send only some joints, or fields of them, for tracking begun after this.  Applies to JSON, delta mode & the binary
+ * format, but not the shared frame.  See the README for the format.
+ * @param spec - e.g. "joints: Head HandLeft HandRight; fields: location hands; decimals: 2", or nullptr for everything
+ */
+DllExport HRESULT setProjection(const char *spec) {
+	if (tracking) return E_ABORT;
+
+	// parsed aside, as a projection is over 10 KB, & left as it was when the spec is not understood
+	static PROJECTION parsed;
+	HRESULT hr = parseProjection(spec, &parsed);
+	if (SUCCEEDED(hr)) projection = parsed;
+	return hr;
+}
+
+/**
+ * Solve the bones of a rig from the joints of each body, for tracking begun after this.  Sent as the bones of each
+ * body, a rotation local to its parent for each bone in the order defined.  JSON & delta mode only.  See the README for
+ * the format.
+ * @param definition - one bone a line, or nullptr for none
+ */
+DllExport HRESULT loadRig(const char *definition) {
+	if (tracking) return E_ABORT;
+
+	return parseRig(definition, &rig);
+}
+
+/**
+ * Send each joint smoothed, & where it is predicted to be ahead of the frame, to hide the latency of the sensor & of
+ * drawing it, for tracking begun after this.  Only locations; rotations are sent as they are.  Applies to every format.
+ * @param leadMillis - after the sensor's frame, up to 200, or 0 for where the joints are
+ * @param None_OneEuro_or_Double - N for the frames as measured, O for a One-Euro filter, or D for double exponential
+ * @param smoothing - One-Euro, the cutoff in Hz at rest, e.g. 1; double exponential, alpha, 0 to 1, e.g. 0.5
+ * @param beta - One-Euro, Hz the cutoff rises per m/s, e.g. 30; double exponential, of the trend, 0 to 1, e.g. 0.4
+ */
+DllExport HRESULT setMotionPrediction(int leadMillis, char None_OneEuro_or_Double, float smoothing, float beta) {
+	if (tracking) return E_ABORT;
+	if (leadMillis < 0 || leadMillis > MOTION_MAX_LEAD_MILLIS) return E_INVALIDARG;
+
+	MotionFilter filter = None_OneEuro_or_Double == 'O' ? MotionFilter_OneEuro : None_OneEuro_or_Double == 'D' ? MotionFilter_Double : MotionFilter_None;
+	if (filter == MotionFilter_OneEuro && !(smoothing > 0 && beta >= 0)) return E_INVALIDARG;
+	if (filter == MotionFilter_Double && !(smoothing > 0 && smoothing <= 1 && beta > 0 && beta <= 1)) return E_INVALIDARG;
+
+	motionConfig.leadMillis = leadMillis;
+	motionConfig.filter = filter;
+	motionConfig.smoothing = smoothing;
+	motionConfig.beta = beta;
+	return S_OK;
+}
+
+/**
+ * Copy the last frames of a body, as sent but before any prediction, with the velocity & acceleration of each joint.
+ * Can be called from any thread, while tracking or after.
+ * @returns S_FALSE when the id has not been seen, or has been forgotten for newer ones
+ */
+DllExport HRESULT getBodyMotion(UINT64 id, BODY_MOTION *motion) {
+	return motionHistory.read(id, motion);
+}
+
+/**
+ * Skip a frame whose bodies are the same as the last frame's, in everything sent of them, for tracking begun after
+ * this, as when everyone holds still, or the sensor repeats itself.  Compared before any transform, so a skipped frame
+ * costs next to nothing; with setMotionPrediction(), compared once predicted, as the joints sent then move until the
+ * motion settles.  Applies to every format.
+ * @param skipUnchanged - anything other than \0, is true
+ * @param heartbeatMillis - of the sensor's time, an unchanged frame is still sent at least this often, so the consumer
+ * knows the stream is alive; 0 for none
+ */
+DllExport HRESULT setChangeDetection(char skipUnchanged, int heartbeatMillis) {
+	if (tracking) return E_ABORT;
+	if (heartbeatMillis < 0 || heartbeatMillis > CHANGE_MAX_HEARTBEAT_MILLIS) return E_INVALIDARG;
+
+	changeConfig.skipUnchanged = skipUnchanged != '\0';
+	changeConfig.heartbeatMillis = heartbeatMillis;
+	return S_OK;
+}
+
+/**
+ * Send only joints which moved, between keyframes of every joint, for tracking begun after this.  JSON only.
+ * @param keyframeInterval - frames sent between keyframes, or 0 to send every joint of every frame
+ * @param locationEpsilon - meters a joint must move, since last sent, to be sent again
+ * @param rotationEpsilon - change of any quaternion component, since last sent, for a joint to be sent again
+ */
+DllExport HRESULT setDeltaMode(int keyframeInterval, float locationEpsilon, float rotationEpsilon) {
+	if (tracking) return E_ABORT;
+	if (keyframeInterval < 0 || !(locationEpsilon >= 0) || !(rotationEpsilon >= 0)) return E_INVALIDARG;
+
+	deltaConfig.keyframeInterval = keyframeInterval;
+	deltaConfig.locationEpsilon = locationEpsilon;
+	deltaConfig.rotationEpsilon = rotationEpsilon;
+	return S_OK;
+}
+
+HRESULT startBodyTracking(void(*cb)(char *), void(*binaryCb)(char *, int), void(*leasedCb)(char *, int), SHARED_FRAME *sharedBuffer,
+	bool binary, bool quantize) {
+	// one session at a time; the thread & pipeline of the one running cannot be restarted under it
+	if (tracking) return E_ABORT;
+
 	// openSensor must have successfully been called first
-	if (sensor == nullptr) {
+	if (frameSource == nullptr) {
 		std::cerr << "Sensor Not open.\n";
 		return E_ABORT;
     }
 
-	//Get a body frame source from which we can get our body frame reader
-	IBodyFrameSource *bodyFrameSource = nullptr;
-	HRESULT hr = sensor->get_BodyFrameSource(&bodyFrameSource);
-
-	if (SUCCEEDED(hr)) {
-		hr = bodyFrameSource->OpenReader(&bodyFrameReader);
+	bodySource = frameSource;
+	if (resampleHz > 0) {
+		resampler.configure(frameSource, resampleHz, resampleMode, &sensorFrameRead);
+		bodySource = &resampler;
 	}
+	HRESULT hr = bodySource->start();
 
 	if (SUCCEEDED(hr)) {
 		// assign the arg to a file scope version
-		mu.lock();
 		applicationCallback = cb;
+		binaryCallback = binaryCb;
+		leasedCallback = leasedCb;
+		shared = sharedBuffer != nullptr;
+		polled = cb == nullptr && binaryCb == nullptr && leasedCb == nullptr && !shared;
+		binaryOutput = binary;
+		binaryQuantized = quantize;
+		deltaOutput = !binary && !shared && deltaConfig.keyframeInterval > 0;
+		deltaEncoder.configure(&deltaConfig);
+		deltaEncoder.reset();
+		motionHistory.configure(&motionConfig);
+		motionHistory.reset();
+		changeDetector.configure(&changeConfig, shared ? getFullProjection() : &projection, rig.nBones > 0);
+		changeDetector.reset();
+		resetTrackingStats();
 
 		// make sure config can be assigned in the thread which called openSensor(), and be visible in the body reader thread
 		localConfig.mirror = config.mirror;
 		localConfig.TPoseStart = config.TPoseStart;
 		localConfig.worldSpace = config.worldSpace;
 		rootXZBasis.Z = -1; // impossible to be behind the sensor, so can use this to detect no set yet
+		poseMatcher.start(localConfig.TPoseStart);
 		rolling = false;
 		frame = 0;
 		clipPlaneEval = false;
-		mu.unlock();
 
-		// start the body thread
-		bodyThread = std::thread (&bodyReaderThreadLoop);
+		// start the body thread, or threads
+		tracking = true;
+		pipelined = pipelineWorkers > 0;
+		if (pipelined) pipeline.start(&BODY_STAGES, pipelineWorkers);
+		else bodyThread = std::thread (&bodyReaderThreadLoop);
 	}
-
-	//We're done with bodyFrameSource, so we'll release it
-	SafeRelease(bodyFrameSource);
-
 	return hr;
 }
 
@@ -145,114 +491,96 @@ DllExport HRESULT beginBodyTracking( void (*cb)(char *) ) {
  * stop body, if it had been started.
  */
 DllExport void endBodyTracking(){
-	mu.lock();
-	bool running = applicationCallback != nullptr;
-	applicationCallback = nullptr; // causes thread loop to fall out
-	mu.unlock();
+	bool running = tracking.exchange(false); // causes thread loop to fall out
 
 	if (running) {
-		// block till thread is done, then release reader
-		bodyThread.join();
-		bodyFrameReader->Release();
+		// wake the threads & anything waiting on the queue, block till threads are done, then release reader
+		bodySource->wake();
+		frameQueue.close();
+		sharedWriter.close();
+		if (pipelined) pipeline.stop();
+		else bodyThread.join();
+		bodySource->stop();
 	}
-	bodyFrameReader = nullptr;
 }
 
 void bodyReaderThreadLoop() {
-	bool timeToQuit;
-
-	// loop forever till told to stop
-	while (1) {
-		mu.lock();
-		timeToQuit = applicationCallback == nullptr;
-		mu.unlock();
-
-		if (timeToQuit) break;
-
-		IBodyFrame *bodyFrame = nullptr;
+	// loop till told to stop, sleeping in the frame source between frames
+	while (tracking) {
+		if (acquireBodies(&inFrame) == S_OK) {
+			processBodies(&inFrame);
+		}
+	}
+}
 
-		// this only produces a good hr 30 times a second, based on bodyFrame->get_RelativeTime()
-		HRESULT hr = bodyFrameReader->AcquireLatestFrame(&bodyFrame);
+/**
+ * Every stage for a frame, one after the other, when not pipelined.
+ */
+void processBodies(const FRAME_DATA *sensorFrame) {
+	if (!extractBodies(sensorFrame, &outFrame, &delta)) return;
 
-		if (SUCCEEDED(hr)) {
-			Vector4 clipPlane;
-			hr = bodyFrame->get_FloorClipPlane(&clipPlane);
+	int len = serializeBodies(&outFrame, &delta, output);
+	deliverBodies(&outFrame, output, len);
+}
 
-			if (SUCCEEDED(hr)) {
-				IBody *bodies[BODY_COUNT] = { 0 };
-				hr = bodyFrame->GetAndRefreshBodyData(_countof(bodies), bodies);
+/**
+ * Acquire stage.  Wait for the next frame, resampled or not.
+ */
+HRESULT acquireBodies(FRAME_DATA *sensorFrame) {
+	HRESULT hr = bodySource->waitForFrame(sensorFrame);
+	if (hr == S_OK && bodySource == frameSource) sensorFrameRead(sensorFrame);
+	return hr;
+}
 
-				if (SUCCEEDED(hr)) {
-					processBodies(BODY_COUNT, bodies, clipPlane);
-					//After body processing is done, we're done with our bodies so release them.
-					for (unsigned int bodyIndex = 0; bodyIndex < _countof(bodies); bodyIndex++) {
-						SafeRelease(bodies[bodyIndex]);
-					}
-				}
-			}
-			SafeRelease(bodyFrame);
-		}
-	}
+/**
+ * Count & record a frame as the sensor delivered it, before any resampling or transforms, so drops are found from the
+ * sensor's own period, & a recording can be replayed with other settings.  Each sensor of a merge records its own frames
+ * instead, before its extrinsics.
+ */
+void sensorFrameRead(const FRAME_DATA *sensorFrame) {
+	countFrameAcquired(sensorFrame->relativeTime);
+	if (frameSource != multiSource) recordFrame(sensorFrame, 0);
 }
 
 /**
- * Actual function which generates the JSON from the body reader.  If no bodies are found, it does not write any JSON.
+ * Extract stage.  Keeps the bodies which have been started by a pose, transforms them, & in delta mode, works out
+ * what changed.  Works on the state of earlier frames, so must be called for each frame in turn.
+ * @returns false when nothing is to be sent; when no bodies are found, nothing is sent.
  */
-void processBodies(const unsigned int &bodyCount, IBody **bodies, const Vector4 clipPlane) {
+bool extractBodies(const FRAME_DATA *sensorFrame, FRAME_DATA *extracted, DELTA_FRAME *deltaFrame) {
+	UINT64 start = stageClock();
+	const Vector4 &clipPlane = sensorFrame->clipPlane;
+
 	// increment the frame #, once rolling, even if the does not get written
 	if (rolling) frame++;
 
-	//	Matrix clipPlaneTransform = clipPlaneTransformMat(clipPlane);
 	if (!clipPlaneEval && clipPlane.w != 0) {
 		setCameraHeight(clipPlane.w);
 		clipPlaneEval = true;
 	}
 
-	int idx = sprintf_s(json, BUF_SZ, "{\n\"floorClipPlane\": ");
-	idx += formatQuaternion(clipPlane, idx);
-	idx += sprintf_s(&json[idx], BUF_SZ - idx, ", \"cameraHeight\": %.3f", getCameraHeight());
-	idx += sprintf_s(&json[idx], BUF_SZ - idx, ",\n\"frame\": %d", frame);
+	extracted->clipPlane = clipPlane;
+	extracted->relativeTime = sensorFrame->relativeTime;
+	extracted->cameraHeight = getCameraHeight();
+	extracted->frame = frame;
+	extracted->resampled = resampleHz > 0;
+	extracted->timeUs = sensorFrame->timeUs;
+
+	// every pose against every body at once; bodies not yet started by a pose, or stopped by one, are not kept
+	bool started[BODY_COUNT];
+	poseMatcher.evaluate(sensorFrame, frame, started);
 
 	int bodiesFound = 0;
 	int completeBodiesFound = 0;
-	idx += sprintf_s(&json[idx], BUF_SZ - idx, ",\n\"bodies\": [");
-	for (unsigned int bodyIndex = 0; bodyIndex < bodyCount; bodyIndex++) {
-		IBody *body = bodies[bodyIndex];
-
-		//Get the tracking status for the body, if it's not tracked we'll skip it
-		BOOLEAN isTracked = false;
-		HRESULT hr = body->get_IsTracked(&isTracked);
-		if (FAILED(hr) || isTracked == false) {
-			continue;
-		}
-
-		UINT64 id;
-		hr = body->get_TrackingId(&id);
-		if (FAILED(hr)) {
-			continue;
-		}
-
-		Joint joints[JointType_Count];
-		hr = body->GetJoints(_countof(joints), joints);
-		if (FAILED(hr)) {
-			continue;
-		}
-
-		JointOrientation rotations[JointType_Count];
-		hr = body->GetJointOrientations(_countof(rotations), rotations);
-		if (FAILED(hr)) {
-			continue;
-		}
-
-		HandState leftHandState = HandState_Unknown;
-		HandState rightHandState = HandState_Unknown;
+	// the source only copies tracked bodies
+	for (int bodyIndex = 0; bodyIndex < sensorFrame->bodyCount; bodyIndex++) {
+		if (!started[bodyIndex]) continue;
+		rolling = true;
 
-		body->get_HandLeftState(&leftHandState);
-		body->get_HandRightState(&rightHandState);
+		BODY_DATA *out = &extracted->bodies[bodiesFound];
+		*out = sensorFrame->bodies[bodyIndex];
 
-		if (!isBodyRolling(id) && !detectTPose(id, joints)) {
-			continue;
-		}
+		Joint *joints = out->joints;
 
         // verify no joints untracked before writing anything
 		bool unTrackedFound = false;
@@ -266,74 +594,10 @@ void processBodies(const unsigned int &bodyCount, IBody **bodies, const Vector4
 			completeBodiesFound++;
 		}
 
-		// all set to write out body
-		if (bodiesFound++ > 1) {
-			idx += sprintf_s(&json[idx], BUF_SZ - idx, ",");
-		}
-		idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n\t{");
-		idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n\t\"id\": %I64d,", id);
-		idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n\t\"joints\": {");
-
-		// write out the joints
-		for (unsigned int i = 0; i < JointType_Count; i++) {
-			CameraSpacePoint position = joints[i].Position;
-			int trackStateIdx = joints[i].TrackingState;
-			Vector4 orientation = rotations[i].Orientation;
-
-			if (!localConfig.mirror) {
-				position.X *= -1;
-				// Not using rotation data, so not actually tested
-				// When Blender does a reflection paste on a quaternion, it just flips the signs of both Y & Z
-				orientation.y *= -1;
-				orientation.z *= -1;
-			}
-
-			// adjust Y for the camera distance from the floor
-			if (localConfig.worldSpace) {
-				// get camera angle from clip plane to
-				float cameraAngleRadians = atan(clipPlane.z / clipPlane.y);
-				float cosCameraAngle = cos(cameraAngleRadians);
-				float sinCameraAngle = sin(cameraAngleRadians);
-
-				position.Y  = clipPlane.w + position.Y * cosCameraAngle + position.Z * sinCameraAngle;
-				float adjustedZ =           position.Z * cosCameraAngle + position.Y * sinCameraAngle;
-				position.Z += position.Z - adjustedZ;
-
-					// adjust for camera location rotation (squedo code) TO DO
-					// https://gamedev.stackexchange.com/questions/80310/transform-world-space-using-kinect-floorclipplane-to-move-origin-to-floor-while
-		//			Matrix cameraSpaceMatrix = compose(orientation, position);
-		//			Matrix worldSpaceMatrix = multiply(cameraSpaceMatrix, clipPlaneTransform);
-		//			decompose(worldSpaceMatrix, &orientation, &position);
-			}
-
-			// Spine Base is the first joint reported, so just grab XZ, when basis not initialized
-			if (rootXZBasis.Z == -1) {
-				rootXZBasis.X = position.X;
-				rootXZBasis.Z = position.Z;
-				std::cout << printf("Root bone XZ basis set (meters) - X: %f, Z: %f\n", rootXZBasis.X, rootXZBasis.Z);
-			}
-			position.X -= rootXZBasis.X;
-			position.Z -= rootXZBasis.Z;
-
-			if (i > 0) {
-				idx += sprintf_s(&json[idx], BUF_SZ - idx, ",");
-			}
-			idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n\t\t\"%s\": {", JOINT_NAMES[i]);
-			idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n\t\t\t\"state\": \"%s\"", TRACK_STATES[trackStateIdx]);
-			idx += sprintf_s(&json[idx], BUF_SZ - idx, ",\n\t\t\t\"location\": ");
-			idx += formatVector(position, idx);
-			idx += sprintf_s(&json[idx], BUF_SZ - idx, ",\n\t\t\t\"rotation\": ");
-			idx += formatQuaternion(orientation, idx);
-			idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n\t\t}");
-		}
-		idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n\t}");
-
-		idx += sprintf_s(&json[idx], BUF_SZ - idx, ",\n\t\"hands\": {");
-		idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n\t\t\"left\": \"%s\"", HAND_STATES[leftHandState]);
-		idx += sprintf_s(&json[idx], BUF_SZ - idx, ",\n\t\t\"right\": \"%s\"", HAND_STATES[rightHandState]);
-		idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n\t}");
+		// all set to keep body; transformed below, all bodies at once
+		bodiesFound++;
 	}
-	idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n}\n]\n}\n");
+	extracted->bodyCount = bodiesFound;
 
 	// indicate when # of bodies changes
 	if (nBodies != completeBodiesFound) {
@@ -341,61 +605,120 @@ void processBodies(const unsigned int &bodyCount, IBody **bodies, const Vector4
 		MessageBeep(MB_OK);
 	}
 
-	// do not callback when no bodies actually found
-	if (bodiesFound == 0) return;
+	// a frame the same as the last, in all that is sent, is not transformed or sent again, but as a heartbeat.  When
+	// predicted or smoothed, what is sent also depends on the motion before, so every frame is added to the history, &
+	// compared once predicted instead
+	bool predicted = motionConfig.leadMillis > 0 || motionConfig.filter != MotionFilter_None;
+	bool checkPredicted = predicted && bodiesFound > 0;
+	ChangeResult change = checkPredicted ? ChangeResult_Changed : changeDetector.check(extracted);
+
+	// do not callback when no bodies actually found, unless delta mode needs to say the last ones left, or the shared
+	// buffer has to be emptied
+	if (bodiesFound == 0) countFrameWithoutBodies();
+	if (bodiesFound == 0 && !deltaOutput && !shared) return false;
+
+	if (!countChange(change)) return false;
+
+	// world space & mirroring are worked out once a frame, then applied to every joint of every body together
+	FRAME_TRANSFORM transform;
+	buildFrameTransform(clipPlane, localConfig.mirror, localConfig.worldSpace, &transform);
+
+	// Spine Base of the first body kept, when basis not initialized
+	if (bodiesFound > 0 && rootXZBasis.Z == -1) {
+		CameraSpacePoint position = extracted->bodies[0].joints[JointType_SpineBase].Position;
+		transformPosition(&transform, &position);
+		rootXZBasis.X = position.X;
+		rootXZBasis.Z = position.Z;
+		std::cout << printf("Root bone XZ basis set (meters) - X: %f, Z: %f\n", rootXZBasis.X, rootXZBasis.Z);
+	}
+	transform.offsetX = rootXZBasis.X;
+	transform.offsetZ = rootXZBasis.Z;
+
+	gatherJoints(extracted, &jointsSoA);
+	transformJoints(&jointsSoA, &transform);
+	scatterJoints(&jointsSoA, extracted);
+
+	// every body is kept, then predicted when asked; before bones, so they are of the joints as sent
+	motionHistory.update(extracted);
+	if (checkPredicted && !countChange(changeDetector.check(extracted))) {
+		endStage(TrackingStage_Joints, start);
+		return false;
+	}
+
+	// from the joints as transformed, so the bones turn with the locations sent, mirrored & in world space or not
+	extracted->nBones = 0;
+	if (rig.nBones > 0) {
+		gatherRigJoints(extracted, &rigJoints);
+		solveRig(&rig, &rigJoints, &rigRotations);
+		scatterRigBones(&rig, &rigRotations, extracted);
+	}
 
-	mu.lock();
-	// double check not told to stop after frame processing began
-	if (applicationCallback != nullptr) applicationCallback(json);
-	mu.unlock();
+	bool send = !deltaOutput || deltaEncoder.encode(extracted, deltaFrame);
+	endStage(TrackingStage_Joints, start);
+	return send;
 }
 
-// this is not called once a T pose has been detected for a given body
-bool detectTPose(UINT64 bodyId, Joint *joints) {
-	float shoulderLeft = joints[4].Position.Y;
-	float shoulderRight = joints[8].Position.Y;
+/**
+ * Count a frame compared with the last by the change detector.
+ * @returns false when unchanged, so not to be sent.
+ */
+bool countChange(ChangeResult change) {
+	if (change == ChangeResult_Unchanged) {
+		countFrameUnchanged();
+		return false;
+	}
+	if (change == ChangeResult_Heartbeat) countHeartbeat();
+	return true;
+}
 
-	float handTipLeft = joints[21].Position.Y;
-	float handTipRight = joints[23].Position.Y;
+/**
+ * Serialize stage.  Formats a frame as requested when tracking began, with only what is projected.  Uses no state of other frames, so can be called
+ * for several frames at once, from different threads.
+ * @returns the bytes to deliver; JSON with its terminating null, or 0 for the shared buffer, which is not formatted.
+ */
+int serializeBodies(const FRAME_DATA *extracted, const DELTA_FRAME *deltaFrame, char *buffer) {
+	UINT64 start = stageClock();
+	int len = 0;
 
-	if (shoulderLeft <= handTipLeft && shoulderRight  <= handTipRight) {
-			setBodyRolling(bodyId);
+	if (shared) {
+		// written in place when delivered
 
-		// make a beep signalling action detected
-		if (rolling) {
-			std::cout << printf("ID: %I64d passed TPose test-", bodyId);
-			std::cout << printf("\tshoulderLeft: %f, shoulderRight: %f, handTipLeft: %f, handTipRight: %f\n", shoulderLeft, shoulderRight, handTipLeft, handTipRight);
-		}
-		return true;
+	} else if (binaryOutput) {
+		len = serializeProjectedBinary(extracted, &projection, buffer, binaryQuantized);
+
+	} else if (deltaOutput) {
+		len = serializeProjectedDeltaJSON(extracted, deltaFrame, &projection, buffer) + 1;
+
+	} else {
+		len = serializeProjectedJSON(extracted, &projection, buffer) + 1;
 	}
-	return false;
+
+	endStage(TrackingStage_Serialize, start);
+	return len;
 }
 
-bool isBodyRolling(UINT64 bodyId) {
-	if (!localConfig.TPoseStart) {
-		rolling = true;
-		return true;
+/**
+ * Deliver stage.  Must be called for each frame in turn.
+ */
+void deliverBodies(const FRAME_DATA *extracted, char *buffer, int len) {
+	UINT64 start = stageClock();
+
+	// the callback is made without any lock held; endBodyTracking() waits for it to return, by joining this thread
+	bool emitted = true;
+	if (shared) {
+		sharedWriter.write(extracted);
+		len = sizeof(SHARED_FRAME);
 	}
-	for (int i = 0; i < 6; i++) {
-		if (bodyId == rollingBodies[i])
-			return true;
+	else if (polled) frameQueue.push(buffer, len);
+	else if (leasedCallback != nullptr) {
+		// with every buffer still held by the application, the frame is dropped, rather than overwrite one it is reading
+		char *lease = framePool.lease(buffer, len);
+		emitted = lease != nullptr;
+		if (emitted) leasedCallback(lease, len);
 	}
-	return false;
-}
-void setBodyRolling(UINT64 bodyId) {
-	for (int i = 0; i < 6; i++) {
-		if (rollingBodies[i] == 0) {
-			rollingBodies[i] = bodyId;
-			rolling = true;
-			return;
-		}
-	}
-}
-
-int formatVector(const CameraSpacePoint Position, const int idx) {
-	return sprintf_s(&json[idx], BUF_SZ - idx, "{\"x\":%.3f,\"y\":%.3f,\"z\":%.3f}", Position.X, Position.Y, Position.Z);
-}
+	else if (binaryOutput) binaryCallback(buffer, len);
+	else applicationCallback(buffer);
 
-int formatQuaternion(const Vector4 Orientation, const int idx) {
-    return sprintf_s(&json[idx], BUF_SZ - idx, "{\"x\":%.3f,\"y\":%.3f,\"z\":%.3f,\"w\":%.3f}", Orientation.x, Orientation.y, Orientation.z, Orientation.w);
+	endStage(TrackingStage_Callback, start);
+	if (emitted) countFrameEmitted(len);
 }
\ No newline at end of file
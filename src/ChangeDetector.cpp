@@ -0,0 +1,102 @@
+#include "KinectToJSON.h"
+
+#include <stddef.h>
+
+// forward declare of non-external functions
+UINT64 hashBody(UINT64 hash, const BODY_DATA *body, const int *wordOffsets, int nWords);
+UINT64 hashWords(UINT64 hash, const void *data, int nWords);
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// file scope variables
+#define TICKS_PER_MILLI 10000LL // of RelativeTime
+#define HASH_BASIS 14695981039346656037ULL
+#define HASH_PRIME 1099511628211ULL
+
+/**
+ * Work out which words of each body to hash, from what the projection sends of it; every location too when a rig is
+ * solved from them.  The id is always hashed, so a body replaced by another in the same place is a change.
+ */
+void ChangeDetector::configure(const CHANGE_CONFIG *config, const PROJECTION *projection, bool allLocations) {
+	this->config = *config;
+	nWords = 0;
+
+	for (int w = 0; w < 2; w++) {
+		wordOffsets[nWords++] = (int) offsetof(BODY_DATA, id) + w * 4;
+	}
+
+	for (int j = 0; j < JointType_Count; j++) {
+		bool sent = (projection->jointMask & (1u << j)) != 0;
+		int joint = (int) (offsetof(BODY_DATA, joints) + j * sizeof(Joint));
+		int rotation = (int) (offsetof(BODY_DATA, rotations) + j * sizeof(JointOrientation) + offsetof(JointOrientation, Orientation));
+
+		if (sent && (projection->fields & ProjectionField_State)) {
+			wordOffsets[nWords++] = joint + (int) offsetof(Joint, TrackingState);
+		}
+		if (allLocations || (sent && (projection->fields & ProjectionField_Location))) {
+			for (int w = 0; w < 3; w++) wordOffsets[nWords++] = joint + (int) offsetof(Joint, Position) + w * 4;
+		}
+		if (sent && (projection->fields & ProjectionField_Rotation)) {
+			for (int w = 0; w < 4; w++) wordOffsets[nWords++] = rotation + w * 4;
+		}
+	}
+
+	if (projection->fields & ProjectionField_Hands) {
+		wordOffsets[nWords++] = (int) offsetof(BODY_DATA, leftHandState);
+		wordOffsets[nWords++] = (int) offsetof(BODY_DATA, rightHandState);
+	}
+}
+
+/**
+ * Forget the last frame, so the next is a change.
+ */
+void ChangeDetector::reset() {
+	haveLast = false;
+}
+
+/**
+ * Hash the floor & the bodies kept of a frame, before any transform, & compare with the last.  Always a change when
+ * not configured to skip frames.
+ */
+ChangeResult ChangeDetector::check(const FRAME_DATA *frame) {
+	if (!config.skipUnchanged) return ChangeResult_Changed;
+
+	UINT64 hash = hashWords(HASH_BASIS, &frame->clipPlane, 4);
+	hash = hashWords(hash, &frame->bodyCount, 1);
+	for (int b = 0; b < frame->bodyCount; b++) {
+		hash = hashBody(hash, &frame->bodies[b], wordOffsets, nWords);
+	}
+
+	bool changed = !haveLast || hash != lastHash;
+	bool heartbeat = !changed && config.heartbeatMillis > 0 && frame->relativeTime - lastSentTime >= config.heartbeatMillis * TICKS_PER_MILLI;
+	haveLast = true;
+	lastHash = hash;
+	if (!changed && !heartbeat) return ChangeResult_Unchanged;
+
+	lastSentTime = frame->relativeTime;
+	return changed ? ChangeResult_Changed : ChangeResult_Heartbeat;
+}
+
+/**
+ * FNV-1a, a 32 bit word at a time, of the words of a body at the given offsets.  Each step is a bijection, so only
+ * bodies which differ in a single word are sure never to hash the same; those differing in more can collide, & a
+ * change lost so is sent by the next heartbeat, when heartbeatMillis is set.
+ */
+UINT64 hashBody(UINT64 hash, const BODY_DATA *body, const int *wordOffsets, int nWords) {
+	const char *base = (const char *) body;
+	for (int w = 0; w < nWords; w++) {
+		UINT32 word;
+		memcpy(&word, base + wordOffsets[w], sizeof(word));
+		hash = (hash ^ word) * HASH_PRIME;
+	}
+	return hash;
+}
+
+UINT64 hashWords(UINT64 hash, const void *data, int nWords) {
+	const char *base = (const char *) data;
+	for (int w = 0; w < nWords; w++) {
+		UINT32 word;
+		memcpy(&word, base + w * sizeof(word), sizeof(word));
+		hash = (hash ^ word) * HASH_PRIME;
+	}
+	return hash;
+}
@@ -0,0 +1,86 @@
+#include "KinectToJSON.h"
+#include "bench/Benchmark.h"
+
+// forward declare of non-external functions
+int serve(int port, int nBodies);
+
+/**
+* The callback used by main.
+*/
+void toConsole(char * msg) {
+	std::cout << msg;
+}
+
+/**
+ * Throw away console printer for testing.  Run with -bench [name] [frames] to time the body processing instead, or with
+ * -sim [bodies] [S|C|W|R] to print synthetic bodies when there is no sensor, moving as setSyntheticBodies, or -replay path [speed] to print a recording.  With
+ * -serve [port] [bodies], frames are streamed to local clients instead of printed; from synthetic bodies when given.
+ * With -export capture outDir [workers] [chunkFrames], a capture of the printed frames is converted to animation clips.
+ */
+int main(int argc, char *argv[]) {
+	char buffer[10];
+
+	if (argc > 1 && strcmp(argv[1], "-bench") == 0) {
+		return runBenchmarks(argc, argv);
+	}
+
+	if (argc > 3 && strcmp(argv[1], "-export") == 0) {
+		return exportSession(argv[2], argv[3], argc > 4 ? atoi(argv[4]) : 0, argc > 5 ? atoi(argv[5]) : 0);
+	}
+
+	if (argc > 1 && strcmp(argv[1], "-serve") == 0) {
+		return serve(argc > 2 ? atoi(argv[2]) : STREAM_DEFAULT_PORT, argc > 3 ? atoi(argv[3]) : 0);
+	}
+
+	HRESULT hr;
+	if (argc > 1 && strcmp(argv[1], "-sim") == 0) {
+		if (argc > 3) setSyntheticBodies(argv[3][0], 0, 0, 0, 0);
+		hr = openSimulatedSensor('\0', 'F', 'W', argc > 2 ? atoi(argv[2]) : 1, 30);
+	} else if (argc > 2 && strcmp(argv[1], "-replay") == 0) {
+		hr = openReplaySensor('\0', 'F', 'W', argv[2], argc > 3 ? (float) atof(argv[3]) : 1);
+	} else {
+		hr = openSensor('\1', 'F', 'W');
+	}
+
+	if (SUCCEEDED(hr)) {
+		hr = beginBodyTracking(&toConsole);
+	}
+
+	if (SUCCEEDED(hr)) {
+		printf("cntrl-c when done: ");
+		scanf_s("%9s", buffer, (unsigned)_countof(buffer) );
+		closeSensor();
+	}
+	return 0;
+}
+
+/**
+ * Stream JSON frames to local clients until enter is pressed, printing the server's counts every few seconds.
+ * @param nBodies - 0 for the sensor, otherwise that many synthetic bodies
+ */
+int serve(int port, int nBodies) {
+	HRESULT hr = nBodies > 0 ? openSimulatedSensor('\0', 'F', 'W', nBodies, 30) : openSensor('\1', 'F', 'W');
+
+	if (SUCCEEDED(hr)) {
+		hr = beginStreaming(port, 'J');
+	}
+
+	if (SUCCEEDED(hr)) {
+		printf("enter when done\n");
+		std::atomic<bool> done(false);
+		std::thread waitForEnter([&done] { getchar(); done = true; });
+
+		for (int ticks = 1; !done; ticks++) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			if (ticks % 50 != 0) continue;
+
+			STREAM_SERVER_STATS stats;
+			getStreamStats(&stats);
+			printf("clients: %d, frames: %llu, sent: %llu, dropped: %llu\n", stats.clients, stats.framesBroadcast, stats.framesSent, stats.framesDropped);
+		}
+		waitForEnter.join();
+		endStreaming();
+	}
+	closeSensor();
+	return SUCCEEDED(hr) ? 0 : 1;
+}
@@ -0,0 +1,442 @@
+#include "KinectToJSON.h"
+
+#include <stdlib.h>
+
+// forward declare of non-external functions
+const char *skipSpace(const char *p);
+const char *expectChar(const char *p, char c);
+const char *readKey(const char *p, char *key, int keySz);
+const char *readString(const char *p, char *value, int valueSz);
+const char *readFloat(const char *p, float *value);
+const char *readInt64(const char *p, INT64 *value);
+const char *skipIds(const char *p);
+const char *readVector(const char *p, float *x, float *y, float *z, float *w);
+const char *readBody(const char *p, const FRAME_DATA *state, FRAME_DATA *frame);
+const char *readJoints(const char *p, BODY_DATA *body);
+const char *readBones(const char *p, Vector4 *bones, int *nBones);
+int lookup(const char *name, const char *table[], int n);
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// file scope variables
+#define ALL_JOINTS ((1u << JointType_Count) - 1)
+#define KEY_SZ 32
+
+// for reconstructFrame(), which is called from one consumer thread
+DeltaDecoder reconstruction;
+FRAME_DATA reconstructed;
+char reconstructedJSON[FRAME_JSON_SZ];
+
+/**
+ * Rebuild a full frame, as beginBodyTracking would have sent it, from each frame of delta mode in turn.  Frames before
+ * the first keyframe cannot be rebuilt.
+ * @returns the length of the frame, including the terminating null, 0 before the first keyframe, or when no bodies are
+ * left, -1 when deltaJSON is not a frame of delta mode, or has too many bodies, or minus the size needed, always under
+ * -1, when bufferLen is too small.
+ */
+DllExport int reconstructFrame(const char *deltaJSON, char *buffer, int bufferLen) {
+	HRESULT hr = reconstruction.apply(deltaJSON, &reconstructed);
+	if (hr == E_PENDING || (SUCCEEDED(hr) && reconstructed.bodyCount == 0)) return 0;
+	if (FAILED(hr)) return -1;
+
+	int len = serializeFrameJSON(&reconstructed, reconstructedJSON) + 1;
+	if (len > bufferLen) return -len;
+
+	memcpy(buffer, reconstructedJSON, len);
+	return len;
+}
+
+void DeltaEncoder::configure(const DELTA_CONFIG *config) {
+	this->config = *config;
+}
+
+/**
+ * Forget what has been sent, so the next frame is a keyframe.
+ */
+void DeltaEncoder::reset() {
+	sinceKeyframe = 0;
+	nSent = 0;
+}
+
+/**
+ * Work out what of the frame needs sending, & remember it as sent.  Values are compared with what was last sent, not
+ * with the last frame, so slow drift is still sent once it adds up to more than an epsilon.
+ * @returns false when there is nothing to send; no bodies, & none just left.
+ */
+bool DeltaEncoder::encode(const FRAME_DATA *frame, DELTA_FRAME *delta) {
+	delta->keyframe = sinceKeyframe == 0;
+	delta->nEntered = 0;
+	delta->nLeft = 0;
+
+	for (int s = 0; s < nSent; s++) {
+		bool present = false;
+		for (int b = 0; b < frame->bodyCount && !present; b++) {
+			present = frame->bodies[b].id == sent[s].id;
+		}
+		if (!present) delta->left[delta->nLeft++] = sent[s].id;
+	}
+
+	for (int b = 0; b < frame->bodyCount; b++) {
+		const BODY_DATA *body = &frame->bodies[b];
+		BODY_DATA *next = &updated[b];
+
+		int s = 0;
+		while (s < nSent && sent[s].id != body->id) s++;
+
+		if (s == nSent) {
+			delta->entered[delta->nEntered++] = body->id;
+			delta->changedJoints[b] = ALL_JOINTS;
+			delta->handsChanged[b] = true;
+			*next = *body;
+			continue;
+		}
+
+		*next = sent[s];
+		UINT32 changed = delta->keyframe ? ALL_JOINTS : changedJoints(&sent[s], body);
+		for (unsigned int i = 0; i < JointType_Count; i++) {
+			if ((changed & (1u << i)) == 0) continue;
+
+			next->joints[i] = body->joints[i];
+			next->rotations[i] = body->rotations[i];
+		}
+		delta->changedJoints[b] = changed;
+
+		delta->handsChanged[b] = delta->keyframe || body->leftHandState != sent[s].leftHandState || body->rightHandState != sent[s].rightHandState;
+		next->leftHandState = body->leftHandState;
+		next->rightHandState = body->rightHandState;
+	}
+
+	nSent = frame->bodyCount;
+	memcpy(sent, updated, nSent * sizeof(BODY_DATA));
+
+	if (frame->bodyCount == 0 && delta->nLeft == 0) return false;
+
+	if (++sinceKeyframe >= config.keyframeInterval) sinceKeyframe = 0;
+	return true;
+}
+
+/**
+ * @returns a bit for each joint whose state changed, or which moved more than an epsilon.
+ */
+UINT32 DeltaEncoder::changedJoints(const BODY_DATA *sent, const BODY_DATA *body) {
+	UINT32 changed = 0;
+	for (unsigned int i = 0; i < JointType_Count; i++) {
+		const CameraSpacePoint &a = sent->joints[i].Position;
+		const CameraSpacePoint &b = body->joints[i].Position;
+		const Vector4 &qa = sent->rotations[i].Orientation;
+		const Vector4 &qb = body->rotations[i].Orientation;
+
+		bool moved = std::abs(a.X - b.X) > config.locationEpsilon || std::abs(a.Y - b.Y) > config.locationEpsilon || std::abs(a.Z - b.Z) > config.locationEpsilon;
+		bool turned = std::abs(qa.x - qb.x) > config.rotationEpsilon || std::abs(qa.y - qb.y) > config.rotationEpsilon ||
+			std::abs(qa.z - qb.z) > config.rotationEpsilon || std::abs(qa.w - qb.w) > config.rotationEpsilon;
+
+		if (moved || turned || sent->joints[i].TrackingState != body->joints[i].TrackingState) {
+			changed |= 1u << i;
+		}
+	}
+	return changed;
+}
+
+void DeltaDecoder::reset() {
+	haveKeyframe = false;
+}
+
+/**
+ * Parse a frame of delta mode, & merge it with what is already known of each body.  A frame of serializeFrameJSON(),
+ * which has no keyframe, is read as one, as it is complete.
+ * @param frame - Set to the full frame, with bodies in the order sent.
+ * @returns E_PENDING before the first keyframe, or E_INVALIDARG when the JSON is not from serializeDeltaJSON().
+ */
+HRESULT DeltaDecoder::apply(const char *json, FRAME_DATA *frame) {
+	char key[KEY_SZ];
+	bool keyframe = true; // until the frame says it is not
+	bool bodiesRead = false;
+	frame->bodyCount = 0;
+	frame->resampled = false;
+	frame->nBones = 0;
+
+	const char *p = expectChar(json, '{');
+	while (p != nullptr && !bodiesRead) {
+		p = readKey(p, key, KEY_SZ);
+		if (p == nullptr) break;
+
+		if (strcmp(key, "floorClipPlane") == 0) {
+			p = readVector(p, &frame->clipPlane.x, &frame->clipPlane.y, &frame->clipPlane.z, &frame->clipPlane.w);
+
+		} else if (strcmp(key, "cameraHeight") == 0) {
+			p = readFloat(p, &frame->cameraHeight);
+
+		} else if (strcmp(key, "frame") == 0) {
+			INT64 number = 0;
+			p = readInt64(p, &number);
+			frame->frame = (int) number;
+
+		} else if (strcmp(key, "timeUs") == 0) {
+			p = readInt64(p, &frame->timeUs);
+			frame->resampled = true;
+
+		} else if (strcmp(key, "keyframe") == 0) {
+			p = skipSpace(p);
+			keyframe = strncmp(p, "true", 4) == 0;
+			p += keyframe ? 4 : strncmp(p, "false", 5) == 0 ? 5 : 0;
+
+		} else if (strcmp(key, "entered") == 0 || strcmp(key, "left") == 0) {
+			// implied by which bodies are listed
+			p = skipIds(p);
+
+		} else if (strcmp(key, "bodies") == 0) {
+			if (!keyframe && !haveKeyframe) return E_PENDING;
+
+			// bodies not listed have left; bodies not already known must have been sent in full
+			p = expectChar(p, '[');
+			while (p != nullptr && *skipSpace(p) != ']') {
+				if (frame->bodyCount == BODY_COUNT) return E_INVALIDARG;
+				if (frame->bodyCount > 0) p = expectChar(p, ',');
+				if (p == nullptr) break;
+
+				p = readBody(p, keyframe ? nullptr : &state, frame);
+				frame->bodyCount++;
+			}
+			bodiesRead = p != nullptr;
+
+		} else {
+			return E_INVALIDARG;
+		}
+
+		if (p != nullptr && !bodiesRead) {
+			p = skipSpace(p);
+			if (*p == ',') p++;
+		}
+	}
+	if (!bodiesRead) return E_INVALIDARG;
+
+	haveKeyframe = true;
+	frame->relativeTime = 0;
+	state = *frame;
+	return S_OK;
+}
+
+/**
+ * Read the next body of frame, starting from its last known values & bones in state, if there.
+ */
+const char *readBody(const char *p, const FRAME_DATA *state, FRAME_DATA *frame) {
+	char key[KEY_SZ];
+	INT64 id = 0;
+	BODY_DATA *body = &frame->bodies[frame->bodyCount];
+	Vector4 *bones = frame->bones[frame->bodyCount];
+
+	// id is always first, so the rest can be merged onto the known body
+	p = expectChar(p, '{');
+	if (p != nullptr) p = readKey(p, key, KEY_SZ);
+	if (p == nullptr || strcmp(key, "id") != 0) return nullptr;
+	p = readInt64(p, &id);
+
+	memset(body, 0, sizeof(BODY_DATA));
+	for (int b = 0; state != nullptr && b < state->bodyCount; b++) {
+		if (state->bodies[b].id != (UINT64) id) continue;
+
+		*body = state->bodies[b];
+		memcpy(bones, state->bones[b], state->nBones * sizeof(Vector4));
+		frame->nBones = state->nBones;
+	}
+	body->id = (UINT64) id;
+
+	while (p != nullptr) {
+		p = skipSpace(p);
+		if (*p == '}') return p + 1;
+
+		p = expectChar(p, ',');
+		if (p != nullptr) p = readKey(p, key, KEY_SZ);
+		if (p == nullptr) return nullptr;
+
+		if (strcmp(key, "joints") == 0) {
+			p = readJoints(p, body);
+
+		} else if (strcmp(key, "bones") == 0) {
+			p = readBones(p, bones, &frame->nBones);
+
+		} else if (strcmp(key, "hands") == 0) {
+			char hand[KEY_SZ];
+			char value[KEY_SZ];
+			p = expectChar(p, '{');
+
+			while (p != nullptr && *skipSpace(p) != '}') {
+				if (*skipSpace(p) == ',') p = skipSpace(p) + 1;
+				p = readKey(p, hand, KEY_SZ);
+				if (p != nullptr) p = readString(p, value, KEY_SZ);
+				if (p == nullptr) return nullptr;
+
+				int handState = lookup(value, HAND_STATES, HandState_Lasso + 1);
+				if (handState < 0) return nullptr;
+
+				if (strcmp(hand, "left") == 0) body->leftHandState = (HandState) handState;
+				else body->rightHandState = (HandState) handState;
+			}
+			if (p != nullptr) p = skipSpace(p) + 1;
+
+		} else {
+			return nullptr;
+		}
+	}
+	return nullptr;
+}
+
+/**
+ * Read the joints object of a body, each of which is sent in full.
+ */
+const char *readJoints(const char *p, BODY_DATA *body) {
+	char name[KEY_SZ];
+	char key[KEY_SZ];
+
+	p = expectChar(p, '{');
+	while (p != nullptr && *skipSpace(p) != '}') {
+		if (*skipSpace(p) == ',') p = skipSpace(p) + 1;
+		p = readKey(p, name, KEY_SZ);
+
+		int i = p != nullptr ? lookup(name, JOINT_NAMES, JointType_Count) : -1;
+		if (i < 0) return nullptr;
+
+		Joint &joint = body->joints[i];
+		Vector4 &orientation = body->rotations[i].Orientation;
+		joint.JointType = (JointType) i;
+		body->rotations[i].JointType = (JointType) i;
+
+		p = expectChar(p, '{');
+		while (p != nullptr && *skipSpace(p) != '}') {
+			if (*skipSpace(p) == ',') p = skipSpace(p) + 1;
+			p = readKey(p, key, KEY_SZ);
+			if (p == nullptr) return nullptr;
+
+			if (strcmp(key, "state") == 0) {
+				char value[KEY_SZ];
+				p = readString(p, value, KEY_SZ);
+				int state = p != nullptr ? lookup(value, TRACK_STATES, TrackingState_Tracked + 1) : -1;
+				if (state < 0) return nullptr;
+				joint.TrackingState = (TrackingState) state;
+
+			} else if (strcmp(key, "location") == 0) {
+				p = readVector(p, &joint.Position.X, &joint.Position.Y, &joint.Position.Z, nullptr);
+
+			} else if (strcmp(key, "rotation") == 0) {
+				p = readVector(p, &orientation.x, &orientation.y, &orientation.z, &orientation.w);
+
+			} else {
+				return nullptr;
+			}
+		}
+		if (p != nullptr) p = skipSpace(p) + 1;
+	}
+	return p != nullptr ? skipSpace(p) + 1 : nullptr;
+}
+
+/**
+ * Read the bones of a body, which are always sent all together.
+ */
+const char *readBones(const char *p, Vector4 *bones, int *nBones) {
+	int n = 0;
+
+	p = expectChar(p, '[');
+	while (p != nullptr && *skipSpace(p) != ']') {
+		if (n == RIG_MAX_BONES) return nullptr;
+		if (n > 0) p = expectChar(p, ',');
+		if (p != nullptr) p = readVector(p, &bones[n].x, &bones[n].y, &bones[n].z, &bones[n].w);
+		n++;
+	}
+	*nBones = n;
+	return p != nullptr ? skipSpace(p) + 1 : nullptr;
+}
+
+/**
+ * Read an object of x, y, z & optionally w numbers, in any order.
+ */
+const char *readVector(const char *p, float *x, float *y, float *z, float *w) {
+	char key[KEY_SZ];
+
+	p = expectChar(p, '{');
+	while (p != nullptr && *skipSpace(p) != '}') {
+		if (*skipSpace(p) == ',') p = skipSpace(p) + 1;
+		p = readKey(p, key, KEY_SZ);
+		if (p == nullptr || key[1] != '\0') return nullptr;
+
+		float *value = key[0] == 'x' ? x : key[0] == 'y' ? y : key[0] == 'z' ? z : key[0] == 'w' ? w : nullptr;
+		if (value == nullptr) return nullptr;
+		p = readFloat(p, value);
+	}
+	return p != nullptr ? skipSpace(p) + 1 : nullptr;
+}
+
+const char *skipSpace(const char *p) {
+	while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p++;
+	return p;
+}
+
+/**
+ * @returns the position after c, or nullptr when c is not next.
+ */
+const char *expectChar(const char *p, char c) {
+	if (p == nullptr) return nullptr;
+
+	p = skipSpace(p);
+	return *p == c ? p + 1 : nullptr;
+}
+
+/**
+ * Read "key": into key.
+ */
+const char *readKey(const char *p, char *key, int keySz) {
+	p = readString(p, key, keySz);
+	return expectChar(p, ':');
+}
+
+/**
+ * Read a quoted string, without escapes; none of the names sent have any.
+ */
+const char *readString(const char *p, char *value, int valueSz) {
+	p = expectChar(p, '"');
+	if (p == nullptr) return nullptr;
+
+	int len = 0;
+	while (*p != '"') {
+		if (*p == '\0' || len == valueSz - 1) return nullptr;
+		value[len++] = *p++;
+	}
+	value[len] = '\0';
+	return p + 1;
+}
+
+const char *readFloat(const char *p, float *value) {
+	if (p == nullptr) return nullptr;
+
+	char *end;
+	double parsed = strtod(p, &end);
+	if (end == p) return nullptr;
+
+	*value = (float) parsed;
+	return end;
+}
+
+const char *readInt64(const char *p, INT64 *value) {
+	if (p == nullptr) return nullptr;
+
+	char *end;
+	long long parsed = strtoll(p, &end, 10);
+	if (end == p) return nullptr;
+
+	*value = parsed;
+	return end;
+}
+
+const char *skipIds(const char *p) {
+	p = expectChar(p, '[');
+	while (p != nullptr && *p != ']') {
+		if (*p == '\0') return nullptr;
+		p++;
+	}
+	return p != nullptr ? p + 1 : nullptr;
+}
+
+int lookup(const char *name, const char *table[], int n) {
+	for (int i = 0; i < n; i++) {
+		if (strcmp(name, table[i]) == 0) return i;
+	}
+	return -1;
+}
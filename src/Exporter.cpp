@@ -0,0 +1,721 @@
+#include "KinectToJSON.h"
+
+#include <algorithm>
+
+// forward declare of non-external functions
+HRESULT writeBVH(const char *path, const EXPORT_CLIP *clip, const EXPORT_SKELETON *skeleton, const Vector4 *rotations);
+HRESULT writeGLTF(const char *path, const char *name, const EXPORT_CLIP *clip, const EXPORT_SKELETON *skeleton, const Vector4 *rotations);
+bool aimRotation(const CameraSpacePoint &from, const CameraSpacePoint &to, Vector4 *q);
+bool frameRotation(const CameraSpacePoint &aim, const CameraSpacePoint &side, Vector4 *q);
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// file scope variables
+#define MIN_BONE_METERS 0.001f    // shorter bones cannot be aimed, so keep their parent's rotation
+#define END_SITE_METERS 0.05f     // past each joint without children, so the last bones have a length in BVH
+#define BVH_UNITS 100.0f          // centimeters, which most importers of BVH expect
+#define BVH_LINE_SZ ((3 + 3 * JointType_Count) * JSON_FLOAT_SZ)
+#define GLTF_FLOAT 5126
+
+// of each bone from its parent, in the rest pose; a T pose facing +Z, with the left along +X, as glTF expects
+const CameraSpacePoint REST_DIRECTIONS[] = {
+	{  0.0f,  0.0f, 0.0f }, // SpineBase, the root
+	{  0.0f,  1.0f, 0.0f }, // SpineMid
+	{  0.0f,  1.0f, 0.0f }, // Neck
+	{  0.0f,  1.0f, 0.0f }, // Head
+
+	{  1.0f,  0.0f, 0.0f }, // ShoulderLeft
+	{  1.0f,  0.0f, 0.0f }, // ElbowLeft
+	{  1.0f,  0.0f, 0.0f }, // WristLeft
+	{  1.0f,  0.0f, 0.0f }, // HandLeft
+
+	{ -1.0f,  0.0f, 0.0f }, // ShoulderRight
+	{ -1.0f,  0.0f, 0.0f }, // ElbowRight
+	{ -1.0f,  0.0f, 0.0f }, // WristRight
+	{ -1.0f,  0.0f, 0.0f }, // HandRight
+
+	{  1.0f,  0.0f, 0.0f }, // HipLeft
+	{  0.0f, -1.0f, 0.0f }, // KneeLeft
+	{  0.0f, -1.0f, 0.0f }, // AnkleLeft
+	{  0.0f,  0.0f, 1.0f }, // FootLeft
+
+	{ -1.0f,  0.0f, 0.0f }, // HipRight
+	{  0.0f, -1.0f, 0.0f }, // KneeRight
+	{  0.0f, -1.0f, 0.0f }, // AnkleRight
+	{  0.0f,  0.0f, 1.0f }, // FootRight
+
+	{  0.0f,  1.0f, 0.0f }, // SpineShoulder
+
+	{  1.0f,  0.0f, 0.0f },      // HandTipLeft
+	{  0.7071f, 0.0f, 0.7071f }, // ThumbLeft, forward of the hand, palms down
+
+	{ -1.0f,  0.0f, 0.0f },      // HandTipRight
+	{ -0.7071f, 0.0f, 0.7071f }  // ThumbRight
+};
+
+const char TABS[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t"; // deeper than the deepest end site of the hierarchy
+
+/**
+ * Convert a capture of the JSON of beginBodyTracking, to a BVH & a glTF clip of each body for each take, in outDir,
+ * which must exist.  Prints how many frames a second were converted.
+ * @param nWorkers - threads parsing frames & writing clips, or 0 for one a core
+ * @param chunkFrames - most frames of a clip, or 0 for EXPORT_CHUNK_FRAMES
+ * @returns 0 when every clip was written, as the exit code of the console exe.
+ */
+int exportSession(const char *inPath, const char *outDir, int nWorkers, int chunkFrames) {
+	SessionExporter exporter;
+	EXPORT_STATS stats;
+
+	if (FAILED(exporter.run(inPath, outDir, nWorkers, chunkFrames, &stats))) return 1;
+
+	printf("{\"export\": \"clips\", \"frames\": %llu, \"skipped\": %llu, \"clips\": %llu, \"failed\": %llu, \"bodyFrames\": %llu, \"seconds\": %.3f, \"framesPerSecond\": %.0f}\n",
+		stats.frames, stats.skipped, stats.clips, stats.failed, stats.bodyFrames, stats.seconds, stats.frames / std::max(stats.seconds, 1e-6));
+	return stats.failed == 0 ? 0 : 1;
+}
+
+/**
+ * Stream the capture through the workers, & wait for the last clip to be written.
+ */
+HRESULT SessionExporter::run(const char *inPath, const char *outDir, int nWorkers, int chunkFrames, EXPORT_STATS *stats) {
+	FILE *in = nullptr;
+	if (fopen_s(&in, inPath, "rb") != 0) {
+		std::cerr << "Cannot open capture: " << inPath << "\n";
+		return E_INVALIDARG;
+	}
+
+	if (nWorkers <= 0) nWorkers = (int) std::thread::hardware_concurrency();
+	this->nWorkers = std::min(std::max(nWorkers, 1), EXPORT_MAX_WORKERS);
+	this->outDir = outDir;
+	this->chunkFrames = chunkFrames > 0 ? chunkFrames : EXPORT_CHUNK_FRAMES;
+	memset(&this->stats, 0, sizeof(EXPORT_STATS));
+	blockLen = 0;
+	blockPos = 0;
+	depth = 0;
+	oversized = false;
+	nTakes = 0;
+	nClipsPending = 0;
+	finished = false;
+
+	// together the batches are several MB, so are only allocated while exporting
+	block = new char[EXPORT_BLOCK_SZ];
+	EXPORT_BATCH *batches = new EXPORT_BATCH[EXPORT_BATCHES];
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point reported = start;
+	for (int i = 0; i < this->nWorkers; i++) {
+		workers[i] = std::thread(&SessionExporter::workerLoop, this);
+	}
+
+	// batch n is read into batches[n % EXPORT_BATCHES], once batch n - EXPORT_BATCHES has been split
+	UINT64 nRead = 0;
+	UINT64 nSplit = 0;
+	bool more = true;
+	while (more || nSplit < nRead) {
+		EXPORT_BATCH *oldest = &batches[nSplit % EXPORT_BATCHES];
+		bool parsed = false;
+		if (nSplit < nRead) {
+			std::unique_lock<std::mutex> lock(mu);
+			if (!more || nRead - nSplit == EXPORT_BATCHES) batchParsed.wait(lock, [oldest] { return oldest->done; });
+			parsed = oldest->done;
+		}
+
+		// split in the order read, so each take is in order
+		if (parsed) {
+			splitBatch(oldest);
+			nSplit++;
+
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (now - reported > std::chrono::seconds(5)) {
+				double seconds = std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count() / 1000.0;
+				printf("frames: %llu, %.0f a second\n", this->stats.frames, this->stats.frames / seconds);
+				reported = now;
+			}
+			continue;
+		}
+
+		EXPORT_BATCH *batch = &batches[nRead % EXPORT_BATCHES];
+		more = readBatch(in, batch);
+		if (batch->nFrames > 0) {
+			std::lock_guard<std::mutex> lock(mu);
+			batch->done = false;
+			batchQueue.push_back(batch);
+			nRead++;
+			work.notify_one();
+		}
+	}
+
+	// bodies still tracked at the end of the capture
+	for (int t = 0; t < nTakes; t++) {
+		queueClip(takes[t]);
+	}
+	nTakes = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(mu);
+		finished = true;
+		work.notify_all();
+	}
+	for (int i = 0; i < this->nWorkers; i++) {
+		workers[i].join();
+	}
+	fclose(in);
+	delete[] block;
+	delete[] batches;
+	block = nullptr;
+
+	this->stats.seconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1e6;
+	*stats = this->stats;
+	return S_OK;
+}
+
+/**
+ * Read up to EXPORT_BATCH_FRAMES frames into batch, each a JSON object, whether one a line or spread over several, as
+ * the callback gives them.  Anything between objects, such as the messages of the console exe, is skipped, as is an
+ * object too big to be a frame.  The names & states of a frame never have braces, so strings need not be looked at.
+ * @returns false at the end of the capture.
+ */
+bool SessionExporter::readBatch(FILE *in, EXPORT_BATCH *batch) {
+	batch->text.clear();
+	batch->nFrames = 0;
+	size_t objectStart = 0; // an object never spans batches, as they only end between objects
+
+	while (batch->nFrames < EXPORT_BATCH_FRAMES) {
+		if (blockPos == blockLen) {
+			blockLen = (int) fread(block, 1, EXPORT_BLOCK_SZ, in);
+			blockPos = 0;
+
+			if (blockLen == 0) {
+				// an object cut short by the end of the capture
+				if (depth > 0) {
+					if (!oversized) batch->text.resize(objectStart);
+					stats.skipped++;
+				}
+				depth = 0;
+				return false;
+			}
+		}
+
+		const char *p = block + blockPos;
+		const char *end = block + blockLen;
+		if (depth == 0) {
+			const char *open = (const char *) memchr(p, '{', end - p);
+			if (open == nullptr) {
+				blockPos = blockLen;
+				continue;
+			}
+			p = open;
+			objectStart = batch->text.size();
+			oversized = false;
+		}
+
+		const char *objectText = p;
+		for (; p < end; p++) {
+			if (*p == '{') {
+				depth++;
+			} else if (*p == '}' && --depth == 0) {
+				p++;
+				break;
+			}
+		}
+		blockPos = (int) (p - block);
+
+		if (!oversized) {
+			batch->text.append(objectText, p - objectText);
+			if (batch->text.size() - objectStart > FRAME_JSON_SZ) {
+				batch->text.resize(objectStart);
+				oversized = true;
+			}
+		}
+
+		if (depth == 0) {
+			if (oversized) {
+				stats.skipped++;
+			} else {
+				batch->text.push_back('\0');
+				batch->starts[batch->nFrames++] = (int) objectStart;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * Add each body of the frames of batch to its take.  A take ends at the first frame without its body, & is cut into
+ * clips of chunkFrames, each queued to be written as it is done.
+ */
+void SessionExporter::splitBatch(const EXPORT_BATCH *batch) {
+	for (int f = 0; f < batch->nFrames; f++) {
+		if (!batch->parsed[f]) {
+			stats.skipped++;
+			continue;
+		}
+
+		const FRAME_DATA *frame = &batch->frames[f];
+		INT64 timeUs = frame->resampled ? frame->timeUs : frame->frame * (INT64) EXPORT_FRAME_US;
+		EXPORT_CLIP *tracked[BODY_COUNT];
+		stats.frames++;
+
+		for (int b = 0; b < frame->bodyCount; b++) {
+			const BODY_DATA *body = &frame->bodies[b];
+
+			EXPORT_CLIP *clip = nullptr;
+			for (int t = 0; t < nTakes; t++) {
+				if (takes[t] != nullptr && takes[t]->id == body->id) {
+					clip = takes[t];
+					takes[t] = nullptr;
+				}
+			}
+
+			if (clip != nullptr && (int) clip->timesUs.size() == chunkFrames) {
+				queueClip(clip);
+				clip = nullptr;
+			}
+
+			if (clip == nullptr) {
+				clip = new EXPORT_CLIP();
+				clip->id = body->id;
+				clip->firstFrame = frame->frame;
+			}
+
+			clip->timesUs.push_back(timeUs);
+			for (unsigned int j = 0; j < JointType_Count; j++) {
+				clip->positions.push_back(body->joints[j].Position);
+				clip->states.push_back((BYTE) body->joints[j].TrackingState);
+			}
+			tracked[b] = clip;
+		}
+
+		// takes of bodies no longer tracked are done
+		for (int t = 0; t < nTakes; t++) {
+			if (takes[t] != nullptr) queueClip(takes[t]);
+		}
+		memcpy(takes, tracked, frame->bodyCount * sizeof(EXPORT_CLIP *));
+		nTakes = frame->bodyCount;
+	}
+}
+
+/**
+ * Hand a clip to the workers, which delete it once written.  Waits while EXPORT_MAX_CLIPS are already waiting, so
+ * reading never gets far ahead of writing.
+ */
+void SessionExporter::queueClip(EXPORT_CLIP *clip) {
+	std::unique_lock<std::mutex> lock(mu);
+	clipWritten.wait(lock, [this] { return nClipsPending < EXPORT_MAX_CLIPS; });
+
+	clipQueue.push_back(clip);
+	nClipsPending++;
+	work.notify_one();
+}
+
+/**
+ * Parse batches, before writing clips, as reading waits on them.  Returns once the capture is read & nothing is left.
+ */
+void SessionExporter::workerLoop() {
+	while (true) {
+		EXPORT_BATCH *batch = nullptr;
+		EXPORT_CLIP *clip = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(mu);
+			work.wait(lock, [this] { return !batchQueue.empty() || !clipQueue.empty() || finished; });
+
+			if (!batchQueue.empty()) {
+				batch = batchQueue.front();
+				batchQueue.pop_front();
+			} else if (!clipQueue.empty()) {
+				clip = clipQueue.front();
+				clipQueue.pop_front();
+			} else {
+				return;
+			}
+		}
+
+		if (batch != nullptr) {
+			parseBatch(batch);
+
+			std::lock_guard<std::mutex> lock(mu);
+			batch->done = true;
+			batchParsed.notify_one();
+
+		} else {
+			HRESULT hr = writeClip(clip);
+			{
+				std::lock_guard<std::mutex> lock(mu);
+				if (SUCCEEDED(hr)) {
+					stats.clips++;
+					stats.bodyFrames += clip->timesUs.size();
+				} else {
+					stats.failed++;
+				}
+				nClipsPending--;
+				clipWritten.notify_one();
+			}
+			delete clip;
+		}
+	}
+}
+
+/**
+ * Each frame is parsed on its own, as a keyframe, so frames of delta mode between keyframes are not understood.
+ */
+void SessionExporter::parseBatch(EXPORT_BATCH *batch) {
+	DeltaDecoder decoder;
+
+	for (int f = 0; f < batch->nFrames; f++) {
+		decoder.reset();
+		batch->parsed[f] = decoder.apply(batch->text.c_str() + batch->starts[f], &batch->frames[f]) == S_OK;
+	}
+}
+
+/**
+ * Solve the rotations of every frame of clip, then write it as id_firstFrame.bvh, & .gltf with its .bin, in outDir.
+ */
+HRESULT SessionExporter::writeClip(const EXPORT_CLIP *clip) {
+	EXPORT_SKELETON skeleton;
+	buildExportSkeleton(clip, &skeleton);
+
+	size_t nFrames = clip->timesUs.size();
+	std::vector<Vector4> rotations(nFrames * JointType_Count);
+	for (size_t f = 0; f < nFrames; f++) {
+		Vector4 *local = &rotations[f * JointType_Count];
+		solveLocalRotations(&clip->positions[f * JointType_Count], &skeleton, local);
+
+		// q & -q are the same rotation, but keyframes are interpolated component by component, so keep to one side
+		for (unsigned int j = 0; f > 0 && j < JointType_Count; j++) {
+			const Vector4 &last = rotations[(f - 1) * JointType_Count + j];
+			Vector4 &q = local[j];
+			if (q.x * last.x + q.y * last.y + q.z * last.z + q.w * last.w < 0) q = { -q.x, -q.y, -q.z, -q.w };
+		}
+	}
+
+	char name[64];
+	sprintf_s(name, sizeof(name), "%llu_%d", clip->id, clip->firstFrame);
+	std::string path = outDir + "/" + name;
+
+	HRESULT hr = writeBVH((path + ".bvh").c_str(), clip, &skeleton, rotations.data());
+	if (SUCCEEDED(hr)) hr = writeGLTF(path.c_str(), name, clip, &skeleton, rotations.data());
+	return hr;
+}
+
+/**
+ * The rest pose of clip, with each bone along REST_DIRECTIONS, as long as it was on average while both its joints were
+ * tracked, or over every frame, when they never both were.
+ */
+void buildExportSkeleton(const EXPORT_CLIP *clip, EXPORT_SKELETON *skeleton) {
+	size_t nFrames = clip->timesUs.size();
+	memset(skeleton->nChildren, 0, sizeof(skeleton->nChildren));
+
+	for (unsigned int j = 0; j < JointType_Count; j++) {
+		JointType parent = JOINT_PARENTS[j];
+		double tracked = 0;
+		double all = 0;
+		int nTracked = 0;
+
+		for (size_t f = 0; f < nFrames; f++) {
+			const CameraSpacePoint *positions = &clip->positions[f * JointType_Count];
+			const BYTE *states = &clip->states[f * JointType_Count];
+			float length = vectorLength(difference(positions[j], positions[parent]));
+
+			all += length;
+			if (states[j] == TrackingState_Tracked && states[parent] == TrackingState_Tracked) {
+				tracked += length;
+				nTracked++;
+			}
+		}
+
+		float length = (float) (nTracked > 0 ? tracked / nTracked : nFrames > 0 ? all / nFrames : 0);
+		skeleton->offsets[j] = { REST_DIRECTIONS[j].X * length, REST_DIRECTIONS[j].Y * length, REST_DIRECTIONS[j].Z * length };
+		if (j != JointType_SpineBase) skeleton->children[parent][skeleton->nChildren[parent]++] = (JointType) j;
+	}
+
+	// depth first, with the children of each in the order of JointType
+	JointType stack[JointType_Count];
+	int nStack = 0;
+	int n = 0;
+	stack[nStack++] = JointType_SpineBase;
+	while (nStack > 0) {
+		JointType j = stack[--nStack];
+		skeleton->order[n++] = j;
+		for (int c = skeleton->nChildren[j] - 1; c >= 0; c--) {
+			stack[nStack++] = skeleton->children[j][c];
+		}
+	}
+}
+
+/**
+ * The rotation of each joint from its parent's, which turns the rest pose of skeleton into positions.  Each joint aims
+ * the bone to its first child, & one with more children turns about that bone to line up the others; the hips, the
+ * shoulders or the thumb.  A joint without children, or whose bone is too short to aim, keeps its parent's rotation.
+ */
+void solveLocalRotations(const CameraSpacePoint *positions, const EXPORT_SKELETON *skeleton, Vector4 *local) {
+	const Vector4 IDENTITY = { 0, 0, 0, 1 };
+	Vector4 world[JointType_Count];
+
+	for (unsigned int i = 0; i < JointType_Count; i++) {
+		JointType j = skeleton->order[i];
+		const Vector4 &parent = j == JointType_SpineBase ? IDENTITY : world[JOINT_PARENTS[j]];
+		world[j] = parent;
+
+		int nChildren = skeleton->nChildren[j];
+		if (nChildren > 0) {
+			const JointType *children = skeleton->children[j];
+			CameraSpacePoint aim = difference(positions[children[0]], positions[j]);
+			const CameraSpacePoint &restAim = skeleton->offsets[children[0]];
+
+			// the second child, or the line from the second to the third, sets the turn about the aim
+			CameraSpacePoint side = { 0, 0, 0 };
+			CameraSpacePoint restSide = { 0, 0, 0 };
+			if (nChildren == 2) {
+				side = difference(positions[children[1]], positions[j]);
+				restSide = skeleton->offsets[children[1]];
+			} else if (nChildren == 3) {
+				side = difference(positions[children[1]], positions[children[2]]);
+				restSide = difference(skeleton->offsets[children[1]], skeleton->offsets[children[2]]);
+			}
+
+			Vector4 observed;
+			Vector4 rest;
+			Vector4 swing;
+			if (nChildren > 1 && frameRotation(aim, side, &observed) && frameRotation(restAim, restSide, &rest)) {
+				world[j] = multiplyQuaternions(observed, conjugate(rest));
+
+			} else {
+				CameraSpacePoint from = restAim;
+				rotatePoint(parent, &from);
+				if (aimRotation(from, aim, &swing)) world[j] = multiplyQuaternions(swing, parent);
+			}
+		}
+		local[j] = multiplyQuaternions(conjugate(parent), world[j]);
+	}
+}
+
+/**
+ * Angles in degrees, of Z, then X, then Y, such that q is the rotation of Z by the first, of X by the second & of Y by
+ * the third, multiplied in that order; the order of the CHANNELS of BVH.
+ */
+void quaternionToEulerZXY(const Vector4 &q, float *degrees) {
+	const float DEGREES = 1 / RADIANS_PER_DEGREE;
+
+	float r00 = 1 - 2 * (q.y * q.y + q.z * q.z);
+	float r01 = 2 * (q.x * q.y - q.w * q.z);
+	float r10 = 2 * (q.x * q.y + q.w * q.z);
+	float r11 = 1 - 2 * (q.x * q.x + q.z * q.z);
+	float r20 = 2 * (q.x * q.z - q.w * q.y);
+	float r21 = 2 * (q.y * q.z + q.w * q.x);
+	float r22 = 1 - 2 * (q.x * q.x + q.y * q.y);
+
+	float x = asin(std::min(std::max(r21, -1.0f), 1.0f));
+	if (std::abs(r21) < 0.99999f) {
+		degrees[0] = atan2(-r01, r11) * DEGREES;
+		degrees[2] = atan2(-r20, r22) * DEGREES;
+	} else {
+		// looking straight up or down, Z & Y turn about the same axis, so Z takes all of it
+		degrees[0] = atan2(r10, r00) * DEGREES;
+		degrees[2] = 0;
+	}
+	degrees[1] = x * DEGREES;
+}
+
+/**
+ * The hierarchy, from the rest pose of skeleton, then a line a frame of the root's location & every joint's rotation.
+ */
+HRESULT writeBVH(const char *path, const EXPORT_CLIP *clip, const EXPORT_SKELETON *skeleton, const Vector4 *rotations) {
+	FILE *file = nullptr;
+	if (fopen_s(&file, path, "wb") != 0) {
+		std::cerr << "Cannot write clip: " << path << "\n";
+		return E_INVALIDARG;
+	}
+
+	// depth first, closing the joints between one & the next
+	int depths[JointType_Count];
+	int open = 0;
+	fprintf(file, "HIERARCHY\n");
+	for (unsigned int i = 0; i < JointType_Count; i++) {
+		JointType j = skeleton->order[i];
+		const CameraSpacePoint &offset = skeleton->offsets[j];
+		bool root = j == JointType_SpineBase;
+		int d = root ? 0 : depths[JOINT_PARENTS[j]] + 1;
+		depths[j] = d;
+
+		for (; open > d; open--) fprintf(file, "%.*s}\n", open - 1, TABS);
+		fprintf(file, "%.*s%s %s\n%.*s{\n", d, TABS, root ? "ROOT" : "JOINT", JOINT_NAMES[j], d, TABS);
+		fprintf(file, "%.*s\tOFFSET %.3f %.3f %.3f\n", d, TABS, offset.X * BVH_UNITS, offset.Y * BVH_UNITS, offset.Z * BVH_UNITS);
+		fprintf(file, "%.*s\tCHANNELS %s\n", d, TABS, root ? "6 Xposition Yposition Zposition Zrotation Xrotation Yrotation" : "3 Zrotation Xrotation Yrotation");
+
+		if (skeleton->nChildren[j] == 0) {
+			const CameraSpacePoint &tip = REST_DIRECTIONS[j];
+			fprintf(file, "%.*s\tEnd Site\n%.*s\t{\n%.*s\t\tOFFSET %.3f %.3f %.3f\n%.*s\t}\n", d, TABS, d, TABS, d, TABS,
+				tip.X * END_SITE_METERS * BVH_UNITS, tip.Y * END_SITE_METERS * BVH_UNITS, tip.Z * END_SITE_METERS * BVH_UNITS, d, TABS);
+		}
+		open = d + 1;
+	}
+	for (; open > 0; open--) fprintf(file, "%.*s}\n", open - 1, TABS);
+
+	// BVH has one frame time, so uneven frames are spread evenly
+	size_t nFrames = clip->timesUs.size();
+	double frameSeconds = nFrames > 1 ? (clip->timesUs.back() - clip->timesUs.front()) / 1e6 / (nFrames - 1) : EXPORT_FRAME_US / 1e6;
+	fprintf(file, "MOTION\nFrames: %d\nFrame Time: %.6f\n", (int) nFrames, frameSeconds);
+
+	char line[BVH_LINE_SZ];
+	for (size_t f = 0; f < nFrames; f++) {
+		const CameraSpacePoint &location = clip->positions[f * JointType_Count + JointType_SpineBase];
+		const Vector4 *local = &rotations[f * JointType_Count];
+
+		char *out = writeFixed3(line, location.X * BVH_UNITS);
+		*out++ = ' ';
+		out = writeFixed3(out, location.Y * BVH_UNITS);
+		*out++ = ' ';
+		out = writeFixed3(out, location.Z * BVH_UNITS);
+		for (unsigned int i = 0; i < JointType_Count; i++) {
+			float degrees[3];
+			quaternionToEulerZXY(local[skeleton->order[i]], degrees);
+			for (int a = 0; a < 3; a++) {
+				*out++ = ' ';
+				out = writeFixed3(out, degrees[a]);
+			}
+		}
+		*out++ = '\n';
+		fwrite(line, 1, out - line, file);
+	}
+
+	bool written = ferror(file) == 0;
+	written &= fclose(file) == 0;
+	return written ? S_OK : E_FAIL;
+}
+
+/**
+ * glTF 2.0 of a node a joint, translated by the rest pose, animated by the root's translation & every joint's rotation.
+ * The keyframes are in name.bin next to it; the times, the root's translations, then the rotations of each joint.
+ */
+HRESULT writeGLTF(const char *path, const char *name, const EXPORT_CLIP *clip, const EXPORT_SKELETON *skeleton, const Vector4 *rotations) {
+	size_t nFrames = clip->timesUs.size();
+	std::string binPath = std::string(path) + ".bin";
+	std::string gltfPath = std::string(path) + ".gltf";
+
+	FILE *bin = nullptr;
+	if (fopen_s(&bin, binPath.c_str(), "wb") != 0) {
+		std::cerr << "Cannot write clip: " << binPath << "\n";
+		return E_INVALIDARG;
+	}
+
+	std::vector<float> values(nFrames * 4);
+	for (size_t f = 0; f < nFrames; f++) {
+		values[f] = (float) ((clip->timesUs[f] - clip->timesUs[0]) / 1e6);
+	}
+	float lastTime = nFrames > 0 ? values[nFrames - 1] : 0;
+	fwrite(values.data(), sizeof(float), nFrames, bin);
+
+	for (size_t f = 0; f < nFrames; f++) {
+		const CameraSpacePoint &location = clip->positions[f * JointType_Count + JointType_SpineBase];
+		values[f * 3] = location.X;
+		values[f * 3 + 1] = location.Y;
+		values[f * 3 + 2] = location.Z;
+	}
+	fwrite(values.data(), sizeof(float), nFrames * 3, bin);
+
+	for (unsigned int j = 0; j < JointType_Count; j++) {
+		for (size_t f = 0; f < nFrames; f++) {
+			const Vector4 &q = rotations[f * JointType_Count + j];
+			values[f * 4] = q.x;
+			values[f * 4 + 1] = q.y;
+			values[f * 4 + 2] = q.z;
+			values[f * 4 + 3] = q.w;
+		}
+		fwrite(values.data(), sizeof(float), nFrames * 4, bin);
+	}
+	bool written = ferror(bin) == 0;
+	written &= fclose(bin) == 0;
+	if (!written) return E_FAIL;
+
+	FILE *file = nullptr;
+	if (fopen_s(&file, gltfPath.c_str(), "wb") != 0) {
+		std::cerr << "Cannot write clip: " << gltfPath << "\n";
+		return E_INVALIDARG;
+	}
+
+	fprintf(file, "{\n\"asset\": {\"version\": \"2.0\", \"generator\": \"KinectToJSON\"},\n\"scene\": 0,\n\"scenes\": [{\"nodes\": [0]}],\n\"nodes\": [");
+	for (unsigned int j = 0; j < JointType_Count; j++) {
+		const CameraSpacePoint &offset = skeleton->offsets[j];
+		fprintf(file, "%s\n\t{\"name\": \"%s\", \"translation\": [%.6f, %.6f, %.6f]", j > 0 ? "," : "", JOINT_NAMES[j], offset.X, offset.Y, offset.Z);
+
+		for (int c = 0; c < skeleton->nChildren[j]; c++) {
+			fprintf(file, "%s%d", c == 0 ? ", \"children\": [" : ", ", (int) skeleton->children[j][c]);
+		}
+		fprintf(file, "%s}", skeleton->nChildren[j] > 0 ? "]" : "");
+	}
+
+	fprintf(file, "\n],\n\"skins\": [{\"skeleton\": 0, \"joints\": [");
+	for (unsigned int j = 0; j < JointType_Count; j++) {
+		fprintf(file, "%s%u", j > 0 ? ", " : "", j);
+	}
+
+	// sampler & accessor 0 are the root's translation, then 1 + j the rotation of joint j
+	fprintf(file, "]}],\n\"animations\": [{\"name\": \"%s\", \"samplers\": [", name);
+	for (unsigned int s = 0; s <= JointType_Count; s++) {
+		fprintf(file, "%s\n\t{\"input\": 0, \"output\": %u, \"interpolation\": \"LINEAR\"}", s > 0 ? "," : "", s + 1);
+	}
+	fprintf(file, "],\n\"channels\": [\n\t{\"sampler\": 0, \"target\": {\"node\": 0, \"path\": \"translation\"}}");
+	for (unsigned int j = 0; j < JointType_Count; j++) {
+		fprintf(file, ",\n\t{\"sampler\": %u, \"target\": {\"node\": %u, \"path\": \"rotation\"}}", j + 1, j);
+	}
+
+	size_t bytes = nFrames * (1 + 3 + 4 * JointType_Count) * sizeof(float);
+	fprintf(file, "]}],\n\"buffers\": [{\"uri\": \"%s.bin\", \"byteLength\": %llu}],\n", name, (unsigned long long) bytes);
+	fprintf(file, "\"bufferViews\": [{\"buffer\": 0, \"byteLength\": %llu}],\n\"accessors\": [", (unsigned long long) bytes);
+	fprintf(file, "\n\t{\"bufferView\": 0, \"componentType\": %d, \"count\": %d, \"type\": \"SCALAR\", \"min\": [0], \"max\": [%.9g]}",
+		GLTF_FLOAT, (int) nFrames, lastTime);
+	fprintf(file, ",\n\t{\"bufferView\": 0, \"byteOffset\": %llu, \"componentType\": %d, \"count\": %d, \"type\": \"VEC3\"}",
+		(unsigned long long) (nFrames * sizeof(float)), GLTF_FLOAT, (int) nFrames);
+	for (unsigned int j = 0; j < JointType_Count; j++) {
+		fprintf(file, ",\n\t{\"bufferView\": 0, \"byteOffset\": %llu, \"componentType\": %d, \"count\": %d, \"type\": \"VEC4\"}",
+			(unsigned long long) (nFrames * (4 + 4 * j) * sizeof(float)), GLTF_FLOAT, (int) nFrames);
+	}
+	fprintf(file, "\n]\n}\n");
+
+	written = ferror(file) == 0;
+	written &= fclose(file) == 0;
+	return written ? S_OK : E_FAIL;
+}
+
+/**
+ * The shortest turn of from onto to.
+ * @returns false when either is too short to have a direction.
+ */
+bool aimRotation(const CameraSpacePoint &from, const CameraSpacePoint &to, Vector4 *q) {
+	float fromLength = vectorLength(from);
+	float toLength = vectorLength(to);
+	if (fromLength < MIN_BONE_METERS || toLength < MIN_BONE_METERS) return false;
+
+	CameraSpacePoint unitFrom = { from.X / fromLength, from.Y / fromLength, from.Z / fromLength };
+	*q = shortestArc(from, to, perpendicularTo(unitFrom));
+	return true;
+}
+
+/**
+ * The rotation of the X, Y & Z axes onto aim, side made square to aim, & their cross product.
+ * @returns false when aim is too short, or side is too near in line with it, to tell which way is which.
+ */
+bool frameRotation(const CameraSpacePoint &aim, const CameraSpacePoint &side, Vector4 *q) {
+	float aimLength = vectorLength(aim);
+	CameraSpacePoint e3 = cross(aim, side);
+	float e3Length = vectorLength(e3);
+	if (aimLength < MIN_BONE_METERS || e3Length < MIN_BONE_METERS * aimLength) return false;
+
+	CameraSpacePoint e1 = { aim.X / aimLength, aim.Y / aimLength, aim.Z / aimLength };
+	e3 = { e3.X / e3Length, e3.Y / e3Length, e3.Z / e3Length };
+	CameraSpacePoint e2 = cross(e3, e1);
+
+	// the matrix of columns e1, e2, e3, as a quaternion, from whichever of its diagonal is largest
+	float trace = e1.X + e2.Y + e3.Z;
+	if (trace > 0) {
+		float s = 0.5f / sqrt(trace + 1);
+		*q = { (e2.Z - e3.Y) * s, (e3.X - e1.Z) * s, (e1.Y - e2.X) * s, 0.25f / s };
+	} else if (e1.X > e2.Y && e1.X > e3.Z) {
+		float s = 2 * sqrt(1 + e1.X - e2.Y - e3.Z);
+		*q = { 0.25f * s, (e2.X + e1.Y) / s, (e3.X + e1.Z) / s, (e2.Z - e3.Y) / s };
+	} else if (e2.Y > e3.Z) {
+		float s = 2 * sqrt(1 + e2.Y - e1.X - e3.Z);
+		*q = { (e2.X + e1.Y) / s, 0.25f * s, (e3.Y + e2.Z) / s, (e3.X - e1.Z) / s };
+	} else {
+		float s = 2 * sqrt(1 + e3.Z - e1.X - e2.Y);
+		*q = { (e3.X + e1.Z) / s, (e3.Y + e2.Z) / s, 0.25f * s, (e1.Y - e2.X) / s };
+	}
+	return true;
+}
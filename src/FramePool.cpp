@@ -0,0 +1,86 @@
+#include "KinectToJSON.h"
+
+/**
+ * @param nBuffers - The most frames the application can hold at once, up to FRAME_POOL_BUFFERS.
+ * @param bufferSz - The largest frame, in bytes.
+ */
+FramePool::FramePool(int nBuffers, int bufferSz) : nBuffers(nBuffers < FRAME_POOL_BUFFERS ? nBuffers : FRAME_POOL_BUFFERS), bufferSz(bufferSz) {
+	memset(&stats, 0, sizeof(stats));
+	memset(leased, 0, sizeof(leased));
+}
+
+FramePool::~FramePool() {
+	delete[] arena;
+}
+
+/**
+ * Ready for a new session, zeroing the counts.  Buffers still held from the last session stay leased, till released.
+ */
+void FramePool::open() {
+	std::lock_guard<std::mutex> lock(mu);
+	if (arena == nullptr) {
+		arena = new char[(size_t) nBuffers * bufferSz];
+		for (int i = 0; i < nBuffers; i++) freeBuffers[nFree++] = nBuffers - 1 - i;
+		stats.arenaAllocations++;
+	}
+
+	UINT64 arenaAllocations = stats.arenaAllocations;
+	memset(&stats, 0, sizeof(stats));
+	stats.buffers = nBuffers;
+	stats.bufferSz = bufferSz;
+	stats.arenaAllocations = arenaAllocations;
+	stats.inUse = stats.peakInUse = nBuffers - nFree;
+}
+
+/**
+ * Copy a frame into a free buffer, which is the caller's till released.
+ * @returns the buffer, or nullptr when every buffer is held, or the frame is too big, so it is dropped.
+ */
+char *FramePool::lease(const char *frame, int len) {
+	int index;
+	{
+		std::lock_guard<std::mutex> lock(mu);
+		if (nFree == 0 || len > bufferSz) {
+			stats.framesDropped++;
+			return nullptr;
+		}
+
+		index = freeBuffers[--nFree];
+		leased[index] = true;
+		stats.framesLeased++;
+		stats.inUse++;
+		if (stats.inUse > stats.peakInUse) stats.peakInUse = stats.inUse;
+	}
+
+	// copied outside the lock, as no one else can have the buffer
+	char *buffer = &arena[(size_t) index * bufferSz];
+	memcpy(buffer, frame, len);
+	return buffer;
+}
+
+/**
+ * Give a buffer back.  Any thread may release any buffer.
+ * @returns E_INVALIDARG for a pointer which is not the start of a leased buffer, including one already released.
+ */
+HRESULT FramePool::release(const char *buffer) {
+	std::lock_guard<std::mutex> lock(mu);
+	uintptr_t start = (uintptr_t) arena;
+	uintptr_t at = (uintptr_t) buffer;
+	bool inArena = arena != nullptr && at >= start && at < start + (size_t) nBuffers * bufferSz && (at - start) % bufferSz == 0;
+	int index = inArena ? (int) ((at - start) / bufferSz) : -1;
+	if (index < 0 || !leased[index]) {
+		stats.badReleases++;
+		return E_INVALIDARG;
+	}
+
+	leased[index] = false;
+	freeBuffers[nFree++] = index;
+	stats.framesReleased++;
+	stats.inUse--;
+	return S_OK;
+}
+
+void FramePool::getStats(FRAME_POOL_STATS *stats) {
+	std::lock_guard<std::mutex> lock(mu);
+	*stats = this->stats;
+}
@@ -0,0 +1,136 @@
+#include "KinectToJSON.h"
+
+/**
+ * @param nSlots - The most frames which can be waiting for the consumer.
+ * @param slotSz - The largest frame, in bytes.
+ */
+FrameQueue::FrameQueue(int nSlots, int slotSz) : nSlots(nSlots), slotSz(slotSz),
+	readIdx(0), writeIdx(0), closed(true), waiters(0), producerWaiting(false), framesQueued(0), framesDelivered(0), framesOverwritten(0), producerWaits(0) {
+}
+
+FrameQueue::~FrameQueue() {
+	delete[] slots;
+	delete[] lens;
+}
+
+/**
+ * Empty the queue & make it ready for a new producer.  Only call when there is no producer running.
+ * @param dropOldest - when full, true overwrites the oldest frame, false makes push() wait for the consumer.
+ */
+void FrameQueue::open(bool dropOldest) {
+	if (slots == nullptr) {
+		slots = new char[(size_t) nSlots * slotSz];
+		lens = new std::atomic<int>[nSlots];
+	}
+	this->dropOldest = dropOldest;
+
+	readIdx = writeIdx.load();
+	framesQueued = 0;
+	framesDelivered = 0;
+	framesOverwritten = 0;
+	producerWaits = 0;
+	closed = false;
+}
+
+/**
+ * Wake a consumer blocked in wait(), & a producer blocked in push().  Frames already queued can still be popped.
+ */
+void FrameQueue::close() {
+	closed = true;
+	std::lock_guard<std::mutex> lock(waitMu);
+	frameReady.notify_all();
+	slotFree.notify_all();
+}
+
+/**
+ * Producer side.  Copies the frame into the next slot.
+ * @returns false if the frame was too big, or the queue closed while waiting for room.
+ */
+bool FrameQueue::push(const char *frame, int len) {
+	if (len > slotSz || slots == nullptr) return false;
+
+	UINT64 w = writeIdx.load(std::memory_order_relaxed);
+	UINT64 r = readIdx.load();
+	if (w - r >= (UINT64) nSlots) {
+		if (dropOldest) {
+			// take the oldest frame away from the consumer; if this fails, the consumer just took it, so there is room
+			if (readIdx.compare_exchange_strong(r, r + 1)) framesOverwritten++;
+
+		} else {
+			// sleep till pop() frees a slot; it sees producerWaiting, or this sees its readIdx, as both are seq_cst
+			producerWaits++;
+			std::unique_lock<std::mutex> lock(waitMu);
+			producerWaiting = true;
+			slotFree.wait(lock, [this, w] {
+				return closed || w - readIdx.load() < (UINT64) nSlots;
+			});
+			producerWaiting = false;
+			if (closed) return false;
+		}
+	}
+
+	int slot = (int) (w % nSlots);
+	memcpy(&slots[(size_t) slot * slotSz], frame, len);
+	lens[slot] = len;
+	writeIdx.store(w + 1);
+	framesQueued++;
+
+	// only pay for the lock when a consumer is actually asleep
+	if (waiters.load() > 0) {
+		std::lock_guard<std::mutex> lock(waitMu);
+		frameReady.notify_one();
+	}
+	return true;
+}
+
+/**
+ * Consumer side.  Copies the oldest frame into buffer, without waiting.
+ * @returns the length of the frame, 0 when there is none, or minus the size needed when bufferLen is too small.
+ */
+int FrameQueue::pop(char *buffer, int bufferLen) {
+	while (true) {
+		UINT64 r = readIdx.load();
+		if (r == writeIdx.load()) return 0;
+
+		int slot = (int) (r % nSlots);
+		int len = lens[slot];
+		if (len > bufferLen) return -len;
+
+		memcpy(buffer, &slots[(size_t) slot * slotSz], len);
+
+		// the producer moves readIdx before overwriting a slot, so if it is unchanged, the copy was not torn
+		if (readIdx.compare_exchange_strong(r, r + 1)) {
+			framesDelivered++;
+			if (producerWaiting.load()) {
+				std::lock_guard<std::mutex> lock(waitMu);
+				slotFree.notify_one();
+			}
+			return len;
+		}
+	}
+}
+
+/**
+ * Consumer side.  As pop(), but sleeps until a frame arrives, the timeout passes, or the queue is closed.
+ */
+int FrameQueue::wait(char *buffer, int bufferLen, int timeoutMillis) {
+	int len = pop(buffer, bufferLen);
+	if (len != 0) return len;
+
+	std::unique_lock<std::mutex> lock(waitMu);
+	waiters++;
+	frameReady.wait_for(lock, std::chrono::milliseconds(timeoutMillis), [this] {
+		return closed || readIdx.load() != writeIdx.load();
+	});
+	waiters--;
+	lock.unlock();
+
+	return pop(buffer, bufferLen);
+}
+
+void FrameQueue::getStats(FRAME_QUEUE_STATS *stats) {
+	stats->framesQueued = framesQueued;
+	stats->framesDelivered = framesDelivered;
+	stats->framesOverwritten = framesOverwritten;
+	stats->producerWaits = producerWaits;
+}
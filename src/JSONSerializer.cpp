@@ -0,0 +1,453 @@
+#include "KinectToJSON.h"
+
+// forward declare of non-external functions
+bool buildFragments();
+char *writeFragment(char *out, const char *fragment, const int len);
+char *writeSteps(char *out, const PROJECTION *projection, const BODY_DATA *body, int from, int to);
+char *writeJoint(char *out, const PROJECTION *projection, const BODY_DATA *body, unsigned int joint, bool first);
+char *writeTrackState(char *out, const BODY_DATA *body, int offset);
+char *writeHandState(char *out, const BODY_DATA *body, int offset);
+char *writeNothing(char *out, const BODY_DATA *body, int offset);
+template<int DECIMALS> char *writeFixed(char *out, float value);
+template<int DECIMALS, int N> char *writeJointValues(char *out, const BODY_DATA *body, int offset);
+void appendStepText(PROJECTION *projection, const char *text);
+void addStep(PROJECTION *projection, int *textStart, char *(*write)(char *, const BODY_DATA *, int), int offset);
+char *writeHands(char *out, const BODY_DATA *body);
+char *writeIds(char *out, const UINT64 *ids, int nIds);
+char *writeInt64(char *out, INT64 value);
+char *writeVector(char *out, const CameraSpacePoint &position);
+char *writeQuaternion(char *out, const Vector4 &orientation);
+char *writeBones(char *out, const FRAME_DATA *frame, int b);
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// pre-baked pieces of the JSON, which only ever change between the numbers & names written out
+typedef struct {
+	char text[64];
+	int len;
+} FRAGMENT;
+
+FRAGMENT trackStateFragments[3]; // state values, with their closing quote
+FRAGMENT handStateFragments[5];
+
+const char FRAME_START[] = "{\n\"floorClipPlane\": ";
+const char CAMERA_HEIGHT[] = ", \"cameraHeight\": ";
+const char FRAME_NUMBER[] = ",\n\"frame\": ";
+const char TIME[] = ", \"timeUs\": "; // only when resampled
+const char BODIES_START[] = ",\n\"bodies\": [";
+const char BODY_START[] = "\n\t{\n\t\"id\": ";
+const char JOINTS_START[] = ",\n\t\"joints\": {";
+const char JOINT_END[] = "\n\t\t}";
+const char HANDS_START[] = "\n\t},\n\t\"hands\": {\n\t\t\"left\": \"";
+const char RIGHT_HAND[] = ",\n\t\t\"right\": \"";
+const char FRAME_END[] = "\n]\n}\n";
+
+// delta mode only; a body with every joint & the hands sent is the same as in a full frame
+const char KEYFRAME[] = ",\n\"keyframe\": ";
+const char ENTERED[] = ",\n\"entered\": [";
+const char LEFT[] = "],\n\"left\": [";
+const char DELTA_BODIES_START[] = "],\n\"bodies\": [";
+const char JOINTS_END[] = "\n\t}";
+const char HANDS_KEY[] = ",\n\t\"hands\": {\n\t\t\"left\": \"";
+const char BODY_CLOSE[] = "\n}";
+const char BONES_START[] = ",\n\t\"bones\": [";
+const char BONE_START[] = "\n\t\t";
+const char BONES_END[] = "\n\t]";
+
+const char VECTOR_X[] = "{\"x\":";
+const char VECTOR_Y[] = ",\"y\":";
+const char VECTOR_Z[] = ",\"z\":";
+const char VECTOR_W[] = ",\"w\":";
+const char *VECTOR_KEYS[] = { VECTOR_X, VECTOR_Y, VECTOR_Z, VECTOR_W };
+const int VECTOR_KEY_LEN = sizeof(VECTOR_X) - 1; // all the same
+
+// location & rotation writers of each precision, for the steps of a projection
+typedef char *(*VALUES_WRITER)(char *, const BODY_DATA *, int);
+const VALUES_WRITER LOCATION_WRITERS[PROJECTION_MAX_DECIMALS + 1] = {
+	&writeJointValues<0, 3>, &writeJointValues<1, 3>, &writeJointValues<2, 3>, &writeJointValues<3, 3>,
+	&writeJointValues<4, 3>, &writeJointValues<5, 3>, &writeJointValues<6, 3>
+};
+const VALUES_WRITER ROTATION_WRITERS[PROJECTION_MAX_DECIMALS + 1] = {
+	&writeJointValues<0, 4>, &writeJointValues<1, 4>, &writeJointValues<2, 4>, &writeJointValues<3, 4>,
+	&writeJointValues<4, 4>, &writeJointValues<5, 4>, &writeJointValues<6, 4>
+};
+const unsigned long long POWERS_OF_10[PROJECTION_MAX_DECIMALS + 1] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+// the length of a string literal, without the terminator
+#define LIT_LEN(literal) (sizeof(literal) - 1)
+
+bool fragmentsBuilt = buildFragments();
+
+/**
+ * Write a frame into buffer, which must be at least FRAME_JSON_SZ.  The output is the same as the original sprintf_s based
+ * version, except that each body is now closed & comma separated.
+ * @returns the number of chars written, not counting the terminating null.
+ */
+int serializeFrameJSON(const FRAME_DATA *frame, char *buffer) {
+	return serializeProjectedJSON(frame, getFullProjection(), buffer);
+}
+
+/**
+ * As serializeFrameJSON(), with only what the projection sends of each body.
+ */
+int serializeProjectedJSON(const FRAME_DATA *frame, const PROJECTION *projection, char *buffer) {
+	char *out = writeFragment(buffer, FRAME_START, LIT_LEN(FRAME_START));
+	out = writeQuaternion(out, frame->clipPlane);
+	out = writeFragment(out, CAMERA_HEIGHT, LIT_LEN(CAMERA_HEIGHT));
+	out = writeFixed3(out, frame->cameraHeight);
+	out = writeFragment(out, FRAME_NUMBER, LIT_LEN(FRAME_NUMBER));
+	out = writeInt64(out, frame->frame);
+	if (frame->resampled) {
+		out = writeFragment(out, TIME, LIT_LEN(TIME));
+		out = writeInt64(out, frame->timeUs);
+	}
+	out = writeFragment(out, BODIES_START, LIT_LEN(BODIES_START));
+
+	for (int b = 0; b < frame->bodyCount; b++) {
+		const BODY_DATA *body = &frame->bodies[b];
+
+		if (b > 0) *out++ = ',';
+		out = writeFragment(out, BODY_START, LIT_LEN(BODY_START));
+		out = writeInt64(out, (INT64) body->id); // %I64d was used originally, so ids are signed
+		out = writeFragment(out, JOINTS_START, LIT_LEN(JOINTS_START));
+		out = writeSteps(out, projection, body, 0, projection->nSteps); // every joint sent, then the hands
+		out = writeFragment(out, JOINTS_END, LIT_LEN(JOINTS_END));
+		if (frame->nBones > 0) out = writeBones(out, frame, b);
+		out = writeFragment(out, BODY_CLOSE, LIT_LEN(BODY_CLOSE));
+	}
+	out = writeFragment(out, FRAME_END, LIT_LEN(FRAME_END));
+	*out = '\0';
+
+	return (int) (out - buffer);
+}
+
+/**
+ * Write a frame of delta mode into buffer, which must be at least FRAME_JSON_SZ.  Every body of the frame is listed, in
+ * order, but with only the joints, & hands, which the delta says changed.  A keyframe is a full frame, plus the ids.
+ * @returns the number of chars written, not counting the terminating null.
+ */
+int serializeDeltaJSON(const FRAME_DATA *frame, const DELTA_FRAME *delta, char *buffer) {
+	return serializeProjectedDeltaJSON(frame, delta, getFullProjection(), buffer);
+}
+
+/**
+ * As serializeDeltaJSON(), with only what the projection sends of each body.  A body whose only changed joints are not
+ * sent has no joints.
+ */
+int serializeProjectedDeltaJSON(const FRAME_DATA *frame, const DELTA_FRAME *delta, const PROJECTION *projection, char *buffer) {
+	bool hands = (projection->fields & ProjectionField_Hands) != 0;
+	char *out = writeFragment(buffer, FRAME_START, LIT_LEN(FRAME_START));
+	out = writeQuaternion(out, frame->clipPlane);
+	out = writeFragment(out, CAMERA_HEIGHT, LIT_LEN(CAMERA_HEIGHT));
+	out = writeFixed3(out, frame->cameraHeight);
+	out = writeFragment(out, FRAME_NUMBER, LIT_LEN(FRAME_NUMBER));
+	out = writeInt64(out, frame->frame);
+	if (frame->resampled) {
+		out = writeFragment(out, TIME, LIT_LEN(TIME));
+		out = writeInt64(out, frame->timeUs);
+	}
+	out = writeFragment(out, KEYFRAME, LIT_LEN(KEYFRAME));
+	out = delta->keyframe ? writeFragment(out, "true", 4) : writeFragment(out, "false", 5);
+	out = writeFragment(out, ENTERED, LIT_LEN(ENTERED));
+	out = writeIds(out, delta->entered, delta->nEntered);
+	out = writeFragment(out, LEFT, LIT_LEN(LEFT));
+	out = writeIds(out, delta->left, delta->nLeft);
+	out = writeFragment(out, DELTA_BODIES_START, LIT_LEN(DELTA_BODIES_START));
+
+	for (int b = 0; b < frame->bodyCount; b++) {
+		const BODY_DATA *body = &frame->bodies[b];
+		UINT32 changed = delta->changedJoints[b] & projection->jointMask;
+
+		if (b > 0) *out++ = ',';
+		out = writeFragment(out, BODY_START, LIT_LEN(BODY_START));
+		out = writeInt64(out, (INT64) body->id);
+
+		if (changed != 0) {
+			out = writeFragment(out, JOINTS_START, LIT_LEN(JOINTS_START));
+			bool first = true;
+			for (unsigned int i = 0; i < JointType_Count; i++) {
+				if ((changed & (1u << i)) == 0) continue;
+
+				out = writeJoint(out, projection, body, i, first);
+				first = false;
+			}
+			out = writeFragment(out, JOINTS_END, LIT_LEN(JOINTS_END));
+		}
+
+		if (hands && delta->handsChanged[b]) {
+			out = writeFragment(out, HANDS_KEY, LIT_LEN(HANDS_KEY));
+			out = writeHands(out, body);
+			out = writeFragment(out, JOINTS_END, LIT_LEN(JOINTS_END));
+		}
+
+		// bones only turn when joints do, so are sent with any change, projected or not
+		if (frame->nBones > 0 && delta->changedJoints[b] != 0) out = writeBones(out, frame, b);
+		out = writeFragment(out, BODY_CLOSE, LIT_LEN(BODY_CLOSE));
+	}
+	out = writeFragment(out, FRAME_END, LIT_LEN(FRAME_END));
+	*out = '\0';
+
+	return (int) (out - buffer);
+}
+
+/**
+ * Fixed precision replacement for sprintf's %.3f.
+ * @returns the position after the last char written.
+ */
+char *writeFixed3(char *out, float value) {
+	return writeFixed<3>(out, value);
+}
+
+/**
+ * Fixed precision replacement for sprintf's %.Nf, up to 6 places.  A float times 10^6 is exact in a double (24 + 20 bits
+ * of mantissa), so rounding that to an integer, ties to even, gives the same digits the CRT does.
+ * @returns the position after the last char written.
+ */
+template<int DECIMALS>
+char *writeFixed(char *out, float value) {
+	double scaled = (double) value * (double) POWERS_OF_10[DECIMALS];
+
+	// nan, inf & anything too large to be an exact integer are left to the CRT; never happens for joints in meters
+	if (!(scaled < 9.0e15 && scaled > -9.0e15)) {
+		return out + sprintf_s(out, JSON_FLOAT_SZ, "%.*f", DECIMALS, value);
+	}
+
+	// sign comes from the value, not the rounded result, so -0.0001 is "-0.000" as with printf
+	if (std::signbit(value)) {
+		*out++ = '-';
+		scaled = -scaled;
+	}
+	unsigned long long units = (unsigned long long) std::nearbyint(scaled);
+	unsigned long long whole = units / POWERS_OF_10[DECIMALS];
+	unsigned int fraction = (unsigned int) (units % POWERS_OF_10[DECIMALS]);
+
+	char digits[20];
+	int nDigits = 0;
+	do {
+		digits[nDigits++] = (char) ('0' + whole % 10);
+		whole /= 10;
+	} while (whole > 0);
+
+	while (nDigits > 0) *out++ = digits[--nDigits];
+	if (DECIMALS == 0) return out;
+
+	*out++ = '.';
+	for (int i = DECIMALS - 1; i >= 0; i--) {
+		out[i] = (char) ('0' + fraction % 10);
+		fraction /= 10;
+	}
+	return out + DECIMALS;
+}
+
+char *writeFragment(char *out, const char *fragment, const int len) {
+	memcpy(out, fragment, len);
+	return out + len;
+}
+
+/**
+ * Walk the steps of a projection, from & to, for a body.
+ */
+char *writeSteps(char *out, const PROJECTION *projection, const BODY_DATA *body, int from, int to) {
+	for (int s = from; s < to; s++) {
+		const EMIT_STEP &step = projection->steps[s];
+		out = writeFragment(out, projection->text + step.text, step.textLen);
+		out = step.write(out, body, step.offset);
+	}
+	return out;
+}
+
+/**
+ * Write the steps of one joint.  They start with a comma for all but the first joint of the projection, so it is skipped
+ * when the joint is the first written, but not the first of the projection.
+ */
+char *writeJoint(char *out, const PROJECTION *projection, const BODY_DATA *body, unsigned int joint, bool first) {
+	const EMIT_STEP &step = projection->steps[projection->jointSteps[joint]];
+	int skip = first && (int) joint != projection->firstJoint ? 1 : 0;
+
+	out = writeFragment(out, projection->text + step.text + skip, step.textLen - skip);
+	out = step.write(out, body, step.offset);
+	return writeSteps(out, projection, body, projection->jointSteps[joint] + 1, projection->jointSteps[joint + 1]);
+}
+
+char *writeTrackState(char *out, const BODY_DATA *body, int offset) {
+	const FRAGMENT &state = trackStateFragments[*(const TrackingState *) ((const char *) body + offset)];
+	return writeFragment(out, state.text, state.len);
+}
+
+char *writeHandState(char *out, const BODY_DATA *body, int offset) {
+	const FRAGMENT &state = handStateFragments[*(const HandState *) ((const char *) body + offset)];
+	return writeFragment(out, state.text, state.len);
+}
+
+// for the text at the end of a joint, which has no value after it
+char *writeNothing(char *out, const BODY_DATA *, int) {
+	return out;
+}
+
+/**
+ * N consecutive floats from offset, as an object of x, y, z & w.
+ */
+template<int DECIMALS, int N>
+char *writeJointValues(char *out, const BODY_DATA *body, int offset) {
+	const float *values = (const float *) ((const char *) body + offset);
+	for (int i = 0; i < N; i++) {
+		out = writeFragment(out, VECTOR_KEYS[i], VECTOR_KEY_LEN);
+		out = writeFixed<DECIMALS>(out, values[i]);
+	}
+	*out++ = '}';
+	return out;
+}
+
+/**
+ * Write the left hand state through to the closing quote of the right.
+ */
+char *writeHands(char *out, const BODY_DATA *body) {
+	const FRAGMENT &left = handStateFragments[body->leftHandState];
+	const FRAGMENT &right = handStateFragments[body->rightHandState];
+
+	out = writeFragment(out, left.text, left.len);
+	out = writeFragment(out, RIGHT_HAND, LIT_LEN(RIGHT_HAND));
+	return writeFragment(out, right.text, right.len);
+}
+
+char *writeIds(char *out, const UINT64 *ids, int nIds) {
+	for (int i = 0; i < nIds; i++) {
+		if (i > 0) *out++ = ',';
+		out = writeInt64(out, (INT64) ids[i]);
+	}
+	return out;
+}
+
+char *writeInt64(char *out, INT64 value) {
+	unsigned long long magnitude = (unsigned long long) value;
+	if (value < 0) {
+		*out++ = '-';
+		magnitude = 0 - magnitude;
+	}
+
+	char digits[20];
+	int nDigits = 0;
+	do {
+		digits[nDigits++] = (char) ('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude > 0);
+
+	while (nDigits > 0) *out++ = digits[--nDigits];
+	return out;
+}
+
+char *writeVector(char *out, const CameraSpacePoint &position) {
+	out = writeFragment(out, VECTOR_X, LIT_LEN(VECTOR_X));
+	out = writeFixed3(out, position.X);
+	out = writeFragment(out, VECTOR_Y, LIT_LEN(VECTOR_Y));
+	out = writeFixed3(out, position.Y);
+	out = writeFragment(out, VECTOR_Z, LIT_LEN(VECTOR_Z));
+	out = writeFixed3(out, position.Z);
+	*out++ = '}';
+	return out;
+}
+
+char *writeQuaternion(char *out, const Vector4 &orientation) {
+	out = writeFragment(out, VECTOR_X, LIT_LEN(VECTOR_X));
+	out = writeFixed3(out, orientation.x);
+	out = writeFragment(out, VECTOR_Y, LIT_LEN(VECTOR_Y));
+	out = writeFixed3(out, orientation.y);
+	out = writeFragment(out, VECTOR_Z, LIT_LEN(VECTOR_Z));
+	out = writeFixed3(out, orientation.z);
+	out = writeFragment(out, VECTOR_W, LIT_LEN(VECTOR_W));
+	out = writeFixed3(out, orientation.w);
+	*out++ = '}';
+	return out;
+}
+
+/**
+ * The bones of a body, as an array in the order of the rig.
+ */
+char *writeBones(char *out, const FRAME_DATA *frame, int b) {
+	out = writeFragment(out, BONES_START, LIT_LEN(BONES_START));
+	for (int i = 0; i < frame->nBones; i++) {
+		if (i > 0) *out++ = ',';
+		out = writeFragment(out, BONE_START, LIT_LEN(BONE_START));
+		out = writeQuaternion(out, frame->bones[b][i]);
+	}
+	return writeFragment(out, BONES_END, LIT_LEN(BONES_END));
+}
+
+/**
+ * The steps of the JSON of a body, for the joints, fields & decimals of a projection.  Everything between the values,
+ * joint names & keys, is baked into the text of the steps.
+ */
+void compileJSONSteps(PROJECTION *projection) {
+	projection->nSteps = 0;
+	projection->textLen = 0;
+	projection->firstJoint = -1;
+	int textStart = 0;
+
+	for (unsigned int j = 0; j < JointType_Count; j++) {
+		projection->jointSteps[j] = projection->nSteps;
+		if ((projection->jointMask & (1u << j)) == 0) continue;
+
+		char name[64];
+		sprintf_s(name, "%s\n\t\t\"%s\": {", projection->firstJoint < 0 ? "" : ",", JOINT_NAMES[j]);
+		appendStepText(projection, name);
+		if (projection->firstJoint < 0) projection->firstJoint = j;
+
+		const char *comma = "";
+		if (projection->fields & ProjectionField_State) {
+			appendStepText(projection, "\n\t\t\t\"state\": \"");
+			addStep(projection, &textStart, &writeTrackState, (int) (offsetof(BODY_DATA, joints) + j * sizeof(Joint) + offsetof(Joint, TrackingState)));
+			comma = ",";
+		}
+		if (projection->fields & ProjectionField_Location) {
+			appendStepText(projection, comma);
+			appendStepText(projection, "\n\t\t\t\"location\": ");
+			addStep(projection, &textStart, LOCATION_WRITERS[projection->decimals], (int) (offsetof(BODY_DATA, joints) + j * sizeof(Joint) + offsetof(Joint, Position)));
+			comma = ",";
+		}
+		if (projection->fields & ProjectionField_Rotation) {
+			appendStepText(projection, comma);
+			appendStepText(projection, "\n\t\t\t\"rotation\": ");
+			addStep(projection, &textStart, ROTATION_WRITERS[projection->decimals], (int) (offsetof(BODY_DATA, rotations) + j * sizeof(JointOrientation) + offsetof(JointOrientation, Orientation)));
+		}
+		appendStepText(projection, JOINT_END);
+		addStep(projection, &textStart, &writeNothing, 0);
+	}
+	projection->jointSteps[JointType_Count] = projection->nSteps;
+
+	if (projection->fields & ProjectionField_Hands) {
+		appendStepText(projection, HANDS_START);
+		addStep(projection, &textStart, &writeHandState, (int) offsetof(BODY_DATA, leftHandState));
+		appendStepText(projection, RIGHT_HAND);
+		addStep(projection, &textStart, &writeHandState, (int) offsetof(BODY_DATA, rightHandState));
+	}
+}
+
+void appendStepText(PROJECTION *projection, const char *text) {
+	int len = (int) strlen(text);
+	memcpy(projection->text + projection->textLen, text, len);
+	projection->textLen += len;
+}
+
+/**
+ * A step of the text appended since the last, then the value at offset.
+ */
+void addStep(PROJECTION *projection, int *textStart, char *(*write)(char *, const BODY_DATA *, int), int offset) {
+	EMIT_STEP &step = projection->steps[projection->nSteps++];
+	step.write = write;
+	step.offset = offset;
+	step.text = (UINT16) *textStart;
+	step.textLen = (UINT16) (projection->textLen - *textStart);
+	*textStart = projection->textLen;
+}
+
+/**
+ * Bake the state values, with their closing quotes.  Run once at static init.
+ */
+bool buildFragments() {
+	for (unsigned int i = 0; i < _countof(trackStateFragments); i++) {
+		trackStateFragments[i].len = sprintf_s(trackStateFragments[i].text, "%s\"", TRACK_STATES[i]);
+	}
+	for (unsigned int i = 0; i < _countof(handStateFragments); i++) {
+		handStateFragments[i].len = sprintf_s(handStateFragments[i].text, "%s\"", HAND_STATES[i]);
+	}
+	return true;
+}
@@ -0,0 +1,224 @@
+#include "KinectToJSON.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define TRANSFORM_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFORM_SSE
+#endif
+
+/**
+ * Work out the rotation which levels the floor plane, once per frame, rather than once per joint.  The clip plane is
+ * the floor's normal in camera space, so its Y & Z are already the cos & sin of the camera's tilt, once normalized;
+ * no trig is needed.  W is the camera's height, when the normal is unit length.  With no floor found (a zero plane),
+ * nothing is rotated.
+ */
+void buildFrameTransform(const Vector4 &clipPlane, bool mirror, bool worldSpace, FRAME_TRANSFORM *transform) {
+	transform->mirrorX = mirror ? 1.0f : -1.0f;
+	transform->cosAngle = 1;
+	transform->sinAngle = 0;
+	transform->height = 0;
+	transform->rotationX = 0;
+	transform->rotationW = 1;
+	transform->offsetX = 0;
+	transform->offsetZ = 0;
+
+	float len = sqrtf(clipPlane.y * clipPlane.y + clipPlane.z * clipPlane.z);
+	if (!worldSpace || len == 0) return;
+
+	float cosAngle = clipPlane.y / len;
+	float sinAngle = clipPlane.z / len;
+	transform->cosAngle = cosAngle;
+	transform->sinAngle = sinAngle;
+	transform->height = clipPlane.w / len;
+
+	// points rotate by -angle about X, so the quaternion is (-sin(angle / 2), 0, 0, cos(angle / 2))
+	float sinHalf = sqrtf((1 - cosAngle) / 2);
+	transform->rotationX = sinAngle < 0 ? sinHalf : -sinHalf;
+	transform->rotationW = sqrtf((1 + cosAngle) / 2);
+}
+
+/**
+ * The position part of transformJoints(), for a single point.
+ */
+void transformPosition(const FRAME_TRANSFORM *transform, CameraSpacePoint *position) {
+	float x = position->X * transform->mirrorX;
+	float y = position->Y;
+	float z = position->Z;
+
+	position->X = x - transform->offsetX;
+	position->Y = transform->height + (y * transform->cosAngle + z * transform->sinAngle);
+	position->Z = (z * transform->cosAngle - y * transform->sinAngle) - transform->offsetZ;
+}
+
+/**
+ * Copy the locations & rotations of every body of the frame into structure of arrays form.
+ */
+void gatherJoints(const FRAME_DATA *frame, JOINT_SOA *soa) {
+	int n = 0;
+	for (int b = 0; b < frame->bodyCount; b++) {
+		const BODY_DATA *body = &frame->bodies[b];
+
+		for (int j = 0; j < JointType_Count; j++, n++) {
+			const CameraSpacePoint &position = body->joints[j].Position;
+			const Vector4 &orientation = body->rotations[j].Orientation;
+
+			soa->px[n] = position.X;
+			soa->py[n] = position.Y;
+			soa->pz[n] = position.Z;
+			soa->qx[n] = orientation.x;
+			soa->qy[n] = orientation.y;
+			soa->qz[n] = orientation.z;
+			soa->qw[n] = orientation.w;
+		}
+	}
+	soa->count = n;
+
+	// the kernels run to a multiple of 8, so keep what is past the last joint defined
+	for (; n < JOINT_SOA_SZ && (n & 7) != 0; n++) {
+		soa->px[n] = soa->py[n] = soa->pz[n] = 0;
+		soa->qx[n] = soa->qy[n] = soa->qz[n] = soa->qw[n] = 0;
+	}
+}
+
+/**
+ * Copy transformed joints back into the bodies they were gathered from.
+ */
+void scatterJoints(const JOINT_SOA *soa, FRAME_DATA *frame) {
+	int n = 0;
+	for (int b = 0; b < frame->bodyCount; b++) {
+		BODY_DATA *body = &frame->bodies[b];
+
+		for (int j = 0; j < JointType_Count; j++, n++) {
+			CameraSpacePoint &position = body->joints[j].Position;
+			Vector4 &orientation = body->rotations[j].Orientation;
+
+			position.X = soa->px[n];
+			position.Y = soa->py[n];
+			position.Z = soa->pz[n];
+			orientation.x = soa->qx[n];
+			orientation.y = soa->qy[n];
+			orientation.z = soa->qz[n];
+			orientation.w = soa->qw[n];
+		}
+	}
+}
+
+/**
+ * Mirror, rotate into world space, & offset by the root basis, one joint at a time.  The reference the vector kernels
+ * are checked against in -bench transform.
+ * When Blender does a reflection paste on a quaternion, it just flips the signs of both Y & Z, so mirroring does too.
+ * The world space rotation of a quaternion is the floor rotation applied to it, r * q, where r only has X & W.
+ */
+void transformJointsScalar(JOINT_SOA *soa, const FRAME_TRANSFORM *transform) {
+	const float m = transform->mirrorX;
+	const float rx = transform->rotationX;
+	const float rw = transform->rotationW;
+
+	for (int i = 0; i < soa->count; i++) {
+		CameraSpacePoint position = { soa->px[i], soa->py[i], soa->pz[i] };
+		transformPosition(transform, &position);
+		soa->px[i] = position.X;
+		soa->py[i] = position.Y;
+		soa->pz[i] = position.Z;
+
+		float x = soa->qx[i];
+		float y = soa->qy[i] * m;
+		float z = soa->qz[i] * m;
+		float w = soa->qw[i];
+
+		soa->qx[i] = rw * x + rx * w;
+		soa->qy[i] = rw * y - rx * z;
+		soa->qz[i] = rw * z + rx * y;
+		soa->qw[i] = rw * w - rx * x;
+	}
+}
+
+#if defined(TRANSFORM_AVX)
+/**
+ * As transformJointsScalar(), 8 joints at a time.
+ */
+void transformJoints(JOINT_SOA *soa, const FRAME_TRANSFORM *transform) {
+	const __m256 m = _mm256_set1_ps(transform->mirrorX);
+	const __m256 c = _mm256_set1_ps(transform->cosAngle);
+	const __m256 s = _mm256_set1_ps(transform->sinAngle);
+	const __m256 h = _mm256_set1_ps(transform->height);
+	const __m256 rx = _mm256_set1_ps(transform->rotationX);
+	const __m256 rw = _mm256_set1_ps(transform->rotationW);
+	const __m256 ox = _mm256_set1_ps(transform->offsetX);
+	const __m256 oz = _mm256_set1_ps(transform->offsetZ);
+
+	for (int i = 0; i < soa->count; i += 8) {
+		__m256 px = _mm256_mul_ps(_mm256_load_ps(&soa->px[i]), m);
+		__m256 py = _mm256_load_ps(&soa->py[i]);
+		__m256 pz = _mm256_load_ps(&soa->pz[i]);
+
+		_mm256_store_ps(&soa->px[i], _mm256_sub_ps(px, ox));
+		_mm256_store_ps(&soa->py[i], _mm256_add_ps(h, _mm256_add_ps(_mm256_mul_ps(py, c), _mm256_mul_ps(pz, s))));
+		_mm256_store_ps(&soa->pz[i], _mm256_sub_ps(_mm256_sub_ps(_mm256_mul_ps(pz, c), _mm256_mul_ps(py, s)), oz));
+
+		__m256 x = _mm256_load_ps(&soa->qx[i]);
+		__m256 y = _mm256_mul_ps(_mm256_load_ps(&soa->qy[i]), m);
+		__m256 z = _mm256_mul_ps(_mm256_load_ps(&soa->qz[i]), m);
+		__m256 w = _mm256_load_ps(&soa->qw[i]);
+
+		_mm256_store_ps(&soa->qx[i], _mm256_add_ps(_mm256_mul_ps(rw, x), _mm256_mul_ps(rx, w)));
+		_mm256_store_ps(&soa->qy[i], _mm256_sub_ps(_mm256_mul_ps(rw, y), _mm256_mul_ps(rx, z)));
+		_mm256_store_ps(&soa->qz[i], _mm256_add_ps(_mm256_mul_ps(rw, z), _mm256_mul_ps(rx, y)));
+		_mm256_store_ps(&soa->qw[i], _mm256_sub_ps(_mm256_mul_ps(rw, w), _mm256_mul_ps(rx, x)));
+	}
+}
+
+const char *getTransformKernel() {
+	return "avx";
+}
+
+#elif defined(TRANSFORM_SSE)
+/**
+ * As transformJointsScalar(), 4 joints at a time.
+ */
+void transformJoints(JOINT_SOA *soa, const FRAME_TRANSFORM *transform) {
+	const __m128 m = _mm_set1_ps(transform->mirrorX);
+	const __m128 c = _mm_set1_ps(transform->cosAngle);
+	const __m128 s = _mm_set1_ps(transform->sinAngle);
+	const __m128 h = _mm_set1_ps(transform->height);
+	const __m128 rx = _mm_set1_ps(transform->rotationX);
+	const __m128 rw = _mm_set1_ps(transform->rotationW);
+	const __m128 ox = _mm_set1_ps(transform->offsetX);
+	const __m128 oz = _mm_set1_ps(transform->offsetZ);
+
+	for (int i = 0; i < soa->count; i += 4) {
+		__m128 px = _mm_mul_ps(_mm_load_ps(&soa->px[i]), m);
+		__m128 py = _mm_load_ps(&soa->py[i]);
+		__m128 pz = _mm_load_ps(&soa->pz[i]);
+
+		_mm_store_ps(&soa->px[i], _mm_sub_ps(px, ox));
+		_mm_store_ps(&soa->py[i], _mm_add_ps(h, _mm_add_ps(_mm_mul_ps(py, c), _mm_mul_ps(pz, s))));
+		_mm_store_ps(&soa->pz[i], _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(pz, c), _mm_mul_ps(py, s)), oz));
+
+		__m128 x = _mm_load_ps(&soa->qx[i]);
+		__m128 y = _mm_mul_ps(_mm_load_ps(&soa->qy[i]), m);
+		__m128 z = _mm_mul_ps(_mm_load_ps(&soa->qz[i]), m);
+		__m128 w = _mm_load_ps(&soa->qw[i]);
+
+		_mm_store_ps(&soa->qx[i], _mm_add_ps(_mm_mul_ps(rw, x), _mm_mul_ps(rx, w)));
+		_mm_store_ps(&soa->qy[i], _mm_sub_ps(_mm_mul_ps(rw, y), _mm_mul_ps(rx, z)));
+		_mm_store_ps(&soa->qz[i], _mm_add_ps(_mm_mul_ps(rw, z), _mm_mul_ps(rx, y)));
+		_mm_store_ps(&soa->qw[i], _mm_sub_ps(_mm_mul_ps(rw, w), _mm_mul_ps(rx, x)));
+	}
+}
+
+const char *getTransformKernel() {
+	return "sse";
+}
+
+#else
+void transformJoints(JOINT_SOA *soa, const FRAME_TRANSFORM *transform) {
+	transformJointsScalar(soa, transform);
+}
+
+const char *getTransformKernel() {
+	return "scalar";
+}
+#endif
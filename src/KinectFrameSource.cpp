@@ -0,0 +1,139 @@
+#include "KinectToJSON.h"
+
+// forward declare of non-external functions
+HRESULT copyFrame(IBodyFrame *bodyFrame, FRAME_DATA *frame);
+
+KinectFrameSource::KinectFrameSource(IKinectSensor *sensor) : sensor(sensor) {
+}
+
+KinectFrameSource::~KinectFrameSource() {
+	stop();
+}
+
+/**
+ * Open a body frame reader, & subscribe to its frame arrived event.
+ */
+HRESULT KinectFrameSource::start() {
+	//Get a body frame source from which we can get our body frame reader
+	IBodyFrameSource *bodyFrameSource = nullptr;
+	HRESULT hr = sensor->get_BodyFrameSource(&bodyFrameSource);
+
+	if (SUCCEEDED(hr)) {
+		hr = bodyFrameSource->OpenReader(&bodyFrameReader);
+	}
+
+	if (SUCCEEDED(hr)) {
+		hr = bodyFrameReader->SubscribeFrameArrived(&frameArrived);
+	}
+
+	if (SUCCEEDED(hr)) {
+		// manual reset, so once woken for stopping, every later wait returns immediately too
+		wakeEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+		if (wakeEvent == nullptr) hr = E_FAIL;
+	}
+
+	//We're done with bodyFrameSource, so we'll release it
+	SafeRelease(bodyFrameSource);
+
+	if (FAILED(hr)) stop();
+	return hr;
+}
+
+void KinectFrameSource::stop() {
+	if (bodyFrameReader != nullptr && frameArrived != 0) {
+		bodyFrameReader->UnsubscribeFrameArrived(frameArrived);
+	}
+	frameArrived = 0;
+	SafeRelease(bodyFrameReader);
+
+	if (wakeEvent != nullptr) CloseHandle(wakeEvent);
+	wakeEvent = nullptr;
+}
+
+/**
+ * Sleep till the sensor signals a new frame, rather than spinning on AcquireLatestFrame, which only succeeds 30 times a
+ * second.
+ */
+HRESULT KinectFrameSource::waitForFrame(FRAME_DATA *frame) {
+	HANDLE events[] = { reinterpret_cast<HANDLE>(frameArrived), wakeEvent };
+	DWORD signalled = WaitForMultipleObjects(_countof(events), events, FALSE, INFINITE);
+	if (signalled != WAIT_OBJECT_0) return S_FALSE;
+
+	// getting the event data is what resets the event
+	IBodyFrameArrivedEventArgs *args = nullptr;
+	HRESULT hr = bodyFrameReader->GetFrameArrivedEventData(frameArrived, &args);
+	SafeRelease(args);
+	if (FAILED(hr)) return hr;
+
+	hr = acquireLatestFrame(frame);
+	return hr == E_PENDING ? S_FALSE : hr;
+}
+
+HRESULT KinectFrameSource::acquireLatestFrame(FRAME_DATA *frame) {
+	IBodyFrame *bodyFrame = nullptr;
+	UINT64 start = stageClock();
+	HRESULT hr = bodyFrameReader->AcquireLatestFrame(&bodyFrame);
+
+	// only frames actually acquired are timed, so polling with nothing new does not swamp the stats
+	if (SUCCEEDED(hr)) {
+		start = endStage(TrackingStage_Acquire, start);
+		hr = copyFrame(bodyFrame, frame);
+		endStage(TrackingStage_Refresh, start);
+	}
+	SafeRelease(bodyFrame);
+	return hr;
+}
+
+void KinectFrameSource::wake() {
+	if (wakeEvent != nullptr) SetEvent(wakeEvent);
+}
+
+/**
+ * Copy the clip plane, time, & each tracked body out of the sensor's interfaces.
+ */
+HRESULT copyFrame(IBodyFrame *bodyFrame, FRAME_DATA *frame) {
+	HRESULT hr = bodyFrame->get_FloorClipPlane(&frame->clipPlane);
+
+	if (SUCCEEDED(hr)) {
+		hr = bodyFrame->get_RelativeTime(&frame->relativeTime);
+	}
+
+	IBody *bodies[BODY_COUNT] = { 0 };
+	if (SUCCEEDED(hr)) {
+		hr = bodyFrame->GetAndRefreshBodyData(_countof(bodies), bodies);
+	}
+
+	frame->bodyCount = 0;
+	if (SUCCEEDED(hr)) {
+		for (unsigned int bodyIndex = 0; bodyIndex < _countof(bodies); bodyIndex++) {
+			IBody *body = bodies[bodyIndex];
+			BODY_DATA *out = &frame->bodies[frame->bodyCount];
+
+			//Get the tracking status for the body, if it's not tracked we'll skip it
+			BOOLEAN isTracked = false;
+			HRESULT bodyHr = body->get_IsTracked(&isTracked);
+			if (FAILED(bodyHr) || isTracked == false) {
+				continue;
+			}
+
+			if (FAILED(body->get_TrackingId(&out->id)) ||
+				FAILED(body->GetJoints(JointType_Count, out->joints)) ||
+				FAILED(body->GetJointOrientations(JointType_Count, out->rotations))) {
+				continue;
+			}
+
+			out->leftHandState = HandState_Unknown;
+			out->rightHandState = HandState_Unknown;
+
+			body->get_HandLeftState(&out->leftHandState);
+			body->get_HandRightState(&out->rightHandState);
+			frame->bodyCount++;
+		}
+	}
+
+	//After copying, we're done with our bodies so release them.
+	for (unsigned int bodyIndex = 0; bodyIndex < _countof(bodies); bodyIndex++) {
+		SafeRelease(bodies[bodyIndex]);
+	}
+	return hr;
+}
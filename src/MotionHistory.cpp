@@ -0,0 +1,231 @@
+#include "KinectToJSON.h"
+
+// forward declare of non-external functions
+void measuredMotion(MOTION_TRACK *track, const float *previous, const float *measured, float seconds);
+void oneEuroMotion(MOTION_TRACK *track, const float *previous, const float *measured, float seconds, const MOTION_CONFIG *config);
+void doubleExponentialMotion(MOTION_TRACK *track, const float *measured, float seconds, const MOTION_CONFIG *config);
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// file scope variables
+#define TICKS_PER_SECOND 10000000LL // of RelativeTime
+#define AXES (3 * JointType_Count)  // X, Y & Z of every joint, one after the other, as laid out in a track
+#define DERIVATIVE_CUTOFF_HZ 2.5f   // One-Euro, of velocity; above the usual 1 Hz, as it also predicts, where lag costs more
+
+void MotionHistory::configure(const MOTION_CONFIG *config) {
+	this->config = *config;
+}
+
+/**
+ * Forget every body.
+ */
+void MotionHistory::reset() {
+	std::lock_guard<std::mutex> lock(mu);
+	for (int i = 0; i < MOTION_MAX_TRACKS; i++) tracks[i].lastSeen = 0;
+	nUpdates = 0;
+}
+
+/**
+ * Add each body of a frame, after transforms, to the history of its id.  When a lead or a filter is configured, its joints
+ * are then replaced by where they are predicted to be, smoothed; otherwise the frame is left as it was.
+ */
+void MotionHistory::update(FRAME_DATA *frame) {
+	bool replace = config.leadMillis > 0 || config.filter != MotionFilter_None;
+
+	std::lock_guard<std::mutex> lock(mu);
+	nUpdates++;
+	for (int b = 0; b < frame->bodyCount; b++) {
+		BODY_DATA *body = &frame->bodies[b];
+		MOTION_TRACK *track = claim(body->id);
+
+		add(track, body, frame->relativeTime);
+		if (replace) predict(track, body);
+	}
+}
+
+/**
+ * Copy the history of a body.
+ * @returns S_FALSE, with no samples, when the id has not been seen, or has been forgotten.
+ */
+HRESULT MotionHistory::read(UINT64 id, BODY_MOTION *motion) {
+	if (motion == nullptr) return E_INVALIDARG;
+
+	std::lock_guard<std::mutex> lock(mu);
+	motion->id = id;
+	motion->nSamples = 0;
+	for (int i = 0; i < MOTION_MAX_TRACKS; i++) {
+		const MOTION_TRACK *track = &tracks[i];
+		if (track->id != id || track->lastSeen == 0) continue;
+
+		int nKept = std::min(track->nSamples, MOTION_HISTORY_FRAMES);
+		for (int s = 0; s < nKept; s++) {
+			motion->samples[s] = track->samples[(track->head - s + MOTION_HISTORY_FRAMES) % MOTION_HISTORY_FRAMES];
+		}
+		motion->nSamples = nKept;
+		memcpy(motion->location, track->location, sizeof(track->location));
+		memcpy(motion->velocity, track->velocity, sizeof(track->velocity));
+		memcpy(motion->acceleration, track->acceleration, sizeof(track->acceleration));
+		return S_OK;
+	}
+	return S_FALSE;
+}
+
+/**
+ * @returns the track of an id, or of the least recently seen, emptied for it.
+ */
+MOTION_TRACK *MotionHistory::claim(UINT64 id) {
+	MOTION_TRACK *oldest = &tracks[0];
+	for (int i = 0; i < MOTION_MAX_TRACKS; i++) {
+		MOTION_TRACK *track = &tracks[i];
+		if (track->id == id && track->lastSeen > 0) {
+			track->lastSeen = nUpdates;
+			return track;
+		}
+		if (track->lastSeen < oldest->lastSeen) oldest = track;
+	}
+
+	oldest->id = id;
+	oldest->lastSeen = nUpdates;
+	oldest->nSamples = 0;
+	return oldest;
+}
+
+/**
+ * Keep a frame of a body, & update the motion of its joints from it.  A frame not after the last is not kept, as there
+ * is nothing to work out a rate from, & one after a gap starts the body again.
+ */
+void MotionHistory::add(MOTION_TRACK *track, const BODY_DATA *body, INT64 relativeTime) {
+	const MOTION_SAMPLE *last = &track->samples[track->head];
+	float seconds = (float) (relativeTime - last->relativeTime) / TICKS_PER_SECOND;
+	if (track->nSamples > 0 && seconds <= 0) return;
+	if (seconds > MOTION_MAX_GAP_MILLIS / 1000.0f) track->nSamples = 0;
+
+	track->head = (track->head + 1) % MOTION_HISTORY_FRAMES;
+	MOTION_SAMPLE *sample = &track->samples[track->head];
+	sample->relativeTime = relativeTime;
+	for (int j = 0; j < JointType_Count; j++) {
+		const CameraSpacePoint &position = body->joints[j].Position;
+		sample->location[0][j] = position.X;
+		sample->location[1][j] = position.Y;
+		sample->location[2][j] = position.Z;
+	}
+
+	const float *previous = last->location[0];
+	const float *measured = sample->location[0];
+	float *location = track->location[0];
+	float *velocity = track->velocity[0];
+	float *acceleration = track->acceleration[0];
+	int nSeen = track->nSamples++;
+
+	// the first frame is where the body is, & the second how fast it moves, whatever the filter; none can tell sooner
+	if (nSeen == 0) {
+		memcpy(location, measured, sizeof(track->location));
+		memset(velocity, 0, sizeof(track->velocity));
+		memset(acceleration, 0, sizeof(track->acceleration));
+
+	} else if (nSeen == 1) {
+		for (int k = 0; k < AXES; k++) {
+			velocity[k] = (measured[k] - previous[k]) / seconds;
+			location[k] = measured[k];
+		}
+
+	} else if (config.filter == MotionFilter_OneEuro) {
+		oneEuroMotion(track, previous, measured, seconds, &config);
+
+	} else if (config.filter == MotionFilter_Double) {
+		doubleExponentialMotion(track, measured, seconds, &config);
+
+	} else {
+		measuredMotion(track, previous, measured, seconds);
+	}
+}
+
+/**
+ * Replace the locations of a body's joints with where its track puts them, config.leadMillis after its last frame,
+ * from their velocity & acceleration.  Rotations are left as they are.
+ */
+void MotionHistory::predict(const MOTION_TRACK *track, BODY_DATA *body) {
+	float lead = config.leadMillis / 1000.0f;
+	float halfLeadSquared = 0.5f * lead * lead;
+
+	for (int j = 0; j < JointType_Count; j++) {
+		CameraSpacePoint &position = body->joints[j].Position;
+		position.X = track->location[0][j] + track->velocity[0][j] * lead + track->acceleration[0][j] * halfLeadSquared;
+		position.Y = track->location[1][j] + track->velocity[1][j] * lead + track->acceleration[1][j] * halfLeadSquared;
+		position.Z = track->location[2][j] + track->velocity[2][j] * lead + track->acceleration[2][j] * halfLeadSquared;
+	}
+}
+
+/**
+ * Factor of a first order low pass, at a cutoff, for a step of a time.
+ */
+float lowPassFactor(float cutoffHz, float seconds) {
+	float timeConstant = 1.0f / (2.0f * 3.14159265f * cutoffHz);
+	return 1.0f / (1.0f + timeConstant / seconds);
+}
+
+/**
+ * Differences between frames, unfiltered.  Exact for steady motion, but noise is multiplied by the frame rate into
+ * velocity, & by its square into acceleration.
+ */
+void measuredMotion(MOTION_TRACK *track, const float *previous, const float *measured, float seconds) {
+	float *location = track->location[0];
+	float *velocity = track->velocity[0];
+	float *acceleration = track->acceleration[0];
+
+	for (int k = 0; k < AXES; k++) {
+		float rate = (measured[k] - previous[k]) / seconds;
+		acceleration[k] = (rate - velocity[k]) / seconds;
+		velocity[k] = rate;
+		location[k] = measured[k];
+	}
+}
+
+/**
+ * One-Euro, Casiez et al. 2012.  Velocity from the frames as measured is low passed at a fixed cutoff, & each joint's
+ * location at a cutoff which rises with its speed.  Acceleration is from the velocity, so as smooth.
+ */
+void oneEuroMotion(MOTION_TRACK *track, const float *previous, const float *measured, float seconds, const MOTION_CONFIG *config) {
+	float *location = track->location[0];
+	float *velocity = track->velocity[0];
+	float *acceleration = track->acceleration[0];
+	float derivative = lowPassFactor(DERIVATIVE_CUTOFF_HZ, seconds);
+
+	for (int k = 0; k < AXES; k++) {
+		float rate = (measured[k] - previous[k]) / seconds;
+		float smoothed = velocity[k] + derivative * (rate - velocity[k]);
+		acceleration[k] = (smoothed - velocity[k]) / seconds;
+		velocity[k] = smoothed;
+	}
+
+	// the cutoff of each joint, from its speed in any direction
+	float factor[JointType_Count];
+	for (int j = 0; j < JointType_Count; j++) {
+		const float *vx = track->velocity[0], *vy = track->velocity[1], *vz = track->velocity[2];
+		float speed = sqrtf(vx[j] * vx[j] + vy[j] * vy[j] + vz[j] * vz[j]);
+		factor[j] = lowPassFactor(config->smoothing + config->beta * speed, seconds);
+	}
+
+	for (int k = 0; k < AXES; k++) {
+		location[k] += factor[k % JointType_Count] * (measured[k] - location[k]);
+	}
+}
+
+/**
+ * Holt's double exponential, with the trend per second, so frames need not be evenly spaced.  The level is a blend of
+ * the frame & where the trend put it; the trend a blend of the change of level & itself, as is acceleration of the trend.
+ */
+void doubleExponentialMotion(MOTION_TRACK *track, const float *measured, float seconds, const MOTION_CONFIG *config) {
+	float *location = track->location[0];
+	float *velocity = track->velocity[0];
+	float *acceleration = track->acceleration[0];
+	float alpha = config->smoothing;
+	float beta = config->beta;
+
+	for (int k = 0; k < AXES; k++) {
+		float level = alpha * measured[k] + (1 - alpha) * (location[k] + velocity[k] * seconds);
+		float trend = beta * (level - location[k]) / seconds + (1 - beta) * velocity[k];
+		acceleration[k] = beta * (trend - velocity[k]) / seconds + (1 - beta) * acceleration[k];
+		velocity[k] = trend;
+		location[k] = level;
+	}
+}
@@ -0,0 +1,365 @@
+#include "KinectToJSON.h"
+
+#include <algorithm>
+#include <climits>
+
+// forward declare of non-external functions
+int countTrackedJoints(const BODY_DATA *body);
+
+/**
+ * @param toleranceMillis - The furthest apart in time frames of different sources can be, & still be merged.  Also the
+ * longest a frame of the first source waits for the others.
+ */
+MultiFrameSource::MultiFrameSource(int toleranceMillis) : tolerance(toleranceMillis * 10000LL), running(false) {
+}
+
+MultiFrameSource::~MultiFrameSource() {
+	stop();
+	for (int s = 0; s < nSources; s++) {
+		delete sources[s]->source;
+		delete sources[s];
+	}
+}
+
+/**
+ * Add a source, which is then owned by this.  The first added is the one merged frames are timed by.  Not while started.
+ * @param extrinsics - from the source's camera space to the world frame; nullptr for the same as the camera
+ */
+HRESULT MultiFrameSource::addSource(FrameSource *source, const SOURCE_EXTRINSICS *extrinsics) {
+	if (running || nSources == MULTI_MAX_SOURCES) return E_ABORT;
+
+	MULTI_SOURCE *added = new MULTI_SOURCE();
+	added->source = source;
+	added->extrinsics.rotation = { 0, 0, 0, 1 };
+	added->extrinsics.translation = { 0, 0, 0 };
+
+	if (extrinsics != nullptr) {
+		const Vector4 &q = extrinsics->rotation;
+		float len = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+		if (len > 0) added->extrinsics.rotation = { q.x / len, q.y / len, q.z / len, q.w / len };
+		added->extrinsics.translation = extrinsics->translation;
+	}
+	sources[nSources++] = added;
+	return S_OK;
+}
+
+int MultiFrameSource::getSourceCount() {
+	return nSources;
+}
+
+void MultiFrameSource::getStats(MULTI_SOURCE_STATS *stats) {
+	std::lock_guard<std::mutex> lock(mu);
+	stats->framesMerged = framesMerged;
+	stats->framesIncomplete = framesIncomplete;
+	stats->duplicateBodies = duplicateBodies;
+	stats->bodiesLeftOut = bodiesLeftOut;
+	stats->maxSkewUs = maxSkew / 10.0f;
+	alignment.getStats(&stats->alignment);
+}
+
+/**
+ * Start every source, then a thread reading each.
+ */
+HRESULT MultiFrameSource::start() {
+	if (nSources == 0) {
+		std::cerr << "No sources added.\n";
+		return E_ABORT;
+	}
+
+	for (int s = 0; s < nSources; s++) {
+		HRESULT hr = sources[s]->source->start();
+		if (FAILED(hr)) {
+			while (--s >= 0) sources[s]->source->stop();
+			return hr;
+		}
+		sources[s]->nReceived = 0;
+		sources[s]->haveOffset = false;
+		sources[s]->lastMerged = LLONG_MIN;
+	}
+
+	woken = false;
+	nextTick = 0;
+	framesMerged = 0;
+	framesIncomplete = 0;
+	duplicateBodies = 0;
+	bodiesLeftOut = 0;
+	maxSkew = 0;
+	alignment.reset();
+
+	running = true;
+	for (int s = 0; s < nSources; s++) {
+		threads[s] = std::thread(&MultiFrameSource::sourceLoop, this, s);
+	}
+	return S_OK;
+}
+
+void MultiFrameSource::stop() {
+	if (!running.exchange(false)) return;
+
+	{
+		std::lock_guard<std::mutex> lock(mu);
+		frameArrived.notify_all(); // any source thread waiting to retry
+	}
+	for (int s = 0; s < nSources; s++) {
+		sources[s]->source->wake();
+		threads[s].join();
+		sources[s]->source->stop();
+	}
+}
+
+/**
+ * Read a source till stopped, recording each frame as read, then moving it into the world frame before taking the lock,
+ * so sources are transformed in parallel.  A source which keeps failing, e.g. a sensor unplugged, is retried less & less
+ * often, rather than spun on.
+ */
+void MultiFrameSource::sourceLoop(int s) {
+	MULTI_SOURCE *source = sources[s];
+	int retryMillis = 1;
+
+	while (running) {
+		if (source->source->waitForFrame(&source->incoming) != S_OK) {
+			std::unique_lock<std::mutex> lock(mu);
+			frameArrived.wait_for(lock, std::chrono::milliseconds(retryMillis), [this] { return !running; });
+			retryMillis = std::min(retryMillis * 2, MULTI_MAX_RETRY_MILLIS);
+			continue;
+		}
+		retryMillis = 1;
+		INT64 arrival = hostTicks();
+		recordFrame(&source->incoming, s);
+		applyExtrinsics(&source->extrinsics, &source->incoming);
+
+		// the least delay seen is taken as none, so the clocks of sources which started at different times line up
+		INT64 offset = arrival - source->incoming.relativeTime;
+		if (!source->haveOffset || offset < source->clockOffset) {
+			source->clockOffset = offset;
+			source->haveOffset = true;
+		}
+
+		std::lock_guard<std::mutex> lock(mu);
+		ALIGNED_FRAME *aligned = &source->frames[source->nReceived % MULTI_SOURCE_FRAMES];
+		aligned->frame.clipPlane = source->incoming.clipPlane;
+		aligned->frame.relativeTime = source->incoming.relativeTime;
+		aligned->frame.bodyCount = source->incoming.bodyCount;
+		memcpy(aligned->frame.bodies, source->incoming.bodies, source->incoming.bodyCount * sizeof(BODY_DATA));
+		aligned->alignedTime = source->incoming.relativeTime + source->clockOffset;
+		aligned->arrivalTime = arrival;
+		source->nReceived++;
+		frameArrived.notify_all();
+	}
+}
+
+/**
+ * Sleep till every source has a frame for the first source's next, or the tolerance has passed since it arrived.
+ */
+HRESULT MultiFrameSource::waitForFrame(FRAME_DATA *frame) {
+	std::unique_lock<std::mutex> lock(mu);
+	while (!woken) {
+		INT64 deadline;
+		if (mergeReady(frame, &deadline)) return S_OK;
+
+		if (deadline == 0) {
+			frameArrived.wait(lock);
+
+		} else {
+			std::chrono::nanoseconds due(deadline * 100);
+			frameArrived.wait_until(lock, std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(due)));
+		}
+	}
+	return S_FALSE;
+}
+
+HRESULT MultiFrameSource::acquireLatestFrame(FRAME_DATA *frame) {
+	std::lock_guard<std::mutex> lock(mu);
+	INT64 deadline;
+	return mergeReady(frame, &deadline) ? S_OK : E_PENDING;
+}
+
+void MultiFrameSource::wake() {
+	std::lock_guard<std::mutex> lock(mu);
+	woken = true;
+	frameArrived.notify_all();
+}
+
+/**
+ * Merge the first source's next frame, if the others are ready for it.  Called with the lock held.
+ * @param deadline - set to when it will be merged regardless, or 0 when there is no frame to merge yet
+ */
+bool MultiFrameSource::mergeReady(FRAME_DATA *frame, INT64 *deadline) {
+	MULTI_SOURCE *first = sources[0];
+	*deadline = 0;
+	if (nextTick >= first->nReceived) return false;
+
+	// frames of the first source which have been overwritten are skipped, as a sensor would skip them
+	if (first->nReceived - nextTick > MULTI_SOURCE_FRAMES) nextTick = first->nReceived - MULTI_SOURCE_FRAMES;
+	const ALIGNED_FRAME *tick = &first->frames[nextTick % MULTI_SOURCE_FRAMES];
+
+	// once every other source has a frame at or after the tick, or its next, by its last period, would be further from
+	// the tick than its latest, no nearer frame can still arrive
+	bool settled = true;
+	for (int s = 1; s < nSources && settled; s++) {
+		const MULTI_SOURCE *source = sources[s];
+		if (source->nReceived == 0) {
+			settled = false;
+			continue;
+		}
+
+		INT64 latest = source->frames[(source->nReceived - 1) % MULTI_SOURCE_FRAMES].alignedTime;
+		settled = latest >= tick->alignedTime;
+		if (!settled && source->nReceived > 1) {
+			INT64 period = latest - source->frames[(source->nReceived - 2) % MULTI_SOURCE_FRAMES].alignedTime;
+			settled = latest + period - tick->alignedTime >= tick->alignedTime - latest;
+		}
+	}
+
+	*deadline = tick->arrivalTime + tolerance;
+	if (!settled && hostTicks() < *deadline) return false;
+
+	merge(tick, frame);
+	nextTick++;
+	return true;
+}
+
+/**
+ * The first source's frame, with the bodies of the frame nearest in time of each other source.
+ */
+void MultiFrameSource::merge(const ALIGNED_FRAME *tick, FRAME_DATA *frame) {
+	frame->clipPlane = tick->frame.clipPlane;
+	frame->relativeTime = tick->frame.relativeTime;
+	frame->bodyCount = tick->frame.bodyCount;
+	memcpy(frame->bodies, tick->frame.bodies, tick->frame.bodyCount * sizeof(BODY_DATA));
+
+	bool complete = true;
+	for (int s = 1; s < nSources; s++) {
+		MULTI_SOURCE *source = sources[s];
+		const ALIGNED_FRAME *nearest = nullptr;
+		INT64 nearestGap = tolerance + 1;
+
+		UINT64 nKept = source->nReceived < MULTI_SOURCE_FRAMES ? source->nReceived : MULTI_SOURCE_FRAMES;
+		for (UINT64 i = source->nReceived - nKept; i < source->nReceived; i++) {
+			const ALIGNED_FRAME *candidate = &source->frames[i % MULTI_SOURCE_FRAMES];
+			if (candidate->alignedTime <= source->lastMerged) continue;
+
+			INT64 gap = candidate->alignedTime - tick->alignedTime;
+			if (gap < 0) gap = -gap;
+			if (gap < nearestGap) {
+				nearest = candidate;
+				nearestGap = gap;
+			}
+		}
+
+		if (nearest == nullptr) {
+			complete = false;
+			continue;
+		}
+		source->lastMerged = nearest->alignedTime;
+		if (nearestGap > maxSkew) maxSkew = nearestGap;
+		mergeBodies(frame, &nearest->frame, s);
+	}
+
+	framesMerged++;
+	if (!complete) framesIncomplete++;
+	alignment.record((UINT64) (hostTicks() - tick->arrivalTime) * 100);
+}
+
+/**
+ * Add the bodies of another source's frame, unless already seen by an earlier source.  The ids of bodies first seen by
+ * a later source have the source # in bits 48 up, as sensors are not told of each other's ids.
+ */
+void MultiFrameSource::mergeBodies(FRAME_DATA *frame, const FRAME_DATA *from, int s) {
+	const int nEarlier = frame->bodyCount;
+
+	for (int b = 0; b < from->bodyCount; b++) {
+		const BODY_DATA *body = &from->bodies[b];
+		const CameraSpacePoint &spine = body->joints[JointType_SpineBase].Position;
+
+		int same = -1;
+		float nearest = MULTI_SAME_BODY_METERS * MULTI_SAME_BODY_METERS;
+		for (int k = 0; k < nEarlier; k++) {
+			const CameraSpacePoint &other = frame->bodies[k].joints[JointType_SpineBase].Position;
+			float dx = spine.X - other.X;
+			float dy = spine.Y - other.Y;
+			float dz = spine.Z - other.Z;
+			float distance = dx * dx + dy * dy + dz * dz;
+			if (distance < nearest) {
+				nearest = distance;
+				same = k;
+			}
+		}
+
+		if (same >= 0) {
+			duplicateBodies++;
+			BODY_DATA *kept = &frame->bodies[same];
+			if (countTrackedJoints(body) > countTrackedJoints(kept)) {
+				UINT64 id = kept->id;
+				*kept = *body;
+				kept->id = id;
+			}
+
+		} else if (frame->bodyCount < BODY_COUNT) {
+			BODY_DATA *added = &frame->bodies[frame->bodyCount++];
+			*added = *body;
+			added->id ^= (UINT64) s << 48;
+
+		} else {
+			bodiesLeftOut++;
+		}
+	}
+}
+
+/**
+ * Move the clip plane, & every joint of every body, from a source's camera space into the world frame.
+ */
+void applyExtrinsics(const SOURCE_EXTRINSICS *extrinsics, FRAME_DATA *frame) {
+	const Vector4 &r = extrinsics->rotation;
+	const CameraSpacePoint &t = extrinsics->translation;
+
+	// the plane's normal rotates, & its distance shifts by how far the translation moves along it
+	CameraSpacePoint normal = { frame->clipPlane.x, frame->clipPlane.y, frame->clipPlane.z };
+	rotatePoint(r, &normal);
+	frame->clipPlane.x = normal.X;
+	frame->clipPlane.y = normal.Y;
+	frame->clipPlane.z = normal.Z;
+	frame->clipPlane.w -= normal.X * t.X + normal.Y * t.Y + normal.Z * t.Z;
+
+	for (int b = 0; b < frame->bodyCount; b++) {
+		BODY_DATA *body = &frame->bodies[b];
+
+		for (int j = 0; j < JointType_Count; j++) {
+			CameraSpacePoint &position = body->joints[j].Position;
+			rotatePoint(r, &position);
+			position.X += t.X;
+			position.Y += t.Y;
+			position.Z += t.Z;
+
+			Vector4 &orientation = body->rotations[j].Orientation;
+			orientation = multiplyQuaternions(r, orientation);
+		}
+	}
+}
+
+/**
+ * The extrinsics which move a point of the world frame back into the source's camera space.
+ */
+void invertExtrinsics(const SOURCE_EXTRINSICS *extrinsics, SOURCE_EXTRINSICS *inverse) {
+	const Vector4 &r = extrinsics->rotation;
+	inverse->rotation = { -r.x, -r.y, -r.z, r.w };
+
+	CameraSpacePoint t = { -extrinsics->translation.X, -extrinsics->translation.Y, -extrinsics->translation.Z };
+	rotatePoint(inverse->rotation, &t);
+	inverse->translation = t;
+}
+
+/**
+ * The host's steady clock, in the 100ns ticks of RelativeTime.
+ */
+INT64 hostTicks() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() / 100;
+}
+
+int countTrackedJoints(const BODY_DATA *body) {
+	int tracked = 0;
+	for (int j = 0; j < JointType_Count; j++) {
+		if (body->joints[j].TrackingState == TrackingState_Tracked) tracked++;
+	}
+	return tracked;
+}
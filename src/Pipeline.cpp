@@ -0,0 +1,134 @@
+#include "KinectToJSON.h"
+
+/**
+ * @param nSlots - The most frames in flight, between being acquired & delivered.
+ */
+FramePipeline::FramePipeline(int nSlots) : nSlots(nSlots), running(false) {
+}
+
+FramePipeline::~FramePipeline() {
+	stop();
+	delete[] slots;
+}
+
+/**
+ * Start a thread for each stage, & nWorkers to serialize.  Only call when not running.
+ */
+void FramePipeline::start(const PIPELINE_STAGES *stages, int nWorkers) {
+	if (slots == nullptr) slots = new PIPELINE_SLOT[nSlots];
+	for (int i = 0; i < nSlots; i++) slots[i].serialized = false;
+
+	this->stages = stages;
+	this->nWorkers = nWorkers < 1 ? 1 : (nWorkers > PIPELINE_MAX_WORKERS ? PIPELINE_MAX_WORKERS : nWorkers);
+	nAcquired = 0;
+	nExtracted = 0;
+	nClaimed = 0;
+	nDelivered = 0;
+	running = true;
+
+	acquirer = std::thread(&FramePipeline::acquireLoop, this);
+	extractor = std::thread(&FramePipeline::extractLoop, this);
+	for (int i = 0; i < this->nWorkers; i++) workers[i] = std::thread(&FramePipeline::serializeLoop, this);
+	deliverer = std::thread(&FramePipeline::deliverLoop, this);
+}
+
+/**
+ * Block till every thread is done.  Frames not yet delivered are thrown away.  The acquire stage must be woken first,
+ * when it could be waiting for a frame which is not coming.
+ */
+void FramePipeline::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mu);
+		if (!running) return;
+		running = false;
+		slotFree.notify_all();
+		acquired.notify_all();
+		extracted.notify_all();
+		serialized.notify_all();
+	}
+
+	acquirer.join();
+	extractor.join();
+	for (int i = 0; i < nWorkers; i++) workers[i].join();
+	deliverer.join();
+}
+
+bool FramePipeline::isRunning() {
+	return running;
+}
+
+void FramePipeline::acquireLoop() {
+	while (running) {
+		PIPELINE_SLOT *slot;
+		{
+			std::unique_lock<std::mutex> lock(mu);
+			slotFree.wait(lock, [this] { return !running || nAcquired - nDelivered < (UINT64) nSlots; });
+			if (!running) return;
+			slot = &slots[nAcquired % nSlots];
+		}
+
+		// the slot is not touched by any other stage till counted as acquired
+		if (stages->acquire(&slot->in) != S_OK) continue;
+
+		std::lock_guard<std::mutex> lock(mu);
+		nAcquired++;
+		acquired.notify_one();
+	}
+}
+
+void FramePipeline::extractLoop() {
+	while (running) {
+		PIPELINE_SLOT *slot;
+		{
+			std::unique_lock<std::mutex> lock(mu);
+			acquired.wait(lock, [this] { return !running || nExtracted < nAcquired; });
+			if (!running) return;
+			slot = &slots[nExtracted % nSlots];
+		}
+
+		slot->send = stages->extract(&slot->in, &slot->out, &slot->delta);
+
+		std::lock_guard<std::mutex> lock(mu);
+		nExtracted++;
+		extracted.notify_one();
+	}
+}
+
+void FramePipeline::serializeLoop() {
+	while (running) {
+		PIPELINE_SLOT *slot;
+		{
+			std::unique_lock<std::mutex> lock(mu);
+			extracted.wait(lock, [this] { return !running || nClaimed < nExtracted; });
+			if (!running) return;
+			slot = &slots[nClaimed++ % nSlots];
+		}
+
+		// frames with nothing to send still pass through, so the deliverer sees every slot in turn
+		if (slot->send) slot->len = stages->serialize(&slot->out, &slot->delta, slot->buffer);
+
+		std::lock_guard<std::mutex> lock(mu);
+		slot->serialized = true;
+		serialized.notify_one();
+	}
+}
+
+void FramePipeline::deliverLoop() {
+	while (running) {
+		PIPELINE_SLOT *slot;
+		{
+			std::unique_lock<std::mutex> lock(mu);
+			// in order; a later frame serialized first waits for this one
+			serialized.wait(lock, [this] { return !running || slots[nDelivered % nSlots].serialized; });
+			if (!running) return;
+			slot = &slots[nDelivered % nSlots];
+		}
+
+		if (slot->send) stages->deliver(&slot->out, slot->buffer, slot->len);
+
+		std::lock_guard<std::mutex> lock(mu);
+		slot->serialized = false;
+		nDelivered++;
+		slotFree.notify_one();
+	}
+}
@@ -0,0 +1,418 @@
+#include "KinectToJSON.h"
+
+#include <stdlib.h>
+#include <vector>
+
+// forward declare of non-external functions
+const char *readToken(const char *p, char *token, int tokenSz);
+const char *parsePoseTerm(const char *p, POSE_TERM *term);
+bool parseJoint(const char *token, int *joint, int *axis);
+bool parseNumber(const char *token, float *value);
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// file scope variables
+#define TOKEN_SZ 64
+#define POSE_EVENT_JSON_SZ (128 + POSE_NAME_SZ)
+
+const char *POSE_ACTIONS[] = { "start", "stop", "marker" };
+
+PoseMatcher::PoseMatcher() {
+	memset(states, 0, sizeof(states));
+}
+
+/**
+ * Replace the templates with those of the text, one a line:
+ *     name start|stop|marker [holdFrames] : term ; term ...
+ * where each term is one of:
+ *     Joint.axis > Joint.axis [meters]    at least meters above, along x, y or z; < for below
+ *     distance Joint Joint < meters       closer than; > for further than
+ *     angle Joint Joint Joint degrees tolerance    the angle at the middle joint
+ * Blank lines, & lines starting with #, are skipped.  Only call when evaluate() is not running.
+ * @returns E_INVALIDARG when any line is not understood, leaving the templates as they were.
+ */
+HRESULT PoseMatcher::load(const char *text) {
+	std::vector<POSE_TEMPLATE> parsed;
+
+	int lineNumber = 0;
+	for (const char *line = text; line != nullptr && *line != '\0'; ) {
+		const char *end = strchr(line, '\n');
+		std::string content(line, end != nullptr ? end - line : strlen(line));
+		line = end != nullptr ? end + 1 : nullptr;
+		lineNumber++;
+
+		size_t first = content.find_first_not_of(" \t\r");
+		if (first == std::string::npos || content[first] == '#') continue;
+
+		POSE_TEMPLATE pose;
+		if (parsed.size() == POSE_MAX_TEMPLATES || FAILED(parsePoseTemplate(content.c_str(), &pose))) {
+			std::cerr << "Pose template on line " << lineNumber << " not understood: " << content << "\n";
+			return E_INVALIDARG;
+		}
+		parsed.push_back(pose);
+	}
+
+	nLoaded = (int) parsed.size();
+	if (nLoaded > 0) memcpy(templates, parsed.data(), nLoaded * sizeof(POSE_TEMPLATE));
+	return S_OK;
+}
+
+int PoseMatcher::getTemplateCount() {
+	return nLoaded;
+}
+
+/**
+ * Forget every body & event, when tracking begins.
+ * @param startPose - when no template loaded starts bodies, add POSE_DEFAULT_TEMPLATE
+ */
+void PoseMatcher::start(bool startPose) {
+	nTemplates = nLoaded;
+
+	bool hasStart = false;
+	bool hasStop = false;
+	for (int t = 0; t < nTemplates; t++) {
+		hasStart |= templates[t].action == PoseAction_Start;
+		hasStop |= templates[t].action == PoseAction_Stop;
+	}
+	if (startPose && !hasStart) {
+		parsePoseTemplate(POSE_DEFAULT_TEMPLATE, &templates[nTemplates++]);
+		hasStart = true;
+	}
+	gated = hasStart || hasStop;
+	needsStart = hasStart;
+
+	memset(states, 0, sizeof(states));
+	nEvaluated = 0;
+
+	std::lock_guard<std::mutex> lock(eventMu);
+	eventsAdded = 0;
+	eventsPolled = 0;
+}
+
+/**
+ * Every template against every body of the frame.  Each term is checked for all bodies together, from the joints laid
+ * out as a structure of arrays, before the next term.
+ */
+void PoseMatcher::match(const FRAME_DATA *frame, POSE_MASK *matches) {
+	int nBodies = frame->bodyCount;
+	gatherJoints(frame, &soa);
+	const float *axes[] = { soa.px, soa.py, soa.pz };
+
+	for (int b = 0; b < nBodies; b++) {
+		for (int w = 0; w < POSE_MASK_WORDS; w++) {
+			int inWord = nTemplates - w * 64;
+			matches[b].bits[w] = inWord >= 64 ? ~0ULL : inWord > 0 ? (1ULL << inWord) - 1 : 0;
+		}
+	}
+
+	for (int t = 0; t < nTemplates; t++) {
+		UINT64 bit = 1ULL << (t & 63);
+		int word = t >> 6;
+
+		for (int i = 0; i < templates[t].nTerms; i++) {
+			const POSE_TERM &term = templates[t].terms[i];
+			int j0 = term.joints[0];
+			int j1 = term.joints[1];
+			int j2 = term.joints[2];
+
+			switch (term.kind) {
+			case PoseTerm_AtLeast: {
+				const float *axis = axes[term.axis];
+				for (int b = 0; b < nBodies; b++) {
+					int base = b * JointType_Count;
+					if (!(axis[base + j0] - axis[base + j1] >= term.value)) matches[b].bits[word] &= ~bit;
+				}
+				break;
+			}
+
+			case PoseTerm_Within:
+			case PoseTerm_Beyond: {
+				float limit = term.value * term.value;
+				bool within = term.kind == PoseTerm_Within;
+				for (int b = 0; b < nBodies; b++) {
+					int base = b * JointType_Count;
+					float dx = soa.px[base + j0] - soa.px[base + j1];
+					float dy = soa.py[base + j0] - soa.py[base + j1];
+					float dz = soa.pz[base + j0] - soa.pz[base + j1];
+					float squared = dx * dx + dy * dy + dz * dz;
+					if ((squared < limit) != within) matches[b].bits[word] &= ~bit;
+				}
+				break;
+			}
+
+			case PoseTerm_Angle:
+				// within the range when the cosine is, scaled by the lengths of both bones rather than divided
+				for (int b = 0; b < nBodies; b++) {
+					int base = b * JointType_Count;
+					float ux = soa.px[base + j0] - soa.px[base + j1];
+					float uy = soa.py[base + j0] - soa.py[base + j1];
+					float uz = soa.pz[base + j0] - soa.pz[base + j1];
+					float vx = soa.px[base + j2] - soa.px[base + j1];
+					float vy = soa.py[base + j2] - soa.py[base + j1];
+					float vz = soa.pz[base + j2] - soa.pz[base + j1];
+					float dot = ux * vx + uy * vy + uz * vz;
+					float lengths = sqrtf((ux * ux + uy * uy + uz * uz) * (vx * vx + vy * vy + vz * vz));
+					if (!(lengths > 0 && dot <= term.cosLow * lengths && dot >= term.cosHigh * lengths)) matches[b].bits[word] &= ~bit;
+				}
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * Match the frame, then act on every template which each body has now held for its holdFrames.
+ * @param frameNumber - of the events
+ * @param send - set for each body of the frame, true when it is started, or bodies need no starting
+ */
+void PoseMatcher::evaluate(const FRAME_DATA *frame, int frameNumber, bool *send) {
+	POSE_MASK matches[BODY_COUNT];
+	match(frame, matches);
+	nEvaluated++;
+
+	for (int b = 0; b < frame->bodyCount; b++) {
+		UINT64 id = frame->bodies[b].id;
+		POSE_BODY_STATE *state = findState(id);
+
+		for (int t = 0; t < nTemplates; t++) {
+			if ((matches[b].bits[t >> 6] & (1ULL << (t & 63))) == 0) {
+				state->held[t] = 0;
+				continue;
+			}
+			if (state->held[t] < UINT16_MAX) state->held[t]++;
+
+			// once each time it is held long enough
+			if (state->held[t] != templates[t].holdFrames) continue;
+
+			const POSE_TEMPLATE &pose = templates[t];
+			if (pose.action == PoseAction_Start && !state->started) {
+				state->started = true;
+				std::cout << "ID: " << id << " passed " << pose.name << " pose\n";
+				addEvent(frameNumber, id, pose);
+
+			} else if (pose.action == PoseAction_Stop && state->started) {
+				state->started = false;
+				addEvent(frameNumber, id, pose);
+
+			} else if (pose.action == PoseAction_Marker && (!gated || state->started)) {
+				addEvent(frameNumber, id, pose);
+			}
+		}
+		send[b] = !gated || state->started;
+	}
+}
+
+/**
+ * Events since last polled, as a JSON array, oldest first.  Only the last POSE_EVENT_SLOTS are kept.
+ * @returns as pollFrame(); the events are still there to poll, when bufferLen was too small.
+ */
+int PoseMatcher::pollEvents(char *buffer, int bufferLen) {
+	static char json[POSE_EVENT_SLOTS * POSE_EVENT_JSON_SZ + 8];
+
+	std::lock_guard<std::mutex> lock(eventMu);
+	if (eventsAdded - eventsPolled > POSE_EVENT_SLOTS) eventsPolled = eventsAdded - POSE_EVENT_SLOTS;
+	if (eventsAdded == eventsPolled) return 0;
+
+	int len = sprintf_s(json, sizeof(json), "[");
+	for (UINT64 e = eventsPolled; e < eventsAdded; e++) {
+		const POSE_EVENT &event = events[e % POSE_EVENT_SLOTS];
+		len += sprintf_s(json + len, sizeof(json) - len, "%s{\"frame\": %d, \"id\": %lld, \"pose\": \"%s\", \"action\": \"%s\"}",
+			e > eventsPolled ? ", " : "", event.frame, (INT64) event.id, event.pose, POSE_ACTIONS[event.action]);
+	}
+	len += sprintf_s(json + len, sizeof(json) - len, "]");
+
+	if (bufferLen < len + 1) return -(len + 1);
+	memcpy(buffer, json, len + 1);
+	eventsPolled = eventsAdded;
+	return len + 1;
+}
+
+/**
+ * The state of a body, taking that of the least recently seen when the id is new.  Poses held before a body was last
+ * missing from a frame are not carried on.
+ */
+POSE_BODY_STATE *PoseMatcher::findState(UINT64 id) {
+	POSE_BODY_STATE *oldest = &states[0];
+	for (int i = 0; i < POSE_MAX_BODY_STATES; i++) {
+		POSE_BODY_STATE *state = &states[i];
+		if (state->id == id && state->lastSeen > 0) {
+			if (state->lastSeen + 1 != nEvaluated) memset(state->held, 0, sizeof(state->held));
+			state->lastSeen = nEvaluated;
+			return state;
+		}
+		if (state->lastSeen < oldest->lastSeen) oldest = state;
+	}
+
+	memset(oldest, 0, sizeof(POSE_BODY_STATE));
+	oldest->id = id;
+	oldest->lastSeen = nEvaluated;
+	oldest->started = !needsStart;
+	return oldest;
+}
+
+void PoseMatcher::addEvent(int frameNumber, UINT64 id, const POSE_TEMPLATE &pose) {
+	std::lock_guard<std::mutex> lock(eventMu);
+	POSE_EVENT &event = events[eventsAdded % POSE_EVENT_SLOTS];
+	event.frame = frameNumber;
+	event.id = id;
+	memcpy(event.pose, pose.name, POSE_NAME_SZ);
+	event.action = pose.action;
+	eventsAdded++;
+}
+
+/**
+ * One line of the format of PoseMatcher::load().
+ */
+HRESULT parsePoseTemplate(const char *line, POSE_TEMPLATE *pose) {
+	char token[TOKEN_SZ];
+	memset(pose, 0, sizeof(POSE_TEMPLATE));
+
+	const char *p = readToken(line, pose->name, POSE_NAME_SZ);
+	if (p == nullptr) return E_INVALIDARG;
+
+	p = readToken(p, token, TOKEN_SZ);
+	if (p == nullptr) return E_INVALIDARG;
+	int action = 0;
+	while (action < PoseAction_Count && strcmp(token, POSE_ACTIONS[action]) != 0) action++;
+	if (action == PoseAction_Count) return E_INVALIDARG;
+	pose->action = (PoseAction) action;
+
+	// hold frames are optional
+	p = readToken(p, token, TOKEN_SZ);
+	pose->holdFrames = 1;
+	if (p != nullptr && strcmp(token, ":") != 0) {
+		float holdFrames;
+		if (!parseNumber(token, &holdFrames) || holdFrames < 1 || holdFrames > UINT16_MAX) return E_INVALIDARG;
+		pose->holdFrames = (int) holdFrames;
+		p = readToken(p, token, TOKEN_SZ);
+	}
+	if (p == nullptr || strcmp(token, ":") != 0) return E_INVALIDARG;
+
+	while (true) {
+		if (pose->nTerms == POSE_MAX_TERMS) return E_INVALIDARG;
+		p = parsePoseTerm(p, &pose->terms[pose->nTerms++]);
+		if (p == nullptr) return E_INVALIDARG;
+
+		p = readToken(p, token, TOKEN_SZ);
+		if (p == nullptr) return S_OK;
+		if (strcmp(token, ";") != 0) return E_INVALIDARG;
+	}
+}
+
+/**
+ * @returns the position after the term, or nullptr when it is not understood.
+ */
+const char *parsePoseTerm(const char *p, POSE_TERM *term) {
+	char token[TOKEN_SZ];
+	int axis;
+
+	p = readToken(p, token, TOKEN_SZ);
+	if (p == nullptr) return nullptr;
+
+	if (strcmp(token, "distance") == 0) {
+		char op[TOKEN_SZ];
+		char a[TOKEN_SZ];
+		char b[TOKEN_SZ];
+		p = readToken(p, a, TOKEN_SZ);
+		if (p != nullptr) p = readToken(p, b, TOKEN_SZ);
+		if (p != nullptr) p = readToken(p, op, TOKEN_SZ);
+		if (p != nullptr) p = readToken(p, token, TOKEN_SZ);
+		if (p == nullptr || !parseJoint(a, &term->joints[0], nullptr) || !parseJoint(b, &term->joints[1], nullptr)) return nullptr;
+		if (!parseNumber(token, &term->value) || term->value < 0) return nullptr;
+
+		if (strcmp(op, "<") == 0) term->kind = PoseTerm_Within;
+		else if (strcmp(op, ">") == 0) term->kind = PoseTerm_Beyond;
+		else return nullptr;
+		return p;
+	}
+
+	if (strcmp(token, "angle") == 0) {
+		char joint[TOKEN_SZ];
+		for (int i = 0; i < 3 && p != nullptr; i++) {
+			p = readToken(p, joint, TOKEN_SZ);
+			if (p != nullptr && !parseJoint(joint, &term->joints[i], nullptr)) return nullptr;
+		}
+		float degrees, tolerance;
+		if (p != nullptr) p = readToken(p, token, TOKEN_SZ);
+		if (p == nullptr || !parseNumber(token, &degrees)) return nullptr;
+		p = readToken(p, token, TOKEN_SZ);
+		if (p == nullptr || !parseNumber(token, &tolerance) || tolerance < 0) return nullptr;
+
+		term->kind = PoseTerm_Angle;
+		term->value = degrees * RADIANS_PER_DEGREE;
+		term->tolerance = tolerance * RADIANS_PER_DEGREE;
+		term->cosLow = cosf(std::max(0.0f, term->value - term->tolerance));
+		term->cosHigh = cosf(std::min(180 * RADIANS_PER_DEGREE, term->value + term->tolerance));
+		return p;
+	}
+
+	// Joint.axis > Joint.axis [meters]; < swaps the joints
+	char op[TOKEN_SZ];
+	char b[TOKEN_SZ];
+	int otherAxis;
+	if (!parseJoint(token, &term->joints[0], &axis)) return nullptr;
+	p = readToken(p, op, TOKEN_SZ);
+	if (p != nullptr) p = readToken(p, b, TOKEN_SZ);
+	if (p == nullptr || !parseJoint(b, &term->joints[1], &otherAxis) || axis < 0 || axis != otherAxis) return nullptr;
+
+	if (strcmp(op, "<") == 0) std::swap(term->joints[0], term->joints[1]);
+	else if (strcmp(op, ">") != 0) return nullptr;
+	term->kind = PoseTerm_AtLeast;
+	term->axis = axis;
+
+	// meters are optional
+	const char *next = readToken(p, token, TOKEN_SZ);
+	if (next != nullptr && parseNumber(token, &term->value)) p = next;
+	return p;
+}
+
+/**
+ * The next token; a run of anything but spaces & : ; < >, which are tokens of their own.
+ * @returns the position after the token, or nullptr when there is none, or it is too long.
+ */
+const char *readToken(const char *p, char *token, int tokenSz) {
+	while (*p == ' ' || *p == '\t' || *p == '\r') p++;
+	if (*p == '\0' || *p == '\n') return nullptr;
+
+	int len = 0;
+	if (strchr(":;<>", *p) != nullptr) {
+		token[len++] = *p++;
+
+	} else {
+		while (*p != '\0' && strchr(" \t\r\n:;<>", *p) == nullptr) {
+			if (len == tokenSz - 1) return nullptr;
+			token[len++] = *p++;
+		}
+	}
+	token[len] = '\0';
+	return p;
+}
+
+/**
+ * A joint's name, as in the JSON, with .x, .y or .z after it when axis is not nullptr.
+ */
+bool parseJoint(const char *token, int *joint, int *axis) {
+	const char *dot = strchr(token, '.');
+	size_t len = dot != nullptr ? dot - token : strlen(token);
+
+	if (axis != nullptr) {
+		if (dot == nullptr || dot[1] < 'x' || dot[1] > 'z' || dot[2] != '\0') return false;
+		*axis = dot[1] - 'x';
+
+	} else if (dot != nullptr) {
+		return false;
+	}
+
+	for (int j = 0; j < JointType_Count; j++) {
+		if (strlen(JOINT_NAMES[j]) == len && strncmp(JOINT_NAMES[j], token, len) == 0) {
+			*joint = j;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool parseNumber(const char *token, float *value) {
+	char *end;
+	*value = strtof(token, &end);
+	return end != token && *end == '\0';
+}
@@ -0,0 +1,118 @@
+#include "KinectToJSON.h"
+
+// forward declare of non-external functions
+const char *readWord(const char *p, char *word, int wordSz);
+int lookupWord(const char *word, const char *table[], int n);
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// file scope variables
+#define WORD_SZ 32
+
+const char *PROJECTION_FIELDS[] = { "state", "location", "rotation", "hands" }; // bit i is ProjectionField 1 << i
+
+/**
+ * Parse what to send of each body, then compile it into the steps of the JSON & values of the binary format.  The spec
+ * is sections separated by ;, each optional:
+ *     joints: Name Name ...                       as in the JSON; default all
+ *     fields: state location rotation hands       default all
+ *     decimals: N                                 places of locations & rotations in JSON, 0 to 6; default 3
+ * @param spec - nullptr or empty for everything, the same as with no projection
+ * @returns E_INVALIDARG when any of the spec is not understood, leaving projection as it was.
+ */
+HRESULT parseProjection(const char *spec, PROJECTION *projection) {
+	UINT32 jointMask = PROJECTION_ALL_JOINTS;
+	int fields = ProjectionField_All;
+	int decimals = PROJECTION_DEFAULT_DECIMALS;
+	char key[WORD_SZ];
+	char word[WORD_SZ];
+
+	for (const char *p = spec; p != nullptr; ) {
+		p = readWord(p, key, WORD_SZ);
+		if (p == nullptr) break;
+
+		p = readWord(p, word, WORD_SZ);
+		if (p == nullptr || strcmp(word, ":") != 0) return E_INVALIDARG;
+
+		// a list of words, to the end of the section
+		UINT32 listed = 0;
+		int nWords = 0;
+		while ((p = readWord(p, word, WORD_SZ)) != nullptr && strcmp(word, ";") != 0) {
+			nWords++;
+
+			if (strcmp(key, "joints") == 0) {
+				int joint = lookupWord(word, JOINT_NAMES, JointType_Count);
+				if (joint < 0) return E_INVALIDARG;
+				listed |= 1u << joint;
+
+			} else if (strcmp(key, "fields") == 0) {
+				int field = lookupWord(word, PROJECTION_FIELDS, _countof(PROJECTION_FIELDS));
+				if (field < 0) return E_INVALIDARG;
+				listed |= 1u << field;
+
+			} else if (strcmp(key, "decimals") == 0) {
+				char *end;
+				long places = strtol(word, &end, 10);
+				if (*end != '\0' || places < 0 || places > PROJECTION_MAX_DECIMALS || nWords > 1) return E_INVALIDARG;
+				decimals = (int) places;
+
+			} else {
+				return E_INVALIDARG;
+			}
+		}
+		if (nWords == 0) return E_INVALIDARG;
+
+		if (strcmp(key, "joints") == 0) jointMask = listed;
+		else if (strcmp(key, "fields") == 0) fields = (int) listed;
+	}
+
+	// without any field of a joint, there are no joints to send
+	if ((fields & (ProjectionField_State | ProjectionField_Location | ProjectionField_Rotation)) == 0) jointMask = 0;
+
+	projection->jointMask = jointMask;
+	projection->fields = fields;
+	projection->decimals = decimals;
+	projection->full = jointMask == PROJECTION_ALL_JOINTS && fields == ProjectionField_All && decimals == PROJECTION_DEFAULT_DECIMALS;
+	compileJSONSteps(projection);
+	compileBinaryValues(projection);
+	return S_OK;
+}
+
+/**
+ * Every joint, field & 3 places, which the serializers use when given no projection.  Compiled on first use.
+ */
+const PROJECTION *getFullProjection() {
+	static PROJECTION full;
+	static bool compiled = SUCCEEDED(parseProjection(nullptr, &full)); // once, by whichever caller is first
+	(void) compiled;
+
+	return &full;
+}
+
+/**
+ * The next word; a run of anything but spaces, commas & : ;, which are words of their own.  One too long is cut short,
+ * so matches nothing.
+ * @returns the position after the word, or nullptr at the end.
+ */
+const char *readWord(const char *p, char *word, int wordSz) {
+	while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' || *p == ',') p++;
+	if (*p == '\0') return nullptr;
+
+	int len = 0;
+	if (*p == ':' || *p == ';') {
+		word[len++] = *p++;
+
+	} else {
+		for (; *p != '\0' && strchr(" \t\r\n,:;", *p) == nullptr; p++) {
+			if (len < wordSz - 1) word[len++] = *p;
+		}
+	}
+	word[len] = '\0';
+	return p;
+}
+
+int lookupWord(const char *word, const char *table[], int n) {
+	for (int i = 0; i < n; i++) {
+		if (strcmp(word, table[i]) == 0) return i;
+	}
+	return -1;
+}
@@ -0,0 +1,229 @@
+#include "KinectToJSON.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// forward declare of non-external functions
+int firstBadFrame(const MAPPED_FILE *data, const MAPPED_FILE *index);
+HRESULT mapFile(const char *path, MAPPED_FILE *mapped);
+void unmapFile(MAPPED_FILE *mapped);
+
+/**
+ * @param speed - 1 plays back at the speed recorded, 2 twice as fast, etc.  0 for as fast as frames can be taken.
+ */
+ReplayFrameSource::ReplayFrameSource(float speed) : speed(speed > 0 ? speed : 0) {
+	memset(&data, 0, sizeof(data));
+	memset(&index, 0, sizeof(index));
+}
+
+ReplayFrameSource::~ReplayFrameSource() {
+	unmapFile(&data);
+	unmapFile(&index);
+}
+
+/**
+ * Map a recorded session, & its index, into memory.
+ * @param path - The data file passed to beginRecording().
+ */
+HRESULT ReplayFrameSource::load(const char *path) {
+	std::string indexPath = std::string(path) + RECORDING_INDEX_EXT;
+	HRESULT hr = mapFile(path, &data);
+
+	if (SUCCEEDED(hr)) {
+		hr = mapFile(indexPath.c_str(), &index);
+	}
+
+	if (SUCCEEDED(hr)) {
+		const RECORDING_HEADER *header = (const RECORDING_HEADER *) data.view;
+		if (data.size < (INT64) sizeof(RECORDING_HEADER) || memcmp(header->magic, RECORDING_MAGIC, sizeof(header->magic)) != 0 ||
+			header->version != RECORDING_VERSION || header->bodyDataSz != sizeof(BODY_DATA)) {
+			hr = E_INVALIDARG;
+		}
+	}
+
+	if (SUCCEEDED(hr)) {
+		int bad = firstBadFrame(&data, &index);
+		if (bad >= 0) {
+			std::cerr << "Recording is cut short or corrupt at frame " << bad << "\n";
+			hr = E_INVALIDARG;
+		}
+	}
+
+	if (FAILED(hr)) {
+		std::cerr << "Cannot load recording: " << path << "\n";
+		unmapFile(&data);
+		unmapFile(&index);
+		return hr;
+	}
+
+	nFrames = (int) (index.size / sizeof(INT64));
+	nextFrame = 0;
+	return S_OK;
+}
+
+/**
+ * Make frame the next one delivered.  The playback clock restarts from it, rather than catching up.
+ */
+HRESULT ReplayFrameSource::seek(int frame) {
+	if (frame < 0 || frame >= nFrames) return E_INVALIDARG;
+
+	std::lock_guard<std::mutex> lock(mu);
+	nextFrame = frame;
+	clockStart = std::chrono::steady_clock::now();
+	clockStartTime = ((const RECORDED_FRAME *) (data.view + ((const INT64 *) index.view)[frame]))->relativeTime;
+	wakeup.notify_all();
+	return S_OK;
+}
+
+int ReplayFrameSource::getFrameCount() {
+	return nFrames;
+}
+
+HRESULT ReplayFrameSource::start() {
+	if (nFrames == 0) return E_ABORT;
+
+	{
+		std::lock_guard<std::mutex> lock(mu);
+		woken = false;
+	}
+	return seek(nextFrame < nFrames ? nextFrame : 0);
+}
+
+void ReplayFrameSource::stop() {
+}
+
+/**
+ * Sleep till the next frame is due.  After the last frame, sleeps till woken, or seeked back into the recording.
+ */
+HRESULT ReplayFrameSource::waitForFrame(FRAME_DATA *frame) {
+	std::unique_lock<std::mutex> lock(mu);
+	while (!woken) {
+		if (nextFrame >= nFrames) {
+			wakeup.wait(lock);
+			continue;
+		}
+
+		std::chrono::steady_clock::time_point due = dueTime(nextFrame);
+		if (std::chrono::steady_clock::now() >= due) break;
+		wakeup.wait_until(lock, due);
+	}
+	if (woken) return S_FALSE;
+	lock.unlock();
+
+	return acquireLatestFrame(frame);
+}
+
+/**
+ * Copy the next frame out of the mapping, when it is due.
+ */
+HRESULT ReplayFrameSource::acquireLatestFrame(FRAME_DATA *frame) {
+	std::lock_guard<std::mutex> lock(mu);
+	if (nextFrame >= nFrames || std::chrono::steady_clock::now() < dueTime(nextFrame)) return E_PENDING;
+
+	// each frame was checked whole by load()
+	INT64 offset = ((const INT64 *) index.view)[nextFrame++];
+	const RECORDED_FRAME *record = (const RECORDED_FRAME *) (data.view + offset);
+	int bodyCount = record->bodyCount;
+
+	UINT64 start = stageClock();
+	frame->clipPlane = record->clipPlane;
+	frame->relativeTime = record->relativeTime;
+	frame->bodyCount = bodyCount;
+	memcpy(frame->bodies, record + 1, bodyCount * sizeof(BODY_DATA));
+	endStage(TrackingStage_Refresh, start);
+	return S_OK;
+}
+
+void ReplayFrameSource::wake() {
+	std::lock_guard<std::mutex> lock(mu);
+	woken = true;
+	wakeup.notify_all();
+}
+
+/**
+ * Check every frame the index points at is whole, & within the data, so frames can be read without checking again.
+ * @returns the first frame which is not, or -1 when all are.
+ */
+int firstBadFrame(const MAPPED_FILE *data, const MAPPED_FILE *index) {
+	if (index->size % sizeof(INT64) != 0) return (int) (index->size / sizeof(INT64));
+
+	const INT64 *offsets = (const INT64 *) index->view;
+	int nFrames = (int) (index->size / sizeof(INT64));
+	for (int f = 0; f < nFrames; f++) {
+		INT64 offset = offsets[f];
+		if (offset < (INT64) sizeof(RECORDING_HEADER) || offset > data->size - (INT64) sizeof(RECORDED_FRAME)) return f;
+
+		INT32 bodyCount = ((const RECORDED_FRAME *) (data->view + offset))->bodyCount;
+		if (bodyCount < 0 || bodyCount > BODY_COUNT) return f;
+		if (offset + (INT64) (sizeof(RECORDED_FRAME) + bodyCount * sizeof(BODY_DATA)) > data->size) return f;
+	}
+	return -1;
+}
+
+/**
+ * When a frame should be delivered, from the time it was recorded, relative to where the clock was started.
+ */
+std::chrono::steady_clock::time_point ReplayFrameSource::dueTime(int frame) {
+	if (speed == 0) return clockStart;
+
+	INT64 ticks = ((const RECORDED_FRAME *) (data.view + ((const INT64 *) index.view)[frame]))->relativeTime - clockStartTime;
+	return clockStart + std::chrono::nanoseconds((INT64) (ticks * 100 / speed));
+}
+
+HRESULT mapFile(const char *path, MAPPED_FILE *mapped) {
+#ifdef _WIN32
+	mapped->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (mapped->file == INVALID_HANDLE_VALUE) {
+		mapped->file = nullptr;
+		return E_INVALIDARG;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(mapped->file, &size) || size.QuadPart == 0) {
+		unmapFile(mapped);
+		return E_INVALIDARG;
+	}
+	mapped->size = size.QuadPart;
+
+	mapped->mapping = CreateFileMappingA(mapped->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapped->mapping != nullptr) {
+		mapped->view = (const char *) MapViewOfFile(mapped->mapping, FILE_MAP_READ, 0, 0, 0);
+	}
+
+	if (mapped->view == nullptr) {
+		unmapFile(mapped);
+		return E_FAIL;
+	}
+	return S_OK;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return E_INVALIDARG;
+
+	// the mapping stays valid after the descriptor is closed
+	struct stat info;
+	if (fstat(fd, &info) == 0 && info.st_size > 0) {
+		void *view = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (view != MAP_FAILED) {
+			mapped->view = (const char *) view;
+			mapped->size = info.st_size;
+		}
+	}
+	::close(fd);
+	return mapped->view != nullptr ? S_OK : E_INVALIDARG;
+#endif
+}
+
+void unmapFile(MAPPED_FILE *mapped) {
+#ifdef _WIN32
+	if (mapped->view != nullptr) UnmapViewOfFile(mapped->view);
+	if (mapped->mapping != nullptr) CloseHandle(mapped->mapping);
+	if (mapped->file != nullptr) CloseHandle(mapped->file);
+#else
+	if (mapped->view != nullptr) munmap((void *) mapped->view, (size_t) mapped->size);
+#endif
+	memset(mapped, 0, sizeof(MAPPED_FILE));
+}
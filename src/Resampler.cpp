@@ -0,0 +1,237 @@
+#include "KinectToJSON.h"
+
+// forward declare of non-external functions
+void copyFrameData(const FRAME_DATA *from, FRAME_DATA *to);
+const BODY_DATA *findBody(const FRAME_DATA *frame, UINT64 id);
+
+#define TICKS_PER_SECOND 10000000LL // of RelativeTime
+
+/**
+ * @param source - read by this, but still owned by the caller
+ * @param hz - frames a second to deliver, up to RESAMPLE_MAX_HZ
+ * @param onRead - passed each frame of the source as read, before it is resampled, e.g. to record it; nullptr for none
+ */
+void ResamplingFrameSource::configure(FrameSource *source, int hz, ResampleMode mode, void (*onRead)(const FRAME_DATA *frame)) {
+	this->source = source;
+	this->hz = hz;
+	this->mode = mode;
+	this->onRead = onRead;
+}
+
+/**
+ * Counts since started.  Only call when no thread is reading frames.
+ */
+void ResamplingFrameSource::getStats(RESAMPLE_STATS *stats) {
+	stats->framesRead = framesRead;
+	stats->framesOutOfOrder = framesOutOfOrder;
+	stats->framesEmitted = framesEmitted;
+	stats->framesInGaps = framesInGaps;
+}
+
+HRESULT ResamplingFrameSource::start() {
+	if (source == nullptr || hz <= 0) return E_ABORT;
+
+	nRead = 0;
+	tick = 0;
+	framesRead = 0;
+	framesOutOfOrder = 0;
+	framesEmitted = 0;
+	framesInGaps = 0;
+	return source->start();
+}
+
+void ResamplingFrameSource::stop() {
+	source->stop();
+}
+
+HRESULT ResamplingFrameSource::waitForFrame(FRAME_DATA *frame) {
+	return nextFrame(frame, true);
+}
+
+HRESULT ResamplingFrameSource::acquireLatestFrame(FRAME_DATA *frame) {
+	return nextFrame(frame, false);
+}
+
+void ResamplingFrameSource::wake() {
+	source->wake();
+}
+
+/**
+ * Deliver the next tick, once there is a frame of the source at or after its time, reading the source till there is.
+ */
+HRESULT ResamplingFrameSource::nextFrame(FRAME_DATA *frame, bool wait) {
+	while (true) {
+		// the first frame read is tick 0
+		if (nRead == 0) {
+			HRESULT hr = readSource(wait);
+			if (hr != S_OK) return hr;
+			startTime = before->relativeTime;
+			tick = 0;
+		}
+
+		INT64 time = tickTime(tick);
+		const FRAME_DATA *latest = nRead == 2 ? after : before;
+		if (latest->relativeTime < time) {
+			// a frame dropped for being out of order is only returned for when not waiting
+			HRESULT hr = readSource(wait);
+			if (hr != S_OK && !(hr == E_PENDING && wait)) return hr;
+			continue;
+		}
+
+		// nothing is made up across a dropout; carry on from the first tick after it
+		if (nRead == 2 && after->relativeTime - before->relativeTime > RESAMPLE_MAX_GAP_MILLIS * (TICKS_PER_SECOND / 1000) && time < after->relativeTime) {
+			UINT64 resumeTick = (UINT64) ((after->relativeTime - startTime) * hz + TICKS_PER_SECOND - 1) / TICKS_PER_SECOND;
+			framesInGaps += resumeTick - tick;
+			tick = resumeTick;
+			continue;
+		}
+
+		resample(time, frame);
+		tick++;
+		framesEmitted++;
+		return S_OK;
+	}
+}
+
+/**
+ * Read the next frame of the source into after, after moving the last read to before.  A frame not after the last is
+ * dropped, unless it is so far before it that the source must have started over, e.g. a replay seeked back.
+ * @returns as the source, or E_PENDING when a frame was dropped.
+ */
+HRESULT ResamplingFrameSource::readSource(bool wait) {
+	if (nRead == 2) {
+		std::swap(before, after);
+		nRead = 1;
+	}
+
+	FRAME_DATA *into = nRead == 0 ? before : after;
+	HRESULT hr = wait ? source->waitForFrame(into) : source->acquireLatestFrame(into);
+	if (hr != S_OK) return hr;
+	framesRead++;
+	if (onRead != nullptr) onRead(into);
+
+	if (nRead == 1 && into->relativeTime <= before->relativeTime) {
+		if (before->relativeTime - into->relativeTime <= RESAMPLE_MAX_GAP_MILLIS * (TICKS_PER_SECOND / 1000)) {
+			framesOutOfOrder++;
+			return E_PENDING;
+		}
+
+		// the clock carries on from the next tick, at this frame
+		std::swap(before, after);
+		startTime = before->relativeTime - tickTime(tick) + startTime;
+		return S_OK;
+	}
+	nRead++;
+	return S_OK;
+}
+
+/**
+ * RelativeTime of a tick, rounded to the nearest 100ns.
+ */
+INT64 ResamplingFrameSource::tickTime(UINT64 tick) {
+	return startTime + (INT64) ((tick * TICKS_PER_SECOND + hz / 2) / hz);
+}
+
+void ResamplingFrameSource::resample(INT64 time, FRAME_DATA *frame) {
+	if (nRead == 1 || after->relativeTime == time) {
+		copyFrameData(nRead == 1 ? before : after, frame);
+
+	} else {
+		float t = (float) (time - before->relativeTime) / (float) (after->relativeTime - before->relativeTime);
+		if (mode == ResampleMode_Decimate) copyFrameData(t < 0.5f ? before : after, frame);
+		else interpolateBodies(before, after, t, frame);
+	}
+
+	frame->relativeTime = time;
+	frame->resampled = true;
+	frame->timeUs = (INT64) ((tick * 1000000ULL + hz / 2) / hz);
+}
+
+/**
+ * The frame at t between before & after, 0 to 1.  Each body of the nearer frame is kept, in its order; those in both are
+ * interpolated, while the rest are as they were.  States, hands & the camera are of the nearer frame.
+ */
+void interpolateBodies(const FRAME_DATA *before, const FRAME_DATA *after, float t, FRAME_DATA *frame) {
+	const FRAME_DATA *nearer = t < 0.5f ? before : after;
+	const Vector4 &a = before->clipPlane;
+	const Vector4 &b = after->clipPlane;
+
+	frame->clipPlane = { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t };
+	frame->relativeTime = before->relativeTime + (INT64) ((after->relativeTime - before->relativeTime) * (double) t);
+	frame->cameraHeight = nearer->cameraHeight;
+	frame->frame = nearer->frame;
+	frame->bodyCount = nearer->bodyCount;
+
+	for (int i = 0; i < nearer->bodyCount; i++) {
+		BODY_DATA *out = &frame->bodies[i];
+		*out = nearer->bodies[i];
+
+		const BODY_DATA *from = findBody(before, out->id);
+		const BODY_DATA *to = findBody(after, out->id);
+		if (from == nullptr || to == nullptr) continue;
+
+		for (int j = 0; j < JointType_Count; j++) {
+			const CameraSpacePoint &p0 = from->joints[j].Position;
+			const CameraSpacePoint &p1 = to->joints[j].Position;
+			out->joints[j].Position = { p0.X + (p1.X - p0.X) * t, p0.Y + (p1.Y - p0.Y) * t, p0.Z + (p1.Z - p0.Z) * t };
+			out->rotations[j].Orientation = slerp(from->rotations[j].Orientation, to->rotations[j].Orientation, t);
+		}
+	}
+}
+
+/**
+ * Spherical linear interpolation, the shorter way round.  A zero quaternion, as the sensor gives the tips of limbs,
+ * stays zero.
+ */
+Vector4 slerp(const Vector4 &a, const Vector4 &b, float t) {
+	float dot = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+	float sign = 1;
+	if (dot < 0) {
+		dot = -dot;
+		sign = -1;
+	}
+
+	// nearly the same rotation, where the sine is too small to divide by; normalized after instead
+	bool linear = dot > 0.9995f;
+	float wa, wb;
+	if (linear) {
+		wa = 1 - t;
+		wb = t;
+
+	} else {
+		float theta = acosf(dot);
+		float sinTheta = sinf(theta);
+		wa = sinf((1 - t) * theta) / sinTheta;
+		wb = sinf(t * theta) / sinTheta;
+	}
+	wb *= sign;
+
+	Vector4 q = { wa * a.x + wb * b.x, wa * a.y + wb * b.y, wa * a.z + wb * b.z, wa * a.w + wb * b.w };
+	if (linear) {
+		float len = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+		if (len > 0) {
+			q.x /= len;
+			q.y /= len;
+			q.z /= len;
+			q.w /= len;
+		}
+	}
+	return q;
+}
+
+// only the bodies of the frame are copied, not the unused ones past bodyCount
+void copyFrameData(const FRAME_DATA *from, FRAME_DATA *to) {
+	to->clipPlane = from->clipPlane;
+	to->relativeTime = from->relativeTime;
+	to->cameraHeight = from->cameraHeight;
+	to->frame = from->frame;
+	to->bodyCount = from->bodyCount;
+	memcpy(to->bodies, from->bodies, from->bodyCount * sizeof(BODY_DATA));
+}
+
+const BODY_DATA *findBody(const FRAME_DATA *frame, UINT64 id) {
+	for (int i = 0; i < frame->bodyCount; i++) {
+		if (frame->bodies[i].id == id) return &frame->bodies[i];
+	}
+	return nullptr;
+}
@@ -0,0 +1,540 @@
+#include "KinectToJSON.h"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define RETARGET_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RETARGET_SSE
+#endif
+
+// forward declare of non-external functions
+HRESULT parseRigBone(const char *line, const RIG *rig, RIG_BONE *bone);
+const char *readRigToken(const char *p, char *token, int tokenSz);
+const char *readRigVector(const char *p, float *v, float *length);
+int findRigJoint(const char *token);
+Vector4 restFrame(const float *rest, float rollDegrees);
+float boundQuaternionPart(float value);
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// file scope variables
+#define RIG_TOKEN_SZ 64
+#define RIG_MIN_METERS 0.0001f // a bone, or line across one, any shorter cannot be aimed, so keeps its parent's turn
+
+/**
+ * Parse a rig, one bone a line, each after its parent:
+ *     name parent : Head Tail x y z [roll degrees] [; side From To x y z]
+ * where parent is - for a root, Head & Tail are the joints the bone runs between, as named in the JSON, & x y z is the
+ * bone at rest, from head to tail, in meters & the axes locations are sent in.  The bone's rest orientation is as
+ * Blender's; Y along the bone, the shortest turn from straight up, then roll degrees about it.  A side line, from one
+ * joint to another, with its direction at rest, sets how far the bone turns about its length; without one, the bone
+ * keeps its parent's.  Blank lines, & lines starting with #, are skipped.
+ * @param text - nullptr or empty for no rig
+ * @returns E_INVALIDARG when any line is not understood, leaving rig as it was.
+ */
+HRESULT parseRig(const char *text, RIG *rig) {
+	RIG parsed;
+	parsed.nBones = 0;
+
+	int lineNumber = 0;
+	for (const char *line = text; line != nullptr && *line != '\0'; ) {
+		const char *end = strchr(line, '\n');
+		std::string content(line, end != nullptr ? end - line : strlen(line));
+		line = end != nullptr ? end + 1 : nullptr;
+		lineNumber++;
+
+		size_t first = content.find_first_not_of(" \t\r");
+		if (first == std::string::npos || content[first] == '#') continue;
+
+		if (parsed.nBones == RIG_MAX_BONES || FAILED(parseRigBone(content.c_str(), &parsed, &parsed.bones[parsed.nBones]))) {
+			std::cerr << "Rig bone on line " << lineNumber << " not understood: " << content << "\n";
+			return E_INVALIDARG;
+		}
+		parsed.nBones++;
+	}
+
+	*rig = parsed;
+	return S_OK;
+}
+
+/**
+ * One line of the format of parseRig(), against the bones before it.
+ */
+HRESULT parseRigBone(const char *line, const RIG *rig, RIG_BONE *bone) {
+	char token[RIG_TOKEN_SZ];
+	memset(bone, 0, sizeof(RIG_BONE));
+	bone->sideFrom = -1;
+	bone->sideTo = -1;
+
+	const char *p = readRigToken(line, bone->name, RIG_NAME_SZ);
+	if (p == nullptr || strcmp(bone->name, ":") == 0 || strcmp(bone->name, "-") == 0) return E_INVALIDARG;
+	for (int i = 0; i < rig->nBones; i++) {
+		if (strcmp(rig->bones[i].name, bone->name) == 0) return E_INVALIDARG;
+	}
+
+	p = readRigToken(p, token, RIG_TOKEN_SZ);
+	if (p == nullptr) return E_INVALIDARG;
+	bone->parent = -1;
+	if (strcmp(token, "-") != 0) {
+		for (int i = 0; i < rig->nBones && bone->parent < 0; i++) {
+			if (strcmp(rig->bones[i].name, token) == 0) bone->parent = i;
+		}
+		if (bone->parent < 0) return E_INVALIDARG;
+	}
+
+	p = readRigToken(p, token, RIG_TOKEN_SZ);
+	if (p == nullptr || strcmp(token, ":") != 0) return E_INVALIDARG;
+
+	p = readRigToken(p, token, RIG_TOKEN_SZ);
+	if (p != nullptr) bone->head = findRigJoint(token);
+	if (p != nullptr) p = readRigToken(p, token, RIG_TOKEN_SZ);
+	if (p != nullptr) bone->tail = findRigJoint(token);
+	if (p == nullptr || bone->head < 0 || bone->tail < 0 || bone->head == bone->tail) return E_INVALIDARG;
+
+	p = readRigVector(p, bone->rest, &bone->length);
+	if (p == nullptr || bone->length < RIG_MIN_METERS) return E_INVALIDARG;
+
+	// roll & side are optional
+	float roll = 0;
+	p = readRigToken(p, token, RIG_TOKEN_SZ);
+	if (p != nullptr && strcmp(token, "roll") == 0) {
+		char *end;
+		p = readRigToken(p, token, RIG_TOKEN_SZ);
+		if (p == nullptr) return E_INVALIDARG;
+		roll = strtof(token, &end);
+		if (*end != '\0') return E_INVALIDARG;
+		p = readRigToken(p, token, RIG_TOKEN_SZ);
+	}
+	bone->frame = restFrame(bone->rest, roll);
+	if (p == nullptr) return S_OK;
+
+	if (strcmp(token, ";") != 0) return E_INVALIDARG;
+	p = readRigToken(p, token, RIG_TOKEN_SZ);
+	if (p == nullptr || strcmp(token, "side") != 0) return E_INVALIDARG;
+
+	p = readRigToken(p, token, RIG_TOKEN_SZ);
+	if (p != nullptr) bone->sideFrom = findRigJoint(token);
+	if (p != nullptr) p = readRigToken(p, token, RIG_TOKEN_SZ);
+	if (p != nullptr) bone->sideTo = findRigJoint(token);
+	if (p == nullptr || bone->sideFrom < 0 || bone->sideTo < 0 || bone->sideFrom == bone->sideTo) return E_INVALIDARG;
+
+	// the line has to cross the bone at rest, or it says nothing of the turn about it
+	float sideLength;
+	p = readRigVector(p, bone->restSide, &sideLength);
+	CameraSpacePoint rest = { bone->rest[0], bone->rest[1], bone->rest[2] };
+	CameraSpacePoint across = acrossAxis(rest, { bone->restSide[0], bone->restSide[1], bone->restSide[2] });
+	if (p == nullptr || sideLength < RIG_MIN_METERS || sqrtf(across.X * across.X + across.Y * across.Y + across.Z * across.Z) < 0.01f) {
+		return E_INVALIDARG;
+	}
+	return readRigToken(p, token, RIG_TOKEN_SZ) == nullptr ? S_OK : E_INVALIDARG;
+}
+
+/**
+ * The next token; a run of anything but spaces, or : or ; on their own.
+ * @returns the position after the token, or nullptr at the end, or when it does not fit.
+ */
+const char *readRigToken(const char *p, char *token, int tokenSz) {
+	while (*p == ' ' || *p == '\t' || *p == '\r') p++;
+	if (*p == '\0') return nullptr;
+
+	int len = 0;
+	if (*p == ':' || *p == ';') {
+		token[len++] = *p++;
+
+	} else {
+		for (; *p != '\0' && strchr(" \t\r:;", *p) == nullptr; p++) {
+			if (len == tokenSz - 1) return nullptr;
+			token[len++] = *p;
+		}
+	}
+	token[len] = '\0';
+	return p;
+}
+
+/**
+ * Three numbers, made unit length.
+ * @param length - set to the length as written
+ * @returns the position after the last, or nullptr when any is not a number.
+ */
+const char *readRigVector(const char *p, float *v, float *length) {
+	char token[RIG_TOKEN_SZ];
+	for (int i = 0; i < 3; i++) {
+		char *end;
+		p = readRigToken(p, token, RIG_TOKEN_SZ);
+		if (p == nullptr) return nullptr;
+		v[i] = strtof(token, &end);
+		if (*end != '\0') return nullptr;
+	}
+
+	*length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	for (int i = 0; i < 3 && *length > 0; i++) v[i] /= *length;
+	return p;
+}
+
+int findRigJoint(const char *token) {
+	for (int i = 0; i < JointType_Count; i++) {
+		if (strcmp(token, JOINT_NAMES[i]) == 0) return i;
+	}
+	return -1;
+}
+
+/**
+ * The rest orientation of a bone as Blender works it out from its head, tail & roll.  The shortest turn of +Y onto
+ * the bone, or a half turn about Z when it points straight down, then the roll about the bone.
+ */
+Vector4 restFrame(const float *rest, float rollDegrees) {
+	Vector4 aim = { 0, 0, 1, 0 };
+	if (rest[1] > -1 + ARC_PARALLEL) {
+		// (w, +Y x rest), normalized
+		float len = sqrtf((1 + rest[1]) * (1 + rest[1]) + rest[2] * rest[2] + rest[0] * rest[0]);
+		aim = { rest[2] / len, 0, -rest[0] / len, (1 + rest[1]) / len };
+	}
+
+	float half = rollDegrees * RADIANS_PER_DEGREE / 2;
+	float s = sinf(half);
+	Vector4 roll = { rest[0] * s, rest[1] * s, rest[2] * s, cosf(half) };
+	return multiplyQuaternions(roll, aim);
+}
+
+/**
+ * Bone tails & heads as lanes of bodies, from each body of the frame.
+ */
+void gatherRigJoints(const FRAME_DATA *frame, RIG_JOINTS *joints) {
+	for (int j = 0; j < JointType_Count; j++) {
+		int b = 0;
+		for (; b < frame->bodyCount; b++) {
+			const CameraSpacePoint &position = frame->bodies[b].joints[j].Position;
+			joints->x[j][b] = position.X;
+			joints->y[j][b] = position.Y;
+			joints->z[j][b] = position.Z;
+		}
+		for (; b < RIG_LANES; b++) joints->x[j][b] = joints->y[j][b] = joints->z[j][b] = 0;
+	}
+	joints->nBodies = frame->bodyCount;
+}
+
+/**
+ * Copy the local rotation of every bone into the bodies it was solved for.
+ */
+void scatterRigBones(const RIG *rig, const RIG_ROTATIONS *rotations, FRAME_DATA *frame) {
+	for (int b = 0; b < frame->bodyCount; b++) {
+		for (int i = 0; i < rig->nBones; i++) {
+			Vector4 &q = frame->bones[b][i];
+			q.x = boundQuaternionPart(rotations->local[0][i][b]);
+			q.y = boundQuaternionPart(rotations->local[1][i][b]);
+			q.z = boundQuaternionPart(rotations->local[2][i][b]);
+			q.w = boundQuaternionPart(rotations->local[3][i][b]);
+		}
+	}
+	frame->nBones = rig->nBones;
+}
+
+/**
+ * Solve each bone of each body, one at a time.  The reference the vector kernels are checked against in -bench
+ * retarget.
+ * A bone's world turn is its parent's, then the shortest arc from where that leaves the bone to where its joints are,
+ * then the turn about the bone which lines its side line up, if it has one.  Its local turn is that relative to its
+ * parent, in its own rest frame, as Blender's pose bones are; parent & own rest frames cancel out when nothing moves.
+ * Everything is from the locations after mirroring & into world space, so the bones agree with the locations sent.
+ */
+void solveRigScalar(const RIG *rig, const RIG_JOINTS *joints, RIG_ROTATIONS *rotations) {
+	for (int b = 0; b < joints->nBodies; b++) {
+		for (int i = 0; i < rig->nBones; i++) {
+			const RIG_BONE &bone = rig->bones[i];
+
+			Vector4 parent = { 0, 0, 0, 1 };
+			if (bone.parent >= 0) {
+				parent.x = rotations->world[0][bone.parent][b];
+				parent.y = rotations->world[1][bone.parent][b];
+				parent.z = rotations->world[2][bone.parent][b];
+				parent.w = rotations->world[3][bone.parent][b];
+			}
+
+			CameraSpacePoint aim = { bone.rest[0], bone.rest[1], bone.rest[2] };
+			rotatePoint(parent, &aim);
+			CameraSpacePoint along = {
+				joints->x[bone.tail][b] - joints->x[bone.head][b],
+				joints->y[bone.tail][b] - joints->y[bone.head][b],
+				joints->z[bone.tail][b] - joints->z[bone.head][b]
+			};
+			Vector4 world = multiplyQuaternions(shortestArc(aim, along, perpendicularTo(aim)), parent);
+
+			if (bone.sideFrom >= 0) {
+				CameraSpacePoint axis = { bone.rest[0], bone.rest[1], bone.rest[2] };
+				CameraSpacePoint side = { bone.restSide[0], bone.restSide[1], bone.restSide[2] };
+				rotatePoint(world, &axis);
+				rotatePoint(world, &side);
+				CameraSpacePoint target = {
+					joints->x[bone.sideTo][b] - joints->x[bone.sideFrom][b],
+					joints->y[bone.sideTo][b] - joints->y[bone.sideFrom][b],
+					joints->z[bone.sideTo][b] - joints->z[bone.sideFrom][b]
+				};
+				world = multiplyQuaternions(turnAbout(axis, acrossAxis(axis, side), acrossAxis(axis, target)), world);
+			}
+
+			Vector4 inverseParent = { -parent.x, -parent.y, -parent.z, parent.w };
+			Vector4 inverseFrame = { -bone.frame.x, -bone.frame.y, -bone.frame.z, bone.frame.w };
+			Vector4 local = multiplyQuaternions(multiplyQuaternions(inverseFrame, multiplyQuaternions(inverseParent, world)), bone.frame);
+			if (local.w < 0) local = { -local.x, -local.y, -local.z, -local.w };
+
+			float *parts[4] = { &world.x, &world.y, &world.z, &world.w };
+			float *localParts[4] = { &local.x, &local.y, &local.z, &local.w };
+			for (int c = 0; c < 4; c++) {
+				rotations->world[c][i][b] = *parts[c];
+				rotations->local[c][i][b] = *localParts[c];
+			}
+		}
+	}
+}
+
+/**
+ * Parts of a unit quaternion, held to +-1, so JSON_BONE_SZ holds even for joints which were not finite.
+ */
+float boundQuaternionPart(float value) {
+	if (value > 1) return 1;
+	if (value < -1) return -1;
+	return value == value ? value : 0;
+}
+
+#if defined(RETARGET_AVX) || defined(RETARGET_SSE)
+// the few operations the kernel needs, on a lane for each body
+#if defined(RETARGET_AVX)
+typedef __m256 LANES;
+#define LANE_WIDTH 8
+
+inline LANES lanesSet(float v) { return _mm256_set1_ps(v); }
+inline LANES lanesLoad(const float *p) { return _mm256_load_ps(p); }
+inline void lanesStore(float *p, LANES v) { _mm256_store_ps(p, v); }
+inline LANES lanesAdd(LANES a, LANES b) { return _mm256_add_ps(a, b); }
+inline LANES lanesSub(LANES a, LANES b) { return _mm256_sub_ps(a, b); }
+inline LANES lanesMul(LANES a, LANES b) { return _mm256_mul_ps(a, b); }
+inline LANES lanesDiv(LANES a, LANES b) { return _mm256_div_ps(a, b); }
+inline LANES lanesSqrt(LANES a) { return _mm256_sqrt_ps(a); }
+inline LANES lanesAbs(LANES a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+inline LANES lanesLess(LANES a, LANES b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline LANES lanesMin(LANES a, LANES b) { return _mm256_min_ps(a, b); }
+inline LANES lanesMax(LANES a, LANES b) { return _mm256_max_ps(a, b); }
+inline LANES lanesSelect(LANES mask, LANES a, LANES b) { return _mm256_blendv_ps(b, a, mask); }
+
+const char *getRetargetKernel() {
+	return "avx";
+}
+
+#else
+typedef __m128 LANES;
+#define LANE_WIDTH 4
+
+inline LANES lanesSet(float v) { return _mm_set1_ps(v); }
+inline LANES lanesLoad(const float *p) { return _mm_load_ps(p); }
+inline void lanesStore(float *p, LANES v) { _mm_store_ps(p, v); }
+inline LANES lanesAdd(LANES a, LANES b) { return _mm_add_ps(a, b); }
+inline LANES lanesSub(LANES a, LANES b) { return _mm_sub_ps(a, b); }
+inline LANES lanesMul(LANES a, LANES b) { return _mm_mul_ps(a, b); }
+inline LANES lanesDiv(LANES a, LANES b) { return _mm_div_ps(a, b); }
+inline LANES lanesSqrt(LANES a) { return _mm_sqrt_ps(a); }
+inline LANES lanesAbs(LANES a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+inline LANES lanesLess(LANES a, LANES b) { return _mm_cmplt_ps(a, b); }
+inline LANES lanesMin(LANES a, LANES b) { return _mm_min_ps(a, b); }
+inline LANES lanesMax(LANES a, LANES b) { return _mm_max_ps(a, b); }
+inline LANES lanesSelect(LANES mask, LANES a, LANES b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+const char *getRetargetKernel() {
+	return "sse";
+}
+#endif
+
+typedef struct {
+	LANES x, y, z;
+} LANE_VECTOR;
+
+typedef struct {
+	LANES x, y, z, w;
+} LANE_QUATERNION;
+
+LANES laneDot(const LANE_VECTOR &a, const LANE_VECTOR &b) {
+	return lanesAdd(lanesAdd(lanesMul(a.x, b.x), lanesMul(a.y, b.y)), lanesMul(a.z, b.z));
+}
+
+LANE_VECTOR laneCross(const LANE_VECTOR &a, const LANE_VECTOR &b) {
+	return {
+		lanesSub(lanesMul(a.y, b.z), lanesMul(a.z, b.y)),
+		lanesSub(lanesMul(a.z, b.x), lanesMul(a.x, b.z)),
+		lanesSub(lanesMul(a.x, b.y), lanesMul(a.y, b.x))
+	};
+}
+
+LANE_VECTOR laneJoints(const RIG_JOINTS *joints, int from, int to, int lane) {
+	return {
+		lanesSub(lanesLoad(&joints->x[to][lane]), lanesLoad(&joints->x[from][lane])),
+		lanesSub(lanesLoad(&joints->y[to][lane]), lanesLoad(&joints->y[from][lane])),
+		lanesSub(lanesLoad(&joints->z[to][lane]), lanesLoad(&joints->z[from][lane]))
+	};
+}
+
+LANE_QUATERNION laneRotation(const float (*parts)[RIG_MAX_BONES][RIG_LANES], int bone, int lane) {
+	return { lanesLoad(&parts[0][bone][lane]), lanesLoad(&parts[1][bone][lane]), lanesLoad(&parts[2][bone][lane]), lanesLoad(&parts[3][bone][lane]) };
+}
+
+void laneStore(float (*parts)[RIG_MAX_BONES][RIG_LANES], int bone, int lane, const LANE_QUATERNION &q) {
+	lanesStore(&parts[0][bone][lane], q.x);
+	lanesStore(&parts[1][bone][lane], q.y);
+	lanesStore(&parts[2][bone][lane], q.z);
+	lanesStore(&parts[3][bone][lane], q.w);
+}
+
+LANE_QUATERNION laneMultiply(const LANE_QUATERNION &a, const LANE_QUATERNION &b) {
+	return {
+		lanesSub(lanesAdd(lanesAdd(lanesMul(a.w, b.x), lanesMul(a.x, b.w)), lanesMul(a.y, b.z)), lanesMul(a.z, b.y)),
+		lanesAdd(lanesSub(lanesAdd(lanesMul(a.w, b.y), lanesMul(a.y, b.w)), lanesMul(a.x, b.z)), lanesMul(a.z, b.x)),
+		lanesSub(lanesAdd(lanesAdd(lanesMul(a.w, b.z), lanesMul(a.z, b.w)), lanesMul(a.x, b.y)), lanesMul(a.y, b.x)),
+		lanesSub(lanesSub(lanesSub(lanesMul(a.w, b.w), lanesMul(a.x, b.x)), lanesMul(a.y, b.y)), lanesMul(a.z, b.z))
+	};
+}
+
+LANE_QUATERNION laneConjugate(const LANE_QUATERNION &q) {
+	const LANES zero = lanesSet(0);
+	return { lanesSub(zero, q.x), lanesSub(zero, q.y), lanesSub(zero, q.z), q.w };
+}
+
+/**
+ * As rotatePoint(); v + 2w(u x v) + 2u x (u x v).
+ */
+LANE_VECTOR laneRotate(const LANE_QUATERNION &q, const LANE_VECTOR &v) {
+	const LANES two = lanesSet(2);
+	LANE_VECTOR u = { q.x, q.y, q.z };
+	LANE_VECTOR t = laneCross(u, v);
+	t = { lanesMul(t.x, two), lanesMul(t.y, two), lanesMul(t.z, two) };
+	LANE_VECTOR ut = laneCross(u, t);
+	return {
+		lanesAdd(lanesAdd(v.x, lanesMul(q.w, t.x)), ut.x),
+		lanesAdd(lanesAdd(v.y, lanesMul(q.w, t.y)), ut.y),
+		lanesAdd(lanesAdd(v.z, lanesMul(q.w, t.z)), ut.z)
+	};
+}
+
+/**
+ * As rotationAbout(), with identity where lengths are too short to say; every case worked out, then picked by mask
+ * rather than branch.
+ */
+LANE_QUATERNION laneRotationAbout(const LANE_VECTOR &axis, LANES dot, LANES sinLength, LANES lengths) {
+	const LANES zero = lanesSet(0);
+	const LANES one = lanesSet(1);
+	const LANES half = lanesSet(0.5f);
+	LANES tooShort = lanesLess(lengths, lanesSet(ARC_MIN_LENGTHS));
+	lengths = lanesSelect(tooShort, one, lengths);
+	LANES cosAngle = lanesMin(lanesMax(lanesDiv(dot, lengths), lanesSet(-1)), one);
+	LANES sinAngle = lanesDiv(sinLength, lengths);
+
+	LANES nearW = lanesSqrt(lanesMul(lanesAdd(one, cosAngle), half));
+	LANES nearK = lanesDiv(lanesMul(sinAngle, half), nearW);
+	LANES h = lanesSqrt(lanesMul(lanesSub(one, cosAngle), half));
+	LANES farK = lanesSelect(lanesLess(sinAngle, zero), lanesSub(zero, h), h);
+	LANES farW = lanesDiv(lanesMul(lanesAbs(sinAngle), half), h);
+
+	LANES far = lanesLess(cosAngle, zero);
+	LANES k = lanesSelect(tooShort, zero, lanesSelect(far, farK, nearK));
+	LANES w = lanesSelect(tooShort, one, lanesSelect(far, farW, nearW));
+	return { lanesMul(axis.x, k), lanesMul(axis.y, k), lanesMul(axis.z, k), w };
+}
+
+/**
+ * As shortestArc().
+ */
+LANE_QUATERNION laneArc(const LANE_VECTOR &from, const LANE_VECTOR &to, const LANE_VECTOR &fallback) {
+	LANES lengths = lanesSqrt(lanesMul(laneDot(from, from), laneDot(to, to)));
+	LANE_VECTOR c = laneCross(from, to);
+	LANES crossLength = lanesSqrt(laneDot(c, c));
+
+	LANES inLine = lanesLess(crossLength, lanesMul(lengths, lanesSet(ARC_PARALLEL)));
+	LANES divisor = lanesSelect(inLine, lanesSet(1), crossLength);
+	LANE_VECTOR axis = {
+		lanesSelect(inLine, fallback.x, lanesDiv(c.x, divisor)),
+		lanesSelect(inLine, fallback.y, lanesDiv(c.y, divisor)),
+		lanesSelect(inLine, fallback.z, lanesDiv(c.z, divisor))
+	};
+	return laneRotationAbout(axis, laneDot(from, to), crossLength, lengths);
+}
+
+/**
+ * As turnAbout().
+ */
+LANE_QUATERNION laneTurnAbout(const LANE_VECTOR &axis, const LANE_VECTOR &from, const LANE_VECTOR &to) {
+	LANES lengths = lanesSqrt(lanesMul(laneDot(from, from), laneDot(to, to)));
+	return laneRotationAbout(axis, laneDot(from, to), laneDot(laneCross(from, to), axis), lengths);
+}
+
+/**
+ * As perpendicularTo().
+ */
+LANE_VECTOR lanePerpendicular(const LANE_VECTOR &v) {
+	const LANES zero = lanesSet(0);
+	LANES nearX = lanesLess(lanesSet(0.9f), lanesAbs(v.x));
+	LANE_VECTOR p = {
+		lanesSelect(nearX, lanesSub(zero, v.z), zero),
+		lanesSelect(nearX, zero, v.z),
+		lanesSelect(nearX, v.x, lanesSub(zero, v.y))
+	};
+	LANES len = lanesSqrt(laneDot(p, p));
+	return { lanesDiv(p.x, len), lanesDiv(p.y, len), lanesDiv(p.z, len) };
+}
+
+/**
+ * As acrossAxis().
+ */
+LANE_VECTOR laneAcross(const LANE_VECTOR &axis, const LANE_VECTOR &v) {
+	LANES along = laneDot(axis, v);
+	return { lanesSub(v.x, lanesMul(axis.x, along)), lanesSub(v.y, lanesMul(axis.y, along)), lanesSub(v.z, lanesMul(axis.z, along)) };
+}
+
+/**
+ * As solveRigScalar(), a bone of every body at a time.
+ */
+void solveRig(const RIG *rig, const RIG_JOINTS *joints, RIG_ROTATIONS *rotations) {
+	const LANES zero = lanesSet(0);
+
+	for (int lane = 0; lane < joints->nBodies; lane += LANE_WIDTH) {
+		for (int i = 0; i < rig->nBones; i++) {
+			const RIG_BONE &bone = rig->bones[i];
+			const LANE_VECTOR rest = { lanesSet(bone.rest[0]), lanesSet(bone.rest[1]), lanesSet(bone.rest[2]) };
+
+			LANE_QUATERNION parent = { zero, zero, zero, lanesSet(1) };
+			if (bone.parent >= 0) parent = laneRotation(rotations->world, bone.parent, lane);
+
+			LANE_VECTOR aim = laneRotate(parent, rest);
+			LANE_VECTOR along = laneJoints(joints, bone.head, bone.tail, lane);
+			LANE_QUATERNION world = laneMultiply(laneArc(aim, along, lanePerpendicular(aim)), parent);
+
+			if (bone.sideFrom >= 0) {
+				const LANE_VECTOR restSide = { lanesSet(bone.restSide[0]), lanesSet(bone.restSide[1]), lanesSet(bone.restSide[2]) };
+				LANE_VECTOR axis = laneRotate(world, rest);
+				LANE_VECTOR side = laneAcross(axis, laneRotate(world, restSide));
+				LANE_VECTOR target = laneAcross(axis, laneJoints(joints, bone.sideFrom, bone.sideTo, lane));
+				world = laneMultiply(laneTurnAbout(axis, side, target), world);
+			}
+			laneStore(rotations->world, i, lane, world);
+
+			const LANE_QUATERNION frame = { lanesSet(bone.frame.x), lanesSet(bone.frame.y), lanesSet(bone.frame.z), lanesSet(bone.frame.w) };
+			LANE_QUATERNION local = laneMultiply(laneMultiply(laneConjugate(frame), laneMultiply(laneConjugate(parent), world)), frame);
+			LANES flip = lanesLess(local.w, zero);
+			local = {
+				lanesSelect(flip, lanesSub(zero, local.x), local.x), lanesSelect(flip, lanesSub(zero, local.y), local.y),
+				lanesSelect(flip, lanesSub(zero, local.z), local.z), lanesSelect(flip, lanesSub(zero, local.w), local.w)
+			};
+			laneStore(rotations->local, i, lane, local);
+		}
+	}
+}
+
+#else
+void solveRig(const RIG *rig, const RIG_JOINTS *joints, RIG_ROTATIONS *rotations) {
+	solveRigScalar(rig, joints, rotations);
+}
+
+const char *getRetargetKernel() {
+	return "scalar";
+}
+#endif
@@ -0,0 +1,109 @@
+#include "KinectToJSON.h"
+
+#include <algorithm>
+
+CameraSpacePoint difference(const CameraSpacePoint &a, const CameraSpacePoint &b) {
+	return { a.X - b.X, a.Y - b.Y, a.Z - b.Z };
+}
+
+CameraSpacePoint cross(const CameraSpacePoint &a, const CameraSpacePoint &b) {
+	return { a.Y * b.Z - a.Z * b.Y, a.Z * b.X - a.X * b.Z, a.X * b.Y - a.Y * b.X };
+}
+
+float dotProduct(const CameraSpacePoint &a, const CameraSpacePoint &b) {
+	return a.X * b.X + a.Y * b.Y + a.Z * b.Z;
+}
+
+float vectorLength(const CameraSpacePoint &v) {
+	return sqrtf(v.X * v.X + v.Y * v.Y + v.Z * v.Z);
+}
+
+Vector4 conjugate(const Vector4 &q) {
+	return { -q.x, -q.y, -q.z, q.w };
+}
+
+/**
+ * v + 2w(u x v) + 2u x (u x v), for the unit quaternion (u, w).
+ */
+void rotatePoint(const Vector4 &q, CameraSpacePoint *point) {
+	float tx = 2 * (q.y * point->Z - q.z * point->Y);
+	float ty = 2 * (q.z * point->X - q.x * point->Z);
+	float tz = 2 * (q.x * point->Y - q.y * point->X);
+
+	point->X += q.w * tx + (q.y * tz - q.z * ty);
+	point->Y += q.w * ty + (q.z * tx - q.x * tz);
+	point->Z += q.w * tz + (q.x * ty - q.y * tx);
+}
+
+Vector4 multiplyQuaternions(const Vector4 &a, const Vector4 &b) {
+	Vector4 product;
+	product.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+	product.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+	product.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+	product.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+	return product;
+}
+
+/**
+ * The shortest turn from one direction to another, of any lengths.  Identity when either is too short to say, & about
+ * fallback when they are too near in line to give an axis.
+ */
+Vector4 shortestArc(const CameraSpacePoint &from, const CameraSpacePoint &to, const CameraSpacePoint &fallback) {
+	float lengths = sqrtf(dotProduct(from, from) * dotProduct(to, to));
+	if (lengths < ARC_MIN_LENGTHS) return { 0, 0, 0, 1 };
+
+	CameraSpacePoint c = cross(from, to);
+	float crossLength = vectorLength(c);
+	CameraSpacePoint axis = fallback;
+	if (crossLength > lengths * ARC_PARALLEL) axis = { c.X / crossLength, c.Y / crossLength, c.Z / crossLength };
+
+	return rotationAbout(axis, dotProduct(from, to) / lengths, crossLength / lengths);
+}
+
+/**
+ * The turn about the unit axis from one direction to another, both already across it.  Identity when either is too
+ * short to say.
+ */
+Vector4 turnAbout(const CameraSpacePoint &axis, const CameraSpacePoint &from, const CameraSpacePoint &to) {
+	float lengths = sqrtf(dotProduct(from, from) * dotProduct(to, to));
+	if (lengths < ARC_MIN_LENGTHS) return { 0, 0, 0, 1 };
+
+	return rotationAbout(axis, dotProduct(from, to) / lengths, dotProduct(cross(from, to), axis) / lengths);
+}
+
+/**
+ * The turn about the unit axis by the angle of the cos & sin given.  Of the two half angle formulas, the one which
+ * does not cancel out, so a turn of nearly half way round, as a body facing the other way to its rig needs, is as
+ * exact as any other.
+ */
+Vector4 rotationAbout(const CameraSpacePoint &axis, float cosAngle, float sinAngle) {
+	cosAngle = std::min(std::max(cosAngle, -1.0f), 1.0f);
+
+	float k, w; // sin & cos of half the angle
+	if (cosAngle >= 0) {
+		w = sqrtf((1 + cosAngle) / 2);
+		k = sinAngle / (2 * w);
+	} else {
+		float h = sqrtf((1 - cosAngle) / 2);
+		k = sinAngle < 0 ? -h : h;
+		w = std::abs(sinAngle) / (2 * h);
+	}
+	return { axis.X * k, axis.Y * k, axis.Z * k, w };
+}
+
+/**
+ * A unit direction at right angles to the unit direction v; across X, unless v is nearly along it.
+ */
+CameraSpacePoint perpendicularTo(const CameraSpacePoint &v) {
+	CameraSpacePoint p = std::abs(v.X) > 0.9f ? CameraSpacePoint { -v.Z, 0, v.X } : CameraSpacePoint { 0, v.Z, -v.Y };
+	float len = vectorLength(p);
+	return { p.X / len, p.Y / len, p.Z / len };
+}
+
+/**
+ * What of v is at right angles to the unit axis.
+ */
+CameraSpacePoint acrossAxis(const CameraSpacePoint &axis, const CameraSpacePoint &v) {
+	float along = dotProduct(axis, v);
+	return { v.X - axis.X * along, v.Y - axis.Y * along, v.Z - axis.Z * along };
+}
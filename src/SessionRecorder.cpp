@@ -0,0 +1,111 @@
+#include "KinectToJSON.h"
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// file scope variables
+SessionRecorder sessionRecorders[MULTI_MAX_SOURCES]; // one a sensor; only the first, unless merging several
+std::atomic<bool> recording(false); // checked on every frame, so the body thread only locks when actually recording
+std::mutex recordingMu;             // guards opening the recordings of sensors after the first, as their frames arrive
+std::string recordingPath;
+bool recordingTried[MULTI_MAX_SOURCES];
+
+/**
+ * Record every frame read from the sensor, before any transforms, until endRecording().  Frames can be played back with
+ * openReplaySensor().  Recording can be started or stopped at any time, whether tracking or not.  When merging sensors,
+ * each is recorded before its extrinsics, the first to path, & each other to path + "." + its #, from 1, once it has a
+ * frame.
+ * @param path - The data file; an index file of the same name + ".idx" is also written.
+ */
+DllExport HRESULT beginRecording(const char *path) {
+	std::lock_guard<std::mutex> lock(recordingMu);
+	HRESULT hr = sessionRecorders[0].open(path);
+	if (SUCCEEDED(hr)) {
+		recordingPath = path;
+		memset(recordingTried, 0, sizeof(recordingTried));
+		recording = true;
+	}
+	return hr;
+}
+
+/**
+ * @returns the number of frames recorded, of the first sensor when merging several.
+ */
+DllExport int endRecording() {
+	std::lock_guard<std::mutex> lock(recordingMu);
+	recording = false;
+	for (int s = 1; s < MULTI_MAX_SOURCES; s++) sessionRecorders[s].close();
+	return sessionRecorders[0].close();
+}
+
+/**
+ * @param sensor - of a merge, from 0, or 0 for the only one
+ */
+void recordFrame(const FRAME_DATA *frame, int sensor) {
+	if (!recording) return;
+
+	if (sensor > 0 && !recordingTried[sensor]) {
+		std::lock_guard<std::mutex> lock(recordingMu);
+		if (!recording || recordingTried[sensor]) return;
+		sessionRecorders[sensor].open((recordingPath + "." + std::to_string(sensor)).c_str());
+		recordingTried[sensor] = true;
+	}
+	sessionRecorders[sensor].append(frame);
+}
+
+SessionRecorder::~SessionRecorder() {
+	close();
+}
+
+HRESULT SessionRecorder::open(const char *path) {
+	std::lock_guard<std::mutex> lock(mu);
+	if (data != nullptr) return E_ABORT;
+
+	std::string indexPath = std::string(path) + RECORDING_INDEX_EXT;
+	if (fopen_s(&data, path, "wb") != 0 || fopen_s(&index, indexPath.c_str(), "wb") != 0) {
+		std::cerr << "Cannot open recording: " << path << "\n";
+		if (data != nullptr) fclose(data);
+		data = nullptr;
+		return E_INVALIDARG;
+	}
+
+	RECORDING_HEADER header;
+	memcpy(header.magic, RECORDING_MAGIC, sizeof(header.magic));
+	header.version = RECORDING_VERSION;
+	header.bodyDataSz = sizeof(BODY_DATA);
+	header.reserved = 0;
+	fwrite(&header, sizeof(header), 1, data);
+
+	offset = sizeof(header);
+	nFrames = 0;
+	return S_OK;
+}
+
+int SessionRecorder::close() {
+	std::lock_guard<std::mutex> lock(mu);
+	if (data != nullptr) fclose(data);
+	if (index != nullptr) fclose(index);
+	data = nullptr;
+	index = nullptr;
+	return nFrames;
+}
+
+/**
+ * Append a frame, & its offset to the index.  Only the tracked bodies are written.
+ */
+void SessionRecorder::append(const FRAME_DATA *frame) {
+	std::lock_guard<std::mutex> lock(mu);
+	if (data == nullptr) return;
+
+	RECORDED_FRAME record;
+	record.clipPlane = frame->clipPlane;
+	record.relativeTime = frame->relativeTime;
+	record.bodyCount = frame->bodyCount;
+	record.reserved = 0;
+
+	// data before index; replay also checks each frame is whole & within the data, in case a recording was cut short
+	fwrite(&record, sizeof(record), 1, data);
+	fwrite(frame->bodies, sizeof(BODY_DATA), frame->bodyCount, data);
+	fwrite(&offset, sizeof(offset), 1, index);
+
+	offset += sizeof(record) + frame->bodyCount * sizeof(BODY_DATA);
+	nFrames++;
+}
@@ -0,0 +1,129 @@
+#include "KinectToJSON.h"
+
+// forward declare of non-external functions
+UINT32 loadSequence(const SHARED_FRAME *shared);
+void storeSequence(SHARED_FRAME *shared, UINT32 sequence);
+
+SharedFrameWriter::SharedFrameWriter() : closed(true), waiters(0) {
+}
+
+/**
+ * Start writing frames into target, which the caller keeps ownership of.  Only call when there is no writer running.
+ */
+void SharedFrameWriter::open(SHARED_FRAME *target) {
+	memset(target, 0, sizeof(SHARED_FRAME));
+	this->target = target;
+	closed = false;
+}
+
+/**
+ * Wake any reader blocked in wait().  The last frame written stays in the target.
+ */
+void SharedFrameWriter::close() {
+	closed = true;
+	std::lock_guard<std::mutex> lock(waitMu);
+	frameReady.notify_all();
+}
+
+/**
+ * Copy the frame into the target, in place.  Only the bodies of the frame are written, so those past bodyCount are
+ * left as they were.
+ */
+void SharedFrameWriter::write(const FRAME_DATA *frame) {
+	UINT32 sequence = loadSequence(target);
+	storeSequence(target, sequence + 1);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	target->frame = frame->frame;
+	target->bodyCount = frame->bodyCount;
+	target->cameraHeight = frame->cameraHeight;
+	target->clipPlane[0] = frame->clipPlane.x;
+	target->clipPlane[1] = frame->clipPlane.y;
+	target->clipPlane[2] = frame->clipPlane.z;
+	target->clipPlane[3] = frame->clipPlane.w;
+	target->relativeTime = frame->relativeTime;
+
+	for (int b = 0; b < frame->bodyCount; b++) {
+		const BODY_DATA *body = &frame->bodies[b];
+		target->ids[b] = body->id;
+		target->handStates[b][0] = body->leftHandState;
+		target->handStates[b][1] = body->rightHandState;
+
+		for (int j = 0; j < JointType_Count; j++) {
+			const CameraSpacePoint &position = body->joints[j].Position;
+			const Vector4 &orientation = body->rotations[j].Orientation;
+			float *out = target->joints[b][j];
+
+			out[0] = (float) body->joints[j].TrackingState;
+			out[1] = position.X;
+			out[2] = position.Y;
+			out[3] = position.Z;
+			out[4] = orientation.x;
+			out[5] = orientation.y;
+			out[6] = orientation.z;
+			out[7] = orientation.w;
+		}
+	}
+
+	std::atomic_thread_fence(std::memory_order_release);
+	storeSequence(target, sequence + 2);
+
+	// only pay for the lock when a reader is actually asleep.  The sequence is a plain store, so without the fence it
+	// could pass the load of waiters, & miss a reader which read the old sequence after its waiters++
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (waiters.load() > 0) {
+		std::lock_guard<std::mutex> lock(waitMu);
+		frameReady.notify_all();
+	}
+}
+
+/**
+ * Sleep until a frame after sequence has been written, the timeout passes, or the writer is closed.
+ * @returns the sequence of the last whole frame written, which is sequence when none was.
+ */
+UINT32 SharedFrameWriter::wait(UINT32 sequence, int timeoutMillis) {
+	if (target == nullptr) return sequence;
+
+	std::unique_lock<std::mutex> lock(waitMu);
+	waiters++;
+	frameReady.wait_for(lock, std::chrono::milliseconds(timeoutMillis), [this, sequence] {
+		UINT32 current = loadSequence(target);
+		return closed || ((current & 1) == 0 && current != sequence);
+	});
+	waiters--;
+
+	return loadSequence(target) & ~1u;
+}
+
+/**
+ * The reader's side of the seqlock, for C callers; Python does the same with the buffer it owns.  Copies until the
+ * frame was not written to during the copy.
+ * @returns the sequence of the frame copied.
+ */
+UINT32 readSharedFrame(const SHARED_FRAME *shared, SHARED_FRAME *copy) {
+	while (true) {
+		UINT32 before = loadSequence(shared);
+		if (before & 1) {
+			std::this_thread::yield();
+			continue;
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		memcpy(copy, shared, sizeof(SHARED_FRAME));
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (loadSequence(shared) == before) {
+			copy->sequence = before;
+			return before;
+		}
+	}
+}
+
+// the buffer is the caller's, so it has no atomics of its own
+UINT32 loadSequence(const SHARED_FRAME *shared) {
+	return *(const volatile UINT32 *) &shared->sequence;
+}
+
+void storeSequence(SHARED_FRAME *shared, UINT32 sequence) {
+	*(volatile UINT32 *) &shared->sequence = sequence;
+}
@@ -0,0 +1,71 @@
+#include "KinectToJSON.h"
+
+/**
+ * @param nBodies - The number of bodies of generateSyntheticFrame(), up to BODY_COUNT.
+ * @param hz - Frames per second; a Kinect v2 is 30.
+ */
+SimulatedFrameSource::SimulatedFrameSource(int nBodies, int hz) :
+	period(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(1000000000LL / (hz > 0 ? hz : 30)))) {
+	config = { nBodies, SyntheticMotion_Swing, 0, 0, 0, 0 };
+}
+
+/**
+ * @param config - Of generateSyntheticBodies(); copied.
+ * @param hz - Frames per second; a Kinect v2 is 30.
+ */
+SimulatedFrameSource::SimulatedFrameSource(const SYNTHETIC_CONFIG *config, int hz) : config(*config),
+	period(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(1000000000LL / (hz > 0 ? hz : 30)))) {
+}
+
+HRESULT SimulatedFrameSource::start() {
+	std::lock_guard<std::mutex> lock(mu);
+	woken = false;
+	frameNumber = 0;
+	startTime = std::chrono::steady_clock::now();
+	nextFrame = startTime + period;
+	return S_OK;
+}
+
+void SimulatedFrameSource::stop() {
+}
+
+/**
+ * Sleep till the next frame is due on the clock.  Frames are never skipped, so a slow consumer sees them late, as with a
+ * sensor's frame arrived event.
+ */
+HRESULT SimulatedFrameSource::waitForFrame(FRAME_DATA *frame) {
+	std::unique_lock<std::mutex> lock(mu);
+	if (wakeup.wait_until(lock, nextFrame, [this] { return woken; })) return S_FALSE;
+	lock.unlock();
+
+	return acquireLatestFrame(frame);
+}
+
+HRESULT SimulatedFrameSource::acquireLatestFrame(FRAME_DATA *frame) {
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (now < nextFrame) return E_PENDING;
+
+	UINT64 start = stageClock();
+	generateSyntheticBodies(frame, &config, frameNumber);
+	endStage(TrackingStage_Refresh, start);
+	frame->relativeTime = std::chrono::duration_cast<std::chrono::nanoseconds>(nextFrame - startTime).count() / 100;
+
+	frameNumber++;
+	nextFrame += period;
+	return S_OK;
+}
+
+void SimulatedFrameSource::wake() {
+	std::lock_guard<std::mutex> lock(mu);
+	woken = true;
+	wakeup.notify_all();
+}
+
+/**
+ * When frames started being due, on the steady clock; frame n is due a period after frame n - 1, the first a period after
+ * this, so how late each is delivered can be measured.
+ */
+std::chrono::steady_clock::time_point SimulatedFrameSource::getStartTime() {
+	std::lock_guard<std::mutex> lock(mu);
+	return startTime;
+}
@@ -0,0 +1,739 @@
+#include "KinectToJSON.h"
+
+#ifdef _WIN32
+#include <ws2tcpip.h>
+#define SEND_FLAGS 0
+#define socketWouldBlock() (WSAGetLastError() == WSAEWOULDBLOCK)
+#else
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#define INVALID_SOCKET (-1)
+#define SEND_FLAGS MSG_NOSIGNAL // a client closing must not kill the process with SIGPIPE
+#define socketWouldBlock() (errno == EAGAIN || errno == EWOULDBLOCK)
+#endif
+
+// forward declare of non-external functions
+void streamFrame(char *json);
+void streamBinaryFrame(char *frame, int len);
+STREAM_SOCKET openListener(int port);
+STREAM_SOCKET openWakeSocket(STREAM_SOCKET *sender);
+bool setNonBlocking(STREAM_SOCKET socket);
+int writeFrameHeader(unsigned char *out, int len, bool webSocket, bool binary);
+int writeHandshake(const char *request, char *reply);
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// file scope variables
+StreamServer streamServer(STREAM_QUEUE_FRAMES, FRAME_JSON_SZ);
+
+// what each socket being watched is
+#define TOKEN_TCP 0
+#define TOKEN_WEBSOCKET 1
+#define TOKEN_WAKE 2
+#define TOKEN_CLIENT 3
+
+const char WEBSOCKET_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+const char WEBSOCKET_KEY[] = "Sec-WebSocket-Key:";
+
+/**
+ * Begin body tracking, sending every frame to any number of local clients, instead of to a callback.  Raw TCP clients
+ * connect to port, WebSocket clients to port + 1.  openSensor must have been called first.
+ * @param JSON_or_Binary - J for JSON, B for the binary format of beginBodyTrackingBinary
+ */
+DllExport HRESULT beginStreaming(int port, char JSON_or_Binary) {
+	bool binary = JSON_or_Binary == 'B';
+	HRESULT hr = streamServer.start(port, binary);
+
+	if (SUCCEEDED(hr)) {
+		hr = binary ? beginBodyTrackingBinary(&streamBinaryFrame, '\0') : beginBodyTracking(&streamFrame);
+		if (FAILED(hr)) streamServer.stop();
+	}
+	return hr;
+}
+
+/**
+ * End body tracking, then disconnect all clients.
+ */
+DllExport void endStreaming() {
+	endBodyTracking();
+	streamServer.stop();
+}
+
+DllExport HRESULT getStreamStats(STREAM_SERVER_STATS *stats) {
+	if (stats == nullptr) return E_POINTER;
+
+	streamServer.getStats(stats);
+	return S_OK;
+}
+
+// the callbacks, on the sensor thread; broadcast never waits on a client
+void streamFrame(char *json) {
+	streamServer.broadcast(json, (int) strlen(json));
+}
+
+void streamBinaryFrame(char *frame, int len) {
+	streamServer.broadcast(frame, len);
+}
+
+/**
+ * @param nFrames - The history kept, which is also the most frames a client can fall behind by.
+ * @param frameSz - The largest frame, in bytes.
+ */
+StreamServer::StreamServer(int nFrames, int frameSz) : nFrames(nFrames), frameSz(frameSz), nStarted(0), nBroadcast(0), wakePending(false), nClients(0),
+	running(false), framesSent(0), framesDropped(0), bytesSent(0) {
+	listeners[0] = listeners[1] = wakeReceiver = wakeSender = INVALID_SOCKET;
+	memset(clients, 0, sizeof(clients));
+}
+
+StreamServer::~StreamServer() {
+	stop();
+	delete[] frames;
+	delete[] lens;
+}
+
+/**
+ * Listen on loopback, raw TCP on port, & WebSocket on port + 1, & start the server's thread.
+ */
+HRESULT StreamServer::start(int port, bool binary) {
+	if (running) return E_ABORT;
+
+#ifdef _WIN32
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) return E_FAIL;
+#endif
+
+	if (frames == nullptr) {
+		frames = new char[(size_t) nFrames * frameSz];
+		lens = new int[nFrames](); // a slot never written is empty
+	}
+	this->binary = binary;
+	nStarted = 0;
+	nBroadcast = 0;
+	framesSent = 0;
+	framesDropped = 0;
+	bytesSent = 0;
+	wakePending = false;
+
+	listeners[0] = openListener(port);
+	listeners[1] = openListener(port + 1);
+	wakeReceiver = openWakeSocket(&wakeSender);
+
+	bool opened = listeners[0] != INVALID_SOCKET && listeners[1] != INVALID_SOCKET && wakeReceiver != INVALID_SOCKET;
+#ifndef _WIN32
+	if (opened) {
+		poller = epoll_create1(0);
+		STREAM_SOCKET watched[] = { listeners[0], listeners[1], wakeReceiver };
+		for (int token = 0; token < TOKEN_CLIENT; token++) {
+			epoll_event event;
+			event.events = EPOLLIN;
+			event.data.u64 = token;
+			opened &= epoll_ctl(poller, EPOLL_CTL_ADD, watched[token], &event) == 0;
+		}
+	}
+#endif
+
+	if (!opened) {
+		std::cerr << "Cannot listen on ports " << port << " & " << port + 1 << "\n";
+		running = true;
+		stop();
+		return E_FAIL;
+	}
+
+	running = true;
+	thread = std::thread(&StreamServer::serverLoop, this);
+	std::cout << "Streaming on port " << port << ", WebSocket on port " << port + 1 << "\n";
+	return S_OK;
+}
+
+/**
+ * Stop the server's thread, & disconnect every client.
+ */
+void StreamServer::stop() {
+	if (!running.exchange(false)) return;
+
+	if (thread.joinable()) {
+		send(wakeSender, "w", 1, SEND_FLAGS);
+		thread.join();
+	}
+
+	for (int c = 0; c < STREAM_MAX_CLIENTS; c++) {
+		if (clients[c] != nullptr) drop(c);
+	}
+
+	STREAM_SOCKET sockets[] = { listeners[0], listeners[1], wakeReceiver, wakeSender };
+	for (unsigned int i = 0; i < _countof(sockets); i++) {
+		if (sockets[i] != INVALID_SOCKET) closeStreamSocket(sockets[i]);
+	}
+	listeners[0] = listeners[1] = wakeReceiver = wakeSender = INVALID_SOCKET;
+
+#ifdef _WIN32
+	WSACleanup();
+#else
+	if (poller >= 0) close(poller);
+	poller = -1;
+#endif
+}
+
+/**
+ * Add a frame to the history, & wake the server's thread to send it.  Called on the sensor thread, so never waits on a
+ * lock, or touches a client's socket.  Only one thread may broadcast.
+ */
+void StreamServer::broadcast(const char *frame, int len) {
+	if (!running || len > frameSz) return;
+
+	// nStarted goes up first, so the server's thread can tell when a slot it copied was being overwritten
+	UINT64 n = nBroadcast.load(std::memory_order_relaxed);
+	nStarted.store(n + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	int slot = (int) (n % nFrames);
+	memcpy(&frames[(size_t) slot * frameSz], frame, len);
+	lens[slot] = len;
+	nBroadcast.store(n + 1, std::memory_order_release);
+
+	// one wake up covers any number of frames, so there is never more than one waiting in the socket
+	if (!wakePending.exchange(true)) send(wakeSender, "w", 1, SEND_FLAGS);
+}
+
+void StreamServer::getStats(STREAM_SERVER_STATS *stats) {
+	stats->framesBroadcast = nBroadcast;
+	stats->framesSent = framesSent;
+	stats->framesDropped = framesDropped;
+	stats->bytesSent = bytesSent;
+	stats->clients = nClients;
+}
+
+void StreamServer::serverLoop() {
+	int tokens[TOKEN_CLIENT + STREAM_MAX_CLIENTS];
+	bool readable[TOKEN_CLIENT + STREAM_MAX_CLIENTS];
+	bool writable[TOKEN_CLIENT + STREAM_MAX_CLIENTS];
+
+	while (running) {
+		int nEvents = waitForEvents(tokens, readable, writable, 1000);
+
+		for (int e = 0; e < nEvents; e++) {
+			int token = tokens[e];
+
+			if (token == TOKEN_TCP || token == TOKEN_WEBSOCKET) {
+				accept(listeners[token], token == TOKEN_WEBSOCKET);
+
+			} else if (token == TOKEN_WAKE) {
+				char drain[64];
+				while (receiveSome(wakeReceiver, drain, sizeof(drain)) > 0);
+
+			} else {
+				int c = token - TOKEN_CLIENT;
+				if (clients[c] != nullptr && readable[e]) read(c);
+				if (clients[c] != nullptr && writable[e]) flush(c);
+			}
+		}
+
+		// cleared before looking at the history, so a frame broadcast from here on wakes the next wait
+		wakePending = false;
+		for (int c = 0; c < STREAM_MAX_CLIENTS; c++) {
+			if (clients[c] != nullptr && !clients[c]->writeWaiting) flush(c);
+		}
+	}
+}
+
+/**
+ * Wait for sockets to become readable, or writable for clients which are waiting to be.
+ * @returns the number of events, each with the token of the socket.
+ */
+int StreamServer::waitForEvents(int *tokens, bool *readable, bool *writable, int timeoutMillis) {
+	int nEvents = 0;
+
+#ifdef _WIN32
+	// WSAPoll has no registration, so the set is built each time
+	WSAPOLLFD fds[TOKEN_CLIENT + STREAM_MAX_CLIENTS];
+	int fdTokens[TOKEN_CLIENT + STREAM_MAX_CLIENTS];
+	STREAM_SOCKET watched[] = { listeners[0], listeners[1], wakeReceiver };
+
+	int n = 0;
+	for (int token = 0; token < TOKEN_CLIENT; token++, n++) {
+		fds[n].fd = watched[token];
+		fds[n].events = POLLRDNORM;
+		fdTokens[n] = token;
+	}
+	for (int c = 0; c < STREAM_MAX_CLIENTS; c++) {
+		if (clients[c] == nullptr) continue;
+
+		fds[n].fd = clients[c]->socket;
+		fds[n].events = POLLRDNORM | (clients[c]->writeWaiting ? POLLWRNORM : 0);
+		fdTokens[n++] = TOKEN_CLIENT + c;
+	}
+
+	if (WSAPoll(fds, n, timeoutMillis) <= 0) return 0;
+
+	for (int i = 0; i < n; i++) {
+		if (fds[i].revents == 0) continue;
+
+		tokens[nEvents] = fdTokens[i];
+		readable[nEvents] = (fds[i].revents & (POLLRDNORM | POLLHUP | POLLERR)) != 0;
+		writable[nEvents] = (fds[i].revents & POLLWRNORM) != 0;
+		nEvents++;
+	}
+#else
+	epoll_event events[TOKEN_CLIENT + STREAM_MAX_CLIENTS];
+	int n = epoll_wait(poller, events, _countof(events), timeoutMillis);
+
+	for (int i = 0; i < n; i++, nEvents++) {
+		tokens[nEvents] = (int) events[i].data.u64;
+		readable[nEvents] = (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0;
+		writable[nEvents] = (events[i].events & EPOLLOUT) != 0;
+	}
+#endif
+	return nEvents;
+}
+
+/**
+ * Take every connection waiting on the listener.  New clients start from the next frame broadcast.
+ */
+void StreamServer::accept(STREAM_SOCKET listener, bool webSocket) {
+	while (true) {
+		STREAM_SOCKET socket = ::accept(listener, nullptr, nullptr);
+		if (socket == INVALID_SOCKET) return;
+
+		int c = 0;
+		while (c < STREAM_MAX_CLIENTS && clients[c] != nullptr) c++;
+
+		if (c == STREAM_MAX_CLIENTS || !setNonBlocking(socket)) {
+			std::cerr << "Stream client refused\n";
+			closeStreamSocket(socket);
+			continue;
+		}
+
+		int noDelay = 1;
+		setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char *) &noDelay, sizeof(noDelay));
+
+		STREAM_CLIENT *client = new STREAM_CLIENT;
+		client->socket = socket;
+		client->webSocket = webSocket;
+		client->upgraded = false;
+		client->writeWaiting = false;
+		client->pendingFrame = false;
+		client->pending = new char[frameSz + STREAM_FRAME_HEADER_SZ];
+		client->pendingLen = 0;
+		client->pendingSent = 0;
+		client->requestLen = 0;
+		client->nextFrame = nBroadcast;
+		clients[c] = client;
+		nClients++;
+
+#ifndef _WIN32
+		epoll_event event;
+		event.events = EPOLLIN;
+		event.data.u64 = TOKEN_CLIENT + c;
+		epoll_ctl(poller, EPOLL_CTL_ADD, socket, &event);
+#endif
+	}
+}
+
+/**
+ * Read what a client sent.  The only thing expected is a WebSocket upgrade request; anything else is ignored, other
+ * than a WebSocket close.
+ */
+void StreamServer::read(int c) {
+	STREAM_CLIENT *client = clients[c];
+	char ignored[1024];
+
+	while (true) {
+		if (client->webSocket && !client->upgraded) {
+			int room = STREAM_REQUEST_SZ - 1 - client->requestLen;
+			int len = receiveSome(client->socket, client->request + client->requestLen, room);
+			if (len < 0 || (len == 0 && room == 0)) {
+				drop(c);
+				return;
+			}
+			if (len == 0) return;
+
+			client->requestLen += len;
+			client->request[client->requestLen] = '\0';
+			if (strstr(client->request, "\r\n\r\n") == nullptr) continue;
+
+			// the reply goes out ahead of any frame
+			client->pendingLen = writeHandshake(client->request, client->pending);
+			client->pendingSent = 0;
+			client->pendingFrame = false;
+			if (client->pendingLen == 0) {
+				drop(c);
+				return;
+			}
+			client->upgraded = true;
+
+		} else {
+			int len = receiveSome(client->socket, ignored, sizeof(ignored));
+			if (len < 0 || (client->webSocket && len > 0 && (ignored[0] & 0x0F) == 0x08)) {
+				drop(c);
+				return;
+			}
+			if (len == 0) return;
+		}
+	}
+}
+
+/**
+ * Send a client as much as its socket will take; what is left of the frame being sent, then the frames it is behind
+ * by.  When it has fallen more than the history behind, its oldest frames are dropped.
+ * @returns false when the client was dropped.
+ */
+bool StreamServer::flush(int c) {
+	STREAM_CLIENT *client = clients[c];
+
+	while (true) {
+		if (client->pendingSent < client->pendingLen) {
+			int sent = sendSome(client->socket, client->pending + client->pendingSent, client->pendingLen - client->pendingSent);
+			if (sent < 0) {
+				drop(c);
+				return false;
+			}
+
+			client->pendingSent += sent;
+			bytesSent += sent;
+			if (client->pendingSent < client->pendingLen) {
+				if (!client->writeWaiting) watch(c, true);
+				return true;
+			}
+			if (client->pendingFrame) framesSent++;
+		}
+
+		if (client->webSocket && !client->upgraded) break;
+
+		UINT64 available = nBroadcast.load(std::memory_order_acquire);
+		if (client->nextFrame >= available) break;
+
+		// the slot of the oldest frame may be being overwritten right now, so it is dropped too
+		if (available + 1 - client->nextFrame > (UINT64) nFrames) {
+			framesDropped += available + 1 - nFrames - client->nextFrame;
+			client->nextFrame = available + 1 - nFrames;
+		}
+
+		int slot = (int) (client->nextFrame % nFrames);
+		int len = lens[slot];
+		if (len < 0 || len > frameSz) {
+			// a slot which cannot be sent is dropped, rather than read again forever
+			framesDropped++;
+			client->nextFrame++;
+			continue;
+		}
+
+		int headerLen = writeFrameHeader((unsigned char *) client->pending, len, client->webSocket, binary);
+		memcpy(client->pending + headerLen, &frames[(size_t) slot * frameSz], len);
+
+		// overwritten while copying; go round again, which drops it
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (nStarted.load(std::memory_order_relaxed) > client->nextFrame + nFrames) continue;
+
+		client->pendingLen = headerLen + len;
+		client->pendingSent = 0;
+		client->pendingFrame = true;
+		client->nextFrame++;
+	}
+
+	if (client->writeWaiting) watch(c, false);
+	return true;
+}
+
+void StreamServer::drop(int c) {
+	STREAM_CLIENT *client = clients[c];
+
+#ifndef _WIN32
+	epoll_ctl(poller, EPOLL_CTL_DEL, client->socket, nullptr);
+#endif
+	closeStreamSocket(client->socket);
+	delete[] client->pending;
+	delete client;
+
+	clients[c] = nullptr;
+	nClients--;
+}
+
+/**
+ * Start or stop waiting for a client's socket to be writable.
+ */
+void StreamServer::watch(int c, bool writable) {
+	clients[c]->writeWaiting = writable;
+
+#ifndef _WIN32
+	epoll_event event;
+	event.events = EPOLLIN | (writable ? (UINT32) EPOLLOUT : 0);
+	event.data.u64 = TOKEN_CLIENT + c;
+	epoll_ctl(poller, EPOLL_CTL_MOD, clients[c]->socket, &event);
+#endif
+}
+
+/**
+ * Raw TCP frames are prefixed by their length, little endian.  WebSocket frames from a server are never masked.
+ * @returns the length of the header.
+ */
+int writeFrameHeader(unsigned char *out, int len, bool webSocket, bool binary) {
+	if (!webSocket) {
+		for (int i = 0; i < 4; i++) out[i] = (unsigned char) (len >> (8 * i));
+		return 4;
+	}
+
+	out[0] = 0x80 | (binary ? 0x02 : 0x01); // final fragment, binary or text
+	if (len < 126) {
+		out[1] = (unsigned char) len;
+		return 2;
+	}
+	if (len < 65536) {
+		out[1] = 126;
+		out[2] = (unsigned char) (len >> 8);
+		out[3] = (unsigned char) len;
+		return 4;
+	}
+
+	out[1] = 127;
+	for (int i = 0; i < 8; i++) out[2 + i] = (unsigned char) ((UINT64) len >> (8 * (7 - i)));
+	return 10;
+}
+
+/**
+ * Write the reply to a WebSocket upgrade request.
+ * @returns the length of the reply, or 0 when the request has no key.
+ */
+int writeHandshake(const char *request, char *reply) {
+	const char *key = strstr(request, WEBSOCKET_KEY);
+	if (strncmp(request, "GET ", 4) != 0 || key == nullptr) return 0;
+
+	key += sizeof(WEBSOCKET_KEY) - 1;
+	while (*key == ' ') key++;
+	int keyLen = 0;
+	while (key[keyLen] != '\r' && key[keyLen] != '\0' && key[keyLen] != ' ') keyLen++;
+
+	char accept[128];
+	if (keyLen + sizeof(WEBSOCKET_GUID) > sizeof(accept)) return 0;
+	memcpy(accept, key, keyLen);
+	memcpy(accept + keyLen, WEBSOCKET_GUID, sizeof(WEBSOCKET_GUID));
+
+	unsigned char digest[20];
+	char encoded[32];
+	sha1((const unsigned char *) accept, strlen(accept), digest);
+	encoded[base64(digest, sizeof(digest), encoded)] = '\0';
+
+	return sprintf_s(reply, STREAM_REQUEST_SZ, "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n", encoded);
+}
+
+/**
+ * A non-blocking listener, on loopback only.
+ */
+STREAM_SOCKET openListener(int port) {
+	STREAM_SOCKET listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (listener == INVALID_SOCKET) return INVALID_SOCKET;
+
+	int reuse = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char *) &reuse, sizeof(reuse));
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons((unsigned short) port);
+
+	if (bind(listener, (sockaddr *) &address, sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0 || !setNonBlocking(listener)) {
+		closeStreamSocket(listener);
+		return INVALID_SOCKET;
+	}
+	return listener;
+}
+
+/**
+ * A pair of loopback UDP sockets, so the sensor thread can wake the server's thread out of its wait, on any platform.
+ * @returns the end to wait on.
+ */
+STREAM_SOCKET openWakeSocket(STREAM_SOCKET *sender) {
+	*sender = INVALID_SOCKET;
+	STREAM_SOCKET receiver = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (receiver == INVALID_SOCKET) return INVALID_SOCKET;
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = 0;
+	socklen_t addressLen = sizeof(address);
+
+	if (bind(receiver, (sockaddr *) &address, sizeof(address)) == 0 && getsockname(receiver, (sockaddr *) &address, &addressLen) == 0) {
+		*sender = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	}
+
+	if (*sender == INVALID_SOCKET || connect(*sender, (sockaddr *) &address, sizeof(address)) != 0 || !setNonBlocking(receiver) || !setNonBlocking(*sender)) {
+		if (*sender != INVALID_SOCKET) closeStreamSocket(*sender);
+		closeStreamSocket(receiver);
+		*sender = INVALID_SOCKET;
+		return INVALID_SOCKET;
+	}
+	return receiver;
+}
+
+bool setNonBlocking(STREAM_SOCKET socket) {
+#ifdef _WIN32
+	u_long nonBlocking = 1;
+	return ioctlsocket(socket, FIONBIO, &nonBlocking) == 0;
+#else
+	int flags = fcntl(socket, F_GETFL, 0);
+	return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+/**
+ * Connect a non-blocking client to a port on loopback, as a viewer would.
+ */
+STREAM_SOCKET connectLoopback(int port) {
+	STREAM_SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (client == INVALID_SOCKET) return INVALID_SOCKET;
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons((unsigned short) port);
+
+	int noDelay = 1;
+	setsockopt(client, IPPROTO_TCP, TCP_NODELAY, (const char *) &noDelay, sizeof(noDelay));
+
+	if (connect(client, (sockaddr *) &address, sizeof(address)) != 0 || !setNonBlocking(client)) {
+		closeStreamSocket(client);
+		return INVALID_SOCKET;
+	}
+	return client;
+}
+
+/**
+ * @returns the bytes read, 0 when there is nothing to read yet, or -1 when closed.
+ */
+int receiveSome(STREAM_SOCKET socket, char *buffer, int len) {
+	int received = (int) recv(socket, buffer, len, 0);
+	if (received > 0) return received;
+	if (received < 0 && socketWouldBlock()) return 0;
+	return -1;
+}
+
+/**
+ * @returns the bytes sent, 0 when the socket's buffer is full, or -1 when closed.
+ */
+int sendSome(STREAM_SOCKET socket, const char *buffer, int len) {
+	int sent = (int) send(socket, buffer, len, SEND_FLAGS);
+	if (sent >= 0) return sent;
+	return socketWouldBlock() ? 0 : -1;
+}
+
+/**
+ * Wait up to timeoutMillis for any of the sockets to be readable.
+ * @returns the number readable, each flagged in readable.
+ */
+int waitReadable(const STREAM_SOCKET *sockets, int nSockets, bool *readable, int timeoutMillis) {
+#ifdef _WIN32
+	WSAPOLLFD fds[STREAM_MAX_CLIENTS];
+#else
+	pollfd fds[STREAM_MAX_CLIENTS];
+#endif
+	if (nSockets > STREAM_MAX_CLIENTS) nSockets = STREAM_MAX_CLIENTS;
+
+	for (int i = 0; i < nSockets; i++) {
+		fds[i].fd = sockets[i];
+		fds[i].events = POLLIN;
+		fds[i].revents = 0;
+	}
+
+#ifdef _WIN32
+	int ready = WSAPoll(fds, nSockets, timeoutMillis);
+#else
+	int ready = poll(fds, nSockets, timeoutMillis);
+#endif
+
+	for (int i = 0; i < nSockets; i++) {
+		readable[i] = ready > 0 && fds[i].revents != 0;
+	}
+	return ready > 0 ? ready : 0;
+}
+
+void closeStreamSocket(STREAM_SOCKET socket) {
+#ifdef _WIN32
+	closesocket(socket);
+#else
+	close(socket);
+#endif
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// just enough of SHA-1 & base64 for the WebSocket handshake
+
+#define ROTATE_LEFT(value, bits) (((value) << (bits)) | ((value) >> (32 - (bits))))
+
+void sha1(const unsigned char *data, size_t len, unsigned char digest[20]) {
+	UINT32 h[] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+	// the message, a 1 bit, zeros, & the length in bits, padded to a multiple of 64 bytes
+	size_t nBlocks = (len + 8) / 64 + 1;
+	for (size_t block = 0; block < nBlocks; block++) {
+		unsigned char chunk[64];
+		for (int i = 0; i < 64; i++) {
+			size_t pos = block * 64 + i;
+			if (pos < len) chunk[i] = data[pos];
+			else if (pos == len) chunk[i] = 0x80;
+			else if (block == nBlocks - 1 && i >= 56) chunk[i] = (unsigned char) (((UINT64) len * 8) >> (8 * (63 - i)));
+			else chunk[i] = 0;
+		}
+
+		UINT32 w[80];
+		for (int i = 0; i < 16; i++) {
+			w[i] = ((UINT32) chunk[i * 4] << 24) | ((UINT32) chunk[i * 4 + 1] << 16) | ((UINT32) chunk[i * 4 + 2] << 8) | chunk[i * 4 + 3];
+		}
+		for (int i = 16; i < 80; i++) {
+			w[i] = ROTATE_LEFT(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+		}
+
+		UINT32 a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+		for (int i = 0; i < 80; i++) {
+			UINT32 f, k;
+			if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+			else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+			else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+			else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+
+			UINT32 temp = ROTATE_LEFT(a, 5) + f + e + k + w[i];
+			e = d;
+			d = c;
+			c = ROTATE_LEFT(b, 30);
+			b = a;
+			a = temp;
+		}
+		h[0] += a;
+		h[1] += b;
+		h[2] += c;
+		h[3] += d;
+		h[4] += e;
+	}
+
+	for (int i = 0; i < 20; i++) {
+		digest[i] = (unsigned char) (h[i / 4] >> (8 * (3 - i % 4)));
+	}
+}
+
+/**
+ * @returns the length written, which is not null terminated.
+ */
+int base64(const unsigned char *data, int len, char *out) {
+	const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	int n = 0;
+
+	for (int i = 0; i < len; i += 3) {
+		UINT32 triple = (UINT32) data[i] << 16;
+		if (i + 1 < len) triple |= (UINT32) data[i + 1] << 8;
+		if (i + 2 < len) triple |= data[i + 2];
+
+		out[n++] = ALPHABET[(triple >> 18) & 0x3F];
+		out[n++] = ALPHABET[(triple >> 12) & 0x3F];
+		out[n++] = i + 1 < len ? ALPHABET[(triple >> 6) & 0x3F] : '=';
+		out[n++] = i + 2 < len ? ALPHABET[triple & 0x3F] : '=';
+	}
+	return n;
+}
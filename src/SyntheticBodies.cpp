@@ -0,0 +1,285 @@
+#include "KinectToJSON.h"
+
+// forward declare of non-external functions
+void swingBody(BODY_DATA *body, float phase, float offsetX);
+void circleBody(BODY_DATA *body, float seconds, float offsetX);
+void waveBody(BODY_DATA *body, float seconds, float offsetX);
+void restBody(BODY_DATA *body, float offsetX);
+void swingAbout(BODY_DATA *body, const int *joints, int nJoints, int pivot, float angle);
+void raiseAbout(BODY_DATA *body, const int *joints, int nJoints, int pivot, float angle);
+float syntheticUniform(UINT32 seed, int a, int b, int c);
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// a standing body, arms down, 2.5 meters in front of the sensor, in camera space (meters)
+const CameraSpacePoint REST_POSE[] = {
+	{  0.00f, -0.30f, 2.50f }, // SpineBase
+	{  0.00f,  0.00f, 2.50f }, // SpineMid
+	{  0.00f,  0.30f, 2.50f }, // Neck
+	{  0.00f,  0.45f, 2.48f }, // Head
+
+	{ -0.18f,  0.22f, 2.50f }, // ShoulderLeft
+	{ -0.21f, -0.05f, 2.50f }, // ElbowLeft
+	{ -0.22f, -0.30f, 2.48f }, // WristLeft
+	{ -0.22f, -0.38f, 2.47f }, // HandLeft
+
+	{  0.18f,  0.22f, 2.50f }, // ShoulderRight
+	{  0.21f, -0.05f, 2.50f }, // ElbowRight
+	{  0.22f, -0.30f, 2.48f }, // WristRight
+	{  0.22f, -0.38f, 2.47f }, // HandRight
+
+	{ -0.08f, -0.35f, 2.50f }, // HipLeft
+	{ -0.09f, -0.80f, 2.48f }, // KneeLeft
+	{ -0.09f, -1.20f, 2.52f }, // AnkleLeft
+	{ -0.09f, -1.25f, 2.42f }, // FootLeft
+
+	{  0.08f, -0.35f, 2.50f }, // HipRight
+	{  0.09f, -0.80f, 2.48f }, // KneeRight
+	{  0.09f, -1.20f, 2.52f }, // AnkleRight
+	{  0.09f, -1.25f, 2.42f }, // FootRight
+
+	{  0.00f,  0.22f, 2.50f }, // SpineShoulder
+
+	{ -0.22f, -0.46f, 2.46f }, // HandTipLeft
+	{ -0.19f, -0.40f, 2.45f }, // ThumbLeft
+
+	{  0.22f, -0.46f, 2.46f }, // HandTipRight
+	{  0.19f, -0.40f, 2.45f }  // ThumbRight
+};
+
+// the joints which swing with each arm, about its shoulder, & with each leg, about its hip
+const int LEFT_ARM[] = { JointType_ElbowLeft, JointType_WristLeft, JointType_HandLeft, JointType_HandTipLeft, JointType_ThumbLeft };
+const int RIGHT_ARM[] = { JointType_ElbowRight, JointType_WristRight, JointType_HandRight, JointType_HandTipRight, JointType_ThumbRight };
+const int LEFT_LEG[] = { JointType_KneeLeft, JointType_AnkleLeft, JointType_FootLeft };
+const int RIGHT_LEG[] = { JointType_KneeRight, JointType_AnkleRight, JointType_FootRight };
+const int RIGHT_FOREARM[] = { JointType_WristRight, JointType_HandRight, JointType_HandTipRight, JointType_ThumbRight };
+
+#define SYNTHETIC_BASE_ID 72057594037927936ULL
+#define FRAME_SECONDS (1.0f / 30.0f)
+#define JOINT_DROPOUT_FRAMES 10 // a third of a second, each joint dropped or not at a time
+#define BODY_DROPOUT_FRAMES 30  // a second, each body missing or not at a time; never the first
+#define CIRCLE_METERS 0.5f      // radius walked around where the body would stand
+#define CIRCLE_SECONDS 8.0f     // to walk around once
+#define STRIDE_HZ 0.9f          // of each leg's swing, when walking
+#define WAVE_HZ 1.5f
+
+/**
+ * Fill a frame with bodies swinging their arms, & swaying side to side.  Deterministic for a given frame number, so
+ * the same sequence can be generated for comparing runs.
+ * @param frame - Where to write; bodyCount is set to nBodies, clamped to BODY_COUNT.
+ * @param nBodies - Bodies are spaced 0.8 meters apart along X.
+ * @param frameNumber - Sensor frames since the start, @ 30 fps.
+ */
+void generateSyntheticFrame(FRAME_DATA *frame, int nBodies, int frameNumber) {
+	SYNTHETIC_CONFIG config = { nBodies, SyntheticMotion_Swing, 0, 0, 0, 0 };
+	generateSyntheticBodies(frame, &config, frameNumber);
+}
+
+/**
+ * Fill a frame with bodies moving as configured, each location off by noise, & joints & bodies dropping out.
+ * Deterministic for a given config & frame number, so the same sequence can be generated for comparing runs.
+ * @param frame - Where to write; bodyCount is set to the bodies not dropped out, of nBodies clamped to BODY_COUNT.
+ * @param config - Bodies are spaced 0.8 meters apart along X, & keep their ids when others drop out.
+ * @param frameNumber - Sensor frames since the start, @ 30 fps.
+ */
+void generateSyntheticBodies(FRAME_DATA *frame, const SYNTHETIC_CONFIG *config, int frameNumber) {
+	int nBodies = config->nBodies;
+	if (nBodies > BODY_COUNT) nBodies = BODY_COUNT;
+	if (nBodies < 0) nBodies = 0;
+
+	float seconds = frameNumber * FRAME_SECONDS;
+
+	// sensor 1.2 meters off the floor, tilted down slightly
+	frame->clipPlane.x = 0.0f;
+	frame->clipPlane.y = 0.996f;
+	frame->clipPlane.z = 0.087f;
+	frame->clipPlane.w = 1.2f;
+	frame->cameraHeight = frame->clipPlane.w;
+	frame->frame = frameNumber;
+	frame->bodyCount = 0;
+
+	for (int b = 0; b < nBodies; b++) {
+		int window = frameNumber / BODY_DROPOUT_FRAMES;
+		if (window > 0 && syntheticUniform(config->seed, b, -1, window) < config->bodyDropout) continue;
+
+		BODY_DATA *body = &frame->bodies[frame->bodyCount++];
+		float phase = seconds * 2.0f + b * 0.7f;
+		float offsetX = (b - (nBodies - 1) * 0.5f) * 0.8f;
+
+		body->id = SYNTHETIC_BASE_ID + b;
+
+		switch (config->motion) {
+		case SyntheticMotion_Circle: circleBody(body, seconds + b * 1.3f, offsetX); break;
+		case SyntheticMotion_Wave: waveBody(body, seconds + b * 0.2f, offsetX); break;
+		case SyntheticMotion_Rest: restBody(body, offsetX); break;
+		default: swingBody(body, phase, offsetX); break;
+		}
+
+		// hand tips & thumbs are the least reliably seen
+		body->joints[JointType_HandTipLeft].TrackingState = TrackingState_Inferred;
+		body->joints[JointType_ThumbRight].TrackingState = TrackingState_Inferred;
+
+		body->leftHandState = (HandState) ((frameNumber / 30 + b) % 5);
+		body->rightHandState = (HandState) ((frameNumber / 45 + b) % 5);
+
+		// as the sensor, a joint which cannot be seen is inferred, or not tracked at all, for a while; the SpineBase too
+		if (config->jointDropout > 0) {
+			for (int j = 0; j < JointType_Count; j++) {
+				float dropped = syntheticUniform(config->seed, b, j, frameNumber / JOINT_DROPOUT_FRAMES);
+				if (dropped < config->jointDropout) body->joints[j].TrackingState = TrackingState_NotTracked;
+				else if (dropped < 2 * config->jointDropout) body->joints[j].TrackingState = TrackingState_Inferred;
+			}
+		}
+
+		if (config->noiseMeters > 0) {
+			for (int j = 0; j < JointType_Count; j++) {
+				CameraSpacePoint &position = body->joints[j].Position;
+				position.X += config->noiseMeters * (2 * syntheticUniform(config->seed + frameNumber, b, j, 0) - 1);
+				position.Y += config->noiseMeters * (2 * syntheticUniform(config->seed + frameNumber, b, j, 1) - 1);
+				position.Z += config->noiseMeters * (2 * syntheticUniform(config->seed + frameNumber, b, j, 2) - 1);
+			}
+		}
+	}
+}
+
+/**
+ * Standing, swaying side to side, with the arms swinging forward & back, opposite to each other, about the shoulders.
+ */
+void swingBody(BODY_DATA *body, float phase, float offsetX) {
+	float sway = 0.05f * sin(phase * 0.5f);
+
+	for (unsigned int i = 0; i < JointType_Count; i++) {
+		Joint &joint = body->joints[i];
+		joint.JointType = (JointType) i;
+		joint.TrackingState = TrackingState_Tracked;
+		joint.Position.X = REST_POSE[i].X + offsetX + sway;
+		joint.Position.Y = REST_POSE[i].Y;
+		joint.Position.Z = REST_POSE[i].Z;
+
+		// a small wobble about Y, normalized so it is still a valid rotation
+		float halfAngle = 0.1f * sin(phase + i * 0.3f);
+		JointOrientation &rotation = body->rotations[i];
+		rotation.JointType = (JointType) i;
+		rotation.Orientation.x = 0.0f;
+		rotation.Orientation.y = sin(halfAngle);
+		rotation.Orientation.z = 0.0f;
+		rotation.Orientation.w = cos(halfAngle);
+	}
+
+	float swing = 0.6f * sin(phase);
+	for (unsigned int a = 0; a < _countof(LEFT_ARM); a++) {
+		Joint &left = body->joints[LEFT_ARM[a]];
+		Joint &right = body->joints[RIGHT_ARM[a]];
+		float dropLeft = body->joints[JointType_ShoulderLeft].Position.Y - left.Position.Y;
+		float dropRight = body->joints[JointType_ShoulderRight].Position.Y - right.Position.Y;
+
+		left.Position.Z -= dropLeft * sin(swing);
+		left.Position.Y += dropLeft * (1.0f - cos(swing));
+		right.Position.Z += dropRight * sin(swing);
+		right.Position.Y += dropRight * (1.0f - cos(-swing));
+	}
+}
+
+/**
+ * Walking around a circle, about where the body would stand, facing the way it walks, with the legs striding & the
+ * arms swinging against them.  Every joint turns with the body, about Y.
+ */
+void circleBody(BODY_DATA *body, float seconds, float offsetX) {
+	restBody(body, 0);
+
+	float stride = 0.45f * sinf(2 * 3.14159265f * STRIDE_HZ * seconds);
+	swingAbout(body, LEFT_LEG, _countof(LEFT_LEG), JointType_HipLeft, stride);
+	swingAbout(body, RIGHT_LEG, _countof(RIGHT_LEG), JointType_HipRight, -stride);
+	swingAbout(body, LEFT_ARM, _countof(LEFT_ARM), JointType_ShoulderLeft, -0.6f * stride);
+	swingAbout(body, RIGHT_ARM, _countof(RIGHT_ARM), JointType_ShoulderRight, 0.6f * stride);
+
+	// around the circle anticlockwise from above, so facing along its tangent
+	float around = 2 * 3.14159265f * seconds / CIRCLE_SECONDS;
+	float heading = -around;
+	float cosHeading = cosf(heading), sinHeading = sinf(heading);
+	float centerX = offsetX + CIRCLE_METERS * cosf(around);
+	float centerZ = REST_POSE[JointType_SpineBase].Z + CIRCLE_METERS * sinf(around);
+	Vector4 turn = { 0, sinf(heading / 2), 0, cosf(heading / 2) };
+
+	for (unsigned int i = 0; i < JointType_Count; i++) {
+		CameraSpacePoint &position = body->joints[i].Position;
+		float x = position.X;
+		float z = position.Z - REST_POSE[JointType_SpineBase].Z;
+		position.X = centerX + x * cosHeading + z * sinHeading;
+		position.Z = centerZ - x * sinHeading + z * cosHeading;
+		body->rotations[i].Orientation = turn;
+	}
+}
+
+/**
+ * Standing, with the right upper arm out to the side, & the forearm up, waving side to side about the elbow.
+ */
+void waveBody(BODY_DATA *body, float seconds, float offsetX) {
+	restBody(body, offsetX);
+
+	float wave = 0.4f * sinf(2 * 3.14159265f * WAVE_HZ * seconds);
+	raiseAbout(body, RIGHT_ARM, _countof(RIGHT_ARM), JointType_ShoulderRight, 3.14159265f / 2);
+	raiseAbout(body, RIGHT_FOREARM, _countof(RIGHT_FOREARM), JointType_ElbowRight, 3.14159265f / 2 + wave);
+}
+
+/**
+ * Standing still, arms down, facing the sensor.
+ */
+void restBody(BODY_DATA *body, float offsetX) {
+	for (unsigned int i = 0; i < JointType_Count; i++) {
+		Joint &joint = body->joints[i];
+		joint.JointType = (JointType) i;
+		joint.TrackingState = TrackingState_Tracked;
+		joint.Position = { REST_POSE[i].X + offsetX, REST_POSE[i].Y, REST_POSE[i].Z };
+
+		JointOrientation &rotation = body->rotations[i];
+		rotation.JointType = (JointType) i;
+		rotation.Orientation = { 0, 0, 0, 1 };
+	}
+}
+
+/**
+ * Turn joints about a pivot joint, forward & back; about X, so the distances between them are kept.
+ */
+void swingAbout(BODY_DATA *body, const int *joints, int nJoints, int pivot, float angle) {
+	const CameraSpacePoint &center = body->joints[pivot].Position;
+	float cosAngle = cosf(angle), sinAngle = sinf(angle);
+
+	for (int i = 0; i < nJoints; i++) {
+		CameraSpacePoint &position = body->joints[joints[i]].Position;
+		float y = position.Y - center.Y;
+		float z = position.Z - center.Z;
+		position.Y = center.Y + y * cosAngle - z * sinAngle;
+		position.Z = center.Z + y * sinAngle + z * cosAngle;
+	}
+}
+
+/**
+ * Turn joints about a pivot joint, out to the side & up; about Z, so the distances between them are kept.  Positive
+ * raises joints below the pivot towards +X.
+ */
+void raiseAbout(BODY_DATA *body, const int *joints, int nJoints, int pivot, float angle) {
+	const CameraSpacePoint &center = body->joints[pivot].Position;
+	float cosAngle = cosf(angle), sinAngle = sinf(angle);
+
+	for (int i = 0; i < nJoints; i++) {
+		CameraSpacePoint &position = body->joints[joints[i]].Position;
+		float x = position.X - center.X;
+		float y = position.Y - center.Y;
+		position.X = center.X + x * cosAngle - y * sinAngle;
+		position.Y = center.Y + x * sinAngle + y * cosAngle;
+	}
+}
+
+/**
+ * @returns 0 to 1, the same for the same arguments, for noise & dropouts without any state.
+ */
+float syntheticUniform(UINT32 seed, int a, int b, int c) {
+	UINT32 hash = seed * 2654435761u;
+	hash = (hash ^ (UINT32) a) * 73856093u;
+	hash = (hash ^ (UINT32) b) * 19349663u;
+	hash = (hash ^ (UINT32) c) * 83492791u;
+	hash ^= hash >> 15;
+	hash *= 2246822519u;
+	hash ^= hash >> 13;
+	return (hash >> 8) / 16777216.0f;
+}
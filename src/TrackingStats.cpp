@@ -0,0 +1,228 @@
+#include "KinectToJSON.h"
+
+// forward declare of non-external functions
+int bucketOf(UINT64 ns);
+UINT64 bucketTop(int bucket);
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+// file scope variables; each count has one thread writing, the body thread, or a stage of the pipeline, so the atomics
+// are for readers on other threads
+LatencyHistogram stageTimes[TrackingStage_Count];
+std::atomic<UINT64> framesAcquired(0);
+std::atomic<UINT64> framesWithoutBodies(0);
+std::atomic<UINT64> framesDropped(0);
+std::atomic<UINT64> framesEmitted(0);
+std::atomic<UINT64> bytesEmitted(0);
+std::atomic<UINT64> framesUnchanged(0);
+std::atomic<UINT64> heartbeats(0);
+
+// the period is learnt from the gaps between frames, so a simulation at any rate works too
+INT64 lastRelativeTime = -1;
+INT64 framePeriod = 0;
+
+const char *STAGE_NAMES[] = { "acquire", "refresh", "joints", "serialize", "callback" };
+
+/**
+ * Counts & times of each stage, since tracking last began.  Can be called from any thread, at any time.
+ */
+DllExport HRESULT getTrackingStats(TRACKING_STATS *stats) {
+	if (stats == nullptr) return E_POINTER;
+
+	stats->framesAcquired = framesAcquired;
+	stats->framesWithoutBodies = framesWithoutBodies;
+	stats->framesDropped = framesDropped;
+	stats->framesEmitted = framesEmitted;
+	stats->bytesEmitted = bytesEmitted;
+	stats->framesUnchanged = framesUnchanged;
+	stats->heartbeats = heartbeats;
+
+	for (int i = 0; i < TrackingStage_Count; i++) {
+		stageTimes[i].getStats(&stats->stages[i]);
+	}
+
+	// an unchanged frame is not timed as a stage, so what it saved is estimated as the mean of a frame sent through the
+	// stages it skips most of; the pose checks & hashing before the skip are counted as saved too, but are a small part
+	const STAGE_STATS *stages = stats->stages;
+	float sentUs = stages[TrackingStage_Joints].meanUs + stages[TrackingStage_Serialize].meanUs + stages[TrackingStage_Callback].meanUs;
+	stats->cpuSavedMs = stats->framesUnchanged * sentUs / 1000;
+	return S_OK;
+}
+
+/**
+ * getTrackingStats() as JSON, for when a struct is awkward, e.g. from Python.
+ * @returns the length including the terminating null, or minus the size needed when bufferLen is too small.
+ */
+DllExport int getTrackingStatsJSON(char *buffer, int bufferLen) {
+	TRACKING_STATS stats;
+	getTrackingStats(&stats);
+
+	char json[2048];
+	int len = sprintf_s(json, sizeof(json), "{\"framesAcquired\": %llu, \"framesWithoutBodies\": %llu, \"framesDropped\": %llu, \"framesEmitted\": %llu, \"bytesEmitted\": %llu, \"framesUnchanged\": %llu, \"heartbeats\": %llu, \"cpuSavedMs\": %.1f, \"stages\": {",
+		stats.framesAcquired, stats.framesWithoutBodies, stats.framesDropped, stats.framesEmitted, stats.bytesEmitted, stats.framesUnchanged,
+		stats.heartbeats, stats.cpuSavedMs);
+
+	for (int i = 0; i < TrackingStage_Count; i++) {
+		const STAGE_STATS &stage = stats.stages[i];
+		len += sprintf_s(json + len, sizeof(json) - len, "%s\"%s\": {\"count\": %llu, \"p50Us\": %.1f, \"p99Us\": %.1f, \"maxUs\": %.1f, \"meanUs\": %.1f}",
+			i > 0 ? ", " : "", STAGE_NAMES[i], stage.count, stage.p50Us, stage.p99Us, stage.maxUs, stage.meanUs);
+	}
+	len += sprintf_s(json + len, sizeof(json) - len, "}}");
+
+	if (bufferLen < len + 1) return -(len + 1);
+	memcpy(buffer, json, len + 1);
+	return len + 1;
+}
+
+/**
+ * Zero everything, when tracking begins, before the body thread is started.
+ */
+void resetTrackingStats() {
+	for (int i = 0; i < TrackingStage_Count; i++) {
+		stageTimes[i].reset();
+	}
+	framesAcquired = 0;
+	framesWithoutBodies = 0;
+	framesDropped = 0;
+	framesEmitted = 0;
+	bytesEmitted = 0;
+	framesUnchanged = 0;
+	heartbeats = 0;
+	lastRelativeTime = -1;
+	framePeriod = 0;
+}
+
+UINT64 stageClock() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Record the time of a stage which began at startNs.
+ * @returns now, so it can be the start of the next stage.
+ */
+UINT64 endStage(TrackingStage stage, UINT64 startNs) {
+	UINT64 now = stageClock();
+	stageTimes[stage].record(now - startNs);
+	return now;
+}
+
+/**
+ * Count a frame read from the source, & any frames missing before it, from the gap since the last one.  A frame older
+ * than the last, as after seeking a replay, just starts the count again.
+ */
+void countFrameAcquired(INT64 relativeTime) {
+	framesAcquired++;
+
+	if (lastRelativeTime >= 0 && relativeTime > lastRelativeTime) {
+		INT64 gap = relativeTime - lastRelativeTime;
+		if (framePeriod == 0 || gap * 3 < framePeriod * 2) {
+			// the first gap, or the first had frames missing
+			framePeriod = gap;
+
+		} else if (gap * 2 < framePeriod * 3) {
+			// the next frame; averaged, so the period follows jitter & the clock of the source
+			framePeriod += (gap - framePeriod) / 8;
+
+		} else {
+			framesDropped += (gap + framePeriod / 2) / framePeriod - 1;
+		}
+	}
+	lastRelativeTime = relativeTime;
+}
+
+void countFrameWithoutBodies() {
+	framesWithoutBodies++;
+}
+
+void countFrameEmitted(int bytes) {
+	framesEmitted++;
+	bytesEmitted += bytes;
+}
+
+void countFrameUnchanged() {
+	framesUnchanged++;
+}
+
+void countHeartbeat() {
+	heartbeats++;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+LatencyHistogram::LatencyHistogram() {
+	reset();
+}
+
+void LatencyHistogram::record(UINT64 ns) {
+	buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+	totalNs.fetch_add(ns, std::memory_order_relaxed);
+
+	// several serializing threads of the pipeline can record at once
+	UINT64 max = maxNs.load(std::memory_order_relaxed);
+	while (ns > max && !maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+	}
+}
+
+void LatencyHistogram::reset() {
+	for (int i = 0; i < LATENCY_BUCKETS; i++) {
+		buckets[i] = 0;
+	}
+	totalNs = 0;
+	maxNs = 0;
+}
+
+/**
+ * Percentiles are the top of the bucket they fall in, but never more than the max.  The count is taken from the buckets
+ * as read, so the percentiles agree with it, even while recording.
+ */
+void LatencyHistogram::getStats(STAGE_STATS *stats) {
+	UINT64 counts[LATENCY_BUCKETS];
+	UINT64 count = 0;
+	for (int i = 0; i < LATENCY_BUCKETS; i++) {
+		counts[i] = buckets[i].load(std::memory_order_relaxed);
+		count += counts[i];
+	}
+	UINT64 max = maxNs.load(std::memory_order_relaxed);
+
+	stats->count = count;
+	stats->maxUs = max / 1000.0f;
+	stats->meanUs = count > 0 ? (float) (totalNs.load(std::memory_order_relaxed) / 1000.0 / count) : 0;
+
+	const double PERCENTILES[] = { 0.5, 0.99 };
+	float *results[] = { &stats->p50Us, &stats->p99Us };
+	for (int p = 0; p < 2; p++) {
+		UINT64 target = (UINT64) ceil(PERCENTILES[p] * count);
+		UINT64 seen = 0;
+		int i = 0;
+		while (i < LATENCY_BUCKETS - 1 && seen + counts[i] < target) seen += counts[i++];
+
+		UINT64 top = bucketTop(i);
+		*results[p] = count > 0 ? (top < max ? top : max) / 1000.0f : 0;
+	}
+}
+
+/**
+ * 0 to 3 ns have a bucket each, then each doubling is split in 4 by the 2 bits after its highest.
+ */
+int bucketOf(UINT64 ns) {
+	if (ns < 4) return (int) ns;
+
+	// index of the highest set bit, by halves
+	int highest = 0;
+	UINT64 v = ns;
+	for (int shift = 32; shift > 0; shift >>= 1) {
+		if (v >> shift) {
+			v >>= shift;
+			highest += shift;
+		}
+	}
+
+	int bucket = 4 * (highest - 1) + (int) ((ns >> (highest - 2)) & 3);
+	return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+UINT64 bucketTop(int bucket) {
+	if (bucket < 4) return bucket;
+
+	int highest = bucket / 4 + 1;
+	UINT64 bottom = (UINT64) (4 + bucket % 4) << (highest - 2);
+	return bottom + ((UINT64) 1 << (highest - 2)) - 1;
+}
@@ -0,0 +1,84 @@
+#include "Benchmark.h"
+
+// each benchmark by the name -bench takes, & the frames it runs when not given
+typedef struct {
+	const char *name;
+	int (*run)(int nFrames);
+	int defaultFrames;
+} BENCHMARK;
+
+const BENCHMARK BENCHMARKS[] = {
+	{ "serialize", &benchSerialize, 20000 },
+	{ "binary", &benchBinary, 20000 },
+	{ "queue", &benchQueue, 60 },
+	{ "source", &benchSource, 60 },
+	{ "replay", &benchReplay, 20000 },
+	{ "transform", &benchTransform, 200000 },
+	{ "delta", &benchDelta, 20000 },
+	{ "stream", &benchStream, 60 },
+	{ "stats", &benchStats, 300 },
+	{ "shared", &benchShared, 20000 },
+	{ "multi", &benchMulti, 1000 },
+	{ "pipeline", &benchPipeline, 5000 },
+	{ "resample", &benchResample, 3000 },
+	{ "poses", &benchPoses, 20000 },
+	{ "projection", &benchProjection, 20000 },
+	{ "export", &benchExport, 3000 },
+	{ "retarget", &benchRetarget, 20000 },
+	{ "motion", &benchMotion, 20000 },
+	{ "synthetic", &benchSynthetic, 20000 },
+	{ "latency", &benchLatency, 240 },
+	{ "change", &benchChange, 300 },
+	{ "soak", &benchSoak, 3000 }
+};
+
+const char *SYNTHETIC_MOTIONS[] = { "swing", "circle", "wave", "rest" };
+
+/**
+ * Run the benchmarks from the console exe: KinectToJSON -bench [name|all] [frames].  Every one requested is run, even
+ * after one fails, then a last line sums up the suite, for CI to keep with the rest.
+ * @returns 0 when all requested benchmarks ran & were correct.
+ */
+int runBenchmarks(int argc, char *argv[]) {
+	const char *only = argc > 2 && strcmp(argv[2], "all") != 0 ? argv[2] : nullptr;
+	int nFrames = argc > 3 ? atoi(argv[3]) : 0;
+
+	int nRan = 0;
+	int nFailed = 0;
+	Clock::time_point start = Clock::now();
+	for (unsigned int i = 0; i < _countof(BENCHMARKS); i++) {
+		if (only != nullptr && strcmp(only, BENCHMARKS[i].name) != 0) continue;
+
+		nRan++;
+		if (BENCHMARKS[i].run(nFrames > 0 ? nFrames : BENCHMARKS[i].defaultFrames) != 0) {
+			std::cerr << "Benchmark failed: " << BENCHMARKS[i].name << "\n";
+			nFailed++;
+		}
+		fflush(stdout);
+	}
+
+	if (nRan == 0) {
+		std::cerr << "Unknown benchmark: " << only << "\n";
+		return 1;
+	}
+
+	double seconds = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count() / 1000.0;
+	printf("{\"bench\": \"suite\", \"ran\": %d, \"failed\": %d, \"seconds\": %.1f}\n", nRan, nFailed, seconds);
+	return nFailed > 0 ? 1 : 0;
+}
+
+double cpuSeconds() {
+#ifdef _WIN32
+	FILETIME created, exited, kernel, user;
+	GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user);
+
+	ULARGE_INTEGER k, u;
+	k.LowPart = kernel.dwLowDateTime;
+	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;
+	u.HighPart = user.dwHighDateTime;
+	return (k.QuadPart + u.QuadPart) / 1e7;
+#else
+	return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+// The benchmarks of the console exe, one source of each for the part it measures.  Each prints one line of JSON to
+// stdout, & returns non zero when what it checks is wrong.  None are built into the DLL.
+#include "../KinectToJSON.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <stddef.h>
+#include <stdlib.h>
+
+#define SYNTHETIC_FRAMES 64 // distinct frames cycled through, so the numbers change but generation is not timed
+
+typedef std::chrono::steady_clock Clock;
+
+// entry points of Benchmark.cpp
+int runBenchmarks(int argc, char *argv[]);
+double cpuSeconds();
+extern const char *SYNTHETIC_MOTIONS[];
+
+// entry points of JSONSerializerBench.cpp
+int benchSerialize(int nFrames);
+
+// entry points of BinaryFrameBench.cpp
+int benchBinary(int nFrames);
+
+// entry points of FrameQueueBench.cpp
+int benchQueue(int nFrames);
+
+// entry points of FrameSourceBench.cpp
+int benchSource(int nFrames);
+
+// entry points of ReplayFrameSourceBench.cpp
+int benchReplay(int nFrames);
+
+// entry points of JointTransformBench.cpp
+int benchTransform(int nFrames);
+
+// entry points of DeltaEncoderBench.cpp
+int benchDelta(int nFrames);
+
+// entry points of StreamServerBench.cpp
+int benchStream(int nFrames);
+
+// entry points of TrackingStatsBench.cpp
+int benchStats(int nFrames);
+
+// entry points of SharedFrameBench.cpp
+int benchShared(int nFrames);
+int parseNumbers(const char *json, float *values);
+
+// entry points of MultiFrameSourceBench.cpp
+int benchMulti(int nFrames);
+
+// entry points of PipelineBench.cpp
+int benchPipeline(int nFrames);
+
+// entry points of ResamplerBench.cpp
+int benchResample(int nFrames);
+
+// entry points of PoseMatcherBench.cpp
+int benchPoses(int nFrames);
+
+// entry points of ProjectionBench.cpp
+int benchProjection(int nFrames);
+
+// entry points of ExporterBench.cpp
+int benchExport(int nFrames);
+
+// entry points of RetargetBench.cpp
+int benchRetarget(int nFrames);
+
+// entry points of MotionHistoryBench.cpp
+int benchMotion(int nFrames);
+
+// entry points of SyntheticBodiesBench.cpp
+int benchSynthetic(int nFrames);
+int benchLatency(int nFrames);
+
+// entry points of ChangeDetectorBench.cpp
+int benchChange(int nFrames);
+
+// entry points of FramePoolBench.cpp
+int benchSoak(int nFrames);
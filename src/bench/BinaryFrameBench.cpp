@@ -0,0 +1,59 @@
+#include "Benchmark.h"
+
+/**
+ * ns & bytes per frame of the binary format, float & quantized, after checking each decodes back to the same JSON, half
+ * of them resampled, with their time.
+ */
+int benchBinary(int nFrames) {
+	static FRAME_DATA frames[SYNTHETIC_FRAMES];
+	static FRAME_DATA decoded;
+	static char expected[FRAME_JSON_SZ];
+	static char actual[FRAME_JSON_SZ];
+	static char binary[FRAME_BINARY_SZ];
+
+	bool roundTrips = true;
+	float maxQuantizedError = 0;
+	for (int f = 0; f < SYNTHETIC_FRAMES; f++) {
+		generateSyntheticFrame(&frames[f], BODY_COUNT, f);
+		frames[f].resampled = f % 2 == 1;
+		frames[f].timeUs = frames[f].resampled ? f * 16667LL : 0;
+		int expectedLen = serializeFrameJSON(&frames[f], expected);
+
+		// floats must come back to the identical JSON
+		int len = serializeFrameBinary(&frames[f], binary, false);
+		roundTrips &= SUCCEEDED(decodeFrameBinary(binary, len, &decoded));
+		int actualLen = serializeFrameJSON(&decoded, actual);
+		roundTrips &= expectedLen == actualLen && memcmp(expected, actual, actualLen) == 0;
+
+		// quantized only to within half a step
+		len = serializeFrameBinary(&frames[f], binary, true);
+		roundTrips &= SUCCEEDED(decodeFrameBinary(binary, len, &decoded)) && decoded.bodyCount == frames[f].bodyCount &&
+			decoded.timeUs == frames[f].timeUs;
+		for (int b = 0; b < decoded.bodyCount; b++) {
+			for (unsigned int i = 0; i < JointType_Count; i++) {
+				const CameraSpacePoint &a = frames[f].bodies[b].joints[i].Position;
+				const CameraSpacePoint &d = decoded.bodies[b].joints[i].Position;
+				maxQuantizedError = std::max(maxQuantizedError, std::max(std::abs(a.X - d.X), std::max(std::abs(a.Y - d.Y), std::abs(a.Z - d.Z))));
+			}
+		}
+	}
+	roundTrips &= maxQuantizedError <= 0.5f / BINARY_LOCATION_SCALE;
+
+	long long bytes = 0;
+	Clock::time_point start = Clock::now();
+	for (int f = 0; f < nFrames; f++) {
+		bytes += serializeFrameBinary(&frames[f % SYNTHETIC_FRAMES], binary, false);
+	}
+	double ns = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+	long long quantizedBytes = 0;
+	start = Clock::now();
+	for (int f = 0; f < nFrames; f++) {
+		quantizedBytes += serializeFrameBinary(&frames[f % SYNTHETIC_FRAMES], binary, true);
+	}
+	double quantizedNs = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+	printf("{\"bench\": \"binary\", \"frames\": %d, \"bodies\": %d, \"nsPerFrame\": %.1f, \"bytesPerFrame\": %lld, \"quantizedNsPerFrame\": %.1f, \"quantizedBytesPerFrame\": %lld, \"maxQuantizedError\": %g, \"roundTrips\": %s}\n",
+		nFrames, BODY_COUNT, ns / nFrames, bytes / nFrames, quantizedNs / nFrames, quantizedBytes / nFrames, maxQuantizedError, roundTrips ? "true" : "false");
+	return roundTrips ? 0 : 1;
+}
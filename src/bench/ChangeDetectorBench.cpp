@@ -0,0 +1,212 @@
+#include "Benchmark.h"
+
+// forward declare of non-external functions
+bool runChange(FrameSource *source, const char *spec, char skipUnchanged, int heartbeatMillis, int leadMillis,
+	int nFrames, std::vector<int> *frames, std::vector<UINT64> *hashes, double *cpuPercent, TRACKING_STATS *stats);
+bool sendsEveryChange(const std::vector<int> &allFrames, const std::vector<UINT64> &allHashes, const std::vector<int> &frames,
+	const std::vector<UINT64> &hashes);
+
+#define CHANGE_HZ 300
+
+/**
+ * Synthetic bodies on the clock of a SimulatedFrameSource, which move till a frame, then hold still at it, with time
+ * going on.  A body predicted from its motion is sent as though still moving for a few frames after it stops.
+ */
+class HaltingFrameSource : public FrameSource {
+public:
+	HaltingFrameSource(const SYNTHETIC_CONFIG *config, int haltFrame) : source(config, CHANGE_HZ), haltFrame(haltFrame) {
+	}
+
+	HRESULT start() {
+		nFrames = 0;
+		return source.start();
+	}
+
+	void stop() {
+		source.stop();
+	}
+
+	HRESULT waitForFrame(FRAME_DATA *frame) {
+		HRESULT hr = source.waitForFrame(frame);
+		if (hr == S_OK) halt(frame);
+		return hr;
+	}
+
+	HRESULT acquireLatestFrame(FRAME_DATA *frame) {
+		HRESULT hr = source.acquireLatestFrame(frame);
+		if (hr == S_OK) halt(frame);
+		return hr;
+	}
+
+	void wake() {
+		source.wake();
+	}
+
+private:
+	SimulatedFrameSource source;
+	int haltFrame;
+	int nFrames = 0;
+	FRAME_DATA halted;
+
+	// keep the bodies of the frame halted at, & send them from then on
+	void halt(FRAME_DATA *frame) {
+		if (nFrames == haltFrame) memcpy(&halted, frame, sizeof(FRAME_DATA));
+		if (nFrames >= haltFrame) memcpy(frame->bodies, halted.bodies, halted.bodyCount * sizeof(BODY_DATA));
+		nFrames++;
+	}
+};
+
+/**
+ * setChangeDetection(), with 6 synthetic bodies at 300 Hz.  With it, frames sent must be those without it, less those
+ * the same as the one before, but for the frame #: all of them when swinging, those where hands change when at rest, &
+ * only the first when waving but sending only the head, & with a lead, those where bodies which have stopped are still
+ * predicted to move.  Heartbeats of still bodies must be evenly spaced, & no further apart than asked for.
+ * Then the CPU of tracking still bodies, with & without, & ns to hash a frame.
+ */
+int benchChange(int nFrames) {
+	const SYNTHETIC_CONFIG SWING = { BODY_COUNT, SyntheticMotion_Swing, 0, 0, 0, 0 };
+	const SYNTHETIC_CONFIG REST = { BODY_COUNT, SyntheticMotion_Rest, 0, 0, 0, 0 };
+	const SYNTHETIC_CONFIG WAVE = { BODY_COUNT, SyntheticMotion_Wave, 0, 0, 0, 0 };
+	const SYNTHETIC_CONFIG *CONFIGS[] = { &SWING, &REST, &WAVE };
+	const char *SPECS[] = { nullptr, nullptr, "joints: Head; fields: location" };
+	const char *NAMES[] = { "swing", "rest", "wave head" };
+
+	bool correct = setChangeDetection('\1', CHANGE_MAX_HEARTBEAT_MILLIS + 1) == E_INVALIDARG;
+	for (unsigned int c = 0; c < _countof(CONFIGS); c++) {
+		std::vector<int> allFrames, frames;
+		std::vector<UINT64> allHashes, hashes;
+		double allCpu, cpu;
+		TRACKING_STATS allStats, stats;
+		SimulatedFrameSource source(CONFIGS[c], CHANGE_HZ);
+		bool ran = runChange(&source, SPECS[c], '\0', 0, 0, nFrames, &allFrames, &allHashes, &allCpu, &allStats) &&
+			runChange(&source, SPECS[c], '\1', 0, 0, nFrames, &frames, &hashes, &cpu, &stats);
+
+		bool same = ran && sendsEveryChange(allFrames, allHashes, frames, hashes) && allStats.framesUnchanged == 0;
+		if (c == 0) same &= frames.size() == allFrames.size();
+		if (c == 1) same &= frames.size() * 10 < allFrames.size() && stats.framesUnchanged > 0 && stats.cpuSavedMs > 0;
+		if (c == 2) same &= frames.size() == 1;
+		correct &= same;
+
+		printf("{\"bench\": \"change\", \"bodies\": \"%s\", \"hz\": %d, \"frames\": %d, \"sentWithout\": %d, \"sentWith\": %d, \"unchanged\": %llu, \"cpuPercentWithout\": %.1f, \"cpuPercentWith\": %.1f, \"cpuSavedMs\": %.1f, \"correct\": %s}\n",
+			NAMES[c], CHANGE_HZ, nFrames, (int) allFrames.size(), (int) frames.size(), stats.framesUnchanged, allCpu, cpu, stats.cpuSavedMs,
+			same ? "true" : "false");
+	}
+
+	// swinging then still, predicted: the joints sent move on after the body stops, till its motion settles
+	const int LEAD_MILLIS = 100;
+	HaltingFrameSource halting(&SWING, nFrames / 2);
+	std::vector<int> ledAllFrames, ledFrames;
+	std::vector<UINT64> ledAllHashes, ledHashes;
+	double ledAllCpu, ledCpu;
+	TRACKING_STATS ledAllStats, ledStats;
+	bool led = runChange(&halting, nullptr, '\0', 0, LEAD_MILLIS, nFrames, &ledAllFrames, &ledAllHashes, &ledAllCpu, &ledAllStats) &&
+		runChange(&halting, nullptr, '\1', 0, LEAD_MILLIS, nFrames, &ledFrames, &ledHashes, &ledCpu, &ledStats) &&
+		sendsEveryChange(ledAllFrames, ledAllHashes, ledFrames, ledHashes) && ledStats.framesUnchanged > 0 &&
+		ledFrames.size() > (size_t) nFrames / 2 + 1;
+	correct &= led;
+
+	printf("{\"bench\": \"change\", \"bodies\": \"swing, then still\", \"leadMillis\": %d, \"hz\": %d, \"frames\": %d, \"sentWithout\": %d, \"sentWith\": %d, \"unchanged\": %llu, \"correct\": %s}\n",
+		LEAD_MILLIS, CHANGE_HZ, nFrames, (int) ledAllFrames.size(), (int) ledFrames.size(), ledStats.framesUnchanged, led ? "true" : "false");
+
+	// still bodies, less their hands, so only heartbeats follow the first frame
+	const int HEARTBEAT_MILLIS = 25; // between frames, so each is the same number of frames apart
+	std::vector<int> frames;
+	std::vector<UINT64> hashes;
+	double cpu;
+	TRACKING_STATS stats;
+	SimulatedFrameSource rest(&REST, CHANGE_HZ);
+	bool beats = runChange(&rest, "fields: state location rotation", '\1', HEARTBEAT_MILLIS, 0, nFrames, &frames, &hashes, &cpu, &stats) &&
+		frames.size() > 2;
+	int gap = beats ? frames[1] - frames[0] : 0;
+	for (size_t i = 1; i < frames.size() && beats; i++) {
+		beats = frames[i] - frames[i - 1] == gap && hashes[i] == hashes[0];
+	}
+	double period = 1000.0 / CHANGE_HZ;
+	beats &= gap * period >= HEARTBEAT_MILLIS && (gap - 1) * period < HEARTBEAT_MILLIS && stats.heartbeats + 1 >= frames.size();
+	correct &= beats;
+
+	// hashing alone, of every field of 6 bodies
+	static FRAME_DATA synthetic[SYNTHETIC_FRAMES];
+	for (int f = 0; f < SYNTHETIC_FRAMES; f++) generateSyntheticFrame(&synthetic[f], BODY_COUNT, f);
+	static ChangeDetector detector;
+	const CHANGE_CONFIG SKIP = { true, 0 };
+	detector.configure(&SKIP, getFullProjection(), false);
+	detector.reset();
+	int nChanged = 0;
+	Clock::time_point start = Clock::now();
+	for (int f = 0; f < nFrames * 100; f++) {
+		if (detector.check(&synthetic[f % SYNTHETIC_FRAMES]) == ChangeResult_Changed) nChanged++;
+	}
+	double ns = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+	correct &= nChanged == nFrames * 100;
+
+	printf("{\"bench\": \"change\", \"heartbeatMillis\": %d, \"sent\": %d, \"heartbeats\": %llu, \"framesApart\": %d, \"nsPerCheck\": %.1f, \"beats\": %s, \"correct\": %s}\n",
+		HEARTBEAT_MILLIS, (int) frames.size(), stats.heartbeats, gap, ns / (nFrames * 100), beats ? "true" : "false", correct ? "true" : "false");
+	return correct ? 0 : 1;
+}
+
+/**
+ * Track bodies from a source with change detection & a lead as given, collecting the frame # & hash of the rest of the JSON of each
+ * frame sent, of the first nFrames of the source.
+ * @returns false when tracking could not begin.
+ */
+bool runChange(FrameSource *source, const char *spec, char skipUnchanged, int heartbeatMillis, int leadMillis,
+	int nFrames, std::vector<int> *frames, std::vector<UINT64> *hashes, double *cpuPercent, TRACKING_STATS *stats) {
+	extern FrameSource *frameSource;
+	static char json[FRAME_JSON_SZ];
+	frameSource = source;
+	setProjection(spec);
+	setChangeDetection(skipUnchanged, heartbeatMillis);
+	setMotionPrediction(leadMillis, 'N', 0, 0);
+
+	double cpuStart = cpuSeconds();
+	Clock::time_point start = Clock::now();
+	bool began = SUCCEEDED(beginBodyTrackingPolled('J', 'B'));
+
+	// once frames past the end are read, every frame before has left the pipeline, so is waiting or was skipped
+	for (bool done = !began; !done; ) {
+		getTrackingStats(stats);
+		done = stats->framesAcquired >= (UINT64) nFrames + PIPELINE_SLOTS + 1;
+
+		int len;
+		while ((len = done ? pollFrame(json, sizeof(json)) : waitFrame(json, sizeof(json), 10)) > 0) {
+			const char *number = strstr(json, "\"frame\": ");
+			int f = number != nullptr ? atoi(number + 9) : -1;
+			if (f < 0 || f >= nFrames) continue;
+
+			// FNV-1a, skipping the frame #
+			UINT64 hash = 14695981039346656037ULL;
+			for (const char *p = json; *p != '\0'; p++) {
+				if (p == number + 9) while (*p >= '0' && *p <= '9') p++;
+				hash = (hash ^ (unsigned char) *p) * 1099511628211ULL;
+			}
+			frames->push_back(f);
+			hashes->push_back(hash);
+		}
+	}
+	double seconds = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count() / 1e6;
+	*cpuPercent = (cpuSeconds() - cpuStart) * 100 / seconds;
+	endBodyTracking();
+	getTrackingStats(stats);
+	frameSource = nullptr;
+	setProjection(nullptr);
+	setChangeDetection('\0', 0);
+	setMotionPrediction(0, 'N', 0, 0);
+	return began;
+}
+
+/**
+ * Whether frames sent with change detection are those of all frames sent without, less those the same as the one
+ * before; each must be the same as without, & every frame which differs from the one before must be there.
+ */
+bool sendsEveryChange(const std::vector<int> &allFrames, const std::vector<UINT64> &allHashes, const std::vector<int> &frames,
+	const std::vector<UINT64> &hashes) {
+	size_t sent = 0;
+	for (size_t i = 0; i < allFrames.size(); i++) {
+		bool isSent = sent < frames.size() && frames[sent] == allFrames[i];
+		if (isSent && hashes[sent] != allHashes[i]) return false;
+		if (!isSent && (i == 0 || allHashes[i] != allHashes[i - 1])) return false;
+		if (isSent) sent++;
+	}
+	return sent == frames.size();
+}
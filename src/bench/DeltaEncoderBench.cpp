@@ -0,0 +1,123 @@
+#include "Benchmark.h"
+
+// forward declare of non-external functions
+bool runDelta(int nFrames, const DELTA_CONFIG *config, bool print);
+
+/**
+ * Bytes & ns per frame of delta mode vs full frames, exact & with epsilons, while bodies leave & come back.  Every
+ * delta frame is rebuilt, which must match the full frame exactly with no epsilons, & within them otherwise.  Then
+ * reconstructFrame() must tell a frame which is not of delta mode from one with no bodies left.
+ */
+int benchDelta(int nFrames) {
+	const DELTA_CONFIG CONFIGS[] = {
+		{ 30, 0.0f, 0.0f },
+		{ 30, 0.005f, 0.01f },
+		{ 30, 0.02f, 0.05f }
+	};
+
+	bool identical = true;
+	for (unsigned int i = 0; i < _countof(CONFIGS); i++) {
+		identical &= runDelta(nFrames, &CONFIGS[i], true);
+	}
+
+	static FRAME_DATA frame;
+	static DELTA_FRAME delta;
+	static char sent[FRAME_JSON_SZ];
+	static char rebuilt[FRAME_JSON_SZ];
+	DeltaEncoder encoder;
+	encoder.configure(&CONFIGS[0]);
+	encoder.reset();
+	generateSyntheticFrame(&frame, BODY_COUNT, 0);
+	encoder.encode(&frame, &delta);
+	serializeDeltaJSON(&frame, &delta, sent);
+	int withBodies = reconstructFrame(sent, rebuilt, sizeof(rebuilt));
+	int malformed = reconstructFrame("{\"frame\": [", rebuilt, sizeof(rebuilt));
+
+	frame.bodyCount = 0;
+	encoder.encode(&frame, &delta);
+	serializeDeltaJSON(&frame, &delta, sent);
+	int allLeft = reconstructFrame(sent, rebuilt, sizeof(rebuilt));
+	bool returns = withBodies > 0 && malformed == -1 && allLeft == 0;
+	identical &= returns;
+
+	printf("{\"bench\": \"delta\", \"withBodies\": %d, \"malformed\": %d, \"allLeft\": %d, \"correct\": %s}\n", withBodies, malformed,
+		allLeft, returns ? "true" : "false");
+	return identical ? 0 : 1;
+}
+
+bool runDelta(int nFrames, const DELTA_CONFIG *config, bool print) {
+	static FRAME_DATA frame;
+	static FRAME_DATA rebuilt;
+	static DELTA_FRAME delta;
+	static char full[FRAME_JSON_SZ];
+	static char sent[FRAME_JSON_SZ];
+	static char rebuiltJSON[FRAME_JSON_SZ];
+
+	DeltaEncoder encoder;
+	DeltaDecoder decoder;
+	encoder.configure(config);
+	encoder.reset();
+	decoder.reset();
+
+	long long fullBytes = 0, deltaBytes = 0;
+	int nKeyframes = 0, nEntered = 0, nLeft = 0;
+	double fullNs = 0, deltaNs = 0, rebuildNs = 0;
+	float maxError = 0;
+	bool identical = true;
+
+	for (int f = 0; f < nFrames && identical; f++) {
+		// 2 bodies step out of view for 5 seconds in every 10
+		generateSyntheticFrame(&frame, f % 300 < 150 ? BODY_COUNT : BODY_COUNT - 2, f);
+
+		Clock::time_point start = Clock::now();
+		fullBytes += serializeFrameJSON(&frame, full);
+		Clock::time_point fullEnd = Clock::now();
+		if (!encoder.encode(&frame, &delta)) continue;
+		deltaBytes += serializeDeltaJSON(&frame, &delta, sent);
+		Clock::time_point deltaEnd = Clock::now();
+		identical = decoder.apply(sent, &rebuilt) == S_OK;
+		Clock::time_point rebuildEnd = Clock::now();
+
+		fullNs += (double) std::chrono::duration_cast<std::chrono::nanoseconds>(fullEnd - start).count();
+		deltaNs += (double) std::chrono::duration_cast<std::chrono::nanoseconds>(deltaEnd - fullEnd).count();
+		rebuildNs += (double) std::chrono::duration_cast<std::chrono::nanoseconds>(rebuildEnd - deltaEnd).count();
+		nKeyframes += delta.keyframe ? 1 : 0;
+		nEntered += delta.nEntered;
+		nLeft += delta.nLeft;
+
+		identical &= rebuilt.bodyCount == frame.bodyCount;
+		for (int b = 0; b < frame.bodyCount && identical; b++) {
+			const BODY_DATA &expected = frame.bodies[b];
+			const BODY_DATA &actual = rebuilt.bodies[b];
+			identical = expected.id == actual.id && expected.leftHandState == actual.leftHandState && expected.rightHandState == actual.rightHandState;
+
+			for (int j = 0; j < JointType_Count && identical; j++) {
+				const CameraSpacePoint &a = expected.joints[j].Position;
+				const CameraSpacePoint &r = actual.joints[j].Position;
+				const Vector4 &qa = expected.rotations[j].Orientation;
+				const Vector4 &qr = actual.rotations[j].Orientation;
+
+				identical = expected.joints[j].TrackingState == actual.joints[j].TrackingState;
+				float location = std::max(std::max(std::abs(a.X - r.X), std::abs(a.Y - r.Y)), std::abs(a.Z - r.Z));
+				float rotation = std::max(std::max(std::abs(qa.x - qr.x), std::abs(qa.y - qr.y)), std::max(std::abs(qa.z - qr.z), std::abs(qa.w - qr.w)));
+
+				// the JSON itself is only to 3 places
+				identical &= location <= config->locationEpsilon + 0.0005f + 1e-6f && rotation <= config->rotationEpsilon + 0.0005f + 1e-6f;
+				maxError = std::max(maxError, std::max(location, rotation));
+			}
+		}
+
+		// with no epsilons, nothing is lost, so rebuilding must give back exactly what a full frame would have been
+		if (config->locationEpsilon == 0 && config->rotationEpsilon == 0) {
+			rebuilt.cameraHeight = frame.cameraHeight;
+			identical &= serializeFrameJSON(&rebuilt, rebuiltJSON) == (int) strlen(full) && strcmp(rebuiltJSON, full) == 0;
+		}
+	}
+
+	if (print) {
+		printf("{\"bench\": \"delta\", \"frames\": %d, \"keyframeInterval\": %d, \"locationEpsilon\": %g, \"rotationEpsilon\": %g, \"fullBytesPerFrame\": %lld, \"deltaBytesPerFrame\": %lld, \"ratio\": %.3f, \"fullNsPerFrame\": %.1f, \"deltaNsPerFrame\": %.1f, \"rebuildNsPerFrame\": %.1f, \"keyframes\": %d, \"entered\": %d, \"left\": %d, \"maxError\": %g, \"identical\": %s}\n",
+			nFrames, config->keyframeInterval, config->locationEpsilon, config->rotationEpsilon, fullBytes / nFrames, deltaBytes / nFrames, (double) deltaBytes / fullBytes,
+			fullNs / nFrames, deltaNs / nFrames, rebuildNs / nFrames, nKeyframes, nEntered, nLeft, maxError, identical ? "true" : "false");
+	}
+	return identical;
+}
@@ -0,0 +1,162 @@
+#include "Benchmark.h"
+
+// forward declare of non-external functions
+bool checkExportedClip(UINT64 id, int firstFrame, int clipFrames);
+
+/**
+ * Export a capture of synthetic bodies, the last leaving a third of the way through & coming back, to BVH & glTF clips
+ * with 1 worker, then one a core.  Each clip must be cut where expected, & the rotations solved must aim every bone
+ * back along where it was captured, & survive the Euler angles of BVH.
+ */
+int benchExport(int nFrames) {
+	static FRAME_DATA frame;
+	static char json[FRAME_JSON_SZ];
+	const char *path = "bench_capture.json";
+	const int N_BODIES = 3;
+	int chunkFrames = std::max(nFrames / 5, 1);
+	int leftAt = nFrames / 3;
+	int backAt = 2 * nFrames / 3;
+
+	// as the console exe prints it, with one frame not understood
+	FILE *capture = nullptr;
+	if (fopen_s(&capture, path, "wb") != 0) return 1;
+	fprintf(capture, "Sensor opened with these settings- Mirror: 'False', T Pose Start: 'False', World space: 'True'\n");
+	UINT64 bodyFrames = 0;
+	for (int f = 0; f < nFrames; f++) {
+		int nBodies = f >= leftAt && f < backAt ? N_BODIES - 1 : N_BODIES;
+		generateSyntheticFrame(&frame, nBodies, f);
+		fwrite(json, 1, serializeFrameJSON(&frame, json), capture);
+		if (f == leftAt) fprintf(capture, "{\"bodies\": [{\"id\": }]}\n");
+		bodyFrames += nBodies;
+	}
+	long long bytes = ftell(capture);
+	fclose(capture);
+
+	// first frames of each take, of each body
+	UINT64 ids[N_BODIES];
+	generateSyntheticFrame(&frame, N_BODIES, 0);
+	for (int b = 0; b < N_BODIES; b++) ids[b] = frame.bodies[b].id;
+	std::vector<std::pair<int, int>> takes;
+	for (int b = 0; b < N_BODIES; b++) {
+		takes.push_back(std::make_pair(0, b < N_BODIES - 1 ? nFrames : leftAt));
+		if (b == N_BODIES - 1) takes.push_back(std::make_pair(backAt, nFrames));
+	}
+
+	bool correct = true;
+	for (int pass = 0; pass < 2; pass++) {
+		SessionExporter exporter;
+		EXPORT_STATS stats;
+		int nWorkers = pass == 0 ? 1 : 0;
+		correct &= SUCCEEDED(exporter.run(path, ".", nWorkers, chunkFrames, &stats));
+		correct &= stats.frames == (UINT64) nFrames && stats.skipped == 1 && stats.failed == 0 && stats.bodyFrames == bodyFrames;
+
+		// each clip's files, with as many frames as expected, removed once checked
+		UINT64 nClips = 0;
+		for (unsigned int t = 0; t < takes.size(); t++) {
+			UINT64 id = ids[std::min((int) t, N_BODIES - 1)];
+			for (int first = takes[t].first; first < takes[t].second; first += chunkFrames) {
+				int clipFrames = std::min(chunkFrames, takes[t].second - first);
+				correct &= checkExportedClip(id, first, clipFrames);
+				nClips++;
+			}
+		}
+		correct &= stats.clips == nClips;
+
+		printf("{\"bench\": \"export\", \"frames\": %d, \"bodies\": %d, \"workers\": %d, \"clips\": %llu, \"mbPerSecond\": %.1f, \"framesPerSecond\": %.0f, \"correct\": %s}\n",
+			nFrames, N_BODIES, nWorkers > 0 ? nWorkers : (int) std::thread::hardware_concurrency(), stats.clips, bytes / 1e6 / stats.seconds,
+			nFrames / stats.seconds, correct ? "true" : "false");
+	}
+	remove(path);
+
+	// a clip of each body, solved & put back together by walking down from the root
+	float worstDegrees = 0;
+	float worstEulerError = 0;
+	for (int b = 0; b < N_BODIES; b++) {
+		EXPORT_CLIP clip;
+		clip.id = ids[b];
+		clip.firstFrame = 0;
+		for (int f = 0; f < 300; f++) {
+			generateSyntheticFrame(&frame, N_BODIES, f);
+			clip.timesUs.push_back(f * (INT64) EXPORT_FRAME_US);
+			for (unsigned int j = 0; j < JointType_Count; j++) {
+				clip.positions.push_back(frame.bodies[b].joints[j].Position);
+				clip.states.push_back((BYTE) frame.bodies[b].joints[j].TrackingState);
+			}
+		}
+
+		EXPORT_SKELETON skeleton;
+		buildExportSkeleton(&clip, &skeleton);
+		for (int f = 0; f < 300; f++) {
+			const CameraSpacePoint *positions = &clip.positions[f * JointType_Count];
+			Vector4 local[JointType_Count];
+			Vector4 world[JointType_Count];
+			solveLocalRotations(positions, &skeleton, local);
+
+			for (unsigned int i = 0; i < JointType_Count; i++) {
+				JointType j = skeleton.order[i];
+				world[j] = j == JointType_SpineBase ? local[j] : multiplyQuaternions(world[JOINT_PARENTS[j]], local[j]);
+
+				// the bone each joint with children aims
+				if (skeleton.nChildren[j] > 0) {
+					JointType child = skeleton.children[j][0];
+					CameraSpacePoint solved = skeleton.offsets[child];
+					rotatePoint(world[j], &solved);
+					CameraSpacePoint captured = { positions[child].X - positions[j].X, positions[child].Y - positions[j].Y, positions[child].Z - positions[j].Z };
+					float cosine = (solved.X * captured.X + solved.Y * captured.Y + solved.Z * captured.Z) /
+						sqrtf((solved.X * solved.X + solved.Y * solved.Y + solved.Z * solved.Z) * (captured.X * captured.X + captured.Y * captured.Y + captured.Z * captured.Z));
+					worstDegrees = std::max(worstDegrees, acosf(std::min(cosine, 1.0f)) * 180.0f / 3.14159265f);
+				}
+
+				// Z, X, Y angles back to the same rotation
+				float degrees[3];
+				quaternionToEulerZXY(local[j], degrees);
+				const float HALF_RADIANS = 3.14159265f / 360;
+				Vector4 z = { 0, 0, sinf(degrees[0] * HALF_RADIANS), cosf(degrees[0] * HALF_RADIANS) };
+				Vector4 x = { sinf(degrees[1] * HALF_RADIANS), 0, 0, cosf(degrees[1] * HALF_RADIANS) };
+				Vector4 y = { 0, sinf(degrees[2] * HALF_RADIANS), 0, cosf(degrees[2] * HALF_RADIANS) };
+				Vector4 q = multiplyQuaternions(multiplyQuaternions(z, x), y);
+				float dot = q.x * local[j].x + q.y * local[j].y + q.z * local[j].z + q.w * local[j].w;
+				worstEulerError = std::max(worstEulerError, 1 - std::abs(dot));
+			}
+		}
+	}
+	correct &= worstDegrees < 0.1f && worstEulerError < 1e-5f;
+
+	printf("{\"bench\": \"export\", \"solve\": true, \"worstAimDegrees\": %.4f, \"worstEulerError\": %.7f, \"correct\": %s}\n",
+		worstDegrees, worstEulerError, correct ? "true" : "false");
+	return correct ? 0 : 1;
+}
+
+/**
+ * The BVH of a clip must say it has clipFrames frames, & the .bin of its glTF hold all of them.  Its files are removed.
+ */
+bool checkExportedClip(UINT64 id, int firstFrame, int clipFrames) {
+	char name[64];
+	sprintf_s(name, sizeof(name), "%llu_%d", id, firstFrame);
+	std::string path = std::string("./") + name;
+
+	bool correct = false;
+	FILE *file = nullptr;
+	if (fopen_s(&file, (path + ".bvh").c_str(), "rb") == 0) {
+		std::vector<char> text(1 << 16);
+		size_t len = fread(text.data(), 1, text.size() - 1, file);
+		text[len] = '\0';
+		char frames[32];
+		sprintf_s(frames, sizeof(frames), "Frames: %d\n", clipFrames);
+		correct = strstr(text.data(), frames) != nullptr;
+		fclose(file);
+	}
+
+	if (fopen_s(&file, (path + ".bin").c_str(), "rb") == 0) {
+		fseek(file, 0, SEEK_END);
+		correct &= ftell(file) == (long) (clipFrames * (1 + 3 + 4 * JointType_Count) * sizeof(float));
+		fclose(file);
+	} else {
+		correct = false;
+	}
+
+	correct &= remove((path + ".gltf").c_str()) == 0;
+	remove((path + ".bvh").c_str());
+	remove((path + ".bin").c_str());
+	return correct;
+}
@@ -0,0 +1,173 @@
+#include "Benchmark.h"
+
+#ifdef _WIN32
+#include <psapi.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+// forward declare of non-external functions
+void soakFrame(char *buffer, int len);
+bool releaseSoakFrames(int keep);
+UINT64 hashBytes(const char *bytes, int len);
+void memoryUse(long long *residentBytes, long long *peakResidentBytes, long long *heapBytes);
+
+#define SOAK_HZ 600
+#define SOAK_HELD 8 // frames the consumer reads behind the newest
+#define SOAK_DROPS 20 // frames dropped on purpose, by holding every buffer
+
+// frames of beginBodyTrackingLeased() not yet released, oldest first, & their hash when passed
+struct {
+	std::mutex mu;
+	char *buffers[FRAME_POOL_BUFFERS];
+	int lens[FRAME_POOL_BUFFERS];
+	UINT64 hashes[FRAME_POOL_BUFFERS];
+	int first, count;
+	UINT64 corrupted, overHeld;
+	char *seen[FRAME_POOL_BUFFERS * 2]; // each buffer address passed, to show they are reused
+	int nSeen;
+} soak;
+
+/**
+ * Hold leased frames, releasing each only once SOAK_HELD newer ones have arrived, & check none changed while held.
+ * Part way, hold every buffer till frames drop, to show they are counted & the pool recovers.  The heap is measured
+ * after warm-up & again at the end, to show nothing is allocated per frame; run with a large nFrames to soak for hours.
+ */
+int benchSoak(int nFrames) {
+	extern FrameSource *frameSource;
+	const SYNTHETIC_CONFIG SOAK = { BODY_COUNT, SyntheticMotion_Wave, 0.003f, 0.05f, 0.05f, 1 };
+	SimulatedFrameSource source(&SOAK, SOAK_HZ);
+	frameSource = &source;
+	soak.first = soak.count = soak.nSeen = 0;
+	soak.corrupted = soak.overHeld = 0;
+
+	long long residentStart, peakStart, heapStart, residentWarm, peakWarm, heapWarm;
+	memoryUse(&residentStart, &peakStart, &heapStart);
+
+	Clock::time_point start = Clock::now();
+	bool correct = SUCCEEDED(beginBodyTrackingLeased(&soakFrame, 'J'));
+	int warmUp = nFrames / 4, holdAt = nFrames / 2;
+	bool warm = false, holding = false, held = false;
+	TRACKING_STATS stats;
+	FRAME_POOL_STATS pool;
+
+	for (bool done = !correct; !done; ) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		getTrackingStats(&stats);
+		getFramePoolStats(&pool);
+		done = stats.framesAcquired >= (UINT64) nFrames;
+
+		if (!warm && stats.framesAcquired >= (UINT64) warmUp) {
+			warm = true;
+			memoryUse(&residentWarm, &peakWarm, &heapWarm);
+		}
+		if (!held && stats.framesAcquired >= (UINT64) holdAt) holding = held = true;
+		if (holding && pool.framesDropped >= SOAK_DROPS) holding = false;
+		correct &= releaseSoakFrames(holding ? FRAME_POOL_BUFFERS : SOAK_HELD);
+	}
+	double seconds = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count() / 1000.0;
+
+	// measured while still tracking, as the heap counts some of what ending it frees as in use
+	if (!warm) memoryUse(&residentWarm, &peakWarm, &heapWarm);
+	long long residentEnd, peakEnd, heapEnd;
+	memoryUse(&residentEnd, &peakEnd, &heapEnd);
+	endBodyTracking();
+	frameSource = nullptr;
+
+	// a frame held after tracking ends can still be read & released
+	correct &= releaseSoakFrames(0);
+	getFramePoolStats(&pool);
+
+	// not leased, not the start of a buffer, & already released
+	char outside[4];
+	char *buffer = soak.nSeen > 0 ? soak.seen[0] : outside;
+	int rejected = (releaseFrame(outside) == E_INVALIDARG) + (releaseFrame(buffer + 1) == E_INVALIDARG) + (releaseFrame(buffer) == E_INVALIDARG);
+	getFramePoolStats(&pool);
+
+	correct &= soak.corrupted == 0 && soak.overHeld == 0 && rejected == 3 && pool.badReleases == 3;
+	correct &= pool.inUse == 0 && pool.framesLeased == pool.framesReleased && pool.framesDropped >= SOAK_DROPS;
+	correct &= pool.arenaAllocations == 1 && pool.peakInUse == (UINT32) FRAME_POOL_BUFFERS && soak.nSeen <= FRAME_POOL_BUFFERS;
+
+	// where the heap can be measured, not a byte more is in use than after warm-up, however long the run
+	bool steady = heapEnd < 0 || heapEnd - heapWarm <= 0;
+	correct &= steady;
+
+	printf("{\"bench\": \"soak\", \"frames\": %llu, \"seconds\": %.1f, \"leased\": %llu, \"released\": %llu, \"dropped\": %llu, \"peakInUse\": %u, \"buffersSeen\": %d, \"arenaAllocations\": %llu, "
+		"\"residentKB\": [%lld, %lld, %lld], \"peakResidentKB\": %lld, \"heapGrowthBytes\": %lld, \"steady\": %s, \"correct\": %s}\n",
+		stats.framesAcquired, seconds, pool.framesLeased, pool.framesReleased, pool.framesDropped, pool.peakInUse, soak.nSeen,
+		pool.arenaAllocations, residentStart / 1024, residentWarm / 1024, residentEnd / 1024, peakEnd / 1024,
+		heapEnd < 0 ? -1 : heapEnd - heapWarm, steady ? "true" : "false", correct ? "true" : "false");
+	return correct ? 0 : 1;
+}
+
+/**
+ * The leased callback, keeping the frame for releaseSoakFrames().  Never allocates, as the pool holds at most
+ * FRAME_POOL_BUFFERS at once.
+ */
+void soakFrame(char *buffer, int len) {
+	UINT64 hash = hashBytes(buffer, len);
+
+	std::lock_guard<std::mutex> lock(soak.mu);
+	if (soak.count == FRAME_POOL_BUFFERS) {
+		soak.overHeld++;
+		return;
+	}
+	int at = (soak.first + soak.count++) % FRAME_POOL_BUFFERS;
+	soak.buffers[at] = buffer;
+	soak.lens[at] = len;
+	soak.hashes[at] = hash;
+
+	bool seen = false;
+	for (int i = 0; i < soak.nSeen && !seen; i++) seen = soak.seen[i] == buffer;
+	if (!seen && soak.nSeen < FRAME_POOL_BUFFERS * 2) soak.seen[soak.nSeen++] = buffer;
+}
+
+/**
+ * Release the oldest frames held, down to keep, checking each is as it was passed.
+ * @returns false when a release failed.
+ */
+bool releaseSoakFrames(int keep) {
+	bool released = true;
+	std::lock_guard<std::mutex> lock(soak.mu);
+	while (soak.count > keep) {
+		int at = soak.first;
+		if (hashBytes(soak.buffers[at], soak.lens[at]) != soak.hashes[at]) soak.corrupted++;
+		released &= SUCCEEDED(releaseFrame(soak.buffers[at]));
+		soak.first = (soak.first + 1) % FRAME_POOL_BUFFERS;
+		soak.count--;
+	}
+	return released;
+}
+
+UINT64 hashBytes(const char *bytes, int len) {
+	UINT64 hash = 14695981039346656037ULL;
+	for (int i = 0; i < len; i++) hash = (hash ^ (unsigned char) bytes[i]) * 1099511628211ULL;
+	return hash;
+}
+
+/**
+ * Resident memory, its peak, & heap bytes in use, of this process; -1 for any which cannot be read here.
+ */
+void memoryUse(long long *residentBytes, long long *peakResidentBytes, long long *heapBytes) {
+	*residentBytes = *peakResidentBytes = *heapBytes = -1;
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		*residentBytes = (long long) counters.WorkingSetSize;
+		*peakResidentBytes = (long long) counters.PeakWorkingSetSize;
+	}
+#elif defined(__GLIBC__)
+	FILE *statm = fopen("/proc/self/statm", "r");
+	long long pages, resident;
+	if (statm != nullptr && fscanf(statm, "%lld %lld", &pages, &resident) == 2) *residentBytes = resident * sysconf(_SC_PAGESIZE);
+	if (statm != nullptr) fclose(statm);
+
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) *peakResidentBytes = (long long) usage.ru_maxrss * 1024;
+
+	struct mallinfo2 info = mallinfo2();
+	*heapBytes = (long long) info.uordblks + (long long) info.hblkhd;
+#endif
+}
@@ -0,0 +1,99 @@
+#include "Benchmark.h"
+
+// forward declare of non-external functions
+bool stressQueue(int hz, bool dropOldest, int nFrames);
+
+/**
+ * Stress the FrameQueue with a producer at 30, 60 & 300 Hz, against a consumer which takes 40 ms per frame.  Each frame
+ * is a pattern derived from its number, so torn or out of order frames are caught.  Then, while polling, beginning again
+ * with a callback must be refused, & with no callback at all, whether tracking or not.
+ */
+int benchQueue(int nFrames) {
+	const int RATES[] = { 30, 60, 300 };
+	bool correct = true;
+	for (unsigned int i = 0; i < _countof(RATES); i++) {
+		correct &= stressQueue(RATES[i], true, nFrames);
+		correct &= stressQueue(RATES[i], false, nFrames);
+	}
+
+	extern FrameSource *frameSource;
+	SimulatedFrameSource source(1, 30);
+	frameSource = &source;
+	bool guarded = beginBodyTracking(nullptr) == E_POINTER && beginBodyTrackingBinary(nullptr, '\0') == E_POINTER &&
+		SUCCEEDED(beginBodyTrackingPolled('J', 'D'));
+	guarded &= beginBodyTracking([](char *) {}) == E_ABORT && beginBodyTrackingBinary([](char *, int) {}, '\0') == E_ABORT &&
+		beginBodyTrackingPolled('J', 'D') == E_ABORT;
+	endBodyTracking();
+	frameSource = nullptr;
+	correct &= guarded;
+
+	printf("{\"bench\": \"queue\", \"secondBeginRefused\": %s}\n", guarded ? "true" : "false");
+	return correct ? 0 : 1;
+}
+
+#define STRESS_FRAME_SZ 20000
+#define STRESS_CONSUMER_MILLIS 40
+#define STRESS_MAX_CPU_PERCENT 25 // a producer blocked on a consumer sleeping 40 ms a frame should be asleep too
+
+/**
+ * A producer at hz against a consumer slower than any of them.  Every frame received must be whole & in order, & a
+ * blocked producer must sleep rather than spin.
+ */
+bool stressQueue(int hz, bool dropOldest, int nFrames) {
+	static FrameQueue queue(8, STRESS_FRAME_SZ);
+	queue.open(dropOldest);
+
+	std::atomic<long long> maxPushNs(0);
+	std::thread producer([&] {
+		static char frame[STRESS_FRAME_SZ];
+		Clock::time_point next = Clock::now();
+		for (int f = 0; f < nFrames; f++) {
+			for (int i = 0; i < STRESS_FRAME_SZ; i++) frame[i] = (char) (f + i);
+
+			Clock::time_point start = Clock::now();
+			queue.push(frame, STRESS_FRAME_SZ);
+			long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+			if (ns > maxPushNs) maxPushNs = ns;
+
+			next += std::chrono::microseconds(1000000 / hz);
+			std::this_thread::sleep_until(next);
+		}
+		queue.close();
+	});
+
+	static char frame[STRESS_FRAME_SZ];
+	int received = 0;
+	int lastFrame = -1;
+	bool intact = true;
+	double cpuStart = cpuSeconds();
+	Clock::time_point start = Clock::now();
+	while (true) {
+		int len = queue.wait(frame, STRESS_FRAME_SZ, 100);
+		if (len == 0) {
+			FRAME_QUEUE_STATS stats;
+			queue.getStats(&stats);
+			if (stats.framesDelivered + stats.framesOverwritten == (UINT64) nFrames) break;
+			continue;
+		}
+
+		// the first byte is the frame number, mod 256; recover the full number from the last one received
+		int f = lastFrame + 1 + (int) (unsigned char) (frame[0] - (char) (lastFrame + 1));
+		for (int i = 0; i < len && intact; i++) intact = frame[i] == (char) (f + i);
+		intact &= len == STRESS_FRAME_SZ && f > lastFrame;
+		lastFrame = f;
+		received++;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(STRESS_CONSUMER_MILLIS));
+	}
+	double seconds = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count() / 1e6;
+	double cpuPercent = (cpuSeconds() - cpuStart) * 100 / seconds;
+	producer.join();
+
+	FRAME_QUEUE_STATS stats;
+	queue.getStats(&stats);
+	bool correct = intact && cpuPercent < STRESS_MAX_CPU_PERCENT;
+	printf("{\"bench\": \"queue\", \"hz\": %d, \"policy\": \"%s\", \"frames\": %d, \"received\": %d, \"overwritten\": %llu, \"producerWaits\": %llu, \"maxPushUs\": %.1f, \"achievedHz\": %.1f, \"cpuPercent\": %.1f, \"intact\": %s, \"correct\": %s}\n",
+		hz, dropOldest ? "drop" : "block", nFrames, received, (unsigned long long) stats.framesOverwritten, (unsigned long long) stats.producerWaits,
+		maxPushNs / 1000.0, nFrames / seconds, cpuPercent, intact ? "true" : "false", correct ? "true" : "false");
+	return correct;
+}
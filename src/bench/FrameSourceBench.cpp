@@ -0,0 +1,47 @@
+#include "Benchmark.h"
+
+#define SOURCE_MIN_CPU_SAVING 4 // times less CPU a frame, & calls, waiting than spinning
+
+/**
+ * CPU time per delivered frame of the original reader loop, which spun on AcquireLatestFrame, vs waiting for each frame
+ * to arrive.  Both run against a 30 Hz simulated sensor of 6 bodies, & serialize what they get.  Waiting must take
+ * under a quarter of the CPU a frame of spinning, & about a call a frame.
+ */
+int benchSource(int nFrames) {
+	static FRAME_DATA frame;
+	static char json[FRAME_JSON_SZ];
+	SimulatedFrameSource source(BODY_COUNT, 30);
+	double cpuMsPerFrame[2];
+	double callsPerFrame[2];
+
+	for (int waiting = 0; waiting < 2; waiting++) {
+		source.start();
+		double cpuStart = cpuSeconds();
+		Clock::time_point start = Clock::now();
+
+		int delivered = 0;
+		long long calls = 0;
+		while (delivered < nFrames) {
+			HRESULT hr = waiting ? source.waitForFrame(&frame) : source.acquireLatestFrame(&frame);
+			calls++;
+			if (hr == S_OK) {
+				serializeFrameJSON(&frame, json);
+				delivered++;
+			}
+		}
+		double cpu = cpuSeconds() - cpuStart;
+		double seconds = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count() / 1e6;
+		source.stop();
+		cpuMsPerFrame[waiting] = cpu * 1000 / nFrames;
+		callsPerFrame[waiting] = (double) calls / nFrames;
+
+		printf("{\"bench\": \"source\", \"loop\": \"%s\", \"frames\": %d, \"callsPerFrame\": %.1f, \"cpuMsPerFrame\": %.3f, \"cpuPercent\": %.1f}\n",
+			waiting ? "wait" : "poll", nFrames, callsPerFrame[waiting], cpuMsPerFrame[waiting], cpu * 100 / seconds);
+	}
+
+	bool correct = cpuMsPerFrame[1] * SOURCE_MIN_CPU_SAVING < cpuMsPerFrame[0] && callsPerFrame[1] < 1.1 &&
+		callsPerFrame[1] * SOURCE_MIN_CPU_SAVING < callsPerFrame[0];
+	printf("{\"bench\": \"source\", \"cpuSaving\": %.1f, \"correct\": %s}\n", cpuMsPerFrame[0] / std::max(cpuMsPerFrame[1], 1e-6),
+		correct ? "true" : "false");
+	return correct ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+#include "Benchmark.h"
+
+// forward declare of non-external functions
+int legacySerializeFrame(const FRAME_DATA *frame, char *buffer);
+
+/**
+ * ns per frame of 6 fully tracked bodies, for the sprintf_s formatting this replaced vs serializeFrameJSON.
+ */
+int benchSerialize(int nFrames) {
+	static FRAME_DATA frames[SYNTHETIC_FRAMES];
+	static char expected[FRAME_JSON_SZ];
+	static char actual[FRAME_JSON_SZ];
+
+	bool identical = true;
+	for (int f = 0; f < SYNTHETIC_FRAMES; f++) {
+		generateSyntheticFrame(&frames[f], BODY_COUNT, f);
+
+		int expectedLen = legacySerializeFrame(&frames[f], expected);
+		int actualLen = serializeFrameJSON(&frames[f], actual);
+		identical &= expectedLen == actualLen && memcmp(expected, actual, actualLen) == 0;
+	}
+
+	Clock::time_point start = Clock::now();
+	for (int f = 0; f < nFrames; f++) {
+		legacySerializeFrame(&frames[f % SYNTHETIC_FRAMES], expected);
+	}
+	double legacyNs = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+	long long bytes = 0;
+	start = Clock::now();
+	for (int f = 0; f < nFrames; f++) {
+		bytes += serializeFrameJSON(&frames[f % SYNTHETIC_FRAMES], actual);
+	}
+	double ns = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+	printf("{\"bench\": \"serialize\", \"frames\": %d, \"bodies\": %d, \"legacyNsPerFrame\": %.1f, \"nsPerFrame\": %.1f, \"speedup\": %.2f, \"bytesPerFrame\": %lld, \"identical\": %s}\n",
+		nFrames, BODY_COUNT, legacyNs / nFrames, ns / nFrames, legacyNs / ns, bytes / nFrames, identical ? "true" : "false");
+	return identical ? 0 : 1;
+}
+
+/**
+ * The original sprintf_s formatting of processBodies, with each body closed as serializeFrameJSON now does.  Kept only
+ * as the baseline to measure against.
+ */
+int legacySerializeFrame(const FRAME_DATA *frame, char *json) {
+	const int BUF_SZ = FRAME_JSON_SZ;
+	const Vector4 &clipPlane = frame->clipPlane;
+
+	int idx = sprintf_s(json, BUF_SZ, "{\n\"floorClipPlane\": ");
+	idx += sprintf_s(&json[idx], BUF_SZ - idx, "{\"x\":%.3f,\"y\":%.3f,\"z\":%.3f,\"w\":%.3f}", clipPlane.x, clipPlane.y, clipPlane.z, clipPlane.w);
+	idx += sprintf_s(&json[idx], BUF_SZ - idx, ", \"cameraHeight\": %.3f", frame->cameraHeight);
+	idx += sprintf_s(&json[idx], BUF_SZ - idx, ",\n\"frame\": %d", frame->frame);
+	idx += sprintf_s(&json[idx], BUF_SZ - idx, ",\n\"bodies\": [");
+
+	for (int b = 0; b < frame->bodyCount; b++) {
+		const BODY_DATA *body = &frame->bodies[b];
+		if (b > 0) {
+			idx += sprintf_s(&json[idx], BUF_SZ - idx, ",");
+		}
+		idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n\t{");
+		idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n\t\"id\": %lld,", (long long) body->id);
+		idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n\t\"joints\": {");
+
+		for (unsigned int i = 0; i < JointType_Count; i++) {
+			const CameraSpacePoint &position = body->joints[i].Position;
+			const Vector4 &orientation = body->rotations[i].Orientation;
+
+			if (i > 0) {
+				idx += sprintf_s(&json[idx], BUF_SZ - idx, ",");
+			}
+			idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n\t\t\"%s\": {", JOINT_NAMES[i]);
+			idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n\t\t\t\"state\": \"%s\"", TRACK_STATES[body->joints[i].TrackingState]);
+			idx += sprintf_s(&json[idx], BUF_SZ - idx, ",\n\t\t\t\"location\": ");
+			idx += sprintf_s(&json[idx], BUF_SZ - idx, "{\"x\":%.3f,\"y\":%.3f,\"z\":%.3f}", position.X, position.Y, position.Z);
+			idx += sprintf_s(&json[idx], BUF_SZ - idx, ",\n\t\t\t\"rotation\": ");
+			idx += sprintf_s(&json[idx], BUF_SZ - idx, "{\"x\":%.3f,\"y\":%.3f,\"z\":%.3f,\"w\":%.3f}", orientation.x, orientation.y, orientation.z, orientation.w);
+			idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n\t\t}");
+		}
+		idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n\t}");
+
+		idx += sprintf_s(&json[idx], BUF_SZ - idx, ",\n\t\"hands\": {");
+		idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n\t\t\"left\": \"%s\"", HAND_STATES[body->leftHandState]);
+		idx += sprintf_s(&json[idx], BUF_SZ - idx, ",\n\t\t\"right\": \"%s\"", HAND_STATES[body->rightHandState]);
+		idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n\t}");
+		idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n}");
+	}
+	idx += sprintf_s(&json[idx], BUF_SZ - idx, "\n]\n}\n");
+	return idx;
+}
@@ -0,0 +1,117 @@
+#include "Benchmark.h"
+
+// forward declare of non-external functions
+void legacyTransformFrame(FRAME_DATA *frame, bool mirror, const CameraSpacePoint &rootXZBasis);
+
+/**
+ * ns per frame of 6 bodies to mirror, rotate into world space & offset, one joint at a time with trig per joint as
+ * processBodies did, vs the structure of arrays kernels.  The kernel must match transformJointsScalar(), & the rotation
+ * must actually level the floor.
+ */
+int benchTransform(int nFrames) {
+	static FRAME_DATA frames[SYNTHETIC_FRAMES];
+	static FRAME_DATA work;
+	static JOINT_SOA reference;
+	static JOINT_SOA actual;
+	CameraSpacePoint rootXZBasis = { 0.1f, 0, 2.0f };
+
+	float maxError = 0;
+	for (int f = 0; f < SYNTHETIC_FRAMES; f++) {
+		generateSyntheticFrame(&frames[f], BODY_COUNT, f);
+
+		for (int mirror = 0; mirror < 2; mirror++) {
+			FRAME_TRANSFORM transform;
+			buildFrameTransform(frames[f].clipPlane, mirror != 0, true, &transform);
+			transform.offsetX = rootXZBasis.X;
+			transform.offsetZ = rootXZBasis.Z;
+
+			gatherJoints(&frames[f], &reference);
+			actual = reference;
+			transformJointsScalar(&reference, &transform);
+			transformJoints(&actual, &transform);
+
+			// the kernels also transform the padding, so only compare what is gathered
+			for (int i = 0; i < reference.count; i++) {
+				float error = std::max(std::max(std::abs(reference.px[i] - actual.px[i]), std::abs(reference.py[i] - actual.py[i])), std::abs(reference.pz[i] - actual.pz[i]));
+				error = std::max(error, std::max(std::abs(reference.qx[i] - actual.qx[i]), std::abs(reference.qy[i] - actual.qy[i])));
+				error = std::max(error, std::max(std::abs(reference.qz[i] - actual.qz[i]), std::abs(reference.qw[i] - actual.qw[i])));
+				maxError = std::max(maxError, error);
+			}
+		}
+	}
+
+	// a point on the floor must end up at Y 0, & the floor's normal rotated by the quaternion must end up straight up
+	const Vector4 &plane = frames[0].clipPlane;
+	FRAME_TRANSFORM transform;
+	buildFrameTransform(plane, true, true, &transform);
+	float lenSq = plane.y * plane.y + plane.z * plane.z;
+	CameraSpacePoint onFloor = { 0.5f, -plane.w * plane.y / lenSq, -plane.w * plane.z / lenSq };
+	transformPosition(&transform, &onFloor);
+
+	float rx = transform.rotationX;
+	float rw = transform.rotationW;
+	float len = sqrtf(lenSq);
+	float normalY = (plane.y * (rw * rw - rx * rx) - plane.z * (2 * rw * rx)) / len;
+	float normalZ = (plane.y * (2 * rw * rx) + plane.z * (rw * rw - rx * rx)) / len;
+	bool level = std::abs(onFloor.Y) < 1e-5f && std::abs(normalY - 1) < 1e-5f && std::abs(normalZ) < 1e-5f;
+
+	Clock::time_point start = Clock::now();
+	for (int f = 0; f < nFrames; f++) {
+		work = frames[f % SYNTHETIC_FRAMES];
+		legacyTransformFrame(&work, false, rootXZBasis);
+	}
+	double legacyNs = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+	start = Clock::now();
+	for (int f = 0; f < nFrames; f++) {
+		work = frames[f % SYNTHETIC_FRAMES];
+		buildFrameTransform(work.clipPlane, false, true, &transform);
+		transform.offsetX = rootXZBasis.X;
+		transform.offsetZ = rootXZBasis.Z;
+
+		gatherJoints(&work, &actual);
+		transformJoints(&actual, &transform);
+		scatterJoints(&actual, &work);
+	}
+	double ns = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+	bool identical = maxError < 1e-5f && level;
+	printf("{\"bench\": \"transform\", \"frames\": %d, \"bodies\": %d, \"kernel\": \"%s\", \"legacyNsPerFrame\": %.1f, \"nsPerFrame\": %.1f, \"speedup\": %.2f, \"maxError\": %g, \"level\": %s, \"identical\": %s}\n",
+		nFrames, BODY_COUNT, getTransformKernel(), legacyNs / nFrames, ns / nFrames, legacyNs / ns, maxError, level ? "true" : "false", identical ? "true" : "false");
+	return identical ? 0 : 1;
+}
+
+/**
+ * The original per joint transforms of processBodies, with the camera angle worked out for every joint.  Kept only as
+ * the baseline to measure against; its Z was never a true rotation, & rotations were not put in world space.
+ */
+void legacyTransformFrame(FRAME_DATA *frame, bool mirror, const CameraSpacePoint &rootXZBasis) {
+	const Vector4 &clipPlane = frame->clipPlane;
+
+	for (int b = 0; b < frame->bodyCount; b++) {
+		Joint *joints = frame->bodies[b].joints;
+		JointOrientation *rotations = frame->bodies[b].rotations;
+
+		for (unsigned int i = 0; i < JointType_Count; i++) {
+			CameraSpacePoint &position = joints[i].Position;
+			Vector4 &orientation = rotations[i].Orientation;
+
+			if (!mirror) {
+				position.X *= -1;
+				orientation.y *= -1;
+				orientation.z *= -1;
+			}
+
+			float cameraAngleRadians = atan(clipPlane.z / clipPlane.y);
+			float cosCameraAngle = cos(cameraAngleRadians);
+			float sinCameraAngle = sin(cameraAngleRadians);
+
+			position.Y  = clipPlane.w + position.Y * cosCameraAngle + position.Z * sinCameraAngle;
+			float adjustedZ =           position.Z * cosCameraAngle + position.Y * sinCameraAngle;
+			position.Z += position.Z - adjustedZ;
+
+			position.X -= rootXZBasis.X;
+			position.Z -= rootXZBasis.Z;
+		}
+	}
+}
@@ -0,0 +1,183 @@
+#include "Benchmark.h"
+
+// forward declare of non-external functions
+double predictionError(const MOTION_CONFIG *config, float noiseMeters, int leadFrames, int nFrames);
+bool followsSteadyMotion(const MOTION_CONFIG *config);
+
+/**
+ * ns per frame of 6 bodies added to the history of their ids, predicted & smoothed.  Then how far the joints of synthetic
+ * bodies, predicted 1 & 2 frames ahead, 33 & 67 ms, are from where they then are, as the root mean square, without & with
+ * 5 mm of noise, for each filter.  Predicting must beat sending the last frame as it is, but with noise only when
+ * filtered, & filtering must beat not.  Then that each filter follows steady motion exactly, a gap or too many ids forget a body, & that a body's
+ * history can be read while tracking.
+ */
+int benchMotion(int nFrames) {
+	const MOTION_CONFIG MEASURED = { 0, MotionFilter_None, 0, 0 };
+	const MOTION_CONFIG ONE_EURO = { 0, MotionFilter_OneEuro, 1.0f, 30.0f };
+	const MOTION_CONFIG DOUBLE = { 0, MotionFilter_Double, 0.5f, 0.4f };
+	const float NOISES[] = { 0, 0.005f };
+	const int MEASURED_FRAMES = 900;
+
+	bool predicts = true;
+	for (unsigned int n = 0; n < _countof(NOISES); n++) {
+		for (int leadFrames = 1; leadFrames <= 2; leadFrames++) {
+			int leadMillis = (leadFrames * 1000 + 15) / 30;
+			MOTION_CONFIG measured = MEASURED, oneEuro = ONE_EURO, smoothed = DOUBLE;
+			measured.leadMillis = oneEuro.leadMillis = smoothed.leadMillis = leadMillis;
+
+			double hold = predictionError(&MEASURED, NOISES[n], leadFrames, MEASURED_FRAMES);
+			double measuredError = predictionError(&measured, NOISES[n], leadFrames, MEASURED_FRAMES);
+			double oneEuroError = predictionError(&oneEuro, NOISES[n], leadFrames, MEASURED_FRAMES);
+			double doubleError = predictionError(&smoothed, NOISES[n], leadFrames, MEASURED_FRAMES);
+
+			// noise is worth more than the lead to unfiltered prediction, so only filters must beat holding it
+			predicts &= oneEuroError < hold && doubleError < hold;
+			if (NOISES[n] > 0) predicts &= oneEuroError < measuredError && doubleError < measuredError;
+			else predicts &= measuredError < hold;
+			printf("{\"bench\": \"motion\", \"noiseMm\": %.0f, \"leadMillis\": %d, \"holdMm\": %.2f, \"measuredMm\": %.2f, \"oneEuroMm\": %.2f, \"doubleMm\": %.2f}\n",
+				NOISES[n] * 1000, leadMillis, hold * 1000, measuredError * 1000, oneEuroError * 1000, doubleError * 1000);
+		}
+	}
+
+	bool steady = followsSteadyMotion(&MEASURED) && followsSteadyMotion(&ONE_EURO) && followsSteadyMotion(&DOUBLE);
+
+	// a gap starts a body again, a frame before the last is not kept, & the least recently seen of too many ids is forgotten
+	static MotionHistory history;
+	static FRAME_DATA frame;
+	static BODY_MOTION motion;
+	history.configure(&MEASURED);
+	history.reset();
+	generateSyntheticFrame(&frame, 1, 0);
+	const INT64 TIMES[] = { 0, 333333, 666666, 500000, 666666 + (MOTION_MAX_GAP_MILLIS + 1) * 10000LL };
+	const int SAMPLES[] = { 1, 2, 3, 3, 1 };
+	bool forgets = true;
+	for (unsigned int t = 0; t < _countof(TIMES); t++) {
+		frame.relativeTime = TIMES[t];
+		history.update(&frame);
+		forgets &= history.read(frame.bodies[0].id, &motion) == S_OK && motion.nSamples == SAMPLES[t];
+	}
+	UINT64 firstId = frame.bodies[0].id;
+	for (int i = 1; i <= MOTION_MAX_TRACKS; i++) {
+		frame.bodies[0].id = firstId + i;
+		frame.relativeTime += 333333;
+		history.update(&frame);
+	}
+	forgets &= history.read(firstId, &motion) == S_FALSE && motion.nSamples == 0 && history.read(firstId + 1, &motion) == S_OK;
+
+	// through tracking, with prediction on; settings are refused while tracking
+	extern FrameSource *frameSource;
+	SimulatedFrameSource source(1, 300);
+	frameSource = &source;
+	static char json[FRAME_JSON_SZ];
+	bool tracks = setMotionPrediction(MOTION_MAX_LEAD_MILLIS + 1, 'N', 0, 0) == E_INVALIDARG && setMotionPrediction(50, 'D', 0.5f, 0) == E_INVALIDARG &&
+		setMotionPrediction(50, 'D', 0.5f, 0.4f) == S_OK && SUCCEEDED(beginBodyTrackingPolled('J', 'B'));
+	for (int received = 0; received < MOTION_HISTORY_FRAMES + 4 && tracks; received++) tracks = waitFrame(json, sizeof(json), 1000) > 0;
+	tracks &= setMotionPrediction(0, 'N', 0, 0) == E_ABORT;
+	tracks &= getBodyMotion(firstId, &motion) == S_OK && motion.nSamples == MOTION_HISTORY_FRAMES && motion.samples[0].relativeTime > motion.samples[1].relativeTime;
+	endBodyTracking();
+	setMotionPrediction(0, 'N', 0, 0);
+	frameSource = nullptr;
+
+	static FRAME_DATA frames[SYNTHETIC_FRAMES];
+	for (int f = 0; f < SYNTHETIC_FRAMES; f++) generateSyntheticFrame(&frames[f], BODY_COUNT, f);
+	MOTION_CONFIG timed = DOUBLE;
+	timed.leadMillis = 50;
+	history.configure(&timed);
+	history.reset();
+	Clock::time_point start = Clock::now();
+	for (int f = 0; f < nFrames; f++) {
+		FRAME_DATA *next = &frames[f % SYNTHETIC_FRAMES];
+		next->relativeTime = f * 333333LL;
+		history.update(next);
+	}
+	double ns = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+	bool correct = predicts && steady && forgets && tracks;
+	printf("{\"bench\": \"motion\", \"frames\": %d, \"bodies\": %d, \"nsPerFrame\": %.1f, \"predicts\": %s, \"steady\": %s, \"forgets\": %s, \"tracks\": %s, \"correct\": %s}\n",
+		nFrames, BODY_COUNT, ns / nFrames, predicts ? "true" : "false", steady ? "true" : "false", forgets ? "true" : "false",
+		tracks ? "true" : "false", correct ? "true" : "false");
+	return correct ? 0 : 1;
+}
+
+/**
+ * Root mean square distance, in meters, of every joint of 6 synthetic bodies at 30 Hz, after the history, from where
+ * they are leadFrames later.  Each location is off by up to noiseMeters, the same for every run.
+ */
+double predictionError(const MOTION_CONFIG *config, float noiseMeters, int leadFrames, int nFrames) {
+	static MotionHistory history;
+	static FRAME_DATA frame;
+	static FRAME_DATA later;
+	history.configure(config);
+	history.reset();
+
+	double sum = 0;
+	long long n = 0;
+	for (int f = 0; f < nFrames; f++) {
+		generateSyntheticFrame(&frame, BODY_COUNT, f);
+		frame.relativeTime = f * 333333LL;
+		for (int b = 0; b < BODY_COUNT; b++) {
+			for (int j = 0; j < JointType_Count; j++) {
+				float *axes = &frame.bodies[b].joints[j].Position.X;
+				for (int a = 0; a < 3; a++) {
+					unsigned int hash = ((f * 73856093u) ^ (b * 19349663u) ^ ((j * 3 + a) * 83492791u)) * 2654435761u;
+					axes[a] += noiseMeters * ((hash >> 8) / 8388608.0f - 1);
+				}
+			}
+		}
+		history.update(&frame);
+
+		// a second to settle
+		if (f < 30) continue;
+		generateSyntheticFrame(&later, BODY_COUNT, f + leadFrames);
+		for (int b = 0; b < BODY_COUNT; b++) {
+			for (int j = 0; j < JointType_Count; j++) {
+				const CameraSpacePoint &p = frame.bodies[b].joints[j].Position;
+				const CameraSpacePoint &e = later.bodies[b].joints[j].Position;
+				sum += (p.X - e.X) * (p.X - e.X) + (p.Y - e.Y) * (p.Y - e.Y) + (p.Z - e.Z) * (p.Z - e.Z);
+				n++;
+			}
+		}
+	}
+	return sqrt(sum / n);
+}
+
+/**
+ * A body moving at a steady 0.5 m/s, in frames up to 2 ms off 30 Hz, must have that velocity & no acceleration once
+ * settled.  Filters without lag must also have it where it is, & predict it 50 ms on.
+ */
+bool followsSteadyMotion(const MOTION_CONFIG *config) {
+	static MotionHistory history;
+	static FRAME_DATA frame;
+	static BODY_MOTION motion;
+	const float VELOCITY[] = { 0.3f, -0.1f, 0.4f };
+	MOTION_CONFIG predicting = *config;
+	predicting.leadMillis = 50;
+	history.configure(&predicting);
+	history.reset();
+	generateSyntheticFrame(&frame, 1, 0);
+
+	bool lags = config->filter == MotionFilter_OneEuro;
+	bool steady = true;
+	for (int f = 0; f < 90; f++) {
+		INT64 time = f * 333333LL + ((f * 7919) % 41 - 20) * 1000;
+		float seconds = time / 1e7f;
+		frame.relativeTime = time;
+		for (int j = 0; j < JointType_Count; j++) {
+			frame.bodies[0].joints[j].Position = { j * 0.01f + VELOCITY[0] * seconds, 1 + VELOCITY[1] * seconds, 2.5f + VELOCITY[2] * seconds };
+		}
+		history.update(&frame);
+		if (f < 60) continue;
+
+		steady &= history.read(frame.bodies[0].id, &motion) == S_OK;
+		for (int j = 0; j < JointType_Count; j++) {
+			const CameraSpacePoint &predicted = frame.bodies[0].joints[j].Position;
+			const float expected[3] = { j * 0.01f + VELOCITY[0] * (seconds + 0.05f), 1 + VELOCITY[1] * (seconds + 0.05f), 2.5f + VELOCITY[2] * (seconds + 0.05f) };
+			const float *axes = &predicted.X;
+			for (int a = 0; a < 3; a++) {
+				steady &= std::abs(motion.velocity[a][j] - VELOCITY[a]) < 1e-3f && std::abs(motion.acceleration[a][j]) < 0.1f;
+				if (!lags) steady &= std::abs(axes[a] - expected[a]) < 1e-4f;
+			}
+		}
+	}
+	return steady;
+}
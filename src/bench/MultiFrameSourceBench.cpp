@@ -0,0 +1,203 @@
+#include "Benchmark.h"
+
+// forward declare of non-external functions
+bool runMulti(int nSources, int hz, int nFrames);
+bool recordsEachSource();
+bool retriesFailingSource();
+
+/**
+ * Synthetic bodies as seen by a source with the given extrinsics, so once moved into the world frame they are where a
+ * source with none would have them, as when several sensors look at the same people.
+ */
+class ViewedFrameSource : public SimulatedFrameSource {
+public:
+	ViewedFrameSource(int nBodies, int hz, const SOURCE_EXTRINSICS *extrinsics) : SimulatedFrameSource(nBodies, hz) {
+		invertExtrinsics(extrinsics, &view);
+	}
+
+	HRESULT acquireLatestFrame(FRAME_DATA *frame) {
+		HRESULT hr = SimulatedFrameSource::acquireLatestFrame(frame);
+		if (hr == S_OK) applyExtrinsics(&view, frame);
+		return hr;
+	}
+
+private:
+	SOURCE_EXTRINSICS view;
+};
+
+/**
+ * A sensor which has been unplugged; every read fails at once.
+ */
+class FailingFrameSource : public FrameSource {
+public:
+	HRESULT start() {
+		return S_OK;
+	}
+
+	void stop() {
+	}
+
+	HRESULT waitForFrame(FRAME_DATA *) {
+		return E_FAIL;
+	}
+
+	HRESULT acquireLatestFrame(FRAME_DATA *) {
+		return E_FAIL;
+	}
+
+	void wake() {
+	}
+};
+
+/**
+ * Merged frames per second, CPU, & the wait to be merged, for 1 to 8 sources of 6 bodies, each at a sensor's 30 Hz &
+ * flat out at 500 Hz.  Each source views the same bodies from a different place, so every merged frame must be the 6
+ * bodies, with the rest found to be duplicates; extrinsics which were wrong would leave bodies out.  Each source must
+ * be recorded on its own, before its extrinsics, & a source which keeps failing must not be spun on.
+ */
+int benchMulti(int nFrames) {
+	// extrinsics must undo exactly
+	static FRAME_DATA original;
+	static FRAME_DATA moved;
+	generateSyntheticFrame(&original, BODY_COUNT, 7);
+	moved = original;
+
+	SOURCE_EXTRINSICS extrinsics = { { 0.1f, 0.7f, -0.1f, 0.7f }, { 1.5f, 0.2f, -3.0f } };
+	float len = sqrtf(0.1f * 0.1f + 0.7f * 0.7f + 0.1f * 0.1f + 0.7f * 0.7f);
+	extrinsics.rotation = { 0.1f / len, 0.7f / len, -0.1f / len, 0.7f / len };
+	SOURCE_EXTRINSICS inverse;
+	invertExtrinsics(&extrinsics, &inverse);
+	applyExtrinsics(&extrinsics, &moved);
+	applyExtrinsics(&inverse, &moved);
+
+	float maxError = 0;
+	for (int b = 0; b < BODY_COUNT; b++) {
+		for (int j = 0; j < JointType_Count; j++) {
+			const CameraSpacePoint &a = original.bodies[b].joints[j].Position;
+			const CameraSpacePoint &c = moved.bodies[b].joints[j].Position;
+			maxError = std::max(maxError, std::max(fabsf(a.X - c.X), std::max(fabsf(a.Y - c.Y), fabsf(a.Z - c.Z))));
+		}
+	}
+	bool correct = maxError < 1e-4f;
+
+	const int SOURCES[] = { 1, 2, 4, 8 };
+	for (unsigned int i = 0; i < _countof(SOURCES); i++) {
+		correct &= runMulti(SOURCES[i], 30, 60);
+		correct &= runMulti(SOURCES[i], 500, nFrames);
+	}
+	correct &= recordsEachSource();
+	correct &= retriesFailingSource();
+	return correct ? 0 : 1;
+}
+
+bool runMulti(int nSources, int hz, int nFrames) {
+	MultiFrameSource multi(MULTI_DEFAULT_TOLERANCE_MILLIS);
+	for (int s = 0; s < nSources; s++) {
+		// each a little further round & along
+		float half = s * 0.2f;
+		SOURCE_EXTRINSICS extrinsics = { { 0, sinf(half), 0, cosf(half) }, { 1.5f * s, 0.1f * s, -0.5f * s } };
+		multi.addSource(new ViewedFrameSource(BODY_COUNT, hz, &extrinsics), &extrinsics);
+	}
+
+	static FRAME_DATA merged;
+	bool correct = SUCCEEDED(multi.start());
+	double cpuStart = cpuSeconds();
+	Clock::time_point start = Clock::now();
+
+	for (int received = 0; received < nFrames && correct; ) {
+		if (multi.waitForFrame(&merged) != S_OK) continue;
+		correct = merged.bodyCount == BODY_COUNT;
+		received++;
+	}
+	double cpu = cpuSeconds() - cpuStart;
+	double seconds = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count() / 1e6;
+	multi.stop();
+
+	MULTI_SOURCE_STATS stats;
+	multi.getStats(&stats);
+	correct &= stats.bodiesLeftOut == 0;
+
+	printf("{\"bench\": \"multi\", \"sources\": %d, \"hz\": %d, \"frames\": %d, \"mergedFps\": %.1f, \"cpuPercent\": %.1f, \"alignP50Us\": %.1f, \"alignP99Us\": %.1f, \"maxSkewUs\": %.1f, \"incomplete\": %llu, \"duplicatesPerFrame\": %.2f, \"leftOut\": %llu, \"correct\": %s}\n",
+		nSources, hz, nFrames, nFrames / seconds, cpu * 100 / seconds, stats.alignment.p50Us, stats.alignment.p99Us, stats.maxSkewUs,
+		stats.framesIncomplete, (double) stats.duplicateBodies / stats.framesMerged, stats.bodiesLeftOut, correct ? "true" : "false");
+	return correct;
+}
+
+/**
+ * Record 2 sources viewing the same bodies; the second's recording, moved by its extrinsics, must be the first's.
+ */
+bool recordsEachSource() {
+	const char *path = "bench_multi.ktj";
+	std::string secondPath = std::string(path) + ".1";
+	SOURCE_EXTRINSICS extrinsics = { { 0, sinf(0.3f), 0, cosf(0.3f) }, { 1.5f, 0.1f, -0.5f } };
+	MultiFrameSource multi(MULTI_DEFAULT_TOLERANCE_MILLIS);
+	multi.addSource(new SimulatedFrameSource(BODY_COUNT, 30), nullptr);
+	multi.addSource(new ViewedFrameSource(BODY_COUNT, 30, &extrinsics), &extrinsics);
+
+	static FRAME_DATA merged;
+	bool correct = SUCCEEDED(beginRecording(path)) && SUCCEEDED(multi.start());
+	for (int received = 0; received < 10 && correct; ) {
+		if (multi.waitForFrame(&merged) == S_OK) received++;
+	}
+	multi.stop();
+	int nRecorded = endRecording();
+
+	static FRAME_DATA first;
+	static FRAME_DATA second;
+	ReplayFrameSource firstReplay(0);
+	ReplayFrameSource secondReplay(0);
+	correct &= SUCCEEDED(firstReplay.load(path)) && SUCCEEDED(secondReplay.load(secondPath.c_str())) &&
+		SUCCEEDED(firstReplay.start()) && SUCCEEDED(secondReplay.start()) &&
+		firstReplay.acquireLatestFrame(&first) == S_OK && secondReplay.acquireLatestFrame(&second) == S_OK;
+	firstReplay.stop();
+	secondReplay.stop();
+
+	float maxError = correct ? 0 : 1;
+	if (correct) {
+		applyExtrinsics(&extrinsics, &second);
+		for (int b = 0; b < BODY_COUNT; b++) {
+			for (int j = 0; j < JointType_Count; j++) {
+				const CameraSpacePoint &a = first.bodies[b].joints[j].Position;
+				const CameraSpacePoint &c = second.bodies[b].joints[j].Position;
+				maxError = std::max(maxError, std::max(fabsf(a.X - c.X), std::max(fabsf(a.Y - c.Y), fabsf(a.Z - c.Z))));
+			}
+		}
+	}
+	correct &= nRecorded >= 10 && maxError < 1e-4f;
+
+	remove(path);
+	remove((std::string(path) + RECORDING_INDEX_EXT).c_str());
+	remove(secondPath.c_str());
+	remove((secondPath + RECORDING_INDEX_EXT).c_str());
+
+	printf("{\"bench\": \"multi\", \"recorded\": %d, \"maxRecordedError\": %g, \"correct\": %s}\n", nRecorded, maxError,
+		correct ? "true" : "false");
+	return correct;
+}
+
+#define FAILING_MAX_CPU_PERCENT 10
+
+/**
+ * A sensor at 30 Hz, merged with one which always fails, for a second.  Merges go on without it, with little CPU.
+ */
+bool retriesFailingSource() {
+	MultiFrameSource multi(MULTI_DEFAULT_TOLERANCE_MILLIS);
+	multi.addSource(new SimulatedFrameSource(BODY_COUNT, 30), nullptr);
+	multi.addSource(new FailingFrameSource(), nullptr);
+
+	static FRAME_DATA merged;
+	bool correct = SUCCEEDED(multi.start());
+	double cpuStart = cpuSeconds();
+	Clock::time_point start = Clock::now();
+	for (int received = 0; received < 30 && correct; ) {
+		if (multi.waitForFrame(&merged) == S_OK) received++;
+	}
+	double cpu = cpuSeconds() - cpuStart;
+	double seconds = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count() / 1e6;
+	multi.stop();
+	correct &= cpu * 100 / seconds < FAILING_MAX_CPU_PERCENT;
+
+	printf("{\"bench\": \"multi\", \"failingSource\": true, \"cpuPercent\": %.1f, \"correct\": %s}\n", cpu * 100 / seconds,
+		correct ? "true" : "false");
+	return correct;
+}
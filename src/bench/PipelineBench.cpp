@@ -0,0 +1,81 @@
+#include "Benchmark.h"
+
+// forward declare of non-external functions
+UINT64 runPipeline(ReplayFrameSource *source, int nWorkers, char JSON_Binary_or_Quantized, int nFrames);
+
+/**
+ * Frames per second of body tracking from a recording replayed as fast as possible, every stage on the one body thread
+ * vs the pipeline with 1, 2 & 4 threads serializing.  Only scales with as many cores as are free.  Every configuration
+ * must deliver the same bytes, in the same order.
+ */
+int benchPipeline(int nFrames) {
+	static FRAME_DATA recorded;
+	const char *path = "bench_pipeline.ktj";
+
+	SessionRecorder recorder;
+	if (FAILED(recorder.open(path))) return 1;
+	for (int f = 0; f < nFrames; f++) {
+		generateSyntheticFrame(&recorded, BODY_COUNT, f);
+		recorded.relativeTime = f * 333333LL;
+		recorder.append(&recorded);
+	}
+	recorder.close();
+
+	ReplayFrameSource source(0);
+	bool correct = SUCCEEDED(source.load(path));
+
+	const char FORMATS[] = { 'J', 'Q' };
+	const int WORKERS[] = { 0, 1, 2, 4 };
+	for (unsigned int i = 0; i < _countof(FORMATS) && correct; i++) {
+		UINT64 serialHash = 0;
+		for (unsigned int w = 0; w < _countof(WORKERS) && correct; w++) {
+			UINT64 hash = runPipeline(&source, WORKERS[w], FORMATS[i], nFrames);
+			if (w == 0) serialHash = hash;
+			correct = hash != 0 && hash == serialHash;
+		}
+	}
+	setPipelineWorkers(PIPELINE_DEFAULT_WORKERS);
+
+	remove(path);
+	remove((std::string(path) + RECORDING_INDEX_EXT).c_str());
+	return correct ? 0 : 1;
+}
+
+/**
+ * @returns a hash of every byte delivered, or 0 when frames went missing.
+ */
+UINT64 runPipeline(ReplayFrameSource *source, int nWorkers, char JSON_Binary_or_Quantized, int nFrames) {
+	extern FrameSource *frameSource;
+	static char frame[FRAME_JSON_SZ];
+	frameSource = source;
+	source->seek(0);
+	setPipelineWorkers(nWorkers);
+
+	// FNV-1a
+	UINT64 hash = 14695981039346656037ULL;
+	int received = 0;
+	double cpuStart = cpuSeconds();
+	Clock::time_point start = Clock::now();
+
+	beginBodyTrackingPolled(JSON_Binary_or_Quantized, 'B');
+	while (received < nFrames) {
+		int len = waitFrame(frame, sizeof(frame), 1000);
+		if (len <= 0) break;
+
+		for (int i = 0; i < len; i++) {
+			hash = (hash ^ (unsigned char) frame[i]) * 1099511628211ULL;
+		}
+		received++;
+	}
+	double seconds = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count() / 1e6;
+	double cpu = cpuSeconds() - cpuStart;
+	endBodyTracking();
+	frameSource = nullptr;
+
+	TRACKING_STATS stats;
+	getTrackingStats(&stats);
+
+	printf("{\"bench\": \"pipeline\", \"format\": \"%c\", \"workers\": %d, \"frames\": %d, \"fps\": %.0f, \"cpuPercent\": %.1f, \"serializeP50Us\": %.1f, \"hash\": \"%016llx\"}\n",
+		JSON_Binary_or_Quantized, nWorkers, received, received / seconds, cpu * 100 / seconds, stats.stages[TrackingStage_Serialize].p50Us, hash);
+	return received == nFrames ? hash : 0;
+}
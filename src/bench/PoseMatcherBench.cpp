@@ -0,0 +1,152 @@
+#include "Benchmark.h"
+
+// forward declare of non-external functions
+void posedFrame(FRAME_DATA *frame, UINT64 firstId, int up, int clap);
+int countEvents(const char *json, const char *action);
+
+/**
+ * us per frame to check 100 templates of 3 terms each against 6 bodies, as a share of a 30 Hz frame, which must be under
+ * 1%.  Then that start, stop & marker poses act when held, that parsing catches mistakes, that the default T pose starts
+ * all 6 bodies, & that ids are forgotten & started again once more have been seen than are kept.
+ */
+int benchPoses(int nFrames) {
+	static FRAME_DATA frame;
+	static PoseMatcher matcher;
+	bool send[BODY_COUNT];
+
+	std::string templates;
+	for (int t = 0; t < 100; t++) {
+		char line[256];
+		const char *a = JOINT_NAMES[t % JointType_Count];
+		const char *b = JOINT_NAMES[(t * 7 + 3) % JointType_Count];
+		const char *c = JOINT_NAMES[(t * 11 + 5) % JointType_Count];
+		sprintf_s(line, sizeof(line), "pose%d marker %d : %s.y > %s.y 0.05 ; distance %s %s < 0.8 ; angle %s %s %s 90 45\n",
+			t, 1 + t % 5, a, b, b, c, a, b, c);
+		templates += line;
+	}
+	bool correct = SUCCEEDED(matcher.load(templates.c_str())) && matcher.getTemplateCount() == 100;
+
+	matcher.start(false);
+	generateSyntheticFrame(&frame, BODY_COUNT, 0);
+	Clock::time_point start = Clock::now();
+	for (int f = 0; f < nFrames; f++) {
+		frame.bodies[f % BODY_COUNT].joints[JointType_HandTipLeft].Position.Y = (f % 60) * 0.02f - 0.5f;
+		matcher.evaluate(&frame, f, send);
+	}
+	double us = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count() / 1e3 / nFrames;
+	double budgetPercent = us * 100 / (1e6 / 30);
+	static char events[POSE_EVENT_SLOTS * 256];
+	matcher.pollEvents(events, sizeof(events));
+
+	// up starts once held 2 frames, clap marks, & down stops
+	correct &= SUCCEEDED(matcher.load(
+		"# arms\n"
+		"up start 2 : HandTipLeft.y > Head.y ; HandTipRight.y > Head.y\n"
+		"clap marker : distance HandLeft HandRight < 0.05\n"
+		"\n"
+		"down stop : HandTipLeft.y < SpineBase.y 0.1 ; HandTipRight.y < SpineBase.y 0.1"));
+	matcher.start(false);
+	const int UP[] = { 3, 3, 0, 0 };
+	const int CLAP[] = { 0, 0, 3, 0 };
+	const int SENT[] = { 0, 3, 3, 0 };
+	for (int f = 0; f < 4; f++) {
+		posedFrame(&frame, 100, UP[f], CLAP[f]);
+		matcher.evaluate(&frame, f, send);
+		int nSent = 0;
+		for (int b = 0; b < BODY_COUNT; b++) nSent += send[b] ? 1 : 0;
+		correct &= nSent == SENT[f];
+	}
+	correct &= matcher.pollEvents(events, sizeof(events)) > 0 && countEvents(events, "start") == 3 && countEvents(events, "marker") == 3 &&
+		countEvents(events, "stop") == 3;
+
+	// a bad line leaves the templates as they were
+	correct &= matcher.load("up start : HandTipLeft.y > Head.x") == E_INVALIDARG && matcher.load("up begin : HandTipLeft.y > Head.y") == E_INVALIDARG &&
+		matcher.load("up start : distance Hand Head < 1") == E_INVALIDARG && matcher.getTemplateCount() == 3;
+
+	// angles, with no bodies needing starting
+	correct &= SUCCEEDED(matcher.load("straight marker : angle ShoulderLeft ElbowLeft WristLeft 180 15\nbent marker : angle ShoulderLeft ElbowLeft WristLeft 90 15"));
+	matcher.start(false);
+	posedFrame(&frame, 100, 0, 0);
+	matcher.evaluate(&frame, 0, send);
+	correct &= matcher.pollEvents(events, sizeof(events)) > 0 && countEvents(events, "marker") == BODY_COUNT && strstr(events, "bent") == nullptr;
+
+	// events keep the name they were raised with, when other templates are loaded before they are polled
+	posedFrame(&frame, 200, 0, 0);
+	matcher.evaluate(&frame, 1, send);
+	correct &= SUCCEEDED(matcher.load("clap marker : distance HandLeft HandRight < 0.1"));
+	correct &= matcher.pollEvents(events, sizeof(events)) > 0 && countEvents(events, "marker") == BODY_COUNT &&
+		strstr(events, "\"straight\"") != nullptr && strstr(events, "clap") == nullptr;
+
+	// the T pose starts all 6 bodies, & 10 frames of new ids forget the first, which must start again
+	matcher.load(nullptr);
+	matcher.start(true);
+	int starts = 0;
+	for (int f = 0; f <= 10; f++) {
+		posedFrame(&frame, f < 10 ? 1000 + f * BODY_COUNT : 1000, BODY_COUNT, 0);
+		matcher.evaluate(&frame, f, send);
+		for (int b = 0; b < BODY_COUNT; b++) correct &= send[b];
+		if (matcher.pollEvents(events, sizeof(events)) > 0) starts += countEvents(events, "start");
+	}
+	correct &= starts == 11 * BODY_COUNT;
+
+	// the T pose added after as many templates as can be loaded
+	templates.clear();
+	for (int t = 0; t < POSE_MAX_TEMPLATES; t++) {
+		char line[64];
+		sprintf_s(line, sizeof(line), "never%d marker : distance Head Head > 1\n", t);
+		templates += line;
+	}
+	correct &= SUCCEEDED(matcher.load(templates.c_str())) && matcher.getTemplateCount() == POSE_MAX_TEMPLATES;
+	matcher.start(true);
+	posedFrame(&frame, 2000, BODY_COUNT, 0);
+	matcher.evaluate(&frame, 0, send);
+	for (int b = 0; b < BODY_COUNT; b++) correct &= send[b];
+	correct &= matcher.pollEvents(events, sizeof(events)) > 0 && countEvents(events, "start") == BODY_COUNT && countEvents(events, "marker") == 0;
+
+	printf("{\"bench\": \"poses\", \"templates\": 100, \"bodies\": %d, \"frames\": %d, \"usPerFrame\": %.2f, \"budgetPercent\": %.3f, \"correct\": %s}\n",
+		BODY_COUNT, nFrames, us, budgetPercent, correct ? "true" : "false");
+	return correct && budgetPercent < 1 ? 0 : 1;
+}
+
+/**
+ * 6 standing bodies, with ids from firstId, the first up of which have their hands above their heads, the first clap
+ * of those not up, their hands together in front of them, & the rest their hands by their sides.
+ */
+void posedFrame(FRAME_DATA *frame, UINT64 firstId, int up, int clap) {
+	generateSyntheticFrame(frame, BODY_COUNT, 0);
+	for (int b = 0; b < BODY_COUNT; b++) {
+		BODY_DATA *body = &frame->bodies[b];
+		body->id = firstId + b;
+		float headY = body->joints[JointType_Head].Position.Y;
+
+		if (b < up) {
+			body->joints[JointType_HandTipLeft].Position.Y = headY + 0.3f;
+			body->joints[JointType_HandTipRight].Position.Y = headY + 0.3f;
+
+		} else if (b < up + clap) {
+			CameraSpacePoint together = body->joints[JointType_SpineMid].Position;
+			together.Z -= 0.3f;
+			body->joints[JointType_HandLeft].Position = together;
+			body->joints[JointType_HandRight].Position = together;
+			body->joints[JointType_HandTipLeft].Position = together;
+			body->joints[JointType_HandTipRight].Position = together;
+
+		} else {
+			// the arms swing, so put the hands by the sides
+			float downY = body->joints[JointType_SpineBase].Position.Y - 0.2f;
+			body->joints[JointType_HandTipLeft].Position.Y = downY;
+			body->joints[JointType_HandTipRight].Position.Y = downY;
+		}
+	}
+}
+
+/**
+ * Events of an action, in the JSON of pollEvents().
+ */
+int countEvents(const char *json, const char *action) {
+	char pattern[64];
+	sprintf_s(pattern, sizeof(pattern), "\"action\": \"%s\"", action);
+	int n = 0;
+	for (const char *p = strstr(json, pattern); p != nullptr; p = strstr(p + 1, pattern)) n++;
+	return n;
+}
@@ -0,0 +1,144 @@
+#include "Benchmark.h"
+
+// forward declare of non-external functions
+bool runProjection(int nFrames, const char *spec, const PROJECTION *projection, long long *fullJSONBytes, double *fullJSONNs,
+	long long *fullBinaryBytes, double *fullBinaryNs);
+
+/**
+ * Bytes & ns per frame of JSON & binary, for projections clients commonly want, against sending everything.  Each is
+ * checked by decoding it back; what is projected must come back to within its decimals, & the rest as zero.
+ */
+int benchProjection(int nFrames) {
+	const char *SPECS[] = {
+		nullptr,
+		"fields: state location",
+		"fields: location; decimals: 2",
+		"joints: Head HandLeft HandRight HandTipLeft HandTipRight ThumbLeft ThumbRight; fields: location hands"
+	};
+	static PROJECTION projection;
+
+	// a spec not understood is refused, & leaves the projection as it was
+	bool correct = SUCCEEDED(parseProjection(SPECS[3], &projection)) && parseProjection("joints: Nose", &projection) == E_INVALIDARG &&
+		parseProjection("fields: velocity", &projection) == E_INVALIDARG && parseProjection("decimals: 7", &projection) == E_INVALIDARG &&
+		parseProjection("joints: ; fields: state", &projection) == E_INVALIDARG && parseProjection("colour: red", &projection) == E_INVALIDARG &&
+		projection.jointMask == ((1u << JointType_Head) | (1u << JointType_HandLeft) | (1u << JointType_HandRight) | (1u << JointType_HandTipLeft) |
+		(1u << JointType_HandTipRight) | (1u << JointType_ThumbLeft) | (1u << JointType_ThumbRight));
+
+	long long fullJSONBytes = 0, fullBinaryBytes = 0;
+	double fullJSONNs = 0, fullBinaryNs = 0;
+	for (unsigned int i = 0; i < _countof(SPECS); i++) {
+		correct &= SUCCEEDED(parseProjection(SPECS[i], &projection)) && projection.full == (SPECS[i] == nullptr);
+		correct &= runProjection(nFrames, SPECS[i], &projection, &fullJSONBytes, &fullJSONNs, &fullBinaryBytes, &fullBinaryNs);
+	}
+	return correct ? 0 : 1;
+}
+
+/**
+ * One projection, the first being the full one, which the rest are compared with.
+ */
+bool runProjection(int nFrames, const char *spec, const PROJECTION *projection, long long *fullJSONBytes, double *fullJSONNs,
+	long long *fullBinaryBytes, double *fullBinaryNs) {
+	static FRAME_DATA frames[SYNTHETIC_FRAMES];
+	static FRAME_DATA decoded;
+	static char json[FRAME_JSON_SZ];
+	static char binary[FRAME_BINARY_SZ];
+	static DELTA_FRAME delta;
+	for (int f = 0; f < SYNTHETIC_FRAMES; f++) {
+		generateSyntheticFrame(&frames[f], BODY_COUNT, f);
+	}
+
+	long long jsonBytes = 0;
+	Clock::time_point start = Clock::now();
+	for (int f = 0; f < nFrames; f++) {
+		jsonBytes += serializeProjectedJSON(&frames[f % SYNTHETIC_FRAMES], projection, json);
+	}
+	double jsonNs = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+	long long binaryBytes = 0;
+	start = Clock::now();
+	for (int f = 0; f < nFrames; f++) {
+		binaryBytes += serializeProjectedBinary(&frames[f % SYNTHETIC_FRAMES], projection, binary, false);
+	}
+	double binaryNs = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+	if (projection->full) {
+		*fullJSONBytes = jsonBytes;
+		*fullJSONNs = jsonNs;
+		*fullBinaryBytes = binaryBytes;
+		*fullBinaryNs = binaryNs;
+	}
+
+	// every number of the JSON; the header's 6, then the id & values of each body
+	static float values[FRAME_JSON_SZ / 2];
+	const FRAME_DATA &frame = frames[0];
+	int nJoints = 0;
+	for (unsigned int j = 0; j < JointType_Count; j++) nJoints += (projection->jointMask >> j) & 1;
+	int jointValues = (projection->fields & ProjectionField_Location ? 3 : 0) + (projection->fields & ProjectionField_Rotation ? 4 : 0);
+	serializeProjectedJSON(&frame, projection, json);
+	bool correct = parseNumbers(json, values) == 6 + frame.bodyCount * (1 + nJoints * jointValues);
+
+	// as a keyframe of delta mode, which the decoder can read back, then as a delta of only the last joint sent
+	delta.keyframe = true;
+	delta.nEntered = 0;
+	delta.nLeft = 0;
+	for (int b = 0; b < frame.bodyCount; b++) {
+		delta.changedJoints[b] = PROJECTION_ALL_JOINTS;
+		delta.handsChanged[b] = true;
+	}
+	DeltaDecoder decoder;
+	serializeProjectedDeltaJSON(&frame, &delta, projection, json);
+	correct &= decoder.apply(json, &decoded) == S_OK;
+	float tolerance = 0.5f * powf(10, (float) -projection->decimals) + 1e-6f;
+	bool binaryCorrect = true;
+	for (int pass = 0; pass < 2; pass++) {
+		correct &= decoded.bodyCount == frame.bodyCount;
+		for (int b = 0; b < frame.bodyCount && correct; b++) {
+			const BODY_DATA &expected = frame.bodies[b];
+			const BODY_DATA &actual = decoded.bodies[b];
+			bool hands = (projection->fields & ProjectionField_Hands) || pass == 1;
+			correct &= actual.id == expected.id && actual.leftHandState == (hands ? expected.leftHandState : 0) &&
+				actual.rightHandState == (hands ? expected.rightHandState : 0);
+
+			for (unsigned int j = 0; j < JointType_Count; j++) {
+				bool sent = (projection->jointMask & (1u << j)) != 0;
+				bool state = (sent && (projection->fields & ProjectionField_State)) || pass == 1;
+				float location = sent && (projection->fields & ProjectionField_Location) ? (pass == 0 ? tolerance : 0) : -1;
+				float rotation = sent && (projection->fields & ProjectionField_Rotation) ? (pass == 0 ? tolerance : 0) : -1;
+
+				const CameraSpacePoint &a = expected.joints[j].Position;
+				const CameraSpacePoint &d = actual.joints[j].Position;
+				const Vector4 &qa = expected.rotations[j].Orientation;
+				const Vector4 &qd = actual.rotations[j].Orientation;
+				correct &= actual.joints[j].TrackingState == (state ? expected.joints[j].TrackingState : 0);
+				correct &= location < 0 ? d.X == 0 && d.Y == 0 && d.Z == 0 :
+					std::abs(a.X - d.X) <= location && std::abs(a.Y - d.Y) <= location && std::abs(a.Z - d.Z) <= location;
+				correct &= rotation < 0 ? qd.x == 0 && qd.y == 0 && qd.z == 0 && qd.w == 0 :
+					std::abs(qa.x - qd.x) <= rotation && std::abs(qa.y - qd.y) <= rotation && std::abs(qa.z - qd.z) <= rotation && std::abs(qa.w - qd.w) <= rotation;
+			}
+		}
+
+		// the binary format is exact, with states & hands always
+		if (pass == 0) {
+			int len = serializeProjectedBinary(&frame, projection, binary, false);
+			binaryCorrect = SUCCEEDED(decodeFrameBinary(binary, len, &decoded));
+		}
+	}
+	correct &= binaryCorrect;
+
+	// a joint written first, which is not the first of the projection, still makes valid JSON
+	for (int b = 0; b < frame.bodyCount; b++) {
+		delta.changedJoints[b] = 0;
+		for (unsigned int j = 0; j < JointType_Count; j++) {
+			if (projection->jointMask & (1u << j)) delta.changedJoints[b] = 1u << j;
+		}
+		delta.handsChanged[b] = false;
+	}
+	delta.keyframe = false;
+	serializeProjectedDeltaJSON(&frame, &delta, projection, json);
+	correct &= decoder.apply(json, &decoded) == S_OK;
+
+	printf("{\"bench\": \"projection\", \"spec\": \"%s\", \"frames\": %d, \"jsonBytesPerFrame\": %lld, \"jsonNsPerFrame\": %.1f, \"binaryBytesPerFrame\": %lld, \"binaryNsPerFrame\": %.1f, \"jsonBytesSaved\": %.3f, \"jsonCpuSaved\": %.3f, \"binaryBytesSaved\": %.3f, \"correct\": %s}\n",
+		spec != nullptr ? spec : "", nFrames, jsonBytes / nFrames, jsonNs / nFrames, binaryBytes / nFrames, binaryNs / nFrames,
+		1 - (double) jsonBytes / *fullJSONBytes, 1 - jsonNs / *fullJSONNs, 1 - (double) binaryBytes / *fullBinaryBytes, correct ? "true" : "false");
+	return correct;
+}
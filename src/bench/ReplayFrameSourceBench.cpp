@@ -0,0 +1,133 @@
+#include "Benchmark.h"
+
+// forward declare of non-external functions
+bool rejectsCorruptRecordings(const char *path);
+bool rewriteFile(const char *path, long long at, const void *bytes, int len, long long truncateTo);
+
+/**
+ * Record synthetic 6 body frames to a session, then replay it as fast as possible through serialization, & seek to
+ * random frames.  Every replayed frame is compared with what was recorded.
+ */
+int benchReplay(int nFrames) {
+	static FRAME_DATA recorded;
+	static FRAME_DATA replayed;
+	static char json[FRAME_JSON_SZ];
+	const char *path = "bench_session.ktj";
+
+	SessionRecorder recorder;
+	if (FAILED(recorder.open(path))) return 1;
+
+	Clock::time_point start = Clock::now();
+	for (int f = 0; f < nFrames; f++) {
+		generateSyntheticFrame(&recorded, BODY_COUNT, f);
+		recorded.relativeTime = f * 333333LL;
+		recorder.append(&recorded);
+	}
+	recorder.close();
+	double recordSeconds = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count() / 1e6;
+
+	ReplayFrameSource source(0);
+	bool identical = SUCCEEDED(source.load(path)) && source.getFrameCount() == nFrames && SUCCEEDED(source.start());
+
+	start = Clock::now();
+	for (int f = 0; f < nFrames && identical; f++) {
+		identical = source.waitForFrame(&replayed) == S_OK;
+		serializeFrameJSON(&replayed, json);
+
+		generateSyntheticFrame(&recorded, BODY_COUNT, f);
+		identical &= replayed.bodyCount == recorded.bodyCount && memcmp(replayed.bodies, recorded.bodies, recorded.bodyCount * sizeof(BODY_DATA)) == 0;
+	}
+	double replaySeconds = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count() / 1e6;
+
+	const int SEEKS = 1000;
+	start = Clock::now();
+	for (int i = 0; i < SEEKS && identical; i++) {
+		int f = (int) ((i * 7919LL) % nFrames);
+		identical = SUCCEEDED(source.seek(f)) && source.acquireLatestFrame(&replayed) == S_OK && replayed.relativeTime == f * 333333LL;
+	}
+	double seekNs = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count() / SEEKS;
+	source.stop();
+
+	FILE *file = nullptr;
+	long long bytes = 0;
+	if (fopen_s(&file, path, "rb") == 0) {
+		fseek(file, 0, SEEK_END);
+		bytes = ftell(file);
+		fclose(file);
+	}
+	remove(path);
+	remove((std::string(path) + RECORDING_INDEX_EXT).c_str());
+
+	bool rejects = rejectsCorruptRecordings(path);
+
+	printf("{\"bench\": \"replay\", \"frames\": %d, \"bodies\": %d, \"bytesPerFrame\": %lld, \"recordFps\": %.0f, \"replayFps\": %.0f, \"seekNs\": %.0f, \"identical\": %s, \"rejectsCorrupt\": %s}\n",
+		nFrames, BODY_COUNT, bytes / nFrames, nFrames / recordSeconds, nFrames / replaySeconds, seekNs, identical ? "true" : "false",
+		rejects ? "true" : "false");
+	return identical && rejects ? 0 : 1;
+}
+
+/**
+ * Whether a short recording loads, & fails to once cut short, or with an index or body count which is out of range.
+ */
+bool rejectsCorruptRecordings(const char *path) {
+	static FRAME_DATA recorded;
+	std::string indexPath = std::string(path) + RECORDING_INDEX_EXT;
+	const int FRAMES = 3;
+	const INT64 frameSz = sizeof(RECORDED_FRAME) + BODY_COUNT * sizeof(BODY_DATA);
+	const INT64 dataSz = sizeof(RECORDING_HEADER) + FRAMES * frameSz;
+	const INT64 pastEnd = dataSz, inHeader = 0;
+	const INT32 negative = -1, tooMany = BODY_COUNT + 1;
+	const char partial[3] = { 0 };
+
+	bool rejects = true;
+	for (int c = -1; c < 6 && rejects; c++) {
+		SessionRecorder recorder;
+		if (FAILED(recorder.open(path))) return false;
+		for (int f = 0; f < FRAMES; f++) {
+			generateSyntheticFrame(&recorded, BODY_COUNT, f);
+			recorder.append(&recorded);
+		}
+		recorder.close();
+
+		// the last frame of the data cut short; part of another index entry; frame 1 past the end, or in the header;
+		// frame 1's body count negative, or too many
+		INT64 bodyCountAt = sizeof(RECORDING_HEADER) + frameSz + offsetof(RECORDED_FRAME, bodyCount);
+		bool rewritten = c == -1 ||
+			(c == 0 && rewriteFile(path, 0, nullptr, 0, dataSz - 1)) ||
+			(c == 1 && rewriteFile(indexPath.c_str(), FRAMES * sizeof(INT64), partial, sizeof(partial), -1)) ||
+			(c == 2 && rewriteFile(indexPath.c_str(), sizeof(INT64), &pastEnd, sizeof(pastEnd), -1)) ||
+			(c == 3 && rewriteFile(indexPath.c_str(), sizeof(INT64), &inHeader, sizeof(inHeader), -1)) ||
+			(c == 4 && rewriteFile(path, bodyCountAt, &negative, sizeof(negative), -1)) ||
+			(c == 5 && rewriteFile(path, bodyCountAt, &tooMany, sizeof(tooMany), -1));
+
+		ReplayFrameSource source(0);
+		HRESULT hr = source.load(path);
+		rejects = rewritten && (c == -1 ? SUCCEEDED(hr) && source.getFrameCount() == FRAMES : hr == E_INVALIDARG);
+	}
+
+	remove(path);
+	remove(indexPath.c_str());
+	return rejects;
+}
+
+/**
+ * Overwrite len bytes of a file at at, & cut it to truncateTo bytes unless that is -1.
+ */
+bool rewriteFile(const char *path, long long at, const void *bytes, int len, long long truncateTo) {
+	std::vector<char> contents;
+	FILE *file = nullptr;
+	if (fopen_s(&file, path, "rb") != 0) return false;
+	char block[4096];
+	size_t n;
+	while ((n = fread(block, 1, sizeof(block), file)) > 0) contents.insert(contents.end(), block, block + n);
+	fclose(file);
+
+	if ((long long) contents.size() < at + len) contents.resize((size_t) (at + len));
+	if (len > 0) memcpy(&contents[(size_t) at], bytes, len);
+	if (truncateTo >= 0 && truncateTo < (long long) contents.size()) contents.resize((size_t) truncateTo);
+
+	if (fopen_s(&file, path, "wb") != 0) return false;
+	bool written = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+	fclose(file);
+	return written;
+}
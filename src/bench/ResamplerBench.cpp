@@ -0,0 +1,204 @@
+#include "Benchmark.h"
+
+// forward declare of non-external functions
+bool runResample(int nFrames, int hz, ResampleMode mode);
+
+/**
+ * Frames of 2 bodies, every joint of which moves in a straight line & turns at a steady rate, so interpolating them is
+ * exact.  At 30 Hz, with up to 2 ms of jitter, every 9th frame missing, a third of a second missing every 100 frames, &
+ * every 97th frame timed before the one it follows.  Delivered as fast as asked for.
+ */
+class JitteredFrameSource : public FrameSource {
+public:
+	JitteredFrameSource(int nFrames) : frames(nFrames) {
+		for (int f = 0; f < nFrames; f++) {
+			INT64 time = isMissing(f) ? -1 : f * 333333LL + ((f * 7919) % 41 - 20) * 1000;
+			if (f % 97 == 96 && time >= 0) time = lastTime - 1000;
+			if (!isMissing(f) && f % 97 != 96) lastTime = time;
+			pose(time, &frames[f]);
+		}
+	}
+
+	HRESULT start() {
+		next = 0;
+		return S_OK;
+	}
+
+	void stop() {
+	}
+
+	HRESULT waitForFrame(FRAME_DATA *frame) {
+		return acquireLatestFrame(frame);
+	}
+
+	HRESULT acquireLatestFrame(FRAME_DATA *frame) {
+		while (next < (int) frames.size() && frames[next].relativeTime < 0) next++;
+		if (next >= (int) frames.size()) return S_FALSE;
+
+		const FRAME_DATA &from = frames[next++];
+		memcpy(frame, &from, offsetof(FRAME_DATA, bodies) + from.bodyCount * sizeof(BODY_DATA));
+		return S_OK;
+	}
+
+	void wake() {
+	}
+
+	// # of ticks at hz, in time with the first frame, which are not within a gap of over RESAMPLE_MAX_GAP_MILLIS
+	int countTicks(int hz) {
+		std::vector<INT64> times;
+		for (int f = 0; f < (int) frames.size(); f++) {
+			if (frames[f].relativeTime >= 0 && f % 97 != 96) times.push_back(frames[f].relativeTime);
+		}
+
+		int ticks = 0;
+		size_t i = 0;
+		for (UINT64 tick = 0; ; tick++) {
+			INT64 time = times[0] + (INT64) ((tick * 10000000ULL + hz / 2) / hz);
+			if (time > times.back()) break;
+
+			while (times[i] < time) i++;
+			if (times[i] > time && times[i] - times[i - 1] > RESAMPLE_MAX_GAP_MILLIS * 10000LL) continue;
+			ticks++;
+		}
+		return ticks;
+	}
+
+	// every joint of each body, at a time in 100ns ticks
+	static void pose(INT64 time, FRAME_DATA *frame) {
+		double seconds = time / 1e7;
+		frame->relativeTime = time;
+		frame->bodyCount = 2;
+		frame->resampled = false;
+
+		for (int b = 0; b < 2; b++) {
+			BODY_DATA *body = &frame->bodies[b];
+			body->id = 72057594037927936ULL + b;
+			body->leftHandState = HandState_Open;
+			body->rightHandState = HandState_Closed;
+
+			for (int j = 0; j < JointType_Count; j++) {
+				double angle = (1 + j * 0.1 + b) * seconds;
+				body->joints[j].JointType = (JointType) j;
+				body->joints[j].TrackingState = TrackingState_Tracked;
+				body->joints[j].Position = { (float) (b + j * 0.01 + 0.05 * seconds), (float) (1 + 0.01 * seconds), (float) (2.5 - 0.02 * seconds) };
+				body->rotations[j].JointType = (JointType) j;
+				body->rotations[j].Orientation = { 0, (float) sin(angle / 2), 0, (float) cos(angle / 2) };
+			}
+		}
+	}
+
+private:
+	static bool isMissing(int f) {
+		return f % 9 == 8 || (f % 100 >= 50 && f % 100 < 60);
+	}
+
+	std::vector<FRAME_DATA> frames;
+	INT64 lastTime = 0;
+	int next = 0;
+};
+
+/**
+ * ns per frame resampled from jittered frames with dropouts, to 24, 60 & 90 Hz, interpolated & decimated.  Every frame
+ * must be on the requested clock, with none in gaps too long to interpolate, & interpolated joints must be where the
+ * steady motion puts them.  Then 30 frames through body tracking, which must be sent with their time, while the
+ * sensor's own frames are counted & recorded.
+ */
+int benchResample(int nFrames) {
+	const int RATES[] = { 24, 60, 90 };
+	bool correct = true;
+	for (unsigned int i = 0; i < _countof(RATES); i++) {
+		correct &= runResample(nFrames, RATES[i], ResampleMode_Interpolate);
+		correct &= runResample(nFrames, RATES[i], ResampleMode_Decimate);
+	}
+
+	extern FrameSource *frameSource;
+	SimulatedFrameSource source(1, 300);
+	frameSource = &source;
+	static char frame[FRAME_JSON_SZ];
+	setResampling(60, 'I');
+	const char *path = "bench_resampled.ktj";
+	beginRecording(path);
+	beginBodyTrackingPolled('J', 'B');
+
+	INT64 lastTimeUs = -1;
+	for (int received = 0; received < 30 && correct; ) {
+		if (waitFrame(frame, sizeof(frame), 1000) <= 0) {
+			correct = false;
+			break;
+		}
+		const char *time = strstr(frame, "\"timeUs\": ");
+		INT64 timeUs = time != nullptr ? atoll(time + 10) : -1;
+		correct = timeUs >= 0 && (lastTimeUs < 0 || timeUs - lastTimeUs == 16666 || timeUs - lastTimeUs == 16667);
+		lastTimeUs = timeUs;
+		received++;
+	}
+	endBodyTracking();
+	int nRecorded = endRecording();
+	remove(path);
+	remove((std::string(path) + RECORDING_INDEX_EXT).c_str());
+	setResampling(0, 'I');
+	frameSource = nullptr;
+
+	// recorded & counted at the sensor's 300 Hz, not the 60 sent
+	TRACKING_STATS stats;
+	getTrackingStats(&stats);
+	correct &= stats.framesAcquired >= 4 * 30 && stats.framesDropped == 0 && nRecorded == (int) stats.framesAcquired;
+
+	printf("{\"bench\": \"resample\", \"tracking\": true, \"hz\": 60, \"lastTimeUs\": %lld, \"framesAcquired\": %llu, \"recorded\": %d, \"correct\": %s}\n",
+		lastTimeUs, stats.framesAcquired, nRecorded, correct ? "true" : "false");
+	return correct ? 0 : 1;
+}
+
+bool runResample(int nFrames, int hz, ResampleMode mode) {
+	JitteredFrameSource source(nFrames);
+	ResamplingFrameSource resampler;
+	resampler.configure(&source, hz, mode, nullptr);
+	static FRAME_DATA frame;
+	static FRAME_DATA expected;
+
+	resampler.start();
+	Clock::time_point start = Clock::now();
+	while (resampler.waitForFrame(&frame) == S_OK) {
+	}
+	double seconds = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count() / 1e9;
+	RESAMPLE_STATS stats;
+	resampler.getStats(&stats);
+
+	// again, checking each frame
+	resampler.start();
+	INT64 firstTime = -1;
+	bool steady = true;
+	float maxLocationError = 0;
+	float maxRotationError = 0;
+	while (resampler.waitForFrame(&frame) == S_OK) {
+		if (firstTime < 0) firstTime = frame.relativeTime;
+		UINT64 tick = (UINT64) ((frame.timeUs * hz + 500000) / 1000000);
+		steady &= frame.resampled && frame.timeUs == (INT64) ((tick * 1000000ULL + hz / 2) / hz) &&
+			frame.relativeTime - firstTime == (INT64) ((tick * 10000000ULL + hz / 2) / hz);
+
+		JitteredFrameSource::pose(frame.relativeTime, &expected);
+		steady &= frame.bodyCount == expected.bodyCount;
+		for (int b = 0; b < frame.bodyCount && steady; b++) {
+			for (int j = 0; j < JointType_Count; j++) {
+				const CameraSpacePoint &p = frame.bodies[b].joints[j].Position;
+				const CameraSpacePoint &e = expected.bodies[b].joints[j].Position;
+				maxLocationError = std::max(maxLocationError, std::max(fabsf(p.X - e.X), std::max(fabsf(p.Y - e.Y), fabsf(p.Z - e.Z))));
+
+				const Vector4 &q = frame.bodies[b].rotations[j].Orientation;
+				const Vector4 &r = expected.bodies[b].rotations[j].Orientation;
+				float dot = std::min(1.0f, fabsf(q.x * r.x + q.y * r.y + q.z * r.z + q.w * r.w));
+				maxRotationError = std::max(maxRotationError, 2 * acosf(dot));
+			}
+		}
+	}
+
+	// decimated frames are up to half a gap interpolated across off, 0.05 s with 2 frames missing, of 0.05 m/s & 4.4 rad/s
+	bool interpolated = mode == ResampleMode_Interpolate;
+	bool correct = steady && (int) stats.framesEmitted == source.countTicks(hz) && stats.framesOutOfOrder > 0 && stats.framesInGaps > 0 &&
+		maxLocationError < (interpolated ? 1e-4f : 0.003f) && maxRotationError < (interpolated ? 2e-3f : 0.25f);
+
+	printf("{\"bench\": \"resample\", \"mode\": \"%s\", \"hz\": %d, \"framesRead\": %llu, \"framesEmitted\": %llu, \"outOfOrder\": %llu, \"inGaps\": %llu, \"nsPerFrame\": %.0f, \"maxLocationError\": %g, \"maxRotationError\": %g, \"correct\": %s}\n",
+		interpolated ? "interpolate" : "decimate", hz, stats.framesRead, stats.framesEmitted, stats.framesOutOfOrder, stats.framesInGaps,
+		seconds * 1e9 / stats.framesEmitted, maxLocationError, maxRotationError, correct ? "true" : "false");
+	return correct;
+}
@@ -0,0 +1,263 @@
+#include "Benchmark.h"
+
+// forward declare of non-external functions
+void restRigJoints(const RIG *rig, FRAME_DATA *frame);
+float rigDegreesOff(const RIG *rig, const RIG_JOINTS *joints, const RIG_ROTATIONS *rotations);
+float degreesBetween(const CameraSpacePoint &a, const CameraSpacePoint &b);
+float boneError(const RIG_ROTATIONS *expected, const RIG_ROTATIONS *actual, int bone, int b);
+
+// a MakeHuman style rig in a T pose, facing +Z with its left along +X, as -bench retarget solves it
+const char BENCH_RIG[] =
+	"# name     parent     : head          tail           rest x y z       roll   ; side line at rest\n"
+	"root       -          : SpineBase     SpineMid       0 0.25 0                ; side HipRight HipLeft 1 0 0\n"
+	"spine      root       : SpineMid      SpineShoulder  0 0.25 0                ; side ShoulderRight ShoulderLeft 1 0 0\n"
+	"neck       spine      : SpineShoulder Neck           0 0.05 0\n"
+	"head       neck       : Neck          Head           0 0.15 0\n"
+	"clavicle.L spine      : SpineShoulder ShoulderLeft   0.18 0 0    roll -90\n"
+	"upperarm.L clavicle.L : ShoulderLeft  ElbowLeft      0.28 0 0    roll -90\n"
+	"lowerarm.L upperarm.L : ElbowLeft     WristLeft      0.25 0 0    roll -90    ; side WristLeft ThumbLeft 0 0 1\n"
+	"hand.L     lowerarm.L : WristLeft     HandTipLeft    0.15 0 0    roll -90\n"
+	"clavicle.R spine      : SpineShoulder ShoulderRight  -0.18 0 0   roll 90\n"
+	"upperarm.R clavicle.R : ShoulderRight ElbowRight     -0.28 0 0   roll 90\n"
+	"lowerarm.R upperarm.R : ElbowRight    WristRight     -0.25 0 0   roll 90     ; side WristRight ThumbRight 0 0 1\n"
+	"hand.R     lowerarm.R : WristRight    HandTipRight   -0.15 0 0   roll 90\n"
+	"pelvis.L   root       : SpineBase     HipLeft        0.1 -0.05 0\n"
+	"thigh.L    pelvis.L   : HipLeft       KneeLeft       0 -0.45 0\n"
+	"shin.L     thigh.L    : KneeLeft      AnkleLeft      0 -0.4 0                ; side AnkleLeft FootLeft 0 0 1\n"
+	"foot.L     shin.L     : AnkleLeft     FootLeft       0 -0.05 0.12\n"
+	"pelvis.R   root       : SpineBase     HipRight       -0.1 -0.05 0\n"
+	"thigh.R    pelvis.R   : HipRight      KneeRight      0 -0.45 0\n"
+	"shin.R     thigh.R    : KneeRight     AnkleRight     0 -0.4 0                ; side AnkleRight FootRight 0 0 1\n"
+	"foot.R     shin.R     : AnkleRight    FootRight      0 -0.05 0.12\n";
+
+/**
+ * ns per frame of 6 bodies, solving the bones of a rig one body at a time vs by the vector kernel, which must match.
+ * Bodies are synthetic, mirrored & not, & in world space, as extractBodies() leaves them.  What is solved is checked by
+ * posing the rig back from it; every bone must point along its joints, & turn to its side line.  The rest pose turned
+ * as a whole, half turns included, must come back as that turn of the root, & no turn of any other bone.  Bones must
+ * also survive JSON, & delta mode, through the decoder.  Definitions which do not make sense must not load.
+ */
+int benchRetarget(int nFrames) {
+	static FRAME_DATA frames[SYNTHETIC_FRAMES];
+	static FRAME_DATA work;
+	static FRAME_DATA turned;
+	static FRAME_DATA decoded;
+	static RIG_JOINTS joints[SYNTHETIC_FRAMES];
+	static RIG_ROTATIONS reference;
+	static RIG_ROTATIONS actual;
+	static JOINT_SOA soa;
+	static DELTA_FRAME delta;
+	static char json[FRAME_JSON_SZ];
+	static RIG rig;
+	static RIG bad;
+	if (FAILED(parseRig(BENCH_RIG, &rig))) return 1;
+
+	const char *BAD_RIGS[] = {
+		"arm upper : ShoulderLeft ElbowLeft 0.3 0 0",                                 // parent not defined before it
+		"arm - : ShoulderLeft Elbow 0.3 0 0",                                         // no such joint
+		"arm - : ShoulderLeft ElbowLeft 0 0 0",                                       // no length
+		"arm - : ShoulderLeft ElbowLeft 0.3 0 0 ; side ElbowLeft WristLeft 1 0 0",    // side line along the bone
+		"arm - : ShoulderLeft ElbowLeft 0.3 0 0\narm - : ElbowLeft WristLeft 0.3 0 0" // the same name twice
+	};
+	bool rejected = true;
+	for (unsigned int i = 0; i < _countof(BAD_RIGS); i++) rejected &= parseRig(BAD_RIGS[i], &bad) == E_INVALIDARG;
+
+	float maxError = 0;
+	float worstDegrees = 0;
+	for (int f = 0; f < SYNTHETIC_FRAMES; f++) {
+		generateSyntheticFrame(&frames[f], BODY_COUNT, f);
+
+		// mirrored last, so that is what is timed
+		for (int mirror = 0; mirror < 2; mirror++) {
+			work = frames[f];
+			FRAME_TRANSFORM transform;
+			buildFrameTransform(work.clipPlane, mirror != 0, true, &transform);
+			gatherJoints(&work, &soa);
+			transformJoints(&soa, &transform);
+			scatterJoints(&soa, &work);
+
+			gatherRigJoints(&work, &joints[f]);
+			solveRigScalar(&rig, &joints[f], &reference);
+			solveRig(&rig, &joints[f], &actual);
+			for (int b = 0; b < BODY_COUNT; b++) {
+				for (int i = 0; i < rig.nBones; i++) maxError = std::max(maxError, boneError(&reference, &actual, i, b));
+			}
+			worstDegrees = std::max(worstDegrees, rigDegreesOff(&rig, &joints[f], &actual));
+		}
+	}
+
+	// turns of the rest pose, the first 3 half turns about X, Y & Z; only the root's is local to nothing
+	float rigidError = 0;
+	restRigJoints(&rig, &turned);
+	const FRAME_DATA rest = turned;
+	const float PI = 3.14159265f;
+	for (int t = 0; t < 64; t++) {
+		static RIG_ROTATIONS expected;
+		for (int b = 0; b < BODY_COUNT; b++) {
+			int k = t * BODY_COUNT + b;
+			CameraSpacePoint axis = { k == 0 ? 1.0f : sinf(k * 1.3f), k == 1 ? 1.0f : cosf(k * 0.7f), k == 2 ? 1.0f : sinf(k * 2.9f) + 0.1f };
+			if (k < 3) axis = { k == 0 ? 1.0f : 0, k == 1 ? 1.0f : 0, k == 2 ? 1.0f : 0 };
+			float len = sqrtf(axis.X * axis.X + axis.Y * axis.Y + axis.Z * axis.Z);
+			float half = (k < 3 ? PI : k * 0.61f) / 2;
+			Vector4 turn = { axis.X / len * sinf(half), axis.Y / len * sinf(half), axis.Z / len * sinf(half), cosf(half) };
+
+			turned.bodies[b].id = b + 1;
+			for (int j = 0; j < JointType_Count; j++) {
+				CameraSpacePoint position = rest.bodies[0].joints[j].Position;
+				rotatePoint(turn, &position);
+				turned.bodies[b].joints[j].Position = { position.X + b, position.Y, position.Z + 2 };
+			}
+
+			const Vector4 &frame = rig.bones[0].frame;
+			Vector4 inverseFrame = { -frame.x, -frame.y, -frame.z, frame.w };
+			Vector4 root = multiplyQuaternions(multiplyQuaternions(inverseFrame, turn), frame);
+			for (int i = 0; i < rig.nBones; i++) {
+				expected.local[0][i][b] = i == 0 ? root.x : 0;
+				expected.local[1][i][b] = i == 0 ? root.y : 0;
+				expected.local[2][i][b] = i == 0 ? root.z : 0;
+				expected.local[3][i][b] = i == 0 ? root.w : 1;
+			}
+		}
+		turned.bodyCount = BODY_COUNT;
+
+		static RIG_JOINTS rigid;
+		gatherRigJoints(&turned, &rigid);
+		solveRig(&rig, &rigid, &actual);
+		for (int b = 0; b < BODY_COUNT; b++) {
+			for (int i = 0; i < rig.nBones; i++) rigidError = std::max(rigidError, boneError(&expected, &actual, i, b));
+		}
+	}
+
+	// the last turns, to 3 places, whole & then with nothing changed, when delta mode sends no bones
+	scatterRigBones(&rig, &actual, &turned);
+	DeltaDecoder decoder;
+	decoder.reset();
+	serializeFrameJSON(&turned, json);
+	bool decodes = SUCCEEDED(decoder.apply(json, &decoded)) && decoded.nBones == rig.nBones;
+
+	DeltaEncoder encoder;
+	DELTA_CONFIG config = { 30, 0, 0 };
+	encoder.configure(&config);
+	encoder.reset();
+	for (int pass = 0; pass < 3 && decodes; pass++) {
+		if (pass > 0) {
+			encoder.encode(&turned, &delta);
+			serializeDeltaJSON(&turned, &delta, json);
+			decodes = SUCCEEDED(decoder.apply(json, &decoded)) && decoded.nBones == rig.nBones && (pass == 1) == (strstr(json, "bones") != nullptr);
+		}
+		for (int b = 0; b < BODY_COUNT && decodes; b++) {
+			for (int i = 0; i < rig.nBones; i++) {
+				const Vector4 &a = turned.bones[b][i];
+				const Vector4 &d = decoded.bones[b][i];
+				decodes &= std::abs(a.x - d.x) < 6e-4f && std::abs(a.y - d.y) < 6e-4f && std::abs(a.z - d.z) < 6e-4f && std::abs(a.w - d.w) < 6e-4f;
+			}
+		}
+	}
+
+	Clock::time_point start = Clock::now();
+	for (int f = 0; f < nFrames; f++) solveRigScalar(&rig, &joints[f % SYNTHETIC_FRAMES], &reference);
+	double scalarNs = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+	start = Clock::now();
+	for (int f = 0; f < nFrames; f++) solveRig(&rig, &joints[f % SYNTHETIC_FRAMES], &actual);
+	double ns = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+	bool correct = rejected && maxError < 1e-5f && worstDegrees < 0.01f && rigidError < 1e-4f && decodes;
+	printf("{\"bench\": \"retarget\", \"frames\": %d, \"bodies\": %d, \"bones\": %d, \"kernel\": \"%s\", \"scalarNsPerFrame\": %.1f, \"nsPerFrame\": %.1f, \"speedup\": %.2f, \"maxError\": %g, \"worstDegrees\": %g, \"rigidError\": %g, \"decodes\": %s, \"rejected\": %s, \"correct\": %s}\n",
+		nFrames, BODY_COUNT, rig.nBones, getRetargetKernel(), scalarNs / nFrames, ns / nFrames, scalarNs / ns, maxError, worstDegrees, rigidError,
+		decodes ? "true" : "false", rejected ? "true" : "false", correct ? "true" : "false");
+	return correct ? 0 : 1;
+}
+
+/**
+ * One body of the rig's rest pose, from its SpineBase at the origin; joints which are only at one end of a side line
+ * are put a little along it.
+ */
+void restRigJoints(const RIG *rig, FRAME_DATA *frame) {
+	bool placed[JointType_Count] = { false };
+	memset(frame, 0, sizeof(FRAME_DATA));
+	frame->bodyCount = 1;
+	CameraSpacePoint *positions[JointType_Count];
+	for (int j = 0; j < JointType_Count; j++) positions[j] = &frame->bodies[0].joints[j].Position;
+
+	placed[rig->bones[0].head] = true;
+	for (int i = 0; i < rig->nBones; i++) {
+		const RIG_BONE &bone = rig->bones[i];
+		const CameraSpacePoint &head = *positions[bone.head];
+		*positions[bone.tail] = { head.X + bone.rest[0] * bone.length, head.Y + bone.rest[1] * bone.length, head.Z + bone.rest[2] * bone.length };
+		placed[bone.tail] = true;
+	}
+	for (int i = 0; i < rig->nBones; i++) {
+		const RIG_BONE &bone = rig->bones[i];
+		if (bone.sideFrom < 0 || placed[bone.sideTo]) continue;
+
+		const CameraSpacePoint &from = *positions[bone.sideFrom];
+		*positions[bone.sideTo] = { from.X + bone.restSide[0] * 0.05f, from.Y + bone.restSide[1] * 0.05f, from.Z + bone.restSide[2] * 0.05f };
+	}
+}
+
+/**
+ * Pose the rig back from the local rotations solved.  How far, in degrees, the worst bone of any body then points from
+ * its joints, or what of its side line is across it from what of the joints' is.
+ */
+float rigDegreesOff(const RIG *rig, const RIG_JOINTS *joints, const RIG_ROTATIONS *rotations) {
+	float worst = 0;
+	Vector4 world[RIG_MAX_BONES];
+
+	for (int b = 0; b < joints->nBodies; b++) {
+		for (int i = 0; i < rig->nBones; i++) {
+			const RIG_BONE &bone = rig->bones[i];
+			Vector4 local = { rotations->local[0][i][b], rotations->local[1][i][b], rotations->local[2][i][b], rotations->local[3][i][b] };
+			Vector4 parent = bone.parent >= 0 ? world[bone.parent] : Vector4 { 0, 0, 0, 1 };
+			Vector4 inverseFrame = { -bone.frame.x, -bone.frame.y, -bone.frame.z, bone.frame.w };
+			world[i] = multiplyQuaternions(parent, multiplyQuaternions(multiplyQuaternions(bone.frame, local), inverseFrame));
+
+			CameraSpacePoint aim = { bone.rest[0], bone.rest[1], bone.rest[2] };
+			rotatePoint(world[i], &aim);
+			CameraSpacePoint along = {
+				joints->x[bone.tail][b] - joints->x[bone.head][b],
+				joints->y[bone.tail][b] - joints->y[bone.head][b],
+				joints->z[bone.tail][b] - joints->z[bone.head][b]
+			};
+			worst = std::max(worst, degreesBetween(aim, along));
+			if (bone.sideFrom < 0) continue;
+
+			CameraSpacePoint side = { bone.restSide[0], bone.restSide[1], bone.restSide[2] };
+			rotatePoint(world[i], &side);
+			CameraSpacePoint target = {
+				joints->x[bone.sideTo][b] - joints->x[bone.sideFrom][b],
+				joints->y[bone.sideTo][b] - joints->y[bone.sideFrom][b],
+				joints->z[bone.sideTo][b] - joints->z[bone.sideFrom][b]
+			};
+			float s = aim.X * side.X + aim.Y * side.Y + aim.Z * side.Z;
+			float t = aim.X * target.X + aim.Y * target.Y + aim.Z * target.Z;
+			side = { side.X - aim.X * s, side.Y - aim.Y * s, side.Z - aim.Z * s };
+			target = { target.X - aim.X * t, target.Y - aim.Y * t, target.Z - aim.Z * t };
+			worst = std::max(worst, degreesBetween(side, target));
+		}
+	}
+	return worst;
+}
+
+/**
+ * 0 when either is too short to have a direction.
+ */
+float degreesBetween(const CameraSpacePoint &a, const CameraSpacePoint &b) {
+	CameraSpacePoint c = { a.Y * b.Z - a.Z * b.Y, a.Z * b.X - a.X * b.Z, a.X * b.Y - a.Y * b.X };
+	float lengths = sqrtf((a.X * a.X + a.Y * a.Y + a.Z * a.Z) * (b.X * b.X + b.Y * b.Y + b.Z * b.Z));
+	if (lengths < 1e-3f) return 0;
+	return atan2f(sqrtf(c.X * c.X + c.Y * c.Y + c.Z * c.Z), a.X * b.X + a.Y * b.Y + a.Z * b.Z) * 57.2957795f;
+}
+
+/**
+ * The largest difference of any part of a local rotation, of either sign, as q & -q are the same turn.
+ */
+float boneError(const RIG_ROTATIONS *expected, const RIG_ROTATIONS *actual, int bone, int b) {
+	float same = 0;
+	float opposite = 0;
+	for (int c = 0; c < 4; c++) {
+		same = std::max(same, std::abs(expected->local[c][bone][b] - actual->local[c][bone][b]));
+		opposite = std::max(opposite, std::abs(expected->local[c][bone][b] + actual->local[c][bone][b]));
+	}
+	return std::min(same, opposite);
+}
@@ -0,0 +1,127 @@
+#include "Benchmark.h"
+
+/**
+ * ns per frame from the body thread to the application having every value as a float: formatting JSON & parsing it
+ * back, vs writing the shared frame & the seqlock copy out of it.  Parsing here is only strtof over every number, so
+ * well under what Python's json module costs.  Then a reader copies as fast as it can while a writer fills in frames
+ * whose every joint is the frame #, which catches any torn copy.  Lastly, 30 frames through beginBodyTrackingShared().
+ */
+int benchShared(int nFrames) {
+	static FRAME_DATA frames[SYNTHETIC_FRAMES];
+	static char json[FRAME_JSON_SZ];
+	static float values[FRAME_JSON_SZ / 2];
+	for (int f = 0; f < SYNTHETIC_FRAMES; f++) {
+		generateSyntheticFrame(&frames[f], BODY_COUNT, f);
+	}
+
+	Clock::time_point start = Clock::now();
+	int nValues = 0;
+	for (int f = 0; f < nFrames; f++) {
+		serializeFrameJSON(&frames[f % SYNTHETIC_FRAMES], json);
+		nValues = parseNumbers(json, values);
+	}
+	double jsonNs = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+	static SHARED_FRAME buffer;
+	static SHARED_FRAME copy;
+	SharedFrameWriter writer;
+	writer.open(&buffer);
+
+	start = Clock::now();
+	for (int f = 0; f < nFrames; f++) {
+		writer.write(&frames[f % SYNTHETIC_FRAMES]);
+		readSharedFrame(&buffer, &copy);
+	}
+	double sharedNs = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+	// what was read back must be exactly what was written
+	bool intact = copy.bodyCount == BODY_COUNT;
+	const FRAME_DATA &last = frames[(nFrames - 1) % SYNTHETIC_FRAMES];
+	for (int b = 0; b < BODY_COUNT && intact; b++) {
+		intact = copy.ids[b] == last.bodies[b].id && copy.joints[b][JointType_Head][2] == last.bodies[b].joints[JointType_Head].Position.Y &&
+			copy.joints[b][JointType_Head][7] == last.bodies[b].rotations[JointType_Head].Orientation.w;
+	}
+
+	// torn copies, against a writer on another thread
+	std::atomic<bool> done(false);
+	std::thread producer([&] {
+		static FRAME_DATA frame;
+		frame = frames[0];
+		for (int f = 0; !done; f++) {
+			frame.frame = f;
+			for (int b = 0; b < BODY_COUNT; b++) {
+				for (int j = 0; j < JointType_Count; j++) {
+					frame.bodies[b].joints[j].Position.X = (float) f;
+					frame.bodies[b].rotations[j].Orientation.w = (float) f;
+				}
+			}
+			writer.write(&frame);
+		}
+	});
+
+	// the frame from before the writer started is not one of its frames, so is not checked
+	int reads = 0;
+	int distinct = 0;
+	UINT32 sequence = copy.sequence;
+	UINT32 first = sequence;
+	for (; reads < nFrames * 10; reads++) {
+		UINT32 read = readSharedFrame(&buffer, &copy);
+		if (read != sequence) distinct++;
+		sequence = read;
+		if (read == first) continue;
+
+		for (int b = 0; b < copy.bodyCount; b++) {
+			for (int j = 0; j < JointType_Count; j++) {
+				intact &= copy.joints[b][j][1] == (float) copy.frame && copy.joints[b][j][7] == (float) copy.frame;
+			}
+		}
+	}
+	done = true;
+	producer.join();
+
+	// a waiting reader is woken by the next write
+	sequence = readSharedFrame(&buffer, &copy);
+	std::thread late([&] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		writer.write(&frames[0]);
+	});
+	intact &= writer.wait(sequence, 1000) == sequence + 2;
+	late.join();
+	writer.close();
+
+	// & through the entry points, from a 300 Hz simulation
+	extern FrameSource *frameSource;
+	SimulatedFrameSource source(BODY_COUNT, 300);
+	frameSource = &source;
+	intact &= beginBodyTrackingShared(&buffer, sizeof(buffer) - 1) == E_INVALIDARG && SUCCEEDED(beginBodyTrackingShared(&buffer, sizeof(buffer)));
+	sequence = 0;
+	for (int f = 0; f < 30 && intact; f++) {
+		sequence = waitSharedFrame(sequence, 1000);
+		readSharedFrame(&buffer, &copy);
+		intact = copy.bodyCount == BODY_COUNT && copy.joints[0][JointType_SpineBase][0] == TrackingState_Tracked;
+	}
+	endBodyTracking();
+	frameSource = nullptr;
+
+	printf("{\"bench\": \"shared\", \"frames\": %d, \"bodies\": %d, \"valuesParsed\": %d, \"jsonNsPerFrame\": %.1f, \"sharedNsPerFrame\": %.1f, \"speedup\": %.1f, \"concurrentReads\": %d, \"distinctFrames\": %d, \"intact\": %s}\n",
+		nFrames, BODY_COUNT, nValues, jsonNs / nFrames, sharedNs / nFrames, jsonNs / sharedNs, reads, distinct, intact ? "true" : "false");
+	return intact ? 0 : 1;
+}
+
+/**
+ * Every number in the JSON, as a float, in order.
+ */
+int parseNumbers(const char *json, float *values) {
+	int n = 0;
+	for (const char *p = json; *p != '\0'; ) {
+		if ((*p >= '0' && *p <= '9') || *p == '-') {
+			char *end;
+			values[n++] = strtof(p, &end);
+			p = end;
+
+		} else {
+			p++;
+		}
+	}
+	return n;
+}
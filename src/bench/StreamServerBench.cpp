@@ -0,0 +1,185 @@
+#include "Benchmark.h"
+
+// forward declare of non-external functions
+bool runStream(StreamServer *server, int port, int nClients, int nFrames, bool paced);
+bool checkWebSocket(StreamServer *server, int port);
+
+#define BENCH_STREAM_PORT (STREAM_DEFAULT_PORT + 100) // clear of a -serve which may be running
+
+/**
+ * Load test of the streaming server with 1, 10 & 100 raw TCP clients, plus 1 which never reads, to show it holds no one
+ * up.  First at 30 fps, for latency from broadcast to a client having the whole frame, then as fast as frames can be
+ * made, for throughput.  The WebSocket handshake & framing are checked first.
+ */
+int benchStream(int nFrames) {
+	const int CLIENTS[] = { 1, 10, 100 };
+	StreamServer server(STREAM_QUEUE_FRAMES, FRAME_JSON_SZ);
+
+	if (FAILED(server.start(BENCH_STREAM_PORT, false))) return 1;
+
+	bool identical = checkWebSocket(&server, BENCH_STREAM_PORT + 1);
+	for (unsigned int i = 0; i < _countof(CLIENTS) && identical; i++) {
+		identical &= runStream(&server, BENCH_STREAM_PORT, CLIENTS[i], nFrames, true);
+		identical &= runStream(&server, BENCH_STREAM_PORT, CLIENTS[i], nFrames * 20, false);
+	}
+	server.stop();
+
+	return identical ? 0 : 1;
+}
+
+bool runStream(StreamServer *server, int port, int nClients, int nFrames, bool paced) {
+	static FRAME_DATA frame;
+	static char json[FRAME_JSON_SZ];
+	const int BUFFER_SZ = FRAME_JSON_SZ + 4;
+
+	std::vector<STREAM_SOCKET> sockets;
+	for (int i = 0; i < nClients; i++) sockets.push_back(connectLoopback(port));
+	STREAM_SOCKET stalled = connectLoopback(port);
+
+	STREAM_SERVER_STATS before;
+	for (int wait = 0; wait < 2000; wait++) {
+		server->getStats(&before);
+		if (before.clients == nClients + 1) break;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	if (before.clients != nClients + 1) {
+		std::cerr << "Stream clients did not connect\n";
+		return false;
+	}
+
+	std::vector<Clock::time_point> sendTimes(nFrames);
+	std::vector<double> latencies;
+	std::vector<int> received(nClients, 0);
+	std::atomic<bool> producing(true);
+
+	// every client is read on one thread, reassembling frames from their length prefixes
+	std::thread receiver([&] {
+		std::vector<char> buffers((size_t) nClients * BUFFER_SZ);
+		std::vector<int> have(nClients, 0);
+		bool *readable = new bool[nClients];
+		Clock::time_point lastData = Clock::now();
+
+		while (producing || Clock::now() - lastData < std::chrono::milliseconds(200)) {
+			if (waitReadable(sockets.data(), nClients, readable, 20) == 0) continue;
+			lastData = Clock::now();
+
+			for (int i = 0; i < nClients; i++) {
+				if (!readable[i]) continue;
+
+				char *buffer = &buffers[(size_t) i * BUFFER_SZ];
+				int len = receiveSome(sockets[i], buffer + have[i], BUFFER_SZ - have[i]);
+				if (len <= 0) continue;
+				have[i] += len;
+
+				while (have[i] >= 4) {
+					int frameLen = (unsigned char) buffer[0] | (unsigned char) buffer[1] << 8 | (unsigned char) buffer[2] << 16 | (unsigned char) buffer[3] << 24;
+					if (have[i] < 4 + frameLen) break;
+
+					Clock::time_point now = Clock::now();
+					const char *number = strstr(buffer + 4, "\"frame\": ");
+					int f = number != nullptr ? atoi(number + 9) : -1;
+					if (f >= 0 && f < nFrames) {
+						latencies.push_back((double) std::chrono::duration_cast<std::chrono::nanoseconds>(now - sendTimes[f]).count() / 1000);
+					}
+					received[i]++;
+
+					have[i] -= 4 + frameLen;
+					memmove(buffer, buffer + 4 + frameLen, have[i]);
+				}
+			}
+		}
+		delete[] readable;
+	});
+
+	double maxBroadcastUs = 0;
+	Clock::time_point start = Clock::now();
+	for (int f = 0; f < nFrames; f++) {
+		if (paced) std::this_thread::sleep_until(start + std::chrono::microseconds(33333LL * f));
+
+		generateSyntheticFrame(&frame, BODY_COUNT, f);
+		int len = serializeFrameJSON(&frame, json);
+
+		Clock::time_point sent = Clock::now();
+		sendTimes[f] = sent;
+		server->broadcast(json, len);
+		maxBroadcastUs = std::max(maxBroadcastUs, (double) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - sent).count() / 1000);
+	}
+	double seconds = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count() / 1e6;
+	producing = false;
+	receiver.join();
+
+	STREAM_SERVER_STATS after;
+	server->getStats(&after);
+	for (int i = 0; i < nClients; i++) closeStreamSocket(sockets[i]);
+	closeStreamSocket(stalled);
+
+	long long total = 0;
+	int fewest = nFrames;
+	for (int i = 0; i < nClients; i++) {
+		total += received[i];
+		fewest = std::min(fewest, received[i]);
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+	double p50 = latencies.empty() ? 0 : latencies[latencies.size() / 2];
+	double p99 = latencies.empty() ? 0 : latencies[latencies.size() * 99 / 100];
+	double worst = latencies.empty() ? 0 : latencies.back();
+
+	// at 30 fps, no client which keeps reading should miss a frame, whatever the stalled one does
+	bool identical = !paced || fewest == nFrames;
+	printf("{\"bench\": \"stream\", \"clients\": %d, \"stalledClients\": 1, \"paced\": %s, \"frames\": %d, \"fewestReceived\": %d, \"framesPerSecondPerClient\": %.1f, \"mbPerSecond\": %.1f, \"p50Us\": %.1f, \"p99Us\": %.1f, \"maxUs\": %.1f, \"maxBroadcastUs\": %.1f, \"dropped\": %llu, \"identical\": %s}\n",
+		nClients, paced ? "true" : "false", nFrames, fewest, total / (double) nClients / seconds, (after.bytesSent - before.bytesSent) / seconds / 1e6,
+		p50, p99, worst, maxBroadcastUs, after.framesDropped - before.framesDropped, identical ? "true" : "false");
+	return identical;
+}
+
+/**
+ * Upgrade a connection with the example key of RFC 6455, & check a frame comes back whole, as a text message.
+ */
+bool checkWebSocket(StreamServer *server, int port) {
+	static FRAME_DATA frame;
+	static char json[FRAME_JSON_SZ];
+	static char reply[FRAME_JSON_SZ + STREAM_FRAME_HEADER_SZ];
+	const char REQUEST[] = "GET / HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+		"Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+	const char ACCEPT[] = "Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n";
+
+	STREAM_SOCKET socket = connectLoopback(port);
+	if (socket == (STREAM_SOCKET) -1) return false;
+	sendSome(socket, REQUEST, sizeof(REQUEST) - 1);
+
+	// read until the end of the reply, then the message, which is sent only once upgraded
+	int have = 0;
+	bool readable;
+	const char *end = nullptr;
+	bool broadcast = false;
+	int expectedLen = 0;
+	for (int wait = 0; wait < 100; wait++) {
+		if (waitReadable(&socket, 1, &readable, 20) > 0) {
+			int len = receiveSome(socket, reply + have, (int) sizeof(reply) - 1 - have);
+			if (len < 0) break;
+			have += len;
+			reply[have] = '\0';
+		}
+
+		if (end == nullptr) end = strstr(reply, "\r\n\r\n");
+		if (end != nullptr && !broadcast) {
+			generateSyntheticFrame(&frame, BODY_COUNT, 0);
+			expectedLen = serializeFrameJSON(&frame, json);
+			server->broadcast(json, expectedLen);
+			broadcast = true;
+		}
+		if (end != nullptr && have - (end + 4 - reply) >= 4 + expectedLen) break;
+	}
+	closeStreamSocket(socket);
+
+	bool identical = end != nullptr && strstr(reply, ACCEPT) != nullptr;
+	if (identical) {
+		const unsigned char *message = (const unsigned char *) end + 4;
+		int len = message[2] << 8 | message[3];
+		identical = message[0] == 0x81 && message[1] == 126 && len == expectedLen && memcmp(message + 4, json, len) == 0;
+	}
+
+	printf("{\"bench\": \"stream\", \"webSocket\": %s}\n", identical ? "true" : "false");
+	return identical;
+}
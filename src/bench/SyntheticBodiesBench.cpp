@@ -0,0 +1,192 @@
+#include "Benchmark.h"
+
+// forward declare of non-external functions
+float boneLengthChange(const SYNTHETIC_CONFIG *config, int nFrames);
+bool runLatency(const SYNTHETIC_CONFIG *config, int hz, int nFrames);
+
+/**
+ * CPU time of the whole process, user & kernel, in seconds.
+ */
+/**
+ * Checks of generateSyntheticBodies(): the same config gives the same frames, & another seed others; each motion keeps
+ * the lengths of bones; noise is within bounds; joints & bodies drop out at about the rates asked for, bodies keeping
+ * their ids, & never in the first second.  Then ns per frame of 6 bodies of each motion, with noise & dropouts.
+ */
+int benchSynthetic(int nFrames) {
+	static FRAME_DATA a, b;
+	const SYNTHETIC_CONFIG NOISY = { BODY_COUNT, SyntheticMotion_Circle, 0.01f, 0.1f, 0.2f, 17 };
+
+	bool deterministic = true;
+	for (int f = 0; f < 300 && deterministic; f += 7) {
+		generateSyntheticBodies(&a, &NOISY, f);
+		generateSyntheticBodies(&b, &NOISY, f);
+		deterministic = memcmp(&a, &b, sizeof(a)) == 0;
+	}
+	SYNTHETIC_CONFIG reseeded = NOISY;
+	reseeded.seed++;
+	generateSyntheticBodies(&b, &reseeded, 299);
+	deterministic &= memcmp(&a, &b, sizeof(a)) != 0;
+
+	// the default, so the frames of earlier benchmarks are the same as they always were
+	SYNTHETIC_CONFIG swing = { BODY_COUNT, SyntheticMotion_Swing, 0, 0, 0, 0 };
+	generateSyntheticFrame(&a, BODY_COUNT, 123);
+	generateSyntheticBodies(&b, &swing, 123);
+	deterministic &= memcmp(&a, &b, sizeof(a)) == 0;
+
+	// swinging moves each arm joint as if it hung straight below the shoulder, so only it stretches bones, a little
+	bool rigid = true;
+	for (int m = 0; m < SyntheticMotion_Count; m++) {
+		SYNTHETIC_CONFIG moving = { BODY_COUNT, (SyntheticMotion) m, 0, 0, 0, 0 };
+		float change = boneLengthChange(&moving, 300);
+		rigid &= change < (m == SyntheticMotion_Swing ? 0.02f : 0.001f);
+		printf("{\"bench\": \"synthetic\", \"motion\": \"%s\", \"maxBoneChangeMm\": %.2f}\n", SYNTHETIC_MOTIONS[m], change * 1000);
+	}
+
+	// noise against the same frame without
+	SYNTHETIC_CONFIG clean = NOISY;
+	clean.noiseMeters = 0;
+	float maxNoise = 0;
+	for (int f = 0; f < 300; f += 11) {
+		generateSyntheticBodies(&a, &NOISY, f);
+		generateSyntheticBodies(&b, &clean, f);
+		for (int i = 0; i < a.bodyCount; i++) {
+			for (int j = 0; j < JointType_Count; j++) {
+				const CameraSpacePoint &noisy = a.bodies[i].joints[j].Position;
+				const CameraSpacePoint &exact = b.bodies[i].joints[j].Position;
+				maxNoise = std::max(maxNoise, std::max(fabsf(noisy.X - exact.X), std::max(fabsf(noisy.Y - exact.Y), fabsf(noisy.Z - exact.Z))));
+			}
+		}
+	}
+	bool noisy = maxNoise > NOISY.noiseMeters * 0.9f && maxNoise <= NOISY.noiseMeters * 1.001f;
+
+	// rates over many spans; the hand tip & thumb always inferred are left out
+	const int DROPOUT_FRAMES = 30000;
+	long long nJoints = 0, nNotTracked = 0, nInferred = 0, nBodies = 0, nPresent = 0;
+	bool firstSecond = true, idsKept = true;
+	for (int f = 0; f < DROPOUT_FRAMES; f++) {
+		generateSyntheticBodies(&a, &NOISY, f);
+		if (f < 30) firstSecond &= a.bodyCount == BODY_COUNT;
+		else {
+			nBodies += BODY_COUNT;
+			nPresent += a.bodyCount;
+		}
+
+		for (int i = 0; i < a.bodyCount; i++) {
+			if (i > 0) idsKept &= a.bodies[i].id > a.bodies[i - 1].id && a.bodies[i].id - a.bodies[0].id < BODY_COUNT;
+			for (int j = 0; j < JointType_Count; j++) {
+				if (j == JointType_HandTipLeft || j == JointType_ThumbRight) continue;
+				nJoints++;
+				if (a.bodies[i].joints[j].TrackingState == TrackingState_NotTracked) nNotTracked++;
+				if (a.bodies[i].joints[j].TrackingState == TrackingState_Inferred) nInferred++;
+			}
+		}
+	}
+	float notTrackedRate = (float) nNotTracked / nJoints;
+	float inferredRate = (float) nInferred / nJoints;
+	float missingRate = 1 - (float) nPresent / nBodies;
+	bool dropsOut = firstSecond && idsKept && fabsf(notTrackedRate - NOISY.jointDropout) < 0.01f &&
+		fabsf(inferredRate - NOISY.jointDropout) < 0.01f && fabsf(missingRate - NOISY.bodyDropout) < 0.02f;
+
+	bool correct = deterministic && rigid && noisy && dropsOut;
+	printf("{\"bench\": \"synthetic\", \"maxNoiseMm\": %.2f, \"notTrackedRate\": %.3f, \"inferredRate\": %.3f, \"missingRate\": %.3f, \"deterministic\": %s, \"rigid\": %s, \"noisy\": %s, \"dropsOut\": %s, \"correct\": %s}\n",
+		maxNoise * 1000, notTrackedRate, inferredRate, missingRate, deterministic ? "true" : "false", rigid ? "true" : "false",
+		noisy ? "true" : "false", dropsOut ? "true" : "false", correct ? "true" : "false");
+
+	for (int m = 0; m < SyntheticMotion_Count; m++) {
+		SYNTHETIC_CONFIG timed = NOISY;
+		timed.motion = (SyntheticMotion) m;
+		Clock::time_point start = Clock::now();
+		for (int f = 0; f < nFrames; f++) {
+			generateSyntheticBodies(&a, &timed, f);
+		}
+		double ns = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+		printf("{\"bench\": \"synthetic\", \"motion\": \"%s\", \"frames\": %d, \"bodies\": %d, \"nsPerFrame\": %.1f}\n",
+			SYNTHETIC_MOTIONS[m], nFrames, BODY_COUNT, ns / nFrames);
+	}
+	return correct ? 0 : 1;
+}
+
+/**
+ * Most any bone of any body is longer or shorter, in meters, than standing still, over the first frames of a config.
+ */
+float boneLengthChange(const SYNTHETIC_CONFIG *config, int nFrames) {
+	static FRAME_DATA rest, moved;
+	SYNTHETIC_CONFIG still = *config;
+	still.motion = SyntheticMotion_Rest;
+	generateSyntheticBodies(&rest, &still, 0);
+
+	float change = 0;
+	for (int f = 0; f < nFrames; f++) {
+		generateSyntheticBodies(&moved, config, f);
+		for (int i = 0; i < moved.bodyCount; i++) {
+			for (int j = 1; j < JointType_Count; j++) {
+				float length[2];
+				const FRAME_DATA *frames[2] = { &rest, &moved };
+				for (int k = 0; k < 2; k++) {
+					const CameraSpacePoint &joint = frames[k]->bodies[i].joints[j].Position;
+					const CameraSpacePoint &parent = frames[k]->bodies[i].joints[JOINT_PARENTS[j]].Position;
+					length[k] = sqrtf((joint.X - parent.X) * (joint.X - parent.X) + (joint.Y - parent.Y) * (joint.Y - parent.Y) +
+						(joint.Z - parent.Z) * (joint.Z - parent.Z));
+				}
+				change = std::max(change, fabsf(length[1] - length[0]));
+			}
+		}
+	}
+	return change;
+}
+
+/**
+ * End to end latency of each synthetic motion, from when a frame is due on the simulated sensor's clock to the
+ * application having its JSON from waitFrame(), with noise & dropouts, as a sensor would give.  Frames must arrive in
+ * order, with none lost but those with every body dropped out.
+ */
+int benchLatency(int nFrames) {
+	bool correct = true;
+	for (int m = 0; m < SyntheticMotion_Count; m++) {
+		SYNTHETIC_CONFIG config = { BODY_COUNT, (SyntheticMotion) m, 0.003f, 0.05f, 0.05f, 1 };
+		correct &= runLatency(&config, 120, nFrames);
+	}
+	return correct ? 0 : 1;
+}
+
+bool runLatency(const SYNTHETIC_CONFIG *config, int hz, int nFrames) {
+	extern FrameSource *frameSource;
+	static char json[FRAME_JSON_SZ];
+	static LatencyHistogram histogram;
+	SimulatedFrameSource source(config, hz);
+	frameSource = &source;
+	histogram.reset();
+	Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(1000000000LL / hz));
+
+	bool correct = SUCCEEDED(beginBodyTrackingPolled('J', 'B'));
+	Clock::time_point startTime = source.getStartTime();
+	int received = 0;
+	int last = -1;
+	while (correct && last < nFrames - 1) {
+		if (waitFrame(json, sizeof(json), 1000) <= 0) {
+			correct = false;
+			break;
+		}
+		Clock::time_point now = Clock::now();
+
+		// the body thread numbers frames from the first with a body, which is always the first of a synthetic sensor
+		const char *number = strstr(json, "\"frame\": ");
+		int f = number != nullptr ? atoi(number + 9) : -1;
+		correct = f > last;
+		last = f;
+		received++;
+		histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - (startTime + period * (f + 1))).count());
+	}
+	endBodyTracking();
+	frameSource = nullptr;
+
+	// every body is missing together rarely enough at 5%, so all but a few frames must arrive
+	correct &= received >= nFrames * 9 / 10;
+
+	STAGE_STATS latency;
+	histogram.getStats(&latency);
+	printf("{\"bench\": \"latency\", \"motion\": \"%s\", \"hz\": %d, \"bodies\": %d, \"frames\": %d, \"received\": %d, \"p50Us\": %.1f, \"p99Us\": %.1f, \"maxUs\": %.1f, \"correct\": %s}\n",
+		SYNTHETIC_MOTIONS[config->motion], hz, config->nBodies, nFrames, received, latency.p50Us, latency.p99Us, latency.maxUs,
+		correct ? "true" : "false");
+	return correct;
+}
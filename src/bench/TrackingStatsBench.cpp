@@ -0,0 +1,59 @@
+#include "Benchmark.h"
+
+/**
+ * ns per stage timed, that drops are counted from gaps in jittery times, & that percentiles are within a bucket of the
+ * truth.  Then the stats of actually tracking a 300 Hz simulation of 6 bodies, polled, through the entry points.
+ */
+int benchStats(int nFrames) {
+	const int TIMINGS = 1000000;
+	resetTrackingStats();
+	UINT64 start = stageClock();
+	for (int i = 0; i < TIMINGS; i++) {
+		start = endStage(TrackingStage_Acquire, start);
+	}
+	TRACKING_STATS stats;
+	getTrackingStats(&stats);
+	double timingNs = stats.stages[TrackingStage_Acquire].meanUs * 1000.0;
+
+	// every 7th frame missing, & 3 together every 50th, with a tenth of a frame of jitter
+	resetTrackingStats();
+	int expectedDrops = 0;
+	for (int f = 0; f < 10000; f++) {
+		if (f % 7 == 6 || (f % 50 >= 20 && f % 50 < 23)) {
+			if (f > 0) expectedDrops++;
+			continue;
+		}
+		countFrameAcquired(f * 333333LL + (f % 3 - 1) * 30000);
+	}
+	getTrackingStats(&stats);
+	bool correct = (int) stats.framesDropped == expectedDrops;
+
+	// 1 to 1000 us, evenly
+	LatencyHistogram histogram;
+	for (int us = 1; us <= 1000; us++) {
+		histogram.record(us * 1000ULL);
+	}
+	STAGE_STATS known;
+	histogram.getStats(&known);
+	correct &= known.count == 1000 && known.p50Us >= 500 && known.p50Us < 500 * 1.25f && known.p99Us >= 990 && known.p99Us <= 1000 && known.maxUs == 1000;
+
+	printf("{\"bench\": \"stats\", \"nsPerStageTimed\": %.1f, \"dropsCounted\": %llu, \"dropsExpected\": %d, \"p50Us\": %.1f, \"p99Us\": %.1f, \"correct\": %s}\n",
+		timingNs, stats.framesDropped, expectedDrops, known.p50Us, known.p99Us, correct ? "true" : "false");
+
+	// the whole pipeline, as an application would see it
+	extern FrameSource *frameSource;
+	SimulatedFrameSource source(BODY_COUNT, 300);
+	frameSource = &source;
+	static char frame[FRAME_JSON_SZ];
+	beginBodyTrackingPolled('J', 'D');
+	for (int received = 0; received < nFrames; ) {
+		if (waitFrame(frame, sizeof(frame), 100) > 0) received++;
+	}
+	endBodyTracking();
+	frameSource = nullptr;
+
+	char json[2048];
+	getTrackingStatsJSON(json, sizeof(json));
+	printf("{\"bench\": \"stats\", \"hz\": 300, \"bodies\": %d, \"tracking\": %s}\n", BODY_COUNT, json);
+	return correct ? 0 : 1;
+}
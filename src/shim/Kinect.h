@@ -0,0 +1,128 @@
+#pragma once
+
+// Stands in for Kinect.h of the Kinect for Windows SDK 2.0, when built on another platform with CMake.  The body types
+// are laid out as the SDK's, so recordings are the same; the interfaces are declared, but GetDefaultKinectSensor() in
+// KinectShim.cpp never finds a sensor.  Synthetic, replayed & merged sources work as on Windows.
+#include <SDKDDKVer.h>
+
+#define BODY_COUNT 6
+
+typedef INT64 TIMESPAN;         // 100ns ticks
+typedef intptr_t WAITABLE_HANDLE;
+
+typedef struct _Vector4 {
+	float x;
+	float y;
+	float z;
+	float w;
+} Vector4;
+
+typedef struct _CameraSpacePoint {
+	float X;
+	float Y;
+	float Z;
+} CameraSpacePoint;
+
+enum _JointType {
+	JointType_SpineBase = 0,
+	JointType_SpineMid = 1,
+	JointType_Neck = 2,
+	JointType_Head = 3,
+	JointType_ShoulderLeft = 4,
+	JointType_ElbowLeft = 5,
+	JointType_WristLeft = 6,
+	JointType_HandLeft = 7,
+	JointType_ShoulderRight = 8,
+	JointType_ElbowRight = 9,
+	JointType_WristRight = 10,
+	JointType_HandRight = 11,
+	JointType_HipLeft = 12,
+	JointType_KneeLeft = 13,
+	JointType_AnkleLeft = 14,
+	JointType_FootLeft = 15,
+	JointType_HipRight = 16,
+	JointType_KneeRight = 17,
+	JointType_AnkleRight = 18,
+	JointType_FootRight = 19,
+	JointType_SpineShoulder = 20,
+	JointType_HandTipLeft = 21,
+	JointType_ThumbLeft = 22,
+	JointType_HandTipRight = 23,
+	JointType_ThumbRight = 24,
+	JointType_Count = (JointType_ThumbRight + 1)
+};
+typedef enum _JointType JointType;
+
+enum _TrackingState {
+	TrackingState_NotTracked = 0,
+	TrackingState_Inferred = 1,
+	TrackingState_Tracked = 2
+};
+typedef enum _TrackingState TrackingState;
+
+enum _HandState {
+	HandState_Unknown = 0,
+	HandState_NotTracked = 1,
+	HandState_Open = 2,
+	HandState_Closed = 3,
+	HandState_Lasso = 4
+};
+typedef enum _HandState HandState;
+
+typedef struct _Joint {
+	enum _JointType JointType; // the enums named, as the members hide their typedefs
+	CameraSpacePoint Position;
+	enum _TrackingState TrackingState;
+} Joint;
+
+typedef struct _JointOrientation {
+	enum _JointType JointType;
+	Vector4 Orientation;
+} JointOrientation;
+
+// only the methods called, in place of the COM interfaces
+struct IUnknown {
+	virtual unsigned long Release() = 0;
+};
+
+struct IBody : public IUnknown {
+	virtual HRESULT GetJoints(UINT capacity, Joint *joints) = 0;
+	virtual HRESULT GetJointOrientations(UINT capacity, JointOrientation *jointOrientations) = 0;
+	virtual HRESULT get_IsTracked(BOOLEAN *tracked) = 0;
+	virtual HRESULT get_TrackingId(UINT64 *trackingId) = 0;
+	virtual HRESULT get_HandLeftState(HandState *handState) = 0;
+	virtual HRESULT get_HandRightState(HandState *handState) = 0;
+};
+
+struct IBodyFrame : public IUnknown {
+	virtual HRESULT get_FloorClipPlane(Vector4 *floorClipPlane) = 0;
+	virtual HRESULT GetAndRefreshBodyData(UINT capacity, IBody **bodies) = 0;
+	virtual HRESULT get_RelativeTime(TIMESPAN *relativeTime) = 0;
+};
+
+struct IBodyFrameReference : public IUnknown {
+	virtual HRESULT AcquireFrame(IBodyFrame **bodyFrame) = 0;
+};
+
+struct IBodyFrameArrivedEventArgs : public IUnknown {
+	virtual HRESULT get_FrameReference(IBodyFrameReference **bodyFrameReference) = 0;
+};
+
+struct IBodyFrameReader : public IUnknown {
+	virtual HRESULT AcquireLatestFrame(IBodyFrame **bodyFrame) = 0;
+	virtual HRESULT SubscribeFrameArrived(WAITABLE_HANDLE *waitableHandle) = 0;
+	virtual HRESULT UnsubscribeFrameArrived(WAITABLE_HANDLE waitableHandle) = 0;
+	virtual HRESULT GetFrameArrivedEventData(WAITABLE_HANDLE waitableHandle, IBodyFrameArrivedEventArgs **eventData) = 0;
+};
+
+struct IBodyFrameSource : public IUnknown {
+	virtual HRESULT OpenReader(IBodyFrameReader **reader) = 0;
+};
+
+struct IKinectSensor : public IUnknown {
+	virtual HRESULT Open() = 0;
+	virtual HRESULT Close() = 0;
+	virtual HRESULT get_BodyFrameSource(IBodyFrameSource **bodyFrameSource) = 0;
+};
+
+HRESULT GetDefaultKinectSensor(IKinectSensor **defaultKinectSensor);
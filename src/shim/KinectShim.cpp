@@ -0,0 +1,9 @@
+#include "KinectToJSON.h"
+
+/**
+ * There is no Kinect runtime off Windows, so openSensor() & addSensorSource() fail as they would with none plugged in.
+ */
+HRESULT GetDefaultKinectSensor(IKinectSensor **defaultKinectSensor) {
+	*defaultKinectSensor = nullptr;
+	return E_FAIL;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+// Stands in for the Windows SDK, when built on another platform with CMake: the types, HRESULTs, & the few CRT & Win32
+// calls used outside of the sensor, mapped to their standard equivalents.  Not used by the Visual Studio project.
+#include <stdint.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stddef.h>
+
+#define __declspec(x) __attribute__((visibility("default")))
+#define __stdcall
+
+typedef int32_t HRESULT;
+typedef int32_t LONG;
+typedef int32_t INT32;
+typedef uint32_t UINT32;
+typedef uint32_t DWORD;
+typedef int16_t INT16;
+typedef uint16_t UINT16;
+typedef long long INT64; // as on Windows, so %lld & %llu fit them on LP64 too
+typedef unsigned long long UINT64;
+typedef unsigned int UINT;
+typedef unsigned char BYTE;
+typedef unsigned char BOOLEAN;
+typedef int BOOL;
+typedef void *HANDLE;
+
+#define TRUE 1
+#define FALSE 0
+
+#define S_OK ((HRESULT) 0L)
+#define S_FALSE ((HRESULT) 1L)
+#define E_ABORT ((HRESULT) 0x80004004L)
+#define E_FAIL ((HRESULT) 0x80004005L)
+#define E_POINTER ((HRESULT) 0x80004003L)
+#define E_PENDING ((HRESULT) 0x8000000AL)
+#define E_OUTOFMEMORY ((HRESULT) 0x8007000EL)
+#define E_INVALIDARG ((HRESULT) 0x80070057L)
+#define SUCCEEDED(hr) (((HRESULT) (hr)) >= 0)
+#define FAILED(hr) (((HRESULT) (hr)) < 0)
+
+#define _countof(array) (sizeof(array) / sizeof(array[0]))
+
+// the secure CRT; buffer sizes are checked the same way, by truncating
+template<size_t N> inline int sprintf_s(char (&buffer)[N], const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(buffer, N, format, args);
+	va_end(args);
+	return len;
+}
+
+inline int sprintf_s(char *buffer, size_t bufferSz, const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(buffer, bufferSz, format, args);
+	va_end(args);
+	return len;
+}
+
+// only ever a string, read up to its width
+#define scanf_s(format, buffer, bufferSz) scanf(format, buffer)
+
+inline int fopen_s(FILE **file, const char *path, const char *mode) {
+	*file = fopen(path, mode);
+	return *file != nullptr ? 0 : 1;
+}
+
+// no sound, when the number of bodies changes
+#define MB_OK 0
+inline BOOL MessageBeep(UINT) {
+	return TRUE;
+}
+
+// events, only for the sensor's frame source, which never starts as there is no sensor
+#define INFINITE 0xFFFFFFFF
+#define WAIT_OBJECT_0 0
+#define WAIT_FAILED 0xFFFFFFFF
+
+inline HANDLE CreateEvent(void *, BOOL, BOOL, const char *) {
+	return nullptr;
+}
+
+inline BOOL SetEvent(HANDLE) {
+	return FALSE;
+}
+
+inline BOOL CloseHandle(HANDLE) {
+	return TRUE;
+}
+
+inline DWORD WaitForMultipleObjects(DWORD, const HANDLE *, BOOL, DWORD) {
+	return WAIT_FAILED;
+}